@@ -0,0 +1,64 @@
+#include "AgentxPeer.h"
+#include "Agentx/Protocol.h"
+#include "Api.h"
+#include "Client.h"
+#include <time.h>
+
+/*
+ * Throughput of the AgentX codec: GETNEXTs of ten varbinds encoded, sent,
+ * decoded and answered by a responder on the other end of a socket pair,
+ * as master and subagent would
+ */
+static void
+_Bench_agentxRoundTrip( int rounds )
+{
+    static const oid from[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 3 };
+    static const oid to[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 4 };
+    Types_Session session;
+    Types_Pdu* pdu;
+    u_char* buf = NULL;
+    size_t bufSize = 0;
+    struct timespec start, end;
+    double seconds;
+    int fd, i;
+    Types_PidT pid;
+    bool ok = true;
+
+    pid = AgentxPeer_start( &fd );
+    if ( pid < 0 ) {
+        printf( "AgentX round trip: cannot start the responder\n" );
+        return;
+    }
+
+    memset( &session, 0, sizeof( session ) );
+    session.version = AGENTX_VERSION_1;
+    pdu = Client_pduCreate( AGENTX_MSG_GETNEXT );
+    pdu->version = AGENTX_VERSION_1;
+    pdu->flags = AGENTX_FLAGS_NETWORK_BYTE_ORDER;
+    pdu->sessid = 7;
+    for ( i = 0; i < 10; i++ )
+        Api_pduAddVariable( pdu, from, 11, asnPRIV_EXCL_RANGE, to, sizeof( to ) );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for ( i = 0; ok && i < rounds; i++ ) {
+        pdu->transid = pdu->reqid = i;
+        ok = AgentxPeer_roundTrip( fd, &session, pdu, &buf, &bufSize );
+    }
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    AgentxPeer_stop( fd, pid );
+    Api_freePdu( pdu );
+    free( buf );
+
+    seconds = ( end.tv_sec - start.tv_sec ) + ( end.tv_nsec - start.tv_nsec ) / 1e9;
+    if ( ok )
+        printf( "AgentX round trip: %d of 10 varbinds, %.0f/s\n", rounds, rounds / seconds );
+    else
+        printf( "AgentX round trip: failed after %d\n", i );
+}
+
+int main()
+{
+    _Bench_agentxRoundTrip( 20000 );
+
+    return 0;
+}
@@ -4111,6 +4111,7 @@ _Api_sessAsyncSend( void* sessp,
     case PRIOT_MSG_TRAP2:
     case PRIOT_MSG_REPORT:
     case AGENTX_MSG_CLEANUPSET:
+    case AGENTX_MSG_CACHE_PUSH:
     case AGENTX_MSG_RESPONSE:
         pdu->flags &= ~PRIOT_UCD_MSG_FLAG_EXPECT_RESPONSE;
         break;
@@ -26,6 +26,7 @@ SOURCES += \
     System/Containers/ContainerListSsll.c \
     System/Containers/ContainerNull.c \
     System/Containers/MapList.c \
+    System/Containers/ContainerSync.c \
     System/Util/Logger.c \
     System/Util/Utilities.c \
     System/Util/Alarm.c \
@@ -40,6 +41,7 @@ SOURCES += \
     Transports/UDPDomain.c \
     Transports/UDPIPv4BaseDomain.c \
     Transports/UnixDomain.c \
+    Transports/ShmDomain.c \
     Transports/CallbackDomain.c \
     System/String.c \
     Api.c \
@@ -71,6 +73,7 @@ SOURCES += \
     System/Containers/List.c \
     System/Util/VariableList.c \
     System/Util/FileParser.c \
+    System/Util/ProcFile.c \
     TextualConvention.c \
     System/Util/Trace.c \
     System/Security/Engine.c \
@@ -91,6 +94,7 @@ HEADERS += \
     System/Containers/ContainerListSsll.h \
     System/Containers/ContainerNull.h \
     System/Containers/MapList.h \
+    System/Containers/ContainerSync.h \
     System/Util/Logger.h \
     System/Util/Utilities.h \
     System/Util/Assert.h \
@@ -110,6 +114,7 @@ HEADERS += \
     Transports/TCPDomain.h \
     Transports/UDPDomain.h \
     Transports/UnixDomain.h \
+    Transports/ShmDomain.h \
     Transports/AliasDomain.h \
     Transports/CallbackDomain.h \
     DataType.h \
@@ -141,6 +146,7 @@ HEADERS += \
     System/Containers/List.h \
     System/Util/VariableList.h \
     System/Util/FileParser.h \
+    System/Util/ProcFile.h \
     TextualConvention.h \
     System/Util/Trace.h \
     System/Security/Engine.h \
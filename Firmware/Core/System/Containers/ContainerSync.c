@@ -0,0 +1,161 @@
+#include "ContainerSync.h"
+#include "System/Util/Assert.h"
+#include "System/Util/Logger.h"
+#include "System/Util/Trace.h"
+#include "System/Util/Utilities.h"
+
+#define _CONTAINERSYNC_GENERATION( sync, entry ) \
+    ( ( u_int* )( ( char* )( entry ) + ( sync )->generationOffset ) )
+
+/** the entries not seen during a pass, collected before removal
+ *  (a container can't be changed while walking it) */
+typedef struct ContainerSyncStale_s {
+    ContainerSync* sync;
+    void** entries;
+    size_t count;
+    size_t size;
+    int failed; /* out of memory: not all of them could be collected */
+} ContainerSyncStale;
+
+void ContainerSync_init( ContainerSync* sync, Container_Container* container,
+    size_t generationOffset, ContainerSyncCreate_f* create,
+    ContainerSyncUpdate_f* update, Container_FuncObjFunc* release,
+    void* context )
+{
+    Assert_assert( NULL != sync && NULL != container );
+
+    memset( sync, 0, sizeof( *sync ) );
+    sync->container = container;
+    sync->generationOffset = generationOffset;
+    sync->create = create;
+    sync->update = update;
+    sync->release = release;
+    sync->context = context;
+}
+
+void ContainerSync_begin( ContainerSync* sync )
+{
+    /*
+     * 0 is the stamp of entries which were never synchronized
+     */
+    if ( 0 == ++sync->generation )
+        ++sync->generation;
+
+    sync->unchanged = sync->updated = sync->inserted = sync->deleted = 0;
+}
+
+int ContainerSync_row( ContainerSync* sync, const void* key, const void* row )
+{
+    void* entry;
+    int rc;
+
+    entry = CONTAINER_FIND( sync->container, key );
+    if ( NULL != entry ) {
+        if ( *_CONTAINERSYNC_GENERATION( sync, entry ) == sync->generation ) {
+            DEBUG_MSGTL( ( "containerSync", "duplicate row in %s\n",
+                sync->container->containerName ? sync->container->containerName : "" ) );
+            return ErrorCode_GENERR;
+        }
+        *_CONTAINERSYNC_GENERATION( sync, entry ) = sync->generation;
+
+        rc = sync->update( entry, row, sync->context );
+        if ( rc < 0 )
+            return ErrorCode_GENERR;
+        if ( rc > 0 )
+            ++sync->updated;
+        else
+            ++sync->unchanged;
+        return ErrorCode_SUCCESS;
+    }
+
+    entry = sync->create( row, sync->context );
+    if ( NULL == entry )
+        return ErrorCode_GENERR;
+    *_CONTAINERSYNC_GENERATION( sync, entry ) = sync->generation;
+
+    if ( CONTAINER_INSERT( sync->container, entry ) ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "containerSync: could not insert entry\n" );
+        sync->release( entry, sync->context );
+        return ErrorCode_GENERR;
+    }
+    ++sync->inserted;
+
+    return ErrorCode_SUCCESS;
+}
+
+static void
+_ContainerSync_collectStale( void* entry, void* context )
+{
+    ContainerSyncStale* stale = ( ContainerSyncStale* )context;
+    void** entries;
+
+    if ( stale->failed
+        || *_CONTAINERSYNC_GENERATION( stale->sync, entry ) == stale->sync->generation )
+        return;
+
+    if ( stale->count == stale->size ) {
+        entries = ( void** )realloc( stale->entries,
+            ( stale->size ? stale->size * 2 : 16 ) * sizeof( void* ) );
+        if ( NULL == entries ) {
+            stale->failed = 1;
+            return;
+        }
+        stale->size = stale->size ? stale->size * 2 : 16;
+        stale->entries = entries;
+    }
+    stale->entries[ stale->count++ ] = entry;
+}
+
+size_t ContainerSync_end( ContainerSync* sync )
+{
+    ContainerSyncStale stale;
+    size_t i;
+
+    memset( &stale, 0, sizeof( stale ) );
+    stale.sync = sync;
+
+    /*
+     * nothing can be missing if every entry was seen
+     */
+    if ( CONTAINER_SIZE( sync->container ) > sync->unchanged + sync->updated + sync->inserted )
+        CONTAINER_FOR_EACH( sync->container, _ContainerSync_collectStale, &stale );
+
+    if ( stale.failed ) {
+        /*
+         * the stale entries can't all be found again: rather than keep
+         * some of them, start over with the next pass
+         */
+        Logger_log( LOGGER_PRIORITY_ERR, "containerSync: %s: malloc failed, clearing it\n",
+            sync->container->containerName ? sync->container->containerName : "" );
+        MEMORY_FREE( stale.entries );
+        sync->deleted = CONTAINER_SIZE( sync->container );
+        CONTAINER_CLEAR( sync->container, sync->release, sync->context );
+        return sync->deleted;
+    }
+
+    for ( i = 0; i < stale.count; ++i ) {
+        CONTAINER_REMOVE( sync->container, stale.entries[ i ] );
+        sync->release( stale.entries[ i ], sync->context );
+    }
+    MEMORY_FREE( stale.entries );
+    sync->deleted = stale.count;
+
+    DEBUG_MSGTL( ( "containerSync", "%s: %lu unchanged, %lu updated, %lu new, %lu deleted\n",
+        sync->container->containerName ? sync->container->containerName : "",
+        ( u_long )sync->unchanged, ( u_long )sync->updated,
+        ( u_long )sync->inserted, ( u_long )sync->deleted ) );
+
+    return stale.count;
+}
+
+size_t ContainerSync_abort( ContainerSync* sync )
+{
+    sync->deleted = CONTAINER_SIZE( sync->container );
+    CONTAINER_CLEAR( sync->container, sync->release, sync->context );
+
+    DEBUG_MSGTL( ( "containerSync", "%s: pass aborted, %lu deleted\n",
+        sync->container->containerName ? sync->container->containerName : "",
+        ( u_long )sync->deleted ) );
+
+    return sync->deleted;
+}
@@ -0,0 +1,114 @@
+#ifndef IOT_CONTAINERSYNC_H
+#define IOT_CONTAINERSYNC_H
+
+/** \file ContainerSync.h
+ *  @brief  Incremental reload of a keyed container from a stream of rows.
+ *
+ *  Instead of building a new container on every reload and reconciling it
+ *  with the previous one, a loader emits each row it reads (typically a
+ *  scratch structure on its stack) through ContainerSync_row(). Rows that
+ *  already have an entry in the container update it in place, new rows
+ *  are inserted, and ContainerSync_end() removes the entries whose row
+ *  was not seen during the pass. Unchanged rows cause no allocation.
+ *
+ *  Each entry carries a u_int generation stamp, at generationOffset from
+ *  the start of the entry, which records the last pass that saw it.
+ *
+ *  \author Dunian Coutinho Sampa (duniansampa)
+ *  \bug    No known bugs.
+ */
+
+#include "System/Containers/Container.h"
+
+/** ============================[ Types ]================== */
+
+/** Allocates a container entry from a row. Returns NULL on error. */
+typedef void*( ContainerSyncCreate_f )( const void* row, void* context );
+
+/** Refreshes an existing entry from a row with the same key.
+ *  Returns the number of changed fields, or < 0 on error. */
+typedef int( ContainerSyncUpdate_f )( void* entry, const void* row, void* context );
+
+/** \struct ContainerSync_s
+ *  The state of the incremental reload of one container.
+ */
+typedef struct ContainerSync_s {
+
+    /** The container kept across reloads */
+    Container_Container* container;
+
+    /** Offset of the u_int generation stamp within an entry */
+    size_t generationOffset;
+
+    /** The current pass */
+    u_int generation;
+
+    ContainerSyncCreate_f* create;
+    ContainerSyncUpdate_f* update;
+
+    /** Frees an entry whose row vanished */
+    Container_FuncObjFunc* release;
+
+    /** Passed to the create, update and release functions */
+    void* context;
+
+    /** Statistics of the last pass */
+    size_t unchanged;
+    size_t updated;
+    size_t inserted;
+    size_t deleted;
+
+} ContainerSync;
+
+/** =============================[ Functions Prototypes ]================== */
+
+/** @brief  Sets up the incremental reload of a container.
+ *
+ *  @param  sync - the state to initialize.
+ *  @param  container - the container kept across reloads.
+ *  @param  generationOffset - offsetof() the u_int generation stamp in an entry.
+ *  @param  create - allocates an entry for a new row.
+ *  @param  update - refreshes an existing entry from its row.
+ *  @param  release - frees an entry whose row vanished.
+ *  @param  context - passed to the functions above.
+ */
+void ContainerSync_init( ContainerSync* sync, Container_Container* container,
+    size_t generationOffset, ContainerSyncCreate_f* create,
+    ContainerSyncUpdate_f* update, Container_FuncObjFunc* release,
+    void* context );
+
+/** @brief  Starts a reload pass.
+ *
+ *  @param  sync - the incremental reload state.
+ */
+void ContainerSync_begin( ContainerSync* sync );
+
+/** @brief  Applies one row of the reload pass.
+ *
+ *  @param  sync - the incremental reload state.
+ *  @param  key - an object the container can compare with its entries
+ *                (CONTAINER_FIND), which identifies the row.
+ *  @param  row - the row, passed to the create or update function.
+ *  @return ErrorCode_SUCCESS, or ErrorCode_GENERR if the row could not be applied.
+ */
+int ContainerSync_row( ContainerSync* sync, const void* key, const void* row );
+
+/** @brief  Ends a reload pass, removing and releasing the entries whose row
+ *          was not seen.  If there is no memory to collect them, the whole
+ *          container is cleared instead.
+ *
+ *  @param  sync - the incremental reload state.
+ *  @return the number of entries removed.
+ */
+size_t ContainerSync_end( ContainerSync* sync );
+
+/** @brief  Ends a reload pass which failed part way.  The entries can't be
+ *          told apart from those of the failed pass, so all of them are
+ *          removed and released; the next pass starts from scratch.
+ *
+ *  @param  sync - the incremental reload state.
+ *  @return the number of entries removed.
+ */
+size_t ContainerSync_abort( ContainerSync* sync );
+
+#endif // IOT_CONTAINERSYNC_H
@@ -121,6 +121,15 @@ unsigned int Alarm_register( unsigned int seconds, unsigned int alarmFlag,
     return _Alarm_register( time, alarmFlag, callbackFunc, callbackFuncArg );
 }
 
+unsigned int Alarm_registerHr( struct timeval t, unsigned int alarmFlag,
+    AlarmCallback_f* callbackFunc, void* callbackFuncArg )
+{
+    if ( t.tv_sec == 0 && t.tv_usec == 0 )
+        t.tv_usec = 1;
+
+    return _Alarm_register( t, alarmFlag, callbackFunc, callbackFuncArg );
+}
+
 void Alarm_initAlarm( void )
 {
     _alarm_startAlarms = 0;
@@ -102,6 +102,20 @@ unsigned int Alarm_register( unsigned int seconds, unsigned int alarmFlag,
  */
 void Alarm_unregister( unsigned int alarmId );
 
+/**
+ * As Alarm_register, for an interval finer than a second.
+ *
+ * @param t - the interval after which (and, with AlarmFlag_REPEAT, every
+ *            which) the callback function is called.
+ *
+ * @return as Alarm_register
+ *
+ * \see Alarm_register
+ * \see Alarm_unregister
+ */
+unsigned int Alarm_registerHr( struct timeval t, unsigned int alarmFlag,
+    AlarmCallback_f* callbackFunc, void* callbackFuncArg );
+
 /**
  * This function unregisters all alarms currently stored.
  *
@@ -0,0 +1,274 @@
+#include "ProcFile.h"
+#include "System/Util/Logger.h"
+#include "System/Util/Memory.h"
+#include "System/Util/Trace.h"
+
+#define _PROCFILE_INITIAL_SIZE 4096
+
+static ProcFile* _procFile_shared = NULL;
+
+ProcFile* ProcFile_shared( const char* path )
+{
+    ProcFile* file;
+
+    for ( file = _procFile_shared; file; file = file->next )
+        if ( 0 == strcmp( file->path, path ) )
+            return file;
+
+    file = MEMORY_MALLOC_TYPEDEF( ProcFile );
+    if ( NULL == file )
+        return NULL;
+    file->path = path;
+    file->fd = -1;
+    file->next = _procFile_shared;
+    _procFile_shared = file;
+    return file;
+}
+
+/*
+ * Reads the file from offset 0, growing the buffer until the whole file
+ * fits. Returns the length read, or -1.
+ */
+static ssize_t _ProcFile_pread( ProcFile* file )
+{
+    ssize_t length;
+    char* buffer;
+
+    for ( ;; ) {
+        length = pread( file->fd, file->buffer, file->size, 0 );
+        if ( length < 0 || ( size_t )length < file->size )
+            return length;
+
+        buffer = ( char* )realloc( file->buffer, file->size * 2 + 1 );
+        if ( NULL == buffer )
+            return -1;
+        file->buffer = buffer;
+        file->size *= 2;
+        DEBUG_MSGTL( ( "procFile", "%s buffer increased to %" NETSNMP_PRIz "d\n",
+            file->path, file->size ) );
+    }
+}
+
+int ProcFile_read( ProcFile* file )
+{
+    ssize_t length = -1;
+    int attempt;
+
+    if ( NULL == file->buffer ) {
+        file->buffer = ( char* )malloc( _PROCFILE_INITIAL_SIZE + 1 );
+        if ( NULL == file->buffer )
+            return ErrorCode_GENERR;
+        file->size = _PROCFILE_INITIAL_SIZE;
+    }
+
+    /*
+     * a kept descriptor can go bad (e.g. the file of a namespace that
+     * went away), so reopen once before giving up
+     */
+    for ( attempt = 0; attempt < 2 && length < 0; attempt++ ) {
+        if ( file->fd < 0 || attempt > 0 ) {
+            if ( file->fd >= 0 )
+                close( file->fd );
+            file->fd = open( file->path, O_RDONLY | O_CLOEXEC );
+            if ( file->fd < 0 ) {
+                DEBUG_MSGTL( ( "procFile", "cannot open %s: %s\n", file->path,
+                    strerror( errno ) ) );
+                return ErrorCode_GENERR;
+            }
+        }
+        length = _ProcFile_pread( file );
+    }
+    if ( length < 0 ) {
+        DEBUG_MSGTL( ( "procFile", "cannot read %s: %s\n", file->path,
+            strerror( errno ) ) );
+        file->length = 0;
+        file->buffer[ 0 ] = '\0';
+        return ErrorCode_GENERR;
+    }
+
+    file->length = length;
+    file->buffer[ length ] = '\0';
+    file->generation++;
+    return ErrorCode_SUCCESS;
+}
+
+int ProcFile_refresh( ProcFile* file, u_int loadGeneration )
+{
+    if ( file->generation && loadGeneration
+        && file->loadGeneration == loadGeneration )
+        return ErrorCode_SUCCESS;
+    if ( ProcFile_read( file ) != ErrorCode_SUCCESS )
+        return ErrorCode_GENERR;
+    file->loadGeneration = loadGeneration;
+    return ErrorCode_SUCCESS;
+}
+
+void ProcFile_close( ProcFile* file )
+{
+    if ( file->fd >= 0 )
+        close( file->fd );
+    file->fd = -1;
+    MEMORY_FREE( file->buffer );
+    file->size = 0;
+    file->length = 0;
+}
+
+const char* ProcFile_findLine( const ProcFile* file, const char* key )
+{
+    const char *line, *end;
+    size_t keyLength = strlen( key );
+
+    if ( NULL == file->buffer )
+        return NULL;
+
+    end = file->buffer + file->length;
+    for ( line = file->buffer; line < end; line++ ) {
+        if ( 0 == strncmp( line, key, keyLength )
+            && ( line[ keyLength ] == ':' || line[ keyLength ] == ' '
+                   || line[ keyLength ] == '\t' ) )
+            return line + keyLength + 1;
+        line = ( const char* )memchr( line, '\n', end - line );
+        if ( NULL == line )
+            break;
+    }
+    return NULL;
+}
+
+const char* ProcFile_parseNumber( const char* cp, unsigned long long* value )
+{
+    unsigned long long number = 0;
+    int negative = 0;
+
+    while ( *cp == ' ' || *cp == '\t' )
+        cp++;
+    if ( *cp == '-' ) {
+        negative = 1;
+        cp++;
+    }
+    if ( *cp < '0' || *cp > '9' )
+        return NULL;
+    while ( *cp >= '0' && *cp <= '9' )
+        number = number * 10 + ( *cp++ - '0' );
+
+    *value = negative ? -number : number;
+    return cp;
+}
+
+int ProcFile_parseNumbers( const char* cp, unsigned long long* values, int count )
+{
+    int i;
+
+    for ( i = 0; i < count && cp; i++ )
+        if ( NULL == ( cp = ProcFile_parseNumber( cp, &values[ i ] ) ) )
+            break;
+    return i;
+}
+
+int ProcFile_keyedValue( const ProcFile* file, const char* key,
+    unsigned long long* value )
+{
+    const char* cp = ProcFile_findLine( file, key );
+
+    if ( NULL == cp || NULL == ProcFile_parseNumber( cp, value ) )
+        return ErrorCode_GENERR;
+    return ErrorCode_SUCCESS;
+}
+
+int ProcFile_forEachField( const ProcFile* file, const char* prefix,
+    ProcFileField_f* callback, void* context )
+{
+    const char *names, *values, *name;
+    unsigned long long value;
+    size_t nameLength;
+    int count = 0;
+
+    /*
+     * the value line follows the header line, with the same prefix
+     */
+    names = ProcFile_findLine( file, prefix );
+    if ( NULL == names )
+        return -1;
+    values = strchr( names, '\n' );
+    if ( NULL == values )
+        return -1;
+    values++;
+    if ( 0 != strncmp( values, prefix, strlen( prefix ) ) )
+        return -1;
+    values += strlen( prefix ) + 1;
+
+    for ( ;; ) {
+        while ( *names == ' ' )
+            names++;
+        if ( *names == '\n' || *names == '\0' )
+            break;
+        name = names;
+        while ( *names != ' ' && *names != '\n' && *names != '\0' )
+            names++;
+        nameLength = names - name;
+
+        values = ProcFile_parseNumber( values, &value );
+        if ( NULL == values )
+            break;
+        if ( callback )
+            ( *callback )( name, nameLength, value, context );
+        count++;
+    }
+    return count;
+}
+
+typedef struct ProcFileHeaderFields_s {
+    const char* const* names;
+    int count;
+    unsigned long long* values;
+    uint64_t found;
+    int next;
+} ProcFileHeaderFields;
+
+static void _ProcFile_headerField( const char* name, size_t nameLength,
+    unsigned long long value, void* context )
+{
+    ProcFileHeaderFields* fields = ( ProcFileHeaderFields* )context;
+    int i, j;
+
+    /*
+     * the names are usually asked for in column order, so start the
+     * search after the last match
+     */
+    for ( j = 0; j < fields->count; j++ ) {
+        i = ( fields->next + j ) % fields->count;
+        if ( 0 == strncmp( fields->names[ i ], name, nameLength )
+            && fields->names[ i ][ nameLength ] == '\0' ) {
+            fields->values[ i ] = value;
+            fields->found |= ( uint64_t )1 << i;
+            fields->next = i + 1;
+            return;
+        }
+    }
+}
+
+int ProcFile_headerFields( const ProcFile* file, const char* prefix,
+    const char* const* names, int count, unsigned long long* values,
+    uint64_t* found )
+{
+    ProcFileHeaderFields fields;
+    int i, n = 0;
+
+    if ( count > 64 )
+        count = 64;
+    fields.names = names;
+    fields.count = count;
+    fields.values = values;
+    fields.found = 0;
+    fields.next = 0;
+
+    if ( count <= 0
+        || ProcFile_forEachField( file, prefix, _ProcFile_headerField, &fields ) < 0 )
+        return -1;
+
+    for ( i = 0; i < count; i++ )
+        if ( fields.found & ( ( uint64_t )1 << i ) )
+            n++;
+    if ( found )
+        *found = fields.found;
+    return n;
+}
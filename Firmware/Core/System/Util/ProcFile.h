@@ -0,0 +1,167 @@
+#ifndef IOT_PROCFILE_H
+#define IOT_PROCFILE_H
+
+/** \file ProcFile.h
+ *  @brief  Repeated reads of small procfs files without per-read allocation.
+ *
+ *  A ProcFile keeps its file descriptor open and re-reads the whole file
+ *  with pread() into a buffer that only grows, so a reload costs one system
+ *  call and no stdio or heap traffic. The parsers work on the buffer in
+ *  place: "Key: value" lines (/proc/meminfo, /proc/vmstat), lines of plain
+ *  numbers (/proc/stat), and the header/value line pairs of /proc/net/snmp
+ *  and /proc/net/netstat, whose columns are matched by name rather than
+ *  by position.
+ *
+ *  Files read by several modules can be shared through ProcFile_shared(),
+ *  and ProcFile_refresh() skips the read if the file was already read for
+ *  the caller's load generation, so modules reloading for the same request
+ *  parse a single read.
+ *
+ *  \author Dunian Coutinho Sampa (duniansampa)
+ *  \bug    No known bugs.
+ */
+
+#include "Generals.h"
+
+/** ============================[ Macros ]============================ */
+
+/** Initializes a static ProcFile */
+#define PROCFILE_INITIALIZER( path ) \
+    {                                \
+        path, -1, NULL, 0, 0, 0, 0, NULL \
+    }
+
+/** ============================[ Types ]================== */
+
+/** \struct ProcFile_s
+ *  A procfs file and the contents of its last read.
+ */
+typedef struct ProcFile_s {
+
+    /** The file name */
+    const char* path;
+
+    /** The kept-open descriptor, -1 until the first read */
+    int fd;
+
+    /** The contents of the last read, NUL terminated */
+    char* buffer;
+
+    /** Allocated size of buffer */
+    size_t size;
+
+    /** Bytes read by the last read */
+    size_t length;
+
+    /** Incremented by each successful read */
+    u_int generation;
+
+    /** The load generation ProcFile_refresh() last read the file for */
+    u_int loadGeneration;
+
+    /** Next shared file */
+    struct ProcFile_s* next;
+
+} ProcFile;
+
+/** Called by ProcFile_forEachField() for each named column */
+typedef void( ProcFileField_f )( const char* name, size_t nameLength,
+    unsigned long long value, void* context );
+
+/** =============================[ Functions Prototypes ]================== */
+
+/** @brief  Returns the ProcFile shared by all users of a path, creating it
+ *          on first use.
+ *
+ *  @param  path - the file name; must stay valid (a string literal).
+ *  @return the shared file, or NULL if out of memory.
+ */
+ProcFile* ProcFile_shared( const char* path );
+
+/** @brief  Reads the whole file into its buffer.
+ *
+ *  @param  file - the file to read.
+ *  @return ErrorCode_SUCCESS, or ErrorCode_GENERR if it can't be read.
+ */
+int ProcFile_read( ProcFile* file );
+
+/** @brief  Reads the file unless it was already read for loadGeneration.
+ *
+ *  @param  file - the file to read.
+ *  @param  loadGeneration - which load the contents are for, such as
+ *          CacheHandler_loadGeneration(); 0 always reads.
+ *  @return ErrorCode_SUCCESS, or ErrorCode_GENERR if it can't be read.
+ */
+int ProcFile_refresh( ProcFile* file, u_int loadGeneration );
+
+/** @brief  Closes the descriptor and frees the buffer.
+ *
+ *  @param  file - the file to close; it can be read again later.
+ */
+void ProcFile_close( ProcFile* file );
+
+/** @brief  Finds the line starting with key, followed by a blank or ':'.
+ *
+ *  @param  file - a file that was read.
+ *  @param  key - the first word of the line, without the delimiter.
+ *  @return the first character after the key and delimiter, or NULL.
+ */
+const char* ProcFile_findLine( const ProcFile* file, const char* key );
+
+/** @brief  Parses one unsigned decimal number, skipping leading blanks.
+ *          A leading '-' gives the two's complement, as strtoull() would.
+ *
+ *  @param  cp - where to start.
+ *  @param  value - the number parsed.
+ *  @return the first character after the number, or NULL if there was none
+ *          before the end of the line.
+ */
+const char* ProcFile_parseNumber( const char* cp, unsigned long long* value );
+
+/** @brief  Parses up to count numbers from the rest of a line.
+ *
+ *  @param  cp - where to start.
+ *  @param  values - the numbers parsed.
+ *  @param  count - the size of values.
+ *  @return the number of values parsed.
+ */
+int ProcFile_parseNumbers( const char* cp, unsigned long long* values, int count );
+
+/** @brief  Gets the first number of the line starting with key
+ *          ("MemTotal:     16309560 kB", "pgpgin 1234").
+ *
+ *  @param  file - a file that was read.
+ *  @param  key - the first word of the line, without the delimiter.
+ *  @param  value - the number.
+ *  @return ErrorCode_SUCCESS, or ErrorCode_GENERR if there's no such line.
+ */
+int ProcFile_keyedValue( const ProcFile* file, const char* key,
+    unsigned long long* value );
+
+/** @brief  Walks the columns of a header/value line pair, such as
+ *          "Ip: Forwarding DefaultTTL ..." followed by "Ip: 1 64 ...".
+ *
+ *  @param  file - a file that was read.
+ *  @param  prefix - the first word of both lines, without the ':'.
+ *  @param  callback - called with the name and value of each column.
+ *  @param  context - passed to callback.
+ *  @return the number of columns, or -1 if the lines were not found.
+ */
+int ProcFile_forEachField( const ProcFile* file, const char* prefix,
+    ProcFileField_f* callback, void* context );
+
+/** @brief  Gets named columns of a header/value line pair.
+ *
+ *  @param  file - a file that was read.
+ *  @param  prefix - the first word of both lines, without the ':'.
+ *  @param  names - the columns wanted (at most 64).
+ *  @param  count - the number of names.
+ *  @param  values - set for each column found; the others are left alone.
+ *  @param  found - if not NULL, bit i is set if names[ i ] was found.
+ *  @return the number of names found, or -1 if the lines were not found.
+ */
+int ProcFile_headerFields( const ProcFile* file, const char* prefix,
+    const char* const* names, int count, unsigned long long* values,
+    uint64_t* found );
+
+#endif // IOT_PROCFILE_H
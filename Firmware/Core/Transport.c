@@ -22,6 +22,7 @@ extern void UDPDomain_ctor();
 extern void TPCDomain_ctor();
 extern void AliasDomain_ctor();
 extern void UnixDomain_ctor();
+extern void ShmDomain_ctor();
 
 
 /*
@@ -287,6 +288,7 @@ Transport_tdomainInit(void)
     TPCDomain_ctor();
     AliasDomain_ctor();
     UnixDomain_ctor();
+    ShmDomain_ctor();
 
     _Transport_tdomainDump();
 }
@@ -0,0 +1,580 @@
+#include "ShmDomain.h"
+#include "System/String.h"
+#include "System/Util/Logger.h"
+#include "System/Util/Trace.h"
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+oid shmDomain_priotShmDomain[] = { TRANSPORT_DOMAIN_SHM };
+static Transport_Tdomain _shmDomain_shmDomain;
+
+#define _SHMDOMAIN_MAGIC 0x50534d31 /* "PSM1" */
+
+/* how long a send waits for the reader to make room, in microseconds */
+#define _SHMDOMAIN_SEND_TIMEOUT ( 5 * 1000 * 1000 )
+
+/*
+ * One direction.  The counters run freely; head - tail is the number of
+ * unread bytes.  Each sits on a cache line of its own, as the two ends
+ * write one each.
+ */
+typedef struct ShmDomain_Ring_s {
+    uint64_t head; /* written by the producer only */
+    char pad1[ 64 - sizeof( uint64_t ) ];
+    uint64_t tail; /* written by the consumer only */
+    char pad2[ 64 - sizeof( uint64_t ) ];
+} ShmDomain_Ring;
+
+/*
+ * The shared memory: ring 0 carries what the listening end sends, ring 1
+ * what the connecting end sends; the data of each follows the header.
+ */
+typedef struct ShmDomain_Shared_s {
+    uint32_t magic;
+    uint32_t size;
+    char pad[ 64 - 2 * sizeof( uint32_t ) ];
+    ShmDomain_Ring ring[ 2 ];
+} ShmDomain_Shared;
+
+#define _SHMDOMAIN_MAP_LENGTH( size ) ( sizeof( ShmDomain_Shared ) + 2 * ( size_t )( size ) )
+
+/*
+ * The transport-specific data.  On the listening end only local and server
+ * are used, except for the connection just accepted, which is handed over
+ * to the copy of the transport made for it.
+ */
+typedef struct ShmDomain_Data_s {
+    int local;
+    struct sockaddr_un server;
+
+    ShmDomain_Shared* shared;
+    uint32_t size;
+    ShmDomain_Ring* in;
+    ShmDomain_Ring* out;
+    u_char* inData;
+    u_char* outData;
+    int peer; /* the Unix-domain socket to the other end */
+    int inEvent; /* signalled by the other end when it writes to in */
+    int outEvent; /* signalled to the other end when out gets bytes */
+} ShmDomain_Data;
+
+static char* _ShmDomain_fmtaddr( Transport_Transport* t, void* data, int len )
+{
+    const char* path = NULL;
+    char* tmp;
+
+    if ( t != NULL && t->data != NULL )
+        path = ( ( ShmDomain_Data* )t->data )->server.sun_path;
+    if ( path == NULL || path[ 0 ] == 0 )
+        return strdup( "Shared memory: unknown" );
+
+    tmp = ( char* )malloc( 16 + strlen( path ) );
+    if ( tmp != NULL )
+        sprintf( tmp, "Shared memory: %s", path );
+    return tmp;
+}
+
+static void _ShmDomain_signal( int fd )
+{
+    uint64_t one = 1;
+
+    while ( write( fd, &one, sizeof( one ) ) < 0 && errno == EINTR )
+        ;
+}
+
+/*
+ * Whether the other end has closed its socket (or died)
+ */
+static int _ShmDomain_peerGone( ShmDomain_Data* d )
+{
+    char c;
+
+    return recv( d->peer, &c, 1, MSG_PEEK | MSG_DONTWAIT ) == 0;
+}
+
+static void _ShmDomain_channelRelease( ShmDomain_Data* d )
+{
+    if ( d->shared != NULL )
+        munmap( d->shared, _SHMDOMAIN_MAP_LENGTH( d->size ) );
+    if ( d->peer >= 0 )
+        close( d->peer );
+    if ( d->inEvent >= 0 )
+        close( d->inEvent );
+    if ( d->outEvent >= 0 )
+        close( d->outEvent );
+    d->shared = NULL;
+    d->peer = d->inEvent = d->outEvent = -1;
+}
+
+/*
+ * Maps the memory of a connection, and returns the descriptor to select on
+ * for it: an epoll descriptor that is readable when the other end signals
+ * or its socket closes.
+ */
+static int _ShmDomain_channelMap( ShmDomain_Data* d, int memfd, int listening )
+{
+    struct epoll_event ev;
+    void* map;
+    int ep;
+
+    map = mmap( NULL, _SHMDOMAIN_MAP_LENGTH( d->size ), PROT_READ | PROT_WRITE,
+        MAP_SHARED, memfd, 0 );
+    if ( map == MAP_FAILED )
+        return -1;
+    d->shared = ( ShmDomain_Shared* )map;
+    if ( listening ) {
+        d->shared->magic = _SHMDOMAIN_MAGIC;
+        d->shared->size = d->size;
+    } else if ( d->shared->magic != _SHMDOMAIN_MAGIC || d->shared->size != d->size ) {
+        DEBUG_MSGTL( ( "priotShm", "bad shared memory header\n" ) );
+        return -1;
+    }
+    d->in = &d->shared->ring[ listening ? 1 : 0 ];
+    d->out = &d->shared->ring[ listening ? 0 : 1 ];
+    d->inData = ( u_char* )( d->shared + 1 ) + ( listening ? d->size : 0 );
+    d->outData = ( u_char* )( d->shared + 1 ) + ( listening ? 0 : d->size );
+
+    ep = epoll_create1( EPOLL_CLOEXEC );
+    if ( ep < 0 )
+        return -1;
+    memset( &ev, 0, sizeof( ev ) );
+    ev.events = EPOLLIN;
+    if ( epoll_ctl( ep, EPOLL_CTL_ADD, d->inEvent, &ev ) < 0 ) {
+        close( ep );
+        return -1;
+    }
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    if ( epoll_ctl( ep, EPOLL_CTL_ADD, d->peer, &ev ) < 0 ) {
+        close( ep );
+        return -1;
+    }
+    return ep;
+}
+
+/*
+ * The listening end: makes the memory and eventfds of a new connection and
+ * passes them to the other end over its socket
+ */
+static int _ShmDomain_channelCreate( ShmDomain_Data* d, int peer )
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr* cmsg;
+    char control[ CMSG_SPACE( 3 * sizeof( int ) ) ];
+    int fds[ 3 ], ep = -1;
+    char c = 0;
+
+    d->peer = peer;
+    d->size = SHMDOMAIN_RING_SIZE;
+    fds[ 0 ] = memfd_create( "priot-shm", MFD_CLOEXEC );
+    fds[ 1 ] = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    fds[ 2 ] = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    d->outEvent = fds[ 1 ];
+    d->inEvent = fds[ 2 ];
+    if ( fds[ 0 ] < 0 || fds[ 1 ] < 0 || fds[ 2 ] < 0
+        || ftruncate( fds[ 0 ], _SHMDOMAIN_MAP_LENGTH( d->size ) ) < 0 )
+        goto out;
+
+    memset( &msg, 0, sizeof( msg ) );
+    memset( control, 0, sizeof( control ) );
+    iov.iov_base = &c;
+    iov.iov_len = 1;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof( control );
+    cmsg = CMSG_FIRSTHDR( &msg );
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN( sizeof( fds ) );
+    memcpy( CMSG_DATA( cmsg ), fds, sizeof( fds ) );
+
+    ep = _ShmDomain_channelMap( d, fds[ 0 ], 1 );
+    if ( ep >= 0 && sendmsg( peer, &msg, MSG_NOSIGNAL ) != 1 ) {
+        close( ep );
+        ep = -1;
+    }
+
+out:
+    if ( fds[ 0 ] >= 0 )
+        close( fds[ 0 ] );
+    if ( ep < 0 ) {
+        DEBUG_MSGTL( ( "priotShm", "couldn't set up a connection, errno %d (%s)\n",
+            errno, strerror( errno ) ) );
+        _ShmDomain_channelRelease( d );
+    }
+    return ep;
+}
+
+/*
+ * The connecting end: takes the memory and eventfds the listening end sent
+ */
+static int _ShmDomain_channelAttach( ShmDomain_Data* d, int peer )
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr* cmsg;
+    struct stat st;
+    char control[ CMSG_SPACE( 3 * sizeof( int ) ) ];
+    int fds[ 3 ] = { -1, -1, -1 }, ep = -1;
+    char c;
+    ssize_t rc;
+
+    d->peer = peer;
+    memset( &msg, 0, sizeof( msg ) );
+    iov.iov_base = &c;
+    iov.iov_len = 1;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof( control );
+    do {
+        rc = recvmsg( peer, &msg, MSG_CMSG_CLOEXEC );
+    } while ( rc < 0 && errno == EINTR );
+
+    cmsg = rc == 1 ? CMSG_FIRSTHDR( &msg ) : NULL;
+    if ( cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+        && cmsg->cmsg_len == CMSG_LEN( sizeof( fds ) ) )
+        memcpy( fds, CMSG_DATA( cmsg ), sizeof( fds ) );
+    d->inEvent = fds[ 1 ];
+    d->outEvent = fds[ 2 ];
+
+    if ( fds[ 0 ] >= 0 && fstat( fds[ 0 ], &st ) == 0
+        && st.st_size > ( off_t )sizeof( ShmDomain_Shared ) ) {
+        d->size = ( st.st_size - sizeof( ShmDomain_Shared ) ) / 2;
+        if ( d->size != 0 && ( d->size & ( d->size - 1 ) ) == 0 )
+            ep = _ShmDomain_channelMap( d, fds[ 0 ], 0 );
+    }
+
+    if ( fds[ 0 ] >= 0 )
+        close( fds[ 0 ] );
+    if ( ep < 0 ) {
+        DEBUG_MSGTL( ( "priotShm", "couldn't attach to the shared memory\n" ) );
+        _ShmDomain_channelRelease( d );
+    }
+    return ep;
+}
+
+/*
+ * Stream semantics: any number of bytes up to size.  An empty ring means
+ * either a stale wakeup or, if the socket has closed, the end of the
+ * stream.
+ */
+static int _ShmDomain_recv( Transport_Transport* t, void* buf, int size, void** opaque, int* olength )
+{
+    ShmDomain_Data* d = ( ShmDomain_Data* )t->data;
+    uint64_t signals, head, tail, count, first, off;
+
+    *opaque = NULL;
+    *olength = 0;
+    if ( d == NULL || d->shared == NULL || size <= 0 )
+        return -1;
+
+    /*
+     * reset the wakeup before looking, so that bytes written from now on
+     * signal again
+     */
+    if ( read( d->inEvent, &signals, sizeof( signals ) ) < 0 && errno != EAGAIN )
+        return -1;
+
+    head = __atomic_load_n( &d->in->head, __ATOMIC_ACQUIRE );
+    tail = d->in->tail;
+    count = head - tail;
+    if ( count == 0 ) {
+        if ( _ShmDomain_peerGone( d ) ) {
+            DEBUG_MSGTL( ( "priotShm", "recv fd %d: peer closed\n", t->sock ) );
+            return 0;
+        }
+        t->flags |= TRANSPORT_FLAG_EMPTY_PKT;
+        return 0;
+    }
+    if ( count > ( uint64_t )size )
+        count = size;
+
+    off = tail & ( d->size - 1 );
+    first = d->size - off < count ? d->size - off : count;
+    memcpy( buf, d->inData + off, first );
+    memcpy( ( u_char* )buf + first, d->inData, count - first );
+    __atomic_store_n( &d->in->tail, tail + count, __ATOMIC_RELEASE );
+
+    /*
+     * the writer only signals when it finds the ring empty; if it wrote
+     * while this was reading, whatever is left needs the wakeup it didn't
+     * send
+     */
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+    if ( __atomic_load_n( &d->in->head, __ATOMIC_RELAXED ) != tail + count )
+        _ShmDomain_signal( d->inEvent );
+
+    DEBUG_MSGTL( ( "priotShm", "recv fd %d got %d bytes\n", t->sock, ( int )count ) );
+    return ( int )count;
+}
+
+static int _ShmDomain_send( Transport_Transport* t, void* buf, int size, void** opaque, int* olength )
+{
+    ShmDomain_Data* d = ( ShmDomain_Data* )t->data;
+    const u_char* from = ( const u_char* )buf;
+    uint64_t head, tail, count, first, off;
+    long waited = 0, delay = 10;
+    struct timespec ts;
+    int sent = 0;
+
+    if ( d == NULL || d->shared == NULL )
+        return -1;
+
+    DEBUG_MSGTL( ( "priotShm", "send %d bytes on fd %d\n", size, t->sock ) );
+    while ( sent < size ) {
+        head = d->out->head;
+        tail = __atomic_load_n( &d->out->tail, __ATOMIC_ACQUIRE );
+        count = d->size - ( head - tail );
+        if ( count == 0 ) {
+            /*
+             * the reader is behind: wait for it, as a blocking socket would
+             */
+            if ( _ShmDomain_peerGone( d ) || waited >= _SHMDOMAIN_SEND_TIMEOUT ) {
+                DEBUG_MSGTL( ( "priotShm", "send fd %d: ring full, %d of %d bytes sent\n",
+                    t->sock, sent, size ) );
+                errno = EPIPE;
+                return -1;
+            }
+            ts.tv_sec = 0;
+            ts.tv_nsec = delay * 1000;
+            nanosleep( &ts, NULL );
+            waited += delay;
+            if ( delay < 1000 )
+                delay *= 2;
+            continue;
+        }
+        if ( count > ( uint64_t )( size - sent ) )
+            count = size - sent;
+
+        off = head & ( d->size - 1 );
+        first = d->size - off < count ? d->size - off : count;
+        memcpy( d->outData + off, from + sent, first );
+        memcpy( d->outData, from + sent + first, count - first );
+        __atomic_store_n( &d->out->head, head + count, __ATOMIC_RELEASE );
+
+        /*
+         * the reader only needs waking if it had read everything; see
+         * _ShmDomain_recv for the other half
+         */
+        __atomic_thread_fence( __ATOMIC_SEQ_CST );
+        if ( __atomic_load_n( &d->out->tail, __ATOMIC_RELAXED ) == head )
+            _ShmDomain_signal( d->outEvent );
+        sent += count;
+    }
+    return sent;
+}
+
+static int _ShmDomain_close( Transport_Transport* t )
+{
+    ShmDomain_Data* d = ( ShmDomain_Data* )t->data;
+    int rc;
+
+    if ( t->sock < 0 )
+        return -1;
+
+    rc = close( t->sock );
+    t->sock = -1;
+    if ( d != NULL ) {
+        _ShmDomain_channelRelease( d );
+        if ( d->local && d->server.sun_path[ 0 ] != 0 ) {
+            DEBUG_MSGTL( ( "priotShm", "close: unlink(\"%s\")\n", d->server.sun_path ) );
+            unlink( d->server.sun_path );
+        }
+    }
+    return rc;
+}
+
+static int _ShmDomain_accept( Transport_Transport* t )
+{
+    ShmDomain_Data* d = ( ShmDomain_Data* )t->data;
+    int newsock, ep;
+
+    if ( d == NULL || t->sock < 0 )
+        return -1;
+
+    /*
+     * a connection that was never taken over by a copy of the transport
+     */
+    _ShmDomain_channelRelease( d );
+
+    newsock = accept( t->sock, NULL, NULL );
+    if ( newsock < 0 ) {
+        DEBUG_MSGTL( ( "priotShm", "accept failed errno %d \"%s\"\n",
+            errno, strerror( errno ) ) );
+        return -1;
+    }
+
+    ep = _ShmDomain_channelCreate( d, newsock );
+    DEBUG_MSGTL( ( "priotShm", "accept %s (fd %d)\n", ep >= 0 ? "succeeded" : "failed", ep ) );
+    return ep;
+}
+
+/*
+ * The copy made for an accepted connection takes the connection over; the
+ * listening transport keeps only its address.
+ */
+static int _ShmDomain_copy( Transport_Transport* from, Transport_Transport* to )
+{
+    ShmDomain_Data* d = ( ShmDomain_Data* )from->data;
+
+    if ( d != NULL && to->data != NULL ) {
+        ( ( ShmDomain_Data* )to->data )->local = 0;
+        d->shared = NULL;
+        d->peer = d->inEvent = d->outEvent = -1;
+    }
+    return 0;
+}
+
+/*
+ * Open a shared memory transport.  Local is TRUE if addr is the socket to
+ * listen on for connections (i.e. this is a server-type session);
+ * otherwise addr is the socket of the listening end to connect to.
+ */
+Transport_Transport* ShmDomain_transport( struct sockaddr_un* addr, int local )
+{
+    Transport_Transport* t = NULL;
+    ShmDomain_Data* d = NULL;
+    int sock, rc;
+
+    if ( addr == NULL || addr->sun_family != AF_UNIX ) {
+        return NULL;
+    }
+
+    DEBUG_MSGTL( ( "priotShm", "open %s %s\n", local ? "local" : "remote",
+        addr->sun_path ) );
+
+    t = MEMORY_MALLOC_TYPEDEF( Transport_Transport );
+    if ( t == NULL ) {
+        return NULL;
+    }
+    t->domain = shmDomain_priotShmDomain;
+    t->domain_length = sizeof( shmDomain_priotShmDomain ) / sizeof( shmDomain_priotShmDomain[ 0 ] );
+    t->sock = -1;
+
+    d = MEMORY_MALLOC_TYPEDEF( ShmDomain_Data );
+    if ( d == NULL ) {
+        Transport_free( t );
+        return NULL;
+    }
+    d->peer = d->inEvent = d->outEvent = -1;
+    d->server = *addr;
+    t->data = d;
+    t->data_length = sizeof( ShmDomain_Data );
+
+    sock = socket( PF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+    if ( sock < 0 ) {
+        Transport_free( t );
+        return NULL;
+    }
+
+    t->flags = TRANSPORT_FLAG_STREAM;
+
+    if ( local ) {
+        t->local = ( u_char* )strdup( addr->sun_path );
+        t->local_length = strlen( addr->sun_path );
+        t->sock = sock;
+        t->flags |= TRANSPORT_FLAG_LISTEN;
+        d->local = 1;
+
+        unlink( addr->sun_path );
+        rc = bind( sock, ( struct sockaddr* )addr, SUN_LEN( addr ) );
+        if ( rc == 0 )
+            rc = listen( sock, TRANSPORT_STREAM_QUEUE_LEN );
+        if ( t->local == NULL || rc != 0 ) {
+            DEBUG_MSGTL( ( "priotShm", "couldn't listen on \"%s\", errno %d (%s)\n",
+                addr->sun_path, errno, strerror( errno ) ) );
+            _ShmDomain_close( t );
+            Transport_free( t );
+            return NULL;
+        }
+    } else {
+        t->remote = ( u_char* )strdup( addr->sun_path );
+        t->remote_length = strlen( addr->sun_path );
+
+        if ( t->remote == NULL
+            || connect( sock, ( struct sockaddr* )addr, sizeof( struct sockaddr_un ) ) != 0 ) {
+            DEBUG_MSGTL( ( "priotShm", "couldn't connect to \"%s\", errno %d (%s)\n",
+                addr->sun_path, errno, strerror( errno ) ) );
+            close( sock );
+            Transport_free( t );
+            return NULL;
+        }
+        t->sock = _ShmDomain_channelAttach( d, sock );
+        if ( t->sock < 0 ) {
+            Transport_free( t );
+            return NULL;
+        }
+    }
+
+    /*
+     * A message longer than a ring is written in pieces as the reader
+     * makes room.
+     */
+    t->msgMaxSize = 0x7fffffff;
+    t->f_recv = _ShmDomain_recv;
+    t->f_send = _ShmDomain_send;
+    t->f_close = _ShmDomain_close;
+    t->f_accept = _ShmDomain_accept;
+    t->f_copy = _ShmDomain_copy;
+    t->f_fmtaddr = _ShmDomain_fmtaddr;
+
+    return t;
+}
+
+Transport_Transport* ShmDomain_createTstring( const char* string, int local, const char* default_target )
+{
+    struct sockaddr_un addr;
+
+    if ( string && *string != '\0' ) {
+    } else if ( default_target && *default_target != '\0' ) {
+        string = default_target;
+    }
+
+    if ( ( string != NULL && *string != '\0' ) && ( strlen( string ) < sizeof( addr.sun_path ) ) ) {
+        addr.sun_family = AF_UNIX;
+        memset( addr.sun_path, 0, sizeof( addr.sun_path ) );
+        String_copyTruncate( addr.sun_path, string, sizeof( addr.sun_path ) );
+        return ShmDomain_transport( &addr, local );
+    } else {
+        if ( string != NULL && *string != '\0' ) {
+            Logger_log( LOGGER_PRIORITY_ERR, "Path too long for shared memory transport\n" );
+        }
+        return NULL;
+    }
+}
+
+Transport_Transport* ShmDomain_createOstring( const u_char* o, size_t o_len, int local )
+{
+    struct sockaddr_un addr;
+
+    if ( o_len > 0 && o_len < ( sizeof( addr.sun_path ) - 1 ) ) {
+        addr.sun_family = AF_UNIX;
+        memset( addr.sun_path, 0, sizeof( addr.sun_path ) );
+        memcpy( addr.sun_path, o, o_len );
+        return ShmDomain_transport( &addr, local );
+    } else {
+        if ( o_len > 0 ) {
+            Logger_log( LOGGER_PRIORITY_ERR, "Path too long for shared memory transport\n" );
+        }
+    }
+    return NULL;
+}
+
+void ShmDomain_ctor( void )
+{
+    _shmDomain_shmDomain.name = shmDomain_priotShmDomain;
+    _shmDomain_shmDomain.name_length = sizeof( shmDomain_priotShmDomain ) / sizeof( oid );
+    _shmDomain_shmDomain.prefix = ( const char** )calloc( 2, sizeof( char* ) );
+    _shmDomain_shmDomain.prefix[ 0 ] = "shm";
+
+    _shmDomain_shmDomain.f_create_from_tstring = NULL;
+    _shmDomain_shmDomain.f_create_from_tstring_new = ShmDomain_createTstring;
+    _shmDomain_shmDomain.f_create_from_ostring = ShmDomain_createOstring;
+
+    Transport_tdomainRegister( &_shmDomain_shmDomain );
+}
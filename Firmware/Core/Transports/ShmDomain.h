@@ -0,0 +1,30 @@
+#ifndef SHMDOMAIN_H
+#define SHMDOMAIN_H
+
+#include "Transport.h"
+
+#include <sys/un.h>
+
+/*
+ * A local stream transport whose bytes go through a pair of single
+ * producer / single consumer rings in memory shared by the two ends, with
+ * an eventfd to wake the reader.  The Unix-domain socket named by the
+ * address ("shm:/path") is only used to hand the memory and the eventfds
+ * to a connecting peer, and to notice when it goes away.
+ */
+
+#define TRANSPORT_DOMAIN_SHM		1,3,6,1,4,1,8072,3,3,20
+extern oid shmDomain_priotShmDomain[];
+
+/* bytes in each direction; a power of two */
+#define SHMDOMAIN_RING_SIZE     ( 256 * 1024 )
+
+Transport_Transport *   ShmDomain_transport(struct sockaddr_un *addr, int local);
+
+Transport_Transport *   ShmDomain_createTstring(const char *string, int local, const char *default_target);
+
+Transport_Transport *   ShmDomain_createOstring(const u_char * o, size_t o_len, int local);
+
+void                ShmDomain_ctor(void);
+
+#endif // SHMDOMAIN_H
@@ -116,6 +116,37 @@ void AgentxConfig_parseAgentxRetries( const char* token, char* cptr )
         DsAgentInterger_AGENTX_RETRIES, x );
 }
 
+void AgentxConfig_parseAgentxWindow( const char* token, char* cptr )
+{
+    int x = atoi( cptr );
+    DEBUG_MSGTL( ( "agentx/config/window", "%s\n", cptr ) );
+    if ( x < 1 ) {
+        ReadConfig_configPerror( "Invalid window size" );
+        return;
+    }
+    DefaultStore_setInt( DsStore_APPLICATION_ID,
+        DsAgentInterger_AGENTX_WINDOW, x );
+}
+
+void AgentxConfig_parseAgentxPushCache( const char* token, char* cptr )
+{
+    int i = -1;
+
+    DEBUG_MSGTL( ( "agentx/config/pushcache", "%s\n", cptr ) );
+    if ( !strcmp( cptr, "yes" ) || !strcmp( cptr, "on" ) )
+        i = 1;
+    else if ( !strcmp( cptr, "no" ) || !strcmp( cptr, "off" ) )
+        i = 0;
+    else
+        i = atoi( cptr );
+
+    if ( i < 0 || i > 1 ) {
+        ReadConfig_error( "agentxPushCache '%s' unrecognised", cptr );
+    } else
+        DefaultStore_setBoolean( DsStore_APPLICATION_ID,
+            DsAgentBoolean_AGENTX_NO_PUSH_CACHE, !i );
+}
+
 /* ---------------------------------------------------------------------
  *
  * Sub-agent
@@ -172,6 +203,12 @@ void AgentxConfig_init( void )
         AgentxConfig_registerConfigHandler( "agentxTimeout",
             AgentxConfig_parseAgentxTimeout, NULL,
             "AgentX Timeout (seconds)" );
+        AgentxConfig_registerConfigHandler( "agentxWindow",
+            AgentxConfig_parseAgentxWindow, NULL,
+            "AgentX requests outstanding per subagent" );
+        AgentxConfig_registerConfigHandler( "agentxPushCache",
+            AgentxConfig_parseAgentxPushCache, NULL,
+            "accept values pushed by subagents (yes|no)" );
     }
 
     /*
@@ -1,5 +1,6 @@
 #include "Master.h"
 #include "../Plugin/Agentx/MasterAdmin.h"
+#include "MasterCache.h"
 #include "BulkToNext.h"
 #include "Client.h"
 #include "System/Util/Trace.h"
@@ -9,6 +10,7 @@
 #include "PriotSettings.h"
 #include "Protocol.h"
 #include "Session.h"
+#include "Transports/ShmDomain.h"
 #include "Transports/UnixDomain.h"
 #include "VarStruct.h"
 
@@ -90,10 +92,12 @@ void Master_realInitMaster( void )
                 Api_sessLogError( LOGGER_PRIORITY_WARNING, buf, &sess );
             }
         } else {
-            if ( t->domain == unixDomain_priotUnixDomain && t->local != NULL ) {
+            if ( ( t->domain == unixDomain_priotUnixDomain
+                     || t->domain == shmDomain_priotShmDomain )
+                && t->local != NULL ) {
                 /*
                  * Apply any settings to the ownership/permissions of the
-                 * AgentX socket
+                 * AgentX socket (for shm:, the one connections are made on)
                  */
                 int agentx_sock_perm = DefaultStore_getInt( DsStore_APPLICATION_ID,
                     DsAgentInterger_X_SOCK_PERM );
@@ -136,11 +140,167 @@ void Master_realInitMaster( void )
     DEBUG_MSGTL( ( "agentx/master", "initializing...   DONE\n" ) );
 }
 
+/*
+ * Counts the non-repeaters and the repeaters of a GETBULK, and the
+ * repetitions that fill the bulk cache of the longest repeater
+ */
+static void
+_Master_bulkShape( RequestInfo* requests, int* nonRepeaters, int* repeaters,
+    int* maxRepetitions )
+{
+    RequestInfo* request;
+
+    *nonRepeaters = *repeaters = *maxRepetitions = 0;
+    for ( request = requests; request; request = request->next ) {
+        if ( request->repeat > 0 ) {
+            ( *repeaters )++;
+            if ( request->repeat + 1 > *maxRepetitions )
+                *maxRepetitions = request->repeat + 1;
+        } else {
+            ( *nonRepeaters )++;
+        }
+    }
+    /* max-repetitions is 16 bits on the wire */
+    if ( *maxRepetitions > 0xffff )
+        *maxRepetitions = 0xffff;
+}
+
+/*
+ * Copies a subagent answer into the original request
+ */
+static void
+_Master_setResult( RequestInfo* request, VariableList* var )
+{
+
+    DEBUG_MSGTL( ( "agentx/master",
+        "  handle_agentx_response: processing: " ) );
+
+    DEBUG_MSGOID( ( "agentx/master", var->name, var->nameLength ) );
+
+    DEBUG_MSG( ( "agentx/master", "\n" ) );
+    if ( DefaultStore_getBoolean( DsStore_APPLICATION_ID, DsAgentBoolean_VERBOSE ) ) {
+
+        DEBUG_MSGTL( ( "agentx/master", "    >> " ) );
+
+        DEBUG_MSGVAR( ( "agentx/master", var ) );
+
+        DEBUG_MSG( ( "agentx/master", "\n" ) );
+    }
+
+    /*
+     * update the oid in the original request
+     */
+    if ( var->type != PRIOT_ENDOFMIBVIEW ) {
+        Client_setVarTypedValue( request->requestvb, var->type,
+            var->value.string, var->valueLength );
+        Client_setVarObjid( request->requestvb, var->name,
+            var->nameLength );
+    }
+}
+
+/*
+ * Merges the answer to an AgentX GetBulk into the bulk cache.
+ *
+ * The response holds one varbind per non-repeater, then rows of one varbind
+ * per repeater (RFC 2741, 7.2.3.2).  Each row moves a repeater on to its
+ * next repetition slot, as BulkToNext_fixRequests() does after a GETNEXT,
+ * until the subagent runs past the end of the registered range or of its
+ * MIB view; that slot is then left to be continued in the next subtree,
+ * as Agent_checkGetnextResults() would.  The subagent may return fewer
+ * rows than asked for; the repeaters still in range are then moved on by
+ * BulkToNext_fixRequests() and the agent asks again for the rest.
+ */
+int Master_mergeBulkResponse( RequestInfo* requests, VariableList* vars )
+{
+    RequestInfo** columns;
+    RequestInfo* request;
+    VariableList* var = vars;
+    int nonRepeaters, repeaters, maxRepetitions, row, j;
+
+    _Master_bulkShape( requests, &nonRepeaters, &repeaters, &maxRepetitions );
+
+    columns = ( RequestInfo** )calloc( repeaters + 1, sizeof( RequestInfo* ) );
+    if ( columns == NULL )
+        return ErrorCode_GENERR;
+
+    /*
+     * the non-repeaters and the first row must all be there
+     */
+    for ( request = requests; request; request = request->next ) {
+        if ( request->repeat > 0 )
+            continue;
+        if ( var == NULL )
+            goto bad;
+        _Master_setResult( request, var );
+        var = var->next;
+    }
+    for ( request = requests, j = 0; request; request = request->next ) {
+        if ( request->repeat <= 0 )
+            continue;
+        if ( var == NULL )
+            goto bad;
+        _Master_setResult( request, var );
+        if ( var->type != PRIOT_ENDOFMIBVIEW
+            && Api_oidCompare( var->name, var->nameLength,
+                   request->range_end, request->range_end_len )
+                < 0 )
+            columns[ j ] = request;
+        j++;
+        var = var->next;
+    }
+
+    for ( row = 1; row < maxRepetitions && var; row++ ) {
+        for ( j = 0; j < repeaters && var; j++, var = var->next ) {
+            request = columns[ j ];
+            if ( request == NULL )
+                continue;
+            if ( request->repeat <= 0 || request->requestvb->next == NULL ) {
+                columns[ j ] = NULL;
+                continue;
+            }
+            request->repeat--;
+            request->requestvb = request->requestvb->next;
+            if ( 2 == request->inclusive )
+                request->inclusive = 0;
+
+            if ( var->type == PRIOT_ENDOFMIBVIEW
+                || Api_oidCompare( var->name, var->nameLength,
+                       request->range_end, request->range_end_len )
+                    >= 0 ) {
+                /*
+                 * done with this subtree: carry on from the start of the
+                 * next one (see Agent_checkGetnextResults)
+                 */
+                DEBUG_MSGTL( ( "agentx/master", "  repeater %d done at row %d\n",
+                    request->index, row ) );
+                Client_setVarObjid( request->requestvb, request->range_end,
+                    request->range_end_len );
+                Client_setVarTypedValue( request->requestvb, asnNULL, NULL, 0 );
+                request->inclusive = 2;
+                columns[ j ] = NULL;
+                continue;
+            }
+            _Master_setResult( request, var );
+        }
+    }
+
+    MEMORY_FREE( columns );
+    if ( var != NULL )
+        return ErrorCode_GENERR;
+    BulkToNext_fixRequests( requests );
+    return ErrorCode_SUCCESS;
+
+bad:
+    MEMORY_FREE( columns );
+    return ErrorCode_GENERR;
+}
+
 /*
          * Handle the response from an AgentX subagent,
          *   merging the answers back into the original query
          */
-int Master_gotResponse( int operation,
+static int
+_Master_handleResponse( int operation,
     Types_Session* session,
     int reqid, Types_Pdu* pdu, void* magic )
 {
@@ -227,7 +387,7 @@ int Master_gotResponse( int operation,
         API_CLEAR_PRIOT_STRIKE_FLAGS( session->flags );
         break;
     default:
-        Logger_log( LOGGER_PRIORITY_ERR, "Unknown operation %d in Master_gotResponse\n",
+        Logger_log( LOGGER_PRIORITY_ERR, "Unknown operation %d in _Master_handleResponse\n",
             operation );
         AgentHandler_freeDelegatedCache( cache );
         return 0;
@@ -296,7 +456,21 @@ int Master_gotResponse( int operation,
 
         DEBUG_MSGTL( ( "agentx/master", "end error branch\n" ) );
         return 1;
-    } else if ( cache->reqinfo->mode == MODE_GET || cache->reqinfo->mode == MODE_GETNEXT || cache->reqinfo->mode == MODE_GETBULK ) {
+    } else if ( cache->reqinfo->mode == MODE_GETBULK ) {
+
+        DEBUG_MSGTL( ( "agentx/master",
+            "Master_gotResponse() merging getbulk...\n" ) );
+        if ( Master_mergeBulkResponse( requests, pdu->variables )
+            != ErrorCode_SUCCESS ) {
+            Logger_log( LOGGER_PRIORITY_ERR,
+                "response to agentx getbulk illegal.  bailing out.\n" );
+            Agent_setRequestError( cache->reqinfo, requests,
+                PRIOT_ERR_GENERR );
+        }
+        for ( request = requests; request; request = request->next ) {
+            request->delegated = REQUEST_IS_NOT_DELEGATED;
+        }
+    } else if ( cache->reqinfo->mode == MODE_GET || cache->reqinfo->mode == MODE_GETNEXT ) {
         /*
          * Replace varbinds for data request types, but not SETs.
          */
@@ -308,31 +482,7 @@ int Master_gotResponse( int operation,
             /*
              * Otherwise, process successful requests
              */
-
-            DEBUG_MSGTL( ( "agentx/master",
-                "  handle_agentx_response: processing: " ) );
-
-            DEBUG_MSGOID( ( "agentx/master", var->name, var->nameLength ) );
-
-            DEBUG_MSG( ( "agentx/master", "\n" ) );
-            if ( DefaultStore_getBoolean( DsStore_APPLICATION_ID, DsAgentBoolean_VERBOSE ) ) {
-
-                DEBUG_MSGTL( ( "agentx/master", "    >> " ) );
-
-                DEBUG_MSGVAR( ( "agentx/master", var ) );
-
-                DEBUG_MSG( ( "agentx/master", "\n" ) );
-            }
-
-            /*
-             * update the oid in the original request
-             */
-            if ( var->type != PRIOT_ENDOFMIBVIEW ) {
-                Client_setVarTypedValue( request->requestvb, var->type,
-                    var->value.string, var->valueLength );
-                Client_setVarObjid( request->requestvb, var->name,
-                    var->nameLength );
-            }
+            _Master_setResult( request, var );
             request->delegated = REQUEST_IS_NOT_DELEGATED;
         }
 
@@ -346,9 +496,6 @@ int Master_gotResponse( int operation,
             Agent_setRequestError( cache->reqinfo, requests,
                 PRIOT_ERR_GENERR );
         }
-
-        if ( cache->reqinfo->mode == MODE_GETBULK )
-            BulkToNext_fixRequests( requests );
     } else {
         /*
          * mark set requests as handled
@@ -364,6 +511,421 @@ int Master_gotResponse( int operation,
     return 1;
 }
 
+/*
+ * The AgentX PDU built by one Master_handler call.  Data requests wait in
+ * the session's pending queue until the window has room; then neighbouring
+ * GETs or GETNEXTs are sent as a single AgentX PDU, whose parts are chained
+ * through next and given to Master_gotResponse as its magic.
+ */
+typedef struct MasterRequest_s {
+    Types_Pdu* pdu;         /* NULL once handed to the session */
+    DelegatedCache* cache;  /* the requests it answers */
+    int count;              /* varbinds in pdu */
+    int windowed;           /* counted in MasterSession.outstanding */
+    int solo;               /* not to be coalesced again */
+    struct MasterRequest_s* next;
+} MasterRequest;
+
+MasterSession*
+Master_getSession( Types_Session* session )
+{
+    MasterSession* ms = ( MasterSession* )session->myvoid;
+
+    if ( ms == NULL ) {
+        ms = MEMORY_MALLOC_TYPEDEF( MasterSession );
+        if ( ms == NULL )
+            return NULL;
+        ms->cacheid = Agent_allocateGlobalcacheid();
+        session->myvoid = ms;
+    }
+    return ms;
+}
+
+/*
+ * Fails the requests of a part that won't get an answer, and frees it
+ */
+static void
+_Master_failRequest( MasterRequest* part )
+{
+    if ( AgentHandler_handlerCheckCache( part->cache ) ) {
+        AgentHandler_handlerMarkRequestsAsDelegated( part->cache->requests,
+            REQUEST_IS_NOT_DELEGATED );
+        Agent_setRequestError( part->cache->reqinfo, part->cache->requests,
+            PRIOT_ERR_GENERR );
+    }
+    AgentHandler_freeDelegatedCache( part->cache );
+    if ( part->pdu )
+        Api_freePdu( part->pdu );
+    free( part );
+}
+
+void Master_freeSession( Types_Session* session )
+{
+    MasterSession* ms = ( MasterSession* )session->myvoid;
+    MasterRequest* part;
+
+    if ( ms == NULL )
+        return;
+
+    /*
+     * what is in flight comes back through Master_gotResponse, but the
+     * queued requests will never be sent
+     */
+    while ( ( part = ms->pending ) != NULL ) {
+        ms->pending = part->next;
+        _Master_failRequest( part );
+    }
+    MasterCache_free( ms );
+    MEMORY_FREE( session->myvoid );
+}
+
+static int
+_Master_window( void )
+{
+    int window = DefaultStore_getInt( DsStore_APPLICATION_ID,
+        DsAgentInterger_AGENTX_WINDOW );
+
+    return window > 0 ? window : MASTER_WINDOW_DEFAULT;
+}
+
+/*
+ * Whether part can go out in the same AgentX PDU as first
+ */
+static int
+_Master_canCoalesce( MasterRequest* first, MasterRequest* part, int count )
+{
+    Types_Pdu *a = first->pdu, *b = part->pdu;
+
+    if ( first->solo || part->solo
+        || count + part->count > MASTER_COALESCE_MAX_VARBINDS )
+        return 0;
+    /* a GetBulk has its own non-repeaters and max-repetitions */
+    if ( a->command != b->command
+        || ( a->command != AGENTX_MSG_GET && a->command != AGENTX_MSG_GETNEXT ) )
+        return 0;
+    if ( a->sessid != b->sessid || a->flags != b->flags
+        || a->communityLen != b->communityLen )
+        return 0;
+    return a->communityLen == 0
+        || memcmp( a->community, b->community, a->communityLen ) == 0;
+}
+
+/*
+ * Sends a list of parts as one AgentX PDU, dropping those whose manager
+ * request has gone away while they were queued
+ */
+static void
+_Master_send( Types_Session* session, MasterSession* ms, MasterRequest* batch )
+{
+    MasterRequest *part, **prev;
+    VariableList* tail;
+    Types_Pdu* pdu;
+
+    for ( prev = &batch; ( part = *prev ) != NULL; ) {
+        if ( part->cache && AgentHandler_handlerCheckCache( part->cache ) == NULL ) {
+            DEBUG_MSGTL( ( "agentx/master", "dropping stale request %p\n", part ) );
+            *prev = part->next;
+            _Master_failRequest( part );
+        } else {
+            prev = &part->next;
+        }
+    }
+    if ( batch == NULL )
+        return;
+
+    if ( batch->next == NULL ) {
+        pdu = batch->pdu;
+        batch->pdu = NULL;
+    } else {
+        /*
+         * the parts keep their own PDUs, to be sent again on their own if
+         * another part makes the subagent fail the coalesced one
+         */
+        pdu = Client_clonePdu( batch->pdu );
+        tail = pdu ? pdu->variables : NULL;
+        if ( tail != NULL ) {
+            pdu->reqid = Api_getNextTransid();
+            while ( tail->next )
+                tail = tail->next;
+            for ( part = batch->next; part && tail; part = part->next ) {
+                tail->next = Client_cloneVarbind( part->pdu->variables );
+                while ( tail->next )
+                    tail = tail->next;
+            }
+        }
+    }
+
+    if ( pdu != NULL ) {
+        DEBUG_MSGTL( ( "agentx/master", "sending pdu (req=0x%x,trans=0x%x,sess=0x%x)\n",
+            ( unsigned )pdu->reqid, ( unsigned )pdu->transid, ( unsigned )pdu->sessid ) );
+        if ( Session_asyncSend( session, pdu, Master_gotResponse, batch ) == 0 ) {
+            Api_freePdu( pdu );
+            pdu = NULL;
+        }
+    }
+    if ( pdu == NULL ) {
+        while ( ( part = batch ) != NULL ) {
+            batch = part->next;
+            _Master_failRequest( part );
+        }
+        return;
+    }
+    if ( batch->windowed )
+        ms->outstanding++;
+}
+
+/*
+ * Sends queued requests while the window has room
+ */
+static void
+_Master_flush( Types_Session* session, MasterSession* ms )
+{
+    MasterRequest *batch, *last;
+    int window = _Master_window();
+    int count;
+
+    while ( ms->pending != NULL && ms->outstanding < window ) {
+        batch = last = ms->pending;
+        count = batch->count;
+        while ( last->next && _Master_canCoalesce( batch, last->next, count ) ) {
+            last = last->next;
+            count += last->count;
+        }
+        ms->pending = last->next;
+        if ( ms->pending == NULL )
+            ms->pendingTail = NULL;
+        last->next = NULL;
+
+        if ( batch != last )
+            DEBUG_MSGTL( ( "agentx/master", "coalesced %d varbinds\n", count ) );
+        _Master_send( session, ms, batch );
+    }
+}
+
+/*
+ * Puts parts back at the head of the queue, to be sent on their own
+ */
+static void
+_Master_requeue( Types_Session* session, MasterRequest* parts )
+{
+    MasterSession* ms = ( MasterSession* )session->myvoid;
+    MasterRequest *part, *last = NULL;
+
+    if ( ms == NULL ) {
+        while ( ( part = parts ) != NULL ) {
+            parts = part->next;
+            _Master_failRequest( part );
+        }
+        return;
+    }
+    for ( part = parts; part; part = part->next ) {
+        part->solo = 1;
+        last = part;
+    }
+    if ( last == NULL )
+        return;
+    last->next = ms->pending;
+    ms->pending = parts;
+    if ( ms->pendingTail == NULL )
+        ms->pendingTail = last;
+}
+
+/*
+ * The response callback: hands each part of the AgentX PDU its share of
+ * the answer.  A subagent error is reported to the part whose varbind
+ * caused it; the other parts of a coalesced PDU are sent again on their
+ * own, as the subagent did not process them.
+ */
+int Master_gotResponse( int operation,
+    Types_Session* session,
+    int reqid, Types_Pdu* pdu, void* magic )
+{
+    MasterRequest *batch = ( MasterRequest* )magic, *part, *next;
+    MasterRequest *resend = NULL, **resendTail = &resend;
+    MasterSession* ms;
+    VariableList *head, *vars, *first, *last;
+    long errindex;
+    int i, offset, ret = 1;
+
+    if ( batch == NULL ) {
+        DEBUG_MSGTL( ( "agentx/master", "response too late on session %8p\n",
+            session ) );
+        return 0;
+    }
+
+    ms = ( MasterSession* )session->myvoid;
+    if ( batch->windowed && ms && ms->outstanding > 0 )
+        ms->outstanding--;
+
+    if ( batch->next == NULL ) {
+        ret = _Master_handleResponse( operation, session, reqid, pdu,
+            batch->cache );
+        if ( batch->pdu )
+            Api_freePdu( batch->pdu );
+        free( batch );
+    } else if ( operation != API_CALLBACK_OP_RECEIVED_MESSAGE ) {
+        /*
+         * the first part closes the session as need be
+         */
+        ret = _Master_handleResponse( operation, session, reqid, pdu,
+            batch->cache );
+        part = batch->next;
+        Api_freePdu( batch->pdu );
+        free( batch );
+        for ( ; part; part = next ) {
+            next = part->next;
+            _Master_failRequest( part );
+        }
+        return ret;
+    } else {
+        head = vars = pdu->variables;
+        errindex = pdu->errindex;
+        offset = 0;
+        for ( part = batch; part; part = next ) {
+            next = part->next;
+            first = vars;
+            last = NULL;
+            for ( i = 0; i < part->count && vars; i++ ) {
+                last = vars;
+                vars = vars->next;
+            }
+
+            if ( pdu->errstat != AGENTX_ERR_NOERROR
+                && ( errindex <= offset || errindex > offset + part->count ) ) {
+                /*
+                 * not the failed varbind: this part wasn't processed
+                 */
+                offset += part->count;
+                part->next = NULL;
+                *resendTail = part;
+                resendTail = &part->next;
+                continue;
+            }
+
+            /*
+             * hand the part its own varbinds and error index
+             */
+            if ( last )
+                last->next = NULL;
+            pdu->variables = first;
+            pdu->errindex = errindex - offset;
+            _Master_handleResponse( operation, session, reqid, pdu,
+                part->cache );
+            if ( last )
+                last->next = vars;
+            offset += part->count;
+
+            Api_freePdu( part->pdu );
+            free( part );
+        }
+        pdu->variables = head;
+        pdu->errindex = errindex;
+        _Master_requeue( session, resend );
+    }
+
+    ms = ( MasterSession* )session->myvoid;
+    if ( operation == API_CALLBACK_OP_RECEIVED_MESSAGE && ms != NULL )
+        _Master_flush( session, ms );
+    return ret;
+}
+
+/*
+ * Adds the AgentX varbind for a request, scoped to the registered range
+ * for the GETNEXT and GETBULK searches
+ */
+static void
+_Master_addRequest( Types_Pdu* pdu, int mode, RequestInfo* request )
+{
+    size_t nlen = request->requestvb->nameLength;
+    oid* nptr = request->requestvb->name;
+
+    DEBUG_MSGTL( ( "agentx/master", "request for variable (" ) );
+
+    DEBUG_MSGOID( ( "agentx/master", nptr, nlen ) );
+
+    DEBUG_MSG( ( "agentx/master", ")\n" ) );
+
+    if ( mode == MODE_GETNEXT || mode == MODE_GETBULK ) {
+
+        if ( Api_oidCompare( nptr, nlen, request->subtree->start_a,
+                 request->subtree->start_len )
+            < 0 ) {
+
+            DEBUG_MSGTL( ( "agentx/master", "inexact request preceeding region (" ) );
+
+            DEBUG_MSGOID( ( "agentx/master", request->subtree->start_a,
+                request->subtree->start_len ) );
+
+            DEBUG_MSG( ( "agentx/master", ")\n" ) );
+            nptr = request->subtree->start_a;
+            nlen = request->subtree->start_len;
+            request->inclusive = 1;
+        }
+
+        if ( request->inclusive ) {
+
+            DEBUG_MSGTL( ( "agentx/master", "INCLUSIVE varbind " ) );
+
+            DEBUG_MSGOID( ( "agentx/master", nptr, nlen ) );
+
+            DEBUG_MSG( ( "agentx/master", " scoped to " ) );
+
+            DEBUG_MSGOID( ( "agentx/master", request->range_end,
+                request->range_end_len ) );
+
+            DEBUG_MSG( ( "agentx/master", "\n" ) );
+            Api_pduAddVariable( pdu, nptr, nlen, asnPRIV_INCL_RANGE,
+                ( u_char* )request->range_end,
+                request->range_end_len * sizeof( oid ) );
+            request->inclusive = 0;
+        } else {
+
+            DEBUG_MSGTL( ( "agentx/master", "EXCLUSIVE varbind " ) );
+
+            DEBUG_MSGOID( ( "agentx/master", nptr, nlen ) );
+
+            DEBUG_MSG( ( "agentx/master", " scoped to " ) );
+
+            DEBUG_MSGOID( ( "agentx/master", request->range_end,
+                request->range_end_len ) );
+
+            DEBUG_MSG( ( "agentx/master", "\n" ) );
+            Api_pduAddVariable( pdu, nptr, nlen, asnPRIV_EXCL_RANGE,
+                ( u_char* )request->range_end,
+                request->range_end_len * sizeof( oid ) );
+        }
+    } else {
+        Api_pduAddVariable( pdu, request->requestvb->name,
+            request->requestvb->nameLength,
+            request->requestvb->type,
+            request->requestvb->value.string,
+            request->requestvb->valueLength );
+    }
+}
+
+/*
+ * Answers the requests from the values the subagent pushed if they are all
+ * there; otherwise they all go to the subagent
+ */
+static int
+_Master_answerFromCache( MasterSession* ms, int mode, RequestInfo* requests )
+{
+    RequestInfo* request;
+
+    MasterCache_expire( ms );
+    for ( request = requests; request; request = request->next ) {
+        if ( MasterCache_find( ms, mode, request ) == NULL )
+            return 0;
+    }
+
+    DEBUG_MSGTL( ( "agentx/master", "answering from pushed values\n" ) );
+    for ( request = requests; request; request = request->next ) {
+        _Master_setResult( request, MasterCache_find( ms, mode, request ) );
+        request->inclusive = 0;
+    }
+    return 1;
+}
+
 /*
  *
  * AgentX State diagram.  [mode] = internal mode it's mapped from:
@@ -385,8 +947,11 @@ int Master_handler( MibHandler* handler,
     Types_Session* ax_session = ( Types_Session* )handler->myvoid;
     RequestInfo* request = requests;
     Types_Pdu* pdu;
-    void* cb_data;
+    VariableList* var;
+    MasterRequest* part;
+    MasterSession* ms;
     int result;
+    int nonRepeaters, repeaters, maxRepetitions;
 
     DEBUG_MSGTL( ( "agentx/master",
         "agentx master handler starting, mode = 0x%02x\n",
@@ -396,6 +961,27 @@ int Master_handler( MibHandler* handler,
         Agent_setRequestError( reqinfo, requests, PRIOT_ERR_GENERR );
         return PRIOT_ERR_NOERROR;
     }
+    ms = Master_getSession( ax_session );
+
+    /*
+     * the values the subagent pushed spare the round trip; a SET drops
+     * those it may change
+     */
+    switch ( reqinfo->mode ) {
+    case MODE_GET:
+    case MODE_GETNEXT:
+        if ( ms != NULL && ms->snapshots != NULL && reginfo->contextName == NULL
+            && _Master_answerFromCache( ms, reqinfo->mode, requests ) )
+            return PRIOT_ERR_NOERROR;
+        break;
+
+    case MODE_SET_RESERVE1:
+    case MODE_SET_COMMIT:
+        for ( request = requests; ms != NULL && request; request = request->next )
+            MasterCache_invalidate( ms, request->requestvb->name,
+                request->requestvb->nameLength );
+        break;
+    }
 
     /*
      * build a new pdu based on the pdu type coming in
@@ -409,8 +995,22 @@ int Master_handler( MibHandler* handler,
         pdu = Client_pduCreate( AGENTX_MSG_GETNEXT );
         break;
 
-    case MODE_GETBULK: /* WWWXXX */
-        pdu = Client_pduCreate( AGENTX_MSG_GETNEXT );
+    case MODE_GETBULK:
+        /*
+         * forward the repetitions in one GetBulk rather than a GetNext
+         * round trip each
+         */
+        _Master_bulkShape( requests, &nonRepeaters, &repeaters,
+            &maxRepetitions );
+        if ( maxRepetitions > 0 ) {
+            pdu = Client_pduCreate( AGENTX_MSG_GETBULK );
+            if ( pdu ) {
+                pdu->non_repeaters = nonRepeaters;
+                pdu->max_repetitions = maxRepetitions;
+            }
+        } else {
+            pdu = Client_pduCreate( AGENTX_MSG_GETNEXT );
+        }
         break;
 
     case MODE_SET_RESERVE1:
@@ -460,77 +1060,24 @@ int Master_handler( MibHandler* handler,
     if ( ax_session->subsession->flags & AGENTX_MSG_FLAG_NETWORK_BYTE_ORDER )
         pdu->flags |= AGENTX_MSG_FLAG_NETWORK_BYTE_ORDER;
 
-    while ( request ) {
-
-        size_t nlen = request->requestvb->nameLength;
-        oid* nptr = request->requestvb->name;
-
-        DEBUG_MSGTL( ( "agentx/master", "request for variable (" ) );
-
-        DEBUG_MSGOID( ( "agentx/master", nptr, nlen ) );
-
-        DEBUG_MSG( ( "agentx/master", ")\n" ) );
-
-        /*
-         * loop through all the requests and create agentx ones out of them
-         */
-
-        if ( reqinfo->mode == MODE_GETNEXT || reqinfo->mode == MODE_GETBULK ) {
-
-            if ( Api_oidCompare( nptr, nlen, request->subtree->start_a,
-                     request->subtree->start_len )
-                < 0 ) {
-
-                DEBUG_MSGTL( ( "agentx/master", "inexact request preceeding region (" ) );
-
-                DEBUG_MSGOID( ( "agentx/master", request->subtree->start_a,
-                    request->subtree->start_len ) );
-
-                DEBUG_MSG( ( "agentx/master", ")\n" ) );
-                nptr = request->subtree->start_a;
-                nlen = request->subtree->start_len;
-                request->inclusive = 1;
-            }
-
-            if ( request->inclusive ) {
-
-                DEBUG_MSGTL( ( "agentx/master", "INCLUSIVE varbind " ) );
-
-                DEBUG_MSGOID( ( "agentx/master", nptr, nlen ) );
-
-                DEBUG_MSG( ( "agentx/master", " scoped to " ) );
-
-                DEBUG_MSGOID( ( "agentx/master", request->range_end,
-                    request->range_end_len ) );
-
-                DEBUG_MSG( ( "agentx/master", "\n" ) );
-                Api_pduAddVariable( pdu, nptr, nlen, asnPRIV_INCL_RANGE,
-                    ( u_char* )request->range_end,
-                    request->range_end_len * sizeof( oid ) );
-                request->inclusive = 0;
-            } else {
-
-                DEBUG_MSGTL( ( "agentx/master", "EXCLUSIVE varbind " ) );
-
-                DEBUG_MSGOID( ( "agentx/master", nptr, nlen ) );
-
-                DEBUG_MSG( ( "agentx/master", " scoped to " ) );
-
-                DEBUG_MSGOID( ( "agentx/master", request->range_end,
-                    request->range_end_len ) );
-
-                DEBUG_MSG( ( "agentx/master", "\n" ) );
-                Api_pduAddVariable( pdu, nptr, nlen, asnPRIV_EXCL_RANGE,
-                    ( u_char* )request->range_end,
-                    request->range_end_len * sizeof( oid ) );
-            }
-        } else {
-            Api_pduAddVariable( pdu, request->requestvb->name,
-                request->requestvb->nameLength,
-                request->requestvb->type,
-                request->requestvb->value.string,
-                request->requestvb->valueLength );
+    /*
+     * a GetBulk wants the non-repeaters first
+     */
+    if ( pdu->command == AGENTX_MSG_GETBULK ) {
+        for ( request = requests; request; request = request->next ) {
+            if ( request->repeat <= 0 )
+                _Master_addRequest( pdu, reqinfo->mode, request );
         }
+        for ( request = requests; request; request = request->next ) {
+            if ( request->repeat > 0 )
+                _Master_addRequest( pdu, reqinfo->mode, request );
+        }
+    } else {
+        for ( request = requests; request; request = request->next )
+            _Master_addRequest( pdu, reqinfo->mode, request );
+    }
+
+    for ( request = requests; request; request = request->next ) {
 
         /*
          * mark the request as delayed
@@ -539,11 +1086,6 @@ int Master_handler( MibHandler* handler,
             request->delegated = REQUEST_IS_DELEGATED;
         else
             request->delegated = REQUEST_IS_NOT_DELEGATED;
-
-        /*
-         * next...
-         */
-        request = request->next;
     }
 
     /*
@@ -551,22 +1093,49 @@ int Master_handler( MibHandler* handler,
      * back from the subagent. So we shouldn't allocate the
      * netsnmp_delegated_cache structure in this case.
      */
-    if ( pdu->command != AGENTX_MSG_CLEANUPSET )
-        cb_data = AgentHandler_createDelegatedCache( handler, reginfo,
+    if ( pdu->command == AGENTX_MSG_CLEANUPSET ) {
+        DEBUG_MSGTL( ( "agentx/master", "sending pdu (req=0x%x,trans=0x%x,sess=0x%x)\n",
+            ( unsigned )pdu->reqid, ( unsigned )pdu->transid, ( unsigned )pdu->sessid ) );
+        result = Session_asyncSend( ax_session, pdu, Master_gotResponse, NULL );
+        if ( result == 0 ) {
+            Api_freePdu( pdu );
+        }
+        return PRIOT_ERR_NOERROR;
+    }
+
+    part = MEMORY_MALLOC_TYPEDEF( MasterRequest );
+    if ( part != NULL )
+        part->cache = AgentHandler_createDelegatedCache( handler, reginfo,
             reqinfo, requests,
             ( void* )ax_session );
-    else
-        cb_data = NULL;
+    if ( part == NULL || part->cache == NULL ) {
+        MEMORY_FREE( part );
+        Api_freePdu( pdu );
+        AgentHandler_handlerMarkRequestsAsDelegated( requests,
+            REQUEST_IS_NOT_DELEGATED );
+        Agent_setRequestError( reqinfo, requests, PRIOT_ERR_GENERR );
+        return PRIOT_ERR_NOERROR;
+    }
+    part->pdu = pdu;
+    for ( var = pdu->variables; var; var = var->next )
+        part->count++;
 
     /*
-     * send the requests out.
+     * send the requests out: the data requests through the window, the
+     * SET phases (which run alone) straight away.
      */
-
-    DEBUG_MSGTL( ( "agentx/master", "sending pdu (req=0x%x,trans=0x%x,sess=0x%x)\n",
-        ( unsigned )pdu->reqid, ( unsigned )pdu->transid, ( unsigned )pdu->sessid ) );
-    result = Session_asyncSend( ax_session, pdu, Master_gotResponse, cb_data );
-    if ( result == 0 ) {
-        Api_freePdu( pdu );
+    if ( ms != NULL
+        && ( pdu->command == AGENTX_MSG_GET || pdu->command == AGENTX_MSG_GETNEXT
+               || pdu->command == AGENTX_MSG_GETBULK ) ) {
+        part->windowed = 1;
+        if ( ms->pendingTail != NULL )
+            ms->pendingTail->next = part;
+        else
+            ms->pending = part;
+        ms->pendingTail = part;
+        _Master_flush( ax_session, ms );
+    } else {
+        _Master_send( ax_session, ms, part );
     }
 
     return PRIOT_ERR_NOERROR;
@@ -3,10 +3,46 @@
 
 #include "AgentHandler.h"
 
+/*
+ * The state the master keeps for each subagent transport session, in its
+ * myvoid.  Data requests beyond the window of outstanding AgentX PDUs wait
+ * in the pending queue, where those for the same subagent are coalesced.
+ * Values the subagent pushed are kept in snapshots (see MasterCache.h).
+ */
+typedef struct MasterSession_s {
+    int cacheid;     /* global cache id shared by the session's registrations */
+    int outstanding; /* windowed PDUs sent and not answered yet */
+    struct MasterRequest_s* pending;
+    struct MasterRequest_s* pendingTail;
+    int push;        /* cache pushes were negotiated at open */
+    struct MasterSnapshot_s* snapshots;
+} MasterSession;
+
+/* outstanding AgentX PDUs per subagent when agentxWindow isn't set */
+#define MASTER_WINDOW_DEFAULT 8
+
+/* the most varbinds coalesced into one AgentX PDU */
+#define MASTER_COALESCE_MAX_VARBINDS 64
+
 void
 Master_realInitMaster( void );
 
 NodeHandlerFT
 Master_handler;
 
+int
+Master_gotResponse( int operation, Types_Session* session,
+    int reqid, Types_Pdu* pdu, void* magic );
+
+MasterSession*
+Master_getSession( Types_Session* session );
+
+void
+Master_freeSession( Types_Session* session );
+
+/** Merges the varbinds of an AgentX GetBulk response into the bulk cache
+ *  of the requests it answers */
+int
+Master_mergeBulkResponse( RequestInfo* requests, VariableList* vars );
+
 #endif // MASTER_H
@@ -7,6 +7,9 @@
 #include "AgentIndex.h"
 #include "SysORTable.h"
 #include "Master.h"
+#include "MasterCache.h"
+#include "System/Util/DefaultStore.h"
+#include "DsAgent.h"
 #include "Client.h"
 #include "Trap.h"
 
@@ -14,6 +17,18 @@
  *  AgentX Administrative request handling
  */
 
+/*
+ * What sessid pushed can't be trusted once its registrations change
+ */
+static void
+_MasterAdmin_dropPushed(Types_Session * session, long sessid)
+{
+    MasterSession  *ms = (MasterSession *) session->myvoid;
+
+    if (ms != NULL)
+        MasterCache_dropSession(ms, sessid);
+}
+
 Types_Session *
 MasterAdmin_findAgentxSession(Types_Session * session, int sessid)
 {
@@ -99,6 +114,7 @@ MasterAdmin_closeAgentxSession(Types_Session * session, int sessid)
          * requests, so that the delegated request will be completed and
          * further requests can be processed
          */
+        Master_freeSession(session);
         Agent_removeDelegatedRequestsForSession(session);
         if (session->subsession != NULL) {
             Types_Session *subsession = session->subsession;
@@ -110,7 +126,6 @@ MasterAdmin_closeAgentxSession(Types_Session * session, int sessid)
         AgentRegistry_unregisterMibsBySession(session);
         AgentIndex_unregisterIndexBySession(session);
         SysORTable_unregisterSysORTableBySession(session);
-        MEMORY_FREE(session->myvoid);
         return AGENTX_ERR_NOERROR;
     }
 
@@ -119,6 +134,7 @@ MasterAdmin_closeAgentxSession(Types_Session * session, int sessid)
     for (sp = session->subsession; sp != NULL; sp = sp->next) {
 
         if (sp->sessid == sessid) {
+            _MasterAdmin_dropPushed(session, sessid);
             AgentRegistry_unregisterMibsBySession(sp);
             AgentIndex_unregisterIndexBySession(sp);
             SysORTable_unregisterSysORTableBySession(sp);
@@ -154,8 +170,8 @@ MasterAdmin_registerAgentxList(Types_Session * session, Types_Pdu *pdu)
     oid             ubound = 0;
     u_long          flags = 0;
     HandlerRegistration *reg;
+    MasterSession  *ms;
     int             rc = 0;
-    int             cacheid;
 
     DEBUG_MSGTL(("agentx/master", "in MasterAdmin_registerAgentxList\n"));
 
@@ -177,17 +193,13 @@ MasterAdmin_registerAgentxList(Types_Session * session, Types_Pdu *pdu)
         flags = FULLY_QUALIFIED_INSTANCE;
     }
 
-    reg = AgentHandler_createHandlerRegistration(buf, Master_handler, pdu->variables->name, pdu->variables->nameLength, HANDLER_CAN_RWRITE | HANDLER_CAN_GETBULK); /* fake it */
-    if (!session->myvoid) {
-        session->myvoid = malloc(sizeof(cacheid));
-        cacheid = Agent_allocateGlobalcacheid();
-        *((int *) session->myvoid) = cacheid;
-    } else {
-        cacheid = *((int *) session->myvoid);
-    }
+    ms = Master_getSession(session);
+    if (ms == NULL)
+        return AGENTX_ERR_PROCESSING_ERROR;
 
+    reg = AgentHandler_createHandlerRegistration(buf, Master_handler, pdu->variables->name, pdu->variables->nameLength, HANDLER_CAN_RWRITE | HANDLER_CAN_GETBULK); /* fake it */
     reg->handler->myvoid = session;
-    reg->global_cacheid = cacheid;
+    reg->global_cacheid = ms->cacheid;
     if (NULL != pdu->community)
         reg->contextName = strdup((char *)pdu->community);
 
@@ -229,6 +241,7 @@ MasterAdmin_unregisterAgentxList(Types_Session * session, Types_Pdu *pdu)
     if (sp == NULL) {
         return AGENTX_ERR_NOT_OPEN;
     }
+    _MasterAdmin_dropPushed(session, sp->sessid);
 
     if (pdu->range_subid != 0) {
         oid             ubound =
@@ -429,6 +442,28 @@ MasterAdmin_agentxPingResponse(Types_Session * session, Types_Pdu *pdu)
         return AGENTX_ERR_NOERROR;
 }
 
+/*
+ * Values a subagent pushed for the master to answer from; there is no
+ * response to these, so one that can't be used is just dropped
+ */
+void
+MasterAdmin_agentxCachePush(Types_Session * session, Types_Pdu *pdu)
+{
+    Types_Session  *sp;
+    MasterSession  *ms;
+
+    sp = MasterAdmin_findAgentxSession(session, pdu->sessid);
+    if (sp == NULL)
+        return;
+    ms = Master_getSession(session);
+    if (ms == NULL || !ms->push || pdu->community != NULL) {
+        DEBUG_MSGTL(("agentx/master", "ignoring cache push on %8p\n",
+                    session));
+        return;
+    }
+    MasterCache_store(ms, sp, pdu);
+}
+
 int
 MasterAdmin_handleMasterAgentxPacket(int operation,
                             Types_Session * session,
@@ -458,6 +493,11 @@ MasterAdmin_handleMasterAgentxPacket(int operation,
      * Okay, it's a API_CALLBACK_OP_RECEIVED_MESSAGE op.
      */
 
+    if (pdu->command == AGENTX_MSG_CACHE_PUSH) {
+        MasterAdmin_agentxCachePush(session, pdu);
+        return 1;
+    }
+
     if (magic) {
         asp = (AgentSession *) magic;
     } else {
@@ -473,6 +513,17 @@ MasterAdmin_handleMasterAgentxPacket(int operation,
         asp->pdu->sessid = MasterAdmin_openAgentxSession(session, pdu);
         if (asp->pdu->sessid == -1)
             asp->status = session->s_snmp_errno;
+        /*
+         * the flag is echoed back to say the pushes will be used
+         */
+        if (asp->pdu->sessid != -1
+            && (pdu->flags & AGENTX_MSG_FLAG_CACHE_PUSH)
+            && !DefaultStore_getBoolean(DsStore_APPLICATION_ID,
+                                        DsAgentBoolean_AGENTX_NO_PUSH_CACHE)
+            && Master_getSession(session) != NULL)
+            Master_getSession(session)->push = 1;
+        else
+            asp->pdu->flags &= ~AGENTX_MSG_FLAG_CACHE_PUSH;
         break;
 
     case AGENTX_MSG_CLOSE:
@@ -527,6 +578,7 @@ MasterAdmin_handleMasterAgentxPacket(int operation,
     case AGENTX_MSG_UNDOSET:
     case AGENTX_MSG_CLEANUPSET:
     case AGENTX_MSG_RESPONSE:
+    case AGENTX_MSG_CACHE_PUSH:
         /*
          * Shouldn't be handled here
          */
@@ -0,0 +1,260 @@
+#include "MasterCache.h"
+#include "AgentRegistry.h"
+#include "Api.h"
+#include "Priot.h"
+#include "System/Util/Time.h"
+#include "System/Util/Trace.h"
+#include "VarStruct.h"
+#include <sys/time.h>
+
+static void
+_MasterCache_freeSnapshot( MasterSnapshot* snap )
+{
+    size_t i;
+
+    for ( i = 0; i < snap->count; i++ )
+        Api_freeVar( snap->vars[ i ] );
+    free( snap->vars );
+    free( snap );
+}
+
+static int
+_MasterCache_compare( const void* a, const void* b )
+{
+    const VariableList* va = *( VariableList* const* )a;
+    const VariableList* vb = *( VariableList* const* )b;
+
+    return Api_oidCompare( va->name, va->nameLength, vb->name, vb->nameLength );
+}
+
+/*
+ * The index of the first value not before name
+ */
+static size_t
+_MasterCache_lowerBound( const MasterSnapshot* snap, const oid* name, size_t len )
+{
+    size_t lo = 0, hi = snap->count, mid;
+
+    while ( lo < hi ) {
+        mid = lo + ( hi - lo ) / 2;
+        if ( Api_oidCompare( snap->vars[ mid ]->name, snap->vars[ mid ]->nameLength,
+                 name, len )
+            < 0 )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * Whether sp answers for the whole of the subtree: the registrations from
+ * its start to its end, however the registry split them, all have to be
+ * its own and follow one another
+ */
+static int
+_MasterCache_registered( Types_Session* sp, const oid* subtree, size_t len )
+{
+    oid end[ TYPES_MAX_OID_LEN ];
+    Subtree *tp, *next;
+
+    if ( len == 0 || subtree[ len - 1 ] == TYPES_OID_MAX_SUBID )
+        return 0;
+    memcpy( end, subtree, len * sizeof( oid ) );
+    end[ len - 1 ]++;
+
+    tp = AgentRegistry_subtreeFind( subtree, len, NULL, NULL );
+    if ( tp == NULL || tp->session != sp )
+        return 0;
+    while ( Api_oidCompare( tp->end_a, tp->end_len, end, len ) < 0 ) {
+        next = tp->next;
+        if ( next == NULL || next->session != sp
+            || Api_oidCompare( next->start_a, next->start_len, tp->end_a, tp->end_len ) != 0 )
+            return 0;
+        tp = next;
+    }
+    return 1;
+}
+
+void MasterCache_store( MasterSession* ms, Types_Session* sp, Types_Pdu* pdu )
+{
+    VariableList *head = pdu->variables, *var, *next;
+    MasterSnapshot* snap;
+    size_t count = 0;
+    long ttl = pdu->time;
+
+    if ( head == NULL || head->nameLength > TYPES_MAX_OID_LEN )
+        return;
+    if ( !_MasterCache_registered( sp, head->name, head->nameLength ) ) {
+        DEBUG_MSGTL( ( "agentx/master/cache", "session %ld pushed unregistered ",
+            sp->sessid ) );
+        DEBUG_MSGOID( ( "agentx/master/cache", head->name, head->nameLength ) );
+        DEBUG_MSG( ( "agentx/master/cache", "\n" ) );
+        return;
+    }
+
+    MasterCache_invalidate( ms, head->name, head->nameLength );
+    if ( ttl <= 0 )
+        return;
+    if ( ttl > MASTER_CACHE_MAX_TTL )
+        ttl = MASTER_CACHE_MAX_TTL;
+
+    for ( var = head->next; var; var = var->next )
+        count++;
+    snap = MEMORY_MALLOC_TYPEDEF( MasterSnapshot );
+    if ( snap == NULL )
+        return;
+    snap->vars = ( VariableList** )calloc( count ? count : 1, sizeof( VariableList* ) );
+    if ( snap->vars == NULL ) {
+        free( snap );
+        return;
+    }
+    memcpy( snap->subtree, head->name, head->nameLength * sizeof( oid ) );
+    snap->subtreeLen = head->nameLength;
+    snap->sessid = sp->sessid;
+
+    /*
+     * take the varbinds over from the PDU rather than copying them; those
+     * outside the subtree, or exceptions, are of no use
+     */
+    for ( var = head->next; var; var = next ) {
+        next = var->next;
+        var->next = NULL;
+        if ( Api_oidIsSubtree( snap->subtree, snap->subtreeLen, var->name,
+                 var->nameLength )
+                == 0
+            && var->type != PRIOT_NOSUCHOBJECT && var->type != PRIOT_NOSUCHINSTANCE
+            && var->type != PRIOT_ENDOFMIBVIEW )
+            snap->vars[ snap->count++ ] = var;
+        else
+            Api_freeVar( var );
+    }
+    head->next = NULL;
+    qsort( snap->vars, snap->count, sizeof( VariableList* ), _MasterCache_compare );
+
+    Time_getMonotonicClock( &snap->expires );
+    snap->expires.tv_sec += ttl;
+    snap->next = ms->snapshots;
+    ms->snapshots = snap;
+
+    DEBUG_MSGTL( ( "agentx/master/cache", "%d values for ", ( int )snap->count ) );
+    DEBUG_MSGOID( ( "agentx/master/cache", snap->subtree, snap->subtreeLen ) );
+    DEBUG_MSG( ( "agentx/master/cache", " for %lds\n", ttl ) );
+}
+
+VariableList*
+MasterCache_find( MasterSession* ms, int mode, RequestInfo* request )
+{
+    const oid* name = request->requestvb->name;
+    size_t len = request->requestvb->nameLength;
+    int inclusive = request->inclusive;
+    MasterSnapshot* snap;
+    size_t i;
+
+    /*
+     * as for the subagent, a GETNEXT before the registration starts at it
+     */
+    if ( mode == MODE_GETNEXT
+        && Api_oidCompare( name, len, request->subtree->start_a,
+               request->subtree->start_len )
+            < 0 ) {
+        name = request->subtree->start_a;
+        len = request->subtree->start_len;
+        inclusive = 1;
+    }
+
+    /*
+     * snapshots don't overlap, so only one can hold the answer
+     */
+    for ( snap = ms->snapshots; snap; snap = snap->next ) {
+        if ( Api_oidIsSubtree( snap->subtree, snap->subtreeLen, name, len ) != 0 )
+            continue;
+        if ( request->subtree->session == NULL
+            || request->subtree->session->sessid != snap->sessid )
+            return NULL;
+
+        i = _MasterCache_lowerBound( snap, name, len );
+        if ( i < snap->count && mode == MODE_GETNEXT && !inclusive
+            && Api_oidEquals( snap->vars[ i ]->name, snap->vars[ i ]->nameLength,
+                   name, len )
+                == 0 )
+            i++;
+        if ( i == snap->count )
+            return NULL; /* what follows the snapshot isn't known */
+
+        if ( mode == MODE_GET )
+            return Api_oidEquals( snap->vars[ i ]->name, snap->vars[ i ]->nameLength,
+                       name, len )
+                    == 0
+                ? snap->vars[ i ]
+                : NULL;
+
+        if ( request->range_end
+            && Api_oidCompare( snap->vars[ i ]->name, snap->vars[ i ]->nameLength,
+                   request->range_end, request->range_end_len )
+                >= 0 )
+            return NULL;
+        return snap->vars[ i ];
+    }
+    return NULL;
+}
+
+void MasterCache_expire( MasterSession* ms )
+{
+    MasterSnapshot **prev, *snap;
+    struct timeval now;
+
+    if ( ms->snapshots == NULL )
+        return;
+
+    Time_getMonotonicClock( &now );
+    for ( prev = &ms->snapshots; ( snap = *prev ) != NULL; ) {
+        if ( timercmp( &snap->expires, &now, < ) ) {
+            *prev = snap->next;
+            _MasterCache_freeSnapshot( snap );
+        } else {
+            prev = &snap->next;
+        }
+    }
+}
+
+void MasterCache_invalidate( MasterSession* ms, const oid* name, size_t nameLength )
+{
+    MasterSnapshot **prev, *snap;
+
+    for ( prev = &ms->snapshots; ( snap = *prev ) != NULL; ) {
+        if ( Api_oidtreeCompare( snap->subtree, snap->subtreeLen, name, nameLength ) == 0 ) {
+            DEBUG_MSGTL( ( "agentx/master/cache", "dropping " ) );
+            DEBUG_MSGOID( ( "agentx/master/cache", snap->subtree, snap->subtreeLen ) );
+            DEBUG_MSG( ( "agentx/master/cache", "\n" ) );
+            *prev = snap->next;
+            _MasterCache_freeSnapshot( snap );
+        } else {
+            prev = &snap->next;
+        }
+    }
+}
+
+void MasterCache_dropSession( MasterSession* ms, long sessid )
+{
+    MasterSnapshot **prev, *snap;
+
+    for ( prev = &ms->snapshots; ( snap = *prev ) != NULL; ) {
+        if ( snap->sessid == sessid ) {
+            *prev = snap->next;
+            _MasterCache_freeSnapshot( snap );
+        } else {
+            prev = &snap->next;
+        }
+    }
+}
+
+void MasterCache_free( MasterSession* ms )
+{
+    MasterSnapshot* snap;
+
+    while ( ( snap = ms->snapshots ) != NULL ) {
+        ms->snapshots = snap->next;
+        _MasterCache_freeSnapshot( snap );
+    }
+}
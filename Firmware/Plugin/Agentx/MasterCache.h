@@ -0,0 +1,54 @@
+#ifndef MASTERCACHE_H
+#define MASTERCACHE_H
+
+#include "Master.h"
+
+/*
+ * Values pushed by subagents (AGENTX_MSG_CACHE_PUSH), which the master
+ * answers from without a round trip until they expire.  Each push replaces
+ * the snapshot of one subtree: a GET is answered when the snapshot holds
+ * the instance, a GETNEXT when the next instance is in the snapshot and in
+ * the request's range.  Everything else goes on to the subagent.
+ *
+ * A subagent may only push what it has registered, and its values only
+ * answer for its own registrations; they are dropped when it unregisters
+ * anything or closes.
+ */
+typedef struct MasterSnapshot_s {
+    oid subtree[ TYPES_MAX_OID_LEN ];
+    size_t subtreeLen;
+    long sessid; /* the AgentX session which pushed it */
+    VariableList** vars; /* sorted by name */
+    size_t count;
+    struct timeval expires; /* monotonic */
+    struct MasterSnapshot_s* next;
+} MasterSnapshot;
+
+/* the longest pushed values are kept, whatever TTL the subagent asks for */
+#define MASTER_CACHE_MAX_TTL 300
+
+/** Replaces the snapshot of the subtree a push from the AgentX session sp
+ *  names (taking its varbinds); ignored unless sp registered all of it */
+void
+MasterCache_store( MasterSession* ms, Types_Session* sp, Types_Pdu* pdu );
+
+/** The cached answer to a GET or GETNEXT request, or NULL on a miss */
+VariableList*
+MasterCache_find( MasterSession* ms, int mode, RequestInfo* request );
+
+/** Drops the snapshots that have expired */
+void
+MasterCache_expire( MasterSession* ms );
+
+/** Drops the snapshots overlapping name */
+void
+MasterCache_invalidate( MasterSession* ms, const oid* name, size_t nameLength );
+
+/** Drops the snapshots the AgentX session sessid pushed */
+void
+MasterCache_dropSession( MasterSession* ms, long sessid );
+
+void
+MasterCache_free( MasterSession* ms );
+
+#endif // MASTERCACHE_H
@@ -56,11 +56,58 @@ Protocol_cmd( u_char code )
         return "Remove Agent Caps";
     case AGENTX_MSG_RESPONSE:
         return "Response";
+    case AGENTX_MSG_CACHE_PUSH:
+        return "Cache Push";
     default:
         return "Unknown";
     }
 }
 
+/*
+ * Sub-identifiers travel as 32-bit words.  These convert a whole OID at a
+ * time, with the byte order test out of the loop, so the swaps compile to
+ * a few vector shuffles instead of a call per sub-identifier.
+ */
+static void
+_Protocol_putSubids( u_char* out, const oid* name, size_t count,
+    int network_order )
+{
+    uint32_t word;
+    size_t i;
+
+    if ( network_order ) {
+        for ( i = 0; i < count; i++ ) {
+            word = htonl( ( uint32_t )name[ i ] );
+            memcpy( out + 4 * i, &word, 4 );
+        }
+    } else {
+        for ( i = 0; i < count; i++ ) {
+            word = ( uint32_t )name[ i ];
+            memcpy( out + 4 * i, &word, 4 );
+        }
+    }
+}
+
+static void
+_Protocol_getSubids( oid* name, const u_char* in, size_t count,
+    int network_order )
+{
+    uint32_t word;
+    size_t i;
+
+    if ( network_order ) {
+        for ( i = 0; i < count; i++ ) {
+            memcpy( &word, in + 4 * i, 4 );
+            name[ i ] = ntohl( word );
+        }
+    } else {
+        for ( i = 0; i < count; i++ ) {
+            memcpy( &word, in + 4 * i, 4 );
+            name[ i ] = word;
+        }
+    }
+}
+
 int Protocol_reallocBuildInt( u_char** buf, size_t* buf_len, size_t* out_len,
     int allow_realloc,
     unsigned int value, int network_order )
@@ -135,7 +182,7 @@ int Protocol_reallocBuildOid( u_char** buf, size_t* buf_len, size_t* out_len,
     int inclusive, oid* name, size_t name_len,
     int network_order )
 {
-    size_t ilen = *out_len, i = 0;
+    size_t ilen = *out_len;
     int prefix = 0;
 
     DEBUG_PRINTINDENT( "dumpv_send" );
@@ -189,13 +236,10 @@ int Protocol_reallocBuildOid( u_char** buf, size_t* buf_len, size_t* out_len,
     DEBUG_INDENTLESS();
     DEBUG_DUMPHEADER( "send", "OID Segments" );
 
-    for ( i = 0; i < name_len; i++ ) {
-        if ( !Protocol_reallocBuildInt( buf, buf_len, out_len, allow_realloc,
-                 name[ i ], network_order ) ) {
-            DEBUG_INDENTLESS();
-            return 0;
-        }
-    }
+    _Protocol_putSubids( *buf + *out_len, name, name_len, network_order );
+    DEBUG_DUMPSETUP( "send", ( *buf + *out_len ), 4 * name_len );
+    DEBUG_MSG( ( "dumpv_send", "  # subids:\t%d\n", ( int )name_len ) );
+    *out_len += 4 * name_len;
     DEBUG_INDENTLESS();
 
     return 1;
@@ -567,12 +611,129 @@ int Protocol_reallocBuildHeader( u_char** buf, size_t* buf_len,
     return 1;
 }
 
+/*
+ * Encoded sizes, used to reserve the whole packet before building it
+ * rather than growing the buffer a few hundred bytes at a time.
+ */
+static size_t
+_Protocol_oidSize( const oid* name, size_t name_len )
+{
+    if ( name_len >= 5 && name[ 0 ] == 1 && name[ 1 ] == 3 && name[ 2 ] == 6
+        && name[ 3 ] == 1 && name[ 4 ] > 0 && name[ 4 ] < 256 )
+        name_len -= 5;
+    return 4 + 4 * name_len;
+}
+
+static size_t
+_Protocol_stringSize( size_t string_len )
+{
+    return 4 + 4 * ( ( string_len + 3 ) / 4 );
+}
+
+static size_t
+_Protocol_varbindSize( const VariableList* vp )
+{
+    size_t size = 4 + _Protocol_oidSize( vp->name, vp->nameLength );
+
+    switch ( vp->type ) {
+    case asnINTEGER:
+    case asnCOUNTER:
+    case asnGAUGE:
+    case asnTIMETICKS:
+    case asnUINTEGER:
+        return size + 4;
+    case asnOPAQUE_FLOAT:
+        return size + _Protocol_stringSize( 3 + sizeof( float ) );
+    case asnOPAQUE_DOUBLE:
+        return size + _Protocol_stringSize( 3 + sizeof( double ) );
+    case asnOPAQUE_I64:
+    case asnOPAQUE_U64:
+    case asnOPAQUE_COUNTER64:
+    case asnOCTET_STR:
+    case asnIPADDRESS:
+    case asnOPAQUE:
+        return size + _Protocol_stringSize( vp->valueLength );
+    case asnOBJECT_ID:
+    case asnPRIV_EXCL_RANGE:
+    case asnPRIV_INCL_RANGE:
+        return size + _Protocol_oidSize( vp->value.objectId, vp->valueLength / sizeof( oid ) );
+    case asnCOUNTER64:
+        return size + 8;
+    default:
+        return size;
+    }
+}
+
+/*
+ * The size of the packet for the PDUs that carry a variable list,
+ * 0 for the others (they are small enough to build as they go).
+ */
+static size_t
+_Protocol_pduSize( const Types_Pdu* pdu )
+{
+    const VariableList* vp;
+    size_t size = 20;
+
+    if ( pdu->flags & AGENTX_MSG_FLAG_NON_DEFAULT_CONTEXT )
+        size += _Protocol_stringSize( pdu->communityLen );
+
+    switch ( pdu->command ) {
+    case AGENTX_MSG_GETBULK:
+        size += 4;
+    /*
+         * Fallthrough
+         */
+    case AGENTX_MSG_GET:
+    case AGENTX_MSG_GETNEXT:
+        for ( vp = pdu->variables; vp != NULL; vp = vp->next )
+            size += _Protocol_oidSize( vp->name, vp->nameLength )
+                + _Protocol_oidSize( vp->value.objectId, vp->valueLength / sizeof( oid ) );
+        return size;
+
+    case AGENTX_MSG_RESPONSE:
+        size += 4;
+    /*
+         * Fallthrough
+         */
+    case AGENTX_MSG_CACHE_PUSH:
+        size += 4;
+    /*
+         * Fallthrough
+         */
+    case AGENTX_MSG_INDEX_ALLOCATE:
+    case AGENTX_MSG_INDEX_DEALLOCATE:
+    case AGENTX_MSG_NOTIFY:
+    case AGENTX_MSG_TESTSET:
+        for ( vp = pdu->variables; vp != NULL; vp = vp->next )
+            size += _Protocol_varbindSize( vp );
+        return size;
+
+    default:
+        return 0;
+    }
+}
+
+static int
+_Protocol_reserve( u_char** buf, size_t* buf_len, size_t needed )
+{
+    u_char* new_buf;
+
+    if ( needed <= *buf_len )
+        return 1;
+    new_buf = ( u_char* )realloc( *buf, needed );
+    if ( new_buf == NULL )
+        return 0;
+    *buf = new_buf;
+    *buf_len = needed;
+    return 1;
+}
+
 static int
 _Protocol_reallocBuild( u_char** buf, size_t* buf_len, size_t* out_len,
     int allow_realloc,
     Types_Session* session, Types_Pdu* pdu )
 {
-    size_t ilen = *out_len;
+    size_t ilen = *out_len, size;
     VariableList* vp;
     int inc, i = 0;
     const int network_order = pdu->flags & AGENTX_FLAGS_NETWORK_BYTE_ORDER;
@@ -603,6 +764,16 @@ _Protocol_reallocBuild( u_char** buf, size_t* buf_len, size_t* out_len,
         pdu->flags |= AGENTX_MSG_FLAG_NON_DEFAULT_CONTEXT;
     }
 
+    /*
+     * Reserve the whole packet up front; the builders below then never
+     * have to grow the buffer.  The "+ 1" matches their ">=" checks.
+     */
+    size = _Protocol_pduSize( pdu );
+    if ( size && allow_realloc
+        && !_Protocol_reserve( buf, buf_len, *out_len + size + 1 ) ) {
+        return 0;
+    }
+
     /*
      * Build the header (and context if appropriate).
      */
@@ -837,6 +1008,29 @@ _Protocol_reallocBuild( u_char** buf, size_t* buf_len, size_t* out_len,
         DEBUG_INDENTLESS();
         break;
 
+    case AGENTX_MSG_CACHE_PUSH:
+        pdu->flags &= ~( PRIOT_UCD_MSG_FLAG_EXPECT_RESPONSE );
+        DEBUG_DUMPHEADER( "send", "Cache Push TTL" );
+        if ( !Protocol_reallocBuildInt( buf, buf_len, out_len, allow_realloc,
+                 pdu->time, network_order ) ) {
+            DEBUG_INDENTLESS();
+            DEBUG_INDENTLESS();
+            return 0;
+        }
+        DEBUG_INDENTLESS();
+
+        DEBUG_DUMPHEADER( "send", "Cache Push Variable List" );
+        for ( vp = pdu->variables; vp != NULL; vp = vp->next ) {
+            if ( !Protocol_reallocBuildVarbind( buf, buf_len, out_len, allow_realloc, vp,
+                     network_order ) ) {
+                DEBUG_INDENTLESS();
+                DEBUG_INDENTLESS();
+                return 0;
+            }
+        }
+        DEBUG_INDENTLESS();
+        break;
+
     case AGENTX_MSG_COMMITSET:
     case AGENTX_MSG_UNDOSET:
     case AGENTX_MSG_PING:
@@ -962,9 +1156,6 @@ Protocol_parseOid( u_char* data, size_t* length, int* inc,
     u_int n_subid;
     u_int prefix;
     u_int tmp_oid_len;
-    int i;
-    int int_offset;
-    u_int* int_ptr = ( u_int* )oid_buf;
     u_char* buf_ptr = data;
 
     if ( *length < 4 ) {
@@ -990,7 +1181,6 @@ Protocol_parseOid( u_char* data, size_t* length, int* inc,
     prefix = data[ 1 ];
     if ( inc )
         *inc = data[ 2 ];
-    int_offset = sizeof( oid ) / 4;
 
     buf_ptr += 4;
     *length -= 4;
@@ -1001,7 +1191,7 @@ Protocol_parseOid( u_char* data, size_t* length, int* inc,
         /*
          * Null OID
          */
-        memset( int_ptr, 0, 2 * sizeof( oid ) );
+        memset( oid_buf, 0, 2 * sizeof( oid ) );
         *oid_len = 2;
         DEBUG_PRINTINDENT( "dumpv_recv" );
         DEBUG_MSG( ( "dumpv_recv", "OID: NULL (0.0)\n" ) );
@@ -1021,7 +1211,6 @@ Protocol_parseOid( u_char* data, size_t* length, int* inc,
         return NULL;
     }
 
-#define endianoff 0
     if ( *length < 4 * n_subid ) {
         DEBUG_MSGTL( ( "agentx", "Incomplete Object ID\n" ) );
         DEBUG_INDENTLESS();
@@ -1029,37 +1218,17 @@ Protocol_parseOid( u_char* data, size_t* length, int* inc,
     }
 
     if ( prefix ) {
-        if ( int_offset == 2 ) { /* align OID values in 64 bit agent */
-            memset( int_ptr, 0, 10 * sizeof( int_ptr[ 0 ] ) );
-            int_ptr[ 0 + endianoff ] = 1;
-            int_ptr[ 2 + endianoff ] = 3;
-            int_ptr[ 4 + endianoff ] = 6;
-            int_ptr[ 6 + endianoff ] = 1;
-            int_ptr[ 8 + endianoff ] = prefix;
-        } else { /* assume int_offset == 1 */
-            int_ptr[ 0 ] = 1;
-            int_ptr[ 1 ] = 3;
-            int_ptr[ 2 ] = 6;
-            int_ptr[ 3 ] = 1;
-            int_ptr[ 4 ] = prefix;
-        }
-        int_ptr = int_ptr + ( int_offset * 5 );
-    }
-
-    for ( i = 0; i < ( int )( int_offset * n_subid ); i = i + int_offset ) {
-        int x;
-
-        x = Protocol_parseInt( buf_ptr, network_byte_order );
-        if ( int_offset == 2 ) {
-            int_ptr[ i + 0 ] = 0;
-            int_ptr[ i + 1 ] = 0;
-            int_ptr[ i + endianoff ] = x;
-        } else {
-            int_ptr[ i ] = x;
-        }
-        buf_ptr += 4;
-        *length -= 4;
+        oid_buf[ 0 ] = 1;
+        oid_buf[ 1 ] = 3;
+        oid_buf[ 2 ] = 6;
+        oid_buf[ 3 ] = 1;
+        oid_buf[ 4 ] = prefix;
     }
+    _Protocol_getSubids( oid_buf + ( prefix ? 5 : 0 ), buf_ptr, n_subid,
+        network_byte_order );
+    DEBUG_DUMPSETUP( "recv", buf_ptr, 4 * n_subid );
+    buf_ptr += 4 * n_subid;
+    *length -= 4 * n_subid;
 
     *oid_len = tmp_oid_len;
 
@@ -1373,10 +1542,230 @@ Protocol_parseHeader( Types_Pdu* pdu, u_char* data, size_t* length )
     return bufp;
 }
 
+/*
+ * The variable lists of Get* and Response PDUs are decoded straight into
+ * the PDU's varbinds: names and values are copied once, from the packet
+ * into their final storage, rather than through stack buffers and
+ * Api_pduAddVariable().
+ */
+
+/* Appends an empty varbind in constant time; *tail is the last one, or NULL */
+static VariableList*
+_Protocol_appendVar( Types_Pdu* pdu, VariableList** tail )
+{
+    VariableList* vp = MEMORY_MALLOC_TYPEDEF( VariableList );
+
+    if ( vp == NULL )
+        return NULL;
+    if ( *tail == NULL )
+        pdu->variables = vp;
+    else
+        ( *tail )->next = vp;
+    *tail = vp;
+    return vp;
+}
+
+/* The number of sub-identifiers the OID at data will expand to */
+static size_t
+_Protocol_oidLength( const u_char* data, size_t length )
+{
+    if ( length < 4 )
+        return 0;
+    if ( data[ 0 ] == 0 && data[ 1 ] == 0 )
+        return 2; /* Null OID */
+    return data[ 1 ] ? data[ 0 ] + 5 : data[ 0 ];
+}
+
+static u_char*
+_Protocol_parseName( u_char* data, size_t* length, int* inc,
+    VariableList* vp, u_int network_byte_order )
+{
+    size_t name_len = _Protocol_oidLength( data, *length );
+
+    if ( name_len > asnMAX_OID_LEN ) {
+        DEBUG_MSGTL( ( "agentx", "Oversized Object ID (%d)\n", ( int )name_len ) );
+        return NULL;
+    }
+    if ( Client_setVarObjid( vp, NULL, name_len ) )
+        return NULL;
+    data = Protocol_parseOid( data, length, inc, vp->name, &name_len,
+        network_byte_order );
+    vp->nameLength = name_len;
+    return data;
+}
+
+static u_char*
+_Protocol_parseOidValue( u_char* data, size_t* length, VariableList* vp,
+    u_int network_byte_order )
+{
+    size_t oid_len = _Protocol_oidLength( data, *length );
+
+    if ( oid_len > asnMAX_OID_LEN ) {
+        DEBUG_MSGTL( ( "agentx", "Oversized Object ID (%d)\n", ( int )oid_len ) );
+        return NULL;
+    }
+    if ( oid_len * sizeof( oid ) <= sizeof( vp->buffer ) ) {
+        vp->value.objectId = ( oid* )vp->buffer;
+    } else {
+        vp->value.objectId = ( oid* )malloc( oid_len * sizeof( oid ) );
+        if ( vp->value.objectId == NULL )
+            return NULL;
+    }
+    data = Protocol_parseOid( data, length, NULL, vp->value.objectId, &oid_len,
+        network_byte_order );
+    vp->valueLength = oid_len * sizeof( oid );
+    return data;
+}
+
+/* Protocol_parseVarbind(), into a (new) varbind */
+static u_char*
+_Protocol_parseVarbindInto( u_char* data, size_t* length, VariableList* vp,
+    u_int network_byte_order )
+{
+    u_char* bufp = data;
+    u_char* opaque;
+    size_t string_len;
+    u_int int_val;
+    int type;
+    Counter64 tmp64;
+
+    if ( *length < 4 )
+        return NULL;
+    DEBUG_DUMPHEADER( "recv", "VarBind:" );
+    DEBUG_DUMPHEADER( "recv", "Type" );
+    type = Protocol_parseShort( bufp, network_byte_order );
+    DEBUG_INDENTLESS();
+    bufp += 4;
+    *length -= 4;
+
+    bufp = _Protocol_parseName( bufp, length, NULL, vp, network_byte_order );
+    if ( bufp == NULL ) {
+        DEBUG_INDENTLESS();
+        return NULL;
+    }
+
+    switch ( type ) {
+    case asnINTEGER:
+    case asnCOUNTER:
+    case asnGAUGE:
+    case asnTIMETICKS:
+    case asnUINTEGER:
+        if ( *length < 4 )
+            break;
+        int_val = Protocol_parseInt( bufp, network_byte_order );
+        if ( Client_setVarTypedValue( vp, ( u_char )type, &int_val, 4 ) )
+            break;
+        DEBUG_INDENTLESS();
+        *length -= 4;
+        return bufp + 4;
+
+    case asnOCTET_STR:
+    case asnIPADDRESS:
+        if ( *length < 4 )
+            break;
+        string_len = Protocol_parseInt( bufp, network_byte_order );
+        if ( *length < _Protocol_stringSize( string_len ) ) {
+            DEBUG_MSGTL( ( "agentx", "Incomplete string\n" ) );
+            break;
+        }
+        DEBUG_DUMPSETUP( "recv", bufp, _Protocol_stringSize( string_len ) );
+        if ( Client_setVarTypedValue( vp, ( u_char )type, bufp + 4, string_len ) )
+            break;
+        DEBUG_INDENTLESS();
+        *length -= _Protocol_stringSize( string_len );
+        return bufp + _Protocol_stringSize( string_len );
+
+    case asnOPAQUE:
+        /*
+         * Opaque floats and doubles are decoded in place
+         */
+        if ( *length < 4 )
+            break;
+        string_len = Protocol_parseInt( bufp, network_byte_order );
+        if ( *length < _Protocol_stringSize( string_len ) )
+            break;
+        opaque = ( u_char* )malloc( string_len + 1 );
+        if ( opaque == NULL )
+            break;
+        bufp = Protocol_parseOpaque( bufp, length, &type, opaque, &string_len,
+            network_byte_order );
+        if ( bufp == NULL
+            || Client_setVarTypedValue( vp, ( u_char )type, opaque, string_len ) ) {
+            free( opaque );
+            break;
+        }
+        free( opaque );
+        DEBUG_INDENTLESS();
+        return bufp;
+
+    case asnPRIV_INCL_RANGE:
+    case asnPRIV_EXCL_RANGE:
+    case asnOBJECT_ID:
+        vp->type = ( u_char )type;
+        bufp = _Protocol_parseOidValue( bufp, length, vp, network_byte_order );
+        DEBUG_INDENTLESS();
+        return bufp;
+
+    case asnCOUNTER64:
+        if ( *length < 8 )
+            break;
+        memset( &tmp64, 0, sizeof( tmp64 ) );
+        if ( network_byte_order ) {
+            tmp64.high = Protocol_parseInt( bufp, network_byte_order );
+            tmp64.low = Protocol_parseInt( bufp + 4, network_byte_order );
+        } else {
+            tmp64.high = Protocol_parseInt( bufp + 4, network_byte_order );
+            tmp64.low = Protocol_parseInt( bufp, network_byte_order );
+        }
+        if ( Client_setVarTypedValue( vp, ( u_char )type, &tmp64, sizeof( tmp64 ) ) )
+            break;
+        DEBUG_INDENTLESS();
+        *length -= 8;
+        return bufp + 8;
+
+    case asnNULL:
+    case PRIOT_NOSUCHOBJECT:
+    case PRIOT_NOSUCHINSTANCE:
+    case PRIOT_ENDOFMIBVIEW:
+        /*
+         * No data associated with these types.
+         */
+        Client_setVarTypedValue( vp, ( u_char )type, NULL, 0 );
+        DEBUG_INDENTLESS();
+        return bufp;
+
+    default:
+        DEBUG_MSG( ( "recv", "Can not parse type %x", type ) );
+        break;
+    }
+    DEBUG_INDENTLESS();
+    return NULL;
+}
+
+/* Parses varbinds up to the end of the packet */
+static int
+_Protocol_parseVarbindList( Types_Pdu* pdu, VariableList** tail,
+    u_char* bufp, size_t* length )
+{
+    VariableList* vp;
+
+    while ( *length > 0 ) {
+        vp = _Protocol_appendVar( pdu, tail );
+        if ( vp == NULL )
+            return 0;
+        bufp = _Protocol_parseVarbindInto( bufp, length, vp,
+            pdu->flags & AGENTX_FLAGS_NETWORK_BYTE_ORDER );
+        if ( bufp == NULL )
+            return 0;
+    }
+    return 1;
+}
+
 int Protocol_parse( Types_Session* session, Types_Pdu* pdu, u_char* data,
     size_t len )
 {
     register u_char* bufp = data;
+    VariableList *vp, *tail = NULL;
     u_char buffer[ API_MAX_MSG_SIZE ];
     oid oid_buffer[ asnMAX_OID_LEN ], end_oid_buf[ asnMAX_OID_LEN ];
     size_t buf_len = sizeof( buffer );
@@ -1385,7 +1774,6 @@ int Protocol_parse( Types_Session* session, Types_Pdu* pdu, u_char* data,
 
     int range_bound; /* OID-range upper bound */
     int inc; /* Inclusive SearchRange flag */
-    int type; /* VarBind data type */
     size_t* length = &len;
 
     if ( pdu == NULL )
@@ -1448,6 +1836,9 @@ int Protocol_parse( Types_Session* session, Types_Pdu* pdu, u_char* data,
         buf_len = sizeof( buffer );
     }
 
+    for ( tail = pdu->variables; tail != NULL && tail->next != NULL; tail = tail->next )
+        ;
+
     DEBUG_DUMPHEADER( "recv", "PDU" );
     switch ( pdu->command ) {
     case AGENTX_MSG_OPEN:
@@ -1564,40 +1955,20 @@ int Protocol_parse( Types_Session* session, Types_Pdu* pdu, u_char* data,
          */
         DEBUG_DUMPHEADER( "recv", "Search Range" );
         while ( *length > 0 ) {
-            bufp = Protocol_parseOid( bufp, length, &inc,
-                oid_buffer, &oid_buf_len,
-                pdu->flags & AGENTX_FLAGS_NETWORK_BYTE_ORDER );
-            if ( bufp == NULL ) {
-                DEBUG_INDENTLESS();
-                DEBUG_INDENTLESS();
-                return ErrorCode_ASN_PARSE_ERR;
+            vp = _Protocol_appendVar( pdu, &tail );
+            if ( vp != NULL )
+                bufp = _Protocol_parseName( bufp, length, &inc, vp,
+                    pdu->flags & AGENTX_FLAGS_NETWORK_BYTE_ORDER );
+            if ( vp != NULL && bufp != NULL ) {
+                vp->type = inc ? asnPRIV_INCL_RANGE : asnPRIV_EXCL_RANGE;
+                bufp = _Protocol_parseOidValue( bufp, length, vp,
+                    pdu->flags & AGENTX_FLAGS_NETWORK_BYTE_ORDER );
             }
-            bufp = Protocol_parseOid( bufp, length, NULL,
-                end_oid_buf, &end_oid_buf_len,
-                pdu->flags & AGENTX_FLAGS_NETWORK_BYTE_ORDER );
-            if ( bufp == NULL ) {
+            if ( vp == NULL || bufp == NULL ) {
                 DEBUG_INDENTLESS();
                 DEBUG_INDENTLESS();
                 return ErrorCode_ASN_PARSE_ERR;
             }
-            end_oid_buf_len *= sizeof( oid );
-            /*
-             * 'Protocol_parseOid()' returns the number of sub_ids
-             */
-
-            if ( inc ) {
-                Api_pduAddVariable( pdu, oid_buffer, oid_buf_len,
-                    asnPRIV_INCL_RANGE,
-                    ( u_char* )end_oid_buf,
-                    end_oid_buf_len );
-            } else {
-                Api_pduAddVariable( pdu, oid_buffer, oid_buf_len,
-                    asnPRIV_EXCL_RANGE,
-                    ( u_char* )end_oid_buf,
-                    end_oid_buf_len );
-            }
-            oid_buf_len = asnMAX_OID_LEN;
-            end_oid_buf_len = asnMAX_OID_LEN;
         }
 
         DEBUG_INDENTLESS();
@@ -1634,21 +2005,28 @@ int Protocol_parse( Types_Session* session, Types_Pdu* pdu, u_char* data,
          */
 
         DEBUG_DUMPHEADER( "recv", "VarBindList" );
-        while ( *length > 0 ) {
-            bufp = Protocol_parseVarbind( bufp, length, &type,
-                oid_buffer, &oid_buf_len,
-                buffer, &buf_len,
-                pdu->flags & AGENTX_FLAGS_NETWORK_BYTE_ORDER );
-            if ( bufp == NULL ) {
-                DEBUG_INDENTLESS();
-                DEBUG_INDENTLESS();
-                return ErrorCode_ASN_PARSE_ERR;
-            }
-            Api_pduAddVariable( pdu, oid_buffer, oid_buf_len,
-                ( u_char )type, buffer, buf_len );
+        if ( !_Protocol_parseVarbindList( pdu, &tail, bufp, length ) ) {
+            DEBUG_INDENTLESS();
+            DEBUG_INDENTLESS();
+            return ErrorCode_ASN_PARSE_ERR;
+        }
+        DEBUG_INDENTLESS();
+        break;
 
-            oid_buf_len = asnMAX_OID_LEN;
-            buf_len = sizeof( buffer );
+    case AGENTX_MSG_CACHE_PUSH:
+        if ( *length < 4 ) {
+            DEBUG_INDENTLESS();
+            return ErrorCode_ASN_PARSE_ERR;
+        }
+        pdu->time = Protocol_parseInt( bufp, pdu->flags & AGENTX_FLAGS_NETWORK_BYTE_ORDER );
+        bufp += 4;
+        *length -= 4;
+
+        DEBUG_DUMPHEADER( "recv", "Cache Push VarBindList" );
+        if ( !_Protocol_parseVarbindList( pdu, &tail, bufp, length ) ) {
+            DEBUG_INDENTLESS();
+            DEBUG_INDENTLESS();
+            return ErrorCode_ASN_PARSE_ERR;
         }
         DEBUG_INDENTLESS();
         break;
@@ -46,6 +46,18 @@
 #define AGENTX_MSG_REMOVE_AGENT_CAPS ((u_char)17)
 #define AGENTX_MSG_RESPONSE    ((u_char)18)
 
+    /*
+     * Extension, not in RFC 2741: a subagent pushes the values of one of
+     * its registered subtrees, for the master to answer from until a TTL
+     * expires.  Payload: TTL (seconds, 0 drops the subtree), then a VarBind
+     * list whose first (Null) varbind names the subtree and the rest hold
+     * all of its values.  The master doesn't respond.
+     *
+     * Only sent on sessions whose Open-PDU carried
+     * AGENTX_MSG_FLAG_CACHE_PUSH and whose Response echoed it back.
+     */
+#define AGENTX_MSG_CACHE_PUSH  ((u_char)64)
+
 
     /*
      * Error codes from RFC 2257 
@@ -83,6 +95,7 @@
 #define AGENTX_MSG_FLAG_ANY_INSTANCE          0x04
 #define AGENTX_MSG_FLAG_NON_DEFAULT_CONTEXT   0x08
 #define AGENTX_MSG_FLAG_NETWORK_BYTE_ORDER    0x10
+#define AGENTX_MSG_FLAG_CACHE_PUSH            0x20    /* extension */
 
 #define AGENTX_MSG_FLAGS_MASK                 0xff
 
@@ -90,6 +103,7 @@
  * Session Flags - see also 'UCD_FLAGS_xxx' in snmp.h
  */
 #define AGENTX_FLAGS_NETWORK_BYTE_ORDER       AGENTX_MSG_FLAG_NETWORK_BYTE_ORDER
+#define AGENTX_FLAGS_CACHE_PUSH               0x10000 /* master accepts pushes */
 
 
 int
@@ -1015,3 +1015,9 @@ void Subagent_checkSession( unsigned int clientreg, void* clientarg )
             ss ) );
     }
 }
+
+int Subagent_pushValues( const oid* subtree, size_t subtreeLen,
+    VariableList* vars, int ttl )
+{
+    return XClient_pushValues( agent_mainSession, subtree, subtreeLen, vars, ttl );
+}
@@ -19,4 +19,14 @@ Subagent_registerCallback;
 AlarmCallback_f
 Subagent_checkSession;
 
+/*
+ * Pushes the values of a subtree for the master to answer from for ttl
+ * seconds, if it agreed to that at open; see XClient_pushValues
+ */
+int
+Subagent_pushValues( const oid * subtree,
+                     size_t subtreeLen,
+                     VariableList * vars,
+                     int ttl );
+
 #endif // SUBAGENT_H
@@ -94,6 +94,7 @@ XClient_openSession(Types_Session * ss)
 
     Api_addVar(pdu, agent_versionSysoid, agent_versionSysoidLen,
                  's', "PRIOT AgentX sub-agent");
+    pdu->flags |= AGENTX_MSG_FLAG_CACHE_PUSH;
 
     if (XClient_synchResponse(ss, pdu, &response) != CLIENT_STAT_SUCCESS)
         return 0;
@@ -107,6 +108,13 @@ XClient_openSession(Types_Session * ss)
     }
 
     ss->sessid = response->sessid;
+    /*
+     * the master echoes the flag back if it will answer from pushed values
+     */
+    if (response->flags & AGENTX_MSG_FLAG_CACHE_PUSH)
+        ss->flags |= AGENTX_FLAGS_CACHE_PUSH;
+    else
+        ss->flags &= ~AGENTX_FLAGS_CACHE_PUSH;
     Api_freePdu(response);
 
     DEBUG_MSGTL(("agentx/subagent", "open \n"));
@@ -458,3 +466,47 @@ XClient_sendPing(Types_Session * ss)
     Api_freePdu(response);
     return 1;
 }
+
+/*
+ * Pushes the values of subtree for the master to answer from for ttl
+ * seconds (0 drops those pushed before).  vars is copied.  There is no
+ * response, so this returns 0 only if the push couldn't be sent, or the
+ * master didn't agree to pushes when the session was opened.
+ */
+int
+XClient_pushValues(Types_Session * ss, const oid * subtree,
+                   size_t subtreeLen, VariableList * vars, int ttl)
+{
+    Types_Pdu    *pdu;
+
+    if (ss == NULL || !IS_AGENTX_VERSION(ss->version)
+        || !(ss->flags & AGENTX_FLAGS_CACHE_PUSH)) {
+        return 0;
+    }
+
+    pdu = Client_pduCreate(AGENTX_MSG_CACHE_PUSH);
+    if (pdu == NULL)
+        return 0;
+    pdu->time = ttl;
+    pdu->sessid = ss->sessid;
+    if (Client_addNullVar(pdu, subtree, subtreeLen) == NULL) {
+        Api_freePdu(pdu);
+        return 0;
+    }
+    if (vars != NULL) {
+        pdu->variables->next = Client_cloneVarbind(vars);
+        if (pdu->variables->next == NULL) {
+            Api_freePdu(pdu);
+            return 0;
+        }
+    }
+
+    DEBUG_MSGTL(("agentx/subagent", "pushing values of "));
+    DEBUG_MSGOID(("agentx/subagent", subtree, subtreeLen));
+    DEBUG_MSG(("agentx/subagent", " for %ds\n", ttl));
+    if (!Api_send(ss, pdu)) {
+        Api_freePdu(pdu);
+        return 0;
+    }
+    return 1;
+}
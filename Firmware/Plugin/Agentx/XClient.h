@@ -64,5 +64,12 @@ XClient_removeAgentcaps( Types_Session *,
 int
 XClient_sendPing( Types_Session * );
 
+int
+XClient_pushValues( Types_Session * ss,
+                    const oid * subtree,
+                    size_t subtreeLen,
+                    VariableList * vars,
+                    int ttl );
+
 
 #endif // XCLIENT_H
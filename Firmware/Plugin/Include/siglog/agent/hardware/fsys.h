@@ -53,6 +53,7 @@ typedef struct netsnmp_fsys_info_s netsnmp_fsys_info;
 #define NETSNMP_FS_FLAG_BOOTABLE 0x08
 #define NETSNMP_FS_FLAG_REMOVE   0x10
 #define NETSNMP_FS_FLAG_UCD      0x20
+#define NETSNMP_FS_FLAG_STALE    0x40   /* statistics not from the last load */
 
 #define NETSNMP_FS_FIND_CREATE     1   /* or use one of the type values */
 #define NETSNMP_FS_FIND_EXIST      0
@@ -83,6 +84,8 @@ struct netsnmp_fsys_info_s {
      int  minpercent;
 
      long flags;
+     int  stale_errno;  /* why NETSNMP_FS_FLAG_STALE: the errno of the
+                           failed probe, or 0 if it did not come back */
 
      netsnmp_fsys_info *next;
 };
@@ -87,6 +87,14 @@ int
 netsnmp_access_defaultrouter_entry_load(size_t *num_entries,
                                         netsnmp_defaultrouter_entry **entries);
 
+/*
+ * entry of the default route an rtnetlink route notification is about
+ */
+struct nlmsghdr;
+int
+netsnmp_access_defaultrouter_entry_from_rtnl(const struct nlmsghdr *msg,
+                                             netsnmp_defaultrouter_entry **entry);
+
 /*
  * entry update
  */
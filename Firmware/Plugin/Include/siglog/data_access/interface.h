@@ -48,6 +48,12 @@
  */
 #define NETSNMP_INTERFACE_FLAGS_CALCULATE_UCAST         0x00200000
 
+/* Values the loader left for later, because reading them costs extra
+ * system calls per interface. They are read on first use through
+ * netsnmp_access_interface_entry_extras_get().
+ */
+#define NETSNMP_INTERFACE_FLAGS_LAZY_SPEED              0x00400000
+
 /*************************************************************
  * constants for enums for the MIB node
  * ifAdminStatus (INTEGER / ASN_INTEGER)
@@ -242,6 +248,15 @@ netsnmp_access_interface_entry_create(const char *name, oid if_index);
 
 void netsnmp_access_interface_entry_free(netsnmp_interface_entry * entry);
 
+/*
+ * build the entry an rtnetlink RTM_NEWLINK notification is about
+ */
+struct nlmsghdr;
+int
+netsnmp_access_interface_entry_from_rtnl(const struct nlmsghdr *msg,
+                                         u_int flags,
+                                         netsnmp_interface_entry **entry);
+
 int
 netsnmp_access_interface_entry_set_admin_status(netsnmp_interface_entry * entry,
 	                                                int ifAdminStatus);
@@ -278,6 +293,12 @@ int netsnmp_access_interface_entry_copy(netsnmp_interface_entry * lhs,
 void netsnmp_access_interface_entry_guess_speed(netsnmp_interface_entry *);
 void netsnmp_access_interface_entry_overrides(netsnmp_interface_entry *);
 
+/*
+ * read lazily loaded values (NETSNMP_INTERFACE_FLAGS_LAZY_* in which)
+ */
+void netsnmp_access_interface_entry_extras_get(netsnmp_interface_entry *,
+                                               u_int which);
+
 
 netsnmp_conf_if_list *
 netsnmp_access_interface_entry_overrides_get(const char * name);
@@ -98,6 +98,14 @@ int
 netsnmp_access_ipaddress_entry_copy(netsnmp_ipaddress_entry *old, 
                                     netsnmp_ipaddress_entry *new_val);
 
+/*
+ * entry of the address an rtnetlink address notification is about
+ */
+struct nlmsghdr;
+int
+netsnmp_access_ipaddress_entry_from_rtnl(const struct nlmsghdr *msg,
+                                         netsnmp_ipaddress_entry **entry);
+
 /*
  * update/compare
  */
@@ -70,6 +70,41 @@ typedef struct netsnmp_route_s {
 
 } netsnmp_route_entry;
 
+/*
+ * netsnmp_route_table
+ *   - compact, sorted snapshot of the ipv4 routing table. a route takes
+ *     16 bytes; next hop and interface, which few routes differ in, are
+ *     kept once in nexthops. routes are ordered by destination, prefix
+ *     length and next hop, the order of the route table indexes.
+ */
+typedef struct netsnmp_route_nexthop_s {
+   uint32_t  addr;           /* network byte order, 0 if directly connected */
+   oid       if_index;
+} netsnmp_route_nexthop;
+
+typedef struct netsnmp_route_compact_s {
+   uint32_t  dest;           /* network byte order */
+   uint32_t  nexthop;        /* index into netsnmp_route_table.nexthops */
+   int32_t   metric;
+   u_char    pfx_len;
+   u_char    type;           /* inetCidrRouteType, 0 if not up */
+   u_char    proto;          /* IANAipRouteProtocol */
+} netsnmp_route_compact;
+
+typedef struct netsnmp_route_table_s {
+   netsnmp_route_compact *routes;
+   size_t    count;
+   size_t    size;
+
+   netsnmp_route_nexthop *nexthops;
+   size_t    nexthop_count;
+   size_t    nexthop_size;
+
+   /* nexthop interning, open addressing, 0 == empty slot */
+   uint32_t *nexthop_hash;
+   size_t    nexthop_hash_size;
+} netsnmp_route_table;
+
 
 
 /**---------------------------------------------------------------------*/
@@ -111,6 +146,95 @@ int
 netsnmp_access_route_entry_copy(netsnmp_route_entry *lhs,
                                 netsnmp_route_entry *rhs);
 
+/*
+ * compact route table load and free. load replaces the contents of
+ * table, free releases them (but not table itself).
+ */
+int netsnmp_access_route_table_load(netsnmp_route_table *table,
+                                    u_int load_flags);
+void netsnmp_access_route_table_free(netsnmp_route_table *table);
+
+/*
+ * add a route while loading, and sort the table when done
+ */
+int netsnmp_access_route_table_add(netsnmp_route_table *table,
+                                   uint32_t dest, u_char pfx_len,
+                                   uint32_t nexthop, oid if_index,
+                                   int32_t metric, u_char type,
+                                   u_char proto);
+void netsnmp_access_route_table_sort(netsnmp_route_table *table);
+
+/*
+ * index of the first route whose destination (host byte order) is
+ * >= dest, table->count if there is none.
+ */
+size_t netsnmp_access_route_table_lower_bound(const netsnmp_route_table *table,
+                                              uint32_t dest);
+
+/*
+ * keep a loaded table up to date: insert adds a route in index order
+ * (or updates the one with the same index and metric), remove deletes
+ * the routes with that index and metric and returns how many there
+ * were. a NULL nexthop matches the routes through any next hop.
+ */
+int netsnmp_access_route_table_insert(netsnmp_route_table *table,
+                                      uint32_t dest, u_char pfx_len,
+                                      uint32_t nexthop, oid if_index,
+                                      int32_t metric, u_char type,
+                                      u_char proto);
+int netsnmp_access_route_table_remove(netsnmp_route_table *table,
+                                      uint32_t dest, u_char pfx_len,
+                                      const netsnmp_route_nexthop *nexthop,
+                                      int32_t metric);
+
+/*
+ * apply one rtnetlink RTM_NEWROUTE/RTM_DELROUTE notification to table.
+ *
+ * @retval  0 applied (or not about the table)
+ * @retval <0 error, the table needs a full reload
+ */
+struct nlmsghdr;
+int netsnmp_access_route_table_update(netsnmp_route_table *table,
+                                      const struct nlmsghdr *msg);
+
+/*
+ * expand route (the index-th route of table) into a full entry
+ */
+netsnmp_route_entry *
+netsnmp_access_route_entry_from_compact(const netsnmp_route_table *table,
+                                        const netsnmp_route_compact *route,
+                                        u_long index);
+
+/*
+ * a container serving a MIB table straight from a netsnmp_route_table.
+ * rows are only built for the routes a request looks at, and released
+ * once the agent is done with the request; rows the table inserts
+ * itself (created by a SET) are kept until the container is cleared.
+ *
+ * index_get sets the table index of entry in index (whose len is the
+ * size of its buffer on entry). the first index_len sub-identifiers of
+ * the index must only depend on the destination and the prefix length,
+ * in the same order. row_get builds a row for entry, which it owns from
+ * then on; the first member of a row must be its Types_Index.
+ */
+typedef int (netsnmp_route_index_f)(const netsnmp_route_entry *entry,
+                                    Types_Index *index);
+typedef void *(netsnmp_route_row_f)(netsnmp_route_entry *entry);
+
+Container_Container *
+netsnmp_access_route_compact_container_create(size_t index_len,
+                                              netsnmp_route_index_f *index_get,
+                                              netsnmp_route_row_f *row_get,
+                                              Container_FuncObjFunc *row_free,
+                                              u_int flags);
+/* routes which are not up (type 0) are not shown */
+#define NETSNMP_ACCESS_ROUTE_COMPACT_SKIP_DOWN          0x0001
+
+int netsnmp_access_route_compact_container_load(Container_Container *container,
+                                                u_int load_flags);
+int netsnmp_access_route_compact_container_update(Container_Container *container,
+                                                  const struct nlmsghdr *msg);
+
 /*
  * find entry in container
  */
@@ -45,6 +45,14 @@
          */
         int32_t         hrSWRunPerfCPU;
         int32_t         hrSWRunPerfMem;
+
+        /*
+         * kept across reloads: a process is the same one as long as
+         * its pid and start time are
+         */
+        unsigned long long start_time;
+        int             stat_fd;    /* arch: kept-open stat file, or -1 */
+        u_int           generation; /* see ContainerSync.h */
         
     } netsnmp_swrun_entry;
 
@@ -82,6 +90,7 @@
     int  swrun_count_processes( void );
     int  swrun_max_processes(   void );
     int  swrun_count_processes_by_name( char *name );
+    Container_Container *swrun_processes( u_int *generation );
 
 #define NETSNMP_SWRUN_NOFLAGS            0x00000000
 #define NETSNMP_SWRUN_ALL_OR_NONE        0x00000001
@@ -82,12 +82,26 @@
 #define NETSNMP_ACCESS_TCPCONN_FREE_KEEP_CONTAINER        0x0002
 
 
+/*
+ * row by row load, for incremental reloads (see ContainerSync.h).
+ * the row passed to the callback is only valid during the call.
+ */
+    typedef int (netsnmp_tcpconn_row_f)(netsnmp_tcpconn_entry *row,
+                                        void *context);
+
+    int netsnmp_access_tcpconn_load_rows(u_int load_flags,
+                                         netsnmp_tcpconn_row_f *row_cb,
+                                         void *context);
+
 /*
  * create/free a tcpconn entry
  */
     netsnmp_tcpconn_entry *
     netsnmp_access_tcpconn_entry_create(void);
 
+    netsnmp_tcpconn_entry *
+    netsnmp_access_tcpconn_entry_dup(const netsnmp_tcpconn_entry *row);
+
     void netsnmp_access_tcpconn_entry_free(netsnmp_tcpconn_entry * entry);
 
 /*
@@ -6,7 +6,7 @@ TEMPLATE = lib
 
 QMAKE_CFLAGS += -Werror=implicit-function-declaration
 
-LIBS += -ldl -lrpm -lrpmio  -lm
+LIBS += -ldl -lrpm -lrpmio  -lm -lpthread
 
 INCLUDEPATH += $$PWD/Include/
 DEPENDPATH += $$PWD/Include/
@@ -29,6 +29,8 @@ SOURCES +=  PluginModules.c \
             utilities/header_generic.c \ ###
             utilities/header_simple_table.c \
             utilities/get_pid_from_inode.c \
+            utilities/sock_diag.c \
+            utilities/rtnl_events.c \
             utilities/Restart.c \
             snmpv3/snmpMPDStats_5_5.c \  ###
             snmpv3/usmStats_5_5.c \
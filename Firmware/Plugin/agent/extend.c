@@ -287,13 +287,77 @@ void shutdown_extend( void )
          *
          *************************/
 
+/*
+ * The command line of an entry: 2 * DisplayStrings
+ */
+#define EXTEND_CMD_LEN ( 255 * 2 + 2 )
+
+static void
+_extend_command_line( netsnmp_extend* extension, char* cmd_buf )
+{
+    if ( extension->args )
+        snprintf( cmd_buf, EXTEND_CMD_LEN, "%s %s", extension->command, extension->args );
+    else
+        snprintf( cmd_buf, EXTEND_CMD_LEN, "%s", extension->command );
+}
+
+/*
+ * The seconds a run of the entry may be reused for.  A run-on-write
+ * entry must really run each time it's told to, so nothing is kept.
+ */
+static int
+_extend_reuse_time( netsnmp_extend* extension )
+{
+    if ( extension->flags & NS_EXTEND_FLAGS_WRITEABLE )
+        return 0;
+    return extension->cache->timeout;
+}
+
+/* entries a walk starts the commands of ahead of itself */
+#define EXTEND_PREFETCH_DEPTH ( 4 * EXECUTECMD_MAX_RUNNING )
+
+/*
+ * A walk is going to want the output of this entry and those after it:
+ * start the commands whose output isn't loaded, so they run side by side
+ * instead of one after another as the walk gets to them.
+ */
+static void
+_extend_prefetch( netsnmp_extend* eptr )
+{
+    char cmd_buf[ EXTEND_CMD_LEN ];
+    int n = 0;
+
+    for ( ; eptr && n < EXTEND_PREFETCH_DEPTH; eptr = eptr->next ) {
+        if ( !( eptr->flags & NS_EXTEND_FLAGS_ACTIVE ) || !eptr->command
+            || _extend_reuse_time( eptr ) <= 0
+            || ( eptr->cache->valid && !CacheHandler_checkExpired( eptr->cache ) ) )
+            continue;
+        _extend_command_line( eptr, cmd_buf );
+        ExecuteCmd_prefetchCommand( cmd_buf, eptr->input,
+            ( eptr->flags & NS_EXTEND_FLAGS_SHELL ) ? ExecuteCmdFlag_SHELL : 0,
+            _extend_reuse_time( eptr ) );
+        n++;
+    }
+}
+
+/*
+ * CacheHandler_checkAndReload() for a walk, which when it has to wait for
+ * an entry's command starts those of the entries to come as well
+ */
+static int
+_extend_walk_reload( netsnmp_extend* eptr )
+{
+    if ( !eptr->cache->valid || CacheHandler_checkExpired( eptr->cache ) )
+        _extend_prefetch( eptr );
+    return CacheHandler_checkAndReload( eptr->cache );
+}
+
 int extend_load_cache( Cache* cache, void* magic )
 {
 
     int out_len = 1024 * 100;
     char out_buf[ 1024 * 100 ];
-    int cmd_len = 255 * 2 + 2; /* 2 * DisplayStrings */
-    char cmd_buf[ 255 * 2 + 2 ];
+    char cmd_buf[ EXTEND_CMD_LEN ];
     int ret;
     char* cp;
     char* line_buf[ 1024 ];
@@ -302,14 +366,10 @@ int extend_load_cache( Cache* cache, void* magic )
     if ( !magic )
         return -1;
     DEBUG_MSGTL( ( "nsExtendTable:cache", "load %s", extension->token ) );
-    if ( extension->args )
-        snprintf( cmd_buf, cmd_len, "%s %s", extension->command, extension->args );
-    else
-        snprintf( cmd_buf, cmd_len, "%s", extension->command );
-    if ( extension->flags & NS_EXTEND_FLAGS_SHELL )
-        ret = ExecuteCmd_runShellCommand( cmd_buf, extension->input, out_buf, &out_len );
-    else
-        ret = ExecuteCmd_runExecCommand( cmd_buf, extension->input, out_buf, &out_len );
+    _extend_command_line( extension, cmd_buf );
+    ret = ExecuteCmd_runCachedCommand( cmd_buf, extension->input,
+        ( extension->flags & NS_EXTEND_FLAGS_SHELL ) ? ExecuteCmdFlag_SHELL : 0,
+        _extend_reuse_time( extension ), out_buf, &out_len );
     DEBUG_MSG( ( "nsExtendTable:cache", ": %s : %d\n", cmd_buf, ret ) );
     if ( ret >= 0 ) {
         if ( out_buf[ out_len - 1 ] == '\n' )
@@ -1191,7 +1251,7 @@ _extend_find_entry( RequestInfo* request,
              *  (and successful) entry, and use the first line of it
              */
             for ( eptr = ereg->ehead; eptr; eptr = eptr->next ) {
-                if ( ( eptr->flags & NS_EXTEND_FLAGS_ACTIVE ) && ( CacheHandler_checkAndReload( eptr->cache ) >= 0 ) ) {
+                if ( ( eptr->flags & NS_EXTEND_FLAGS_ACTIVE ) && ( _extend_walk_reload( eptr ) >= 0 ) ) {
                     line_idx = 1;
                     break;
                 }
@@ -1220,7 +1280,7 @@ _extend_find_entry( RequestInfo* request,
              * (or use the first following entry that is)
              */
             for ( ; eptr; eptr = eptr->next ) {
-                if ( ( eptr->flags & NS_EXTEND_FLAGS_ACTIVE ) && ( CacheHandler_checkAndReload( eptr->cache ) >= 0 ) ) {
+                if ( ( eptr->flags & NS_EXTEND_FLAGS_ACTIVE ) && ( _extend_walk_reload( eptr ) >= 0 ) ) {
                     break;
                 }
                 line_idx = 1;
@@ -1241,7 +1301,7 @@ _extend_find_entry( RequestInfo* request,
                      */
                     line_idx = 1;
                     for ( eptr = eptr->next; eptr; eptr = eptr->next ) {
-                        if ( ( eptr->flags & NS_EXTEND_FLAGS_ACTIVE ) && ( CacheHandler_checkAndReload( eptr->cache ) >= 0 ) ) {
+                        if ( ( eptr->flags & NS_EXTEND_FLAGS_ACTIVE ) && ( _extend_walk_reload( eptr ) >= 0 ) ) {
                             break;
                         }
                     }
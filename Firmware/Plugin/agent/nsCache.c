@@ -1,10 +1,14 @@
 #include "nsCache.h"
 #include "System/Util/Alarm.h"
+#include "AgentReadConfig.h"
 #include "CacheHandler.h"
 #include "Client.h"
 #include "System/Util/Trace.h"
 #include "System/Util/DefaultStore.h"
 #include "DsAgent.h"
+#include "Impl.h"
+#include "Mib.h"
+#include "ReadConfig.h"
 #include "Scalar.h"
 
 #define nsCache 1, 3, 6, 1, 4, 1, 8072, 1, 5
@@ -23,6 +27,10 @@
 
 #define NSCACHE_TIMEOUT 2
 #define NSCACHE_STATUS 3
+#define NSCACHE_LOAD_TIME 4
+#define NSCACHE_REQUEST_INTERVAL 5
+#define NSCACHE_HITS 6
+#define NSCACHE_MISSES 7
 
 #define NSCACHE_STATUS_ENABLED 1
 #define NSCACHE_STATUS_DISABLED 2
@@ -65,7 +73,7 @@ void init_nsCache( void )
     }
     Table_helperAddIndexes( table_info, asnPRIV_IMPLIED_OBJECT_ID, 0 );
     table_info->min_column = NSCACHE_TIMEOUT;
-    table_info->max_column = NSCACHE_STATUS;
+    table_info->max_column = NSCACHE_MISSES;
 
     /*
      * .... and the iteration information ....
@@ -87,6 +95,82 @@ void init_nsCache( void )
             nsCacheTable_oid, asnOID_LENGTH( nsCacheTable_oid ),
             HANDLER_CAN_RWRITE ),
         iinfo );
+
+    /*
+     * ... and the policies of the individual caches
+     */
+    AgentReadConfig_priotdRegisterConfigHandler( "cacheAdaptive",
+        nsCache_parseAdaptive, NULL,
+        "CACHE-OID MIN-TIMEOUT MAX-TIMEOUT [LOAD-BUDGET-PERCENT]" );
+    AgentReadConfig_priotdRegisterConfigHandler( "cacheStaleWhileRevalidate",
+        nsCache_parseStaleWhileRevalidate, NULL,
+        "CACHE-OID REFRESH-AHEAD STALE-TIMEOUT" );
+}
+
+/*
+ * nsCache config handling
+ */
+
+/*
+ * Finds the cache named by the first word of line, and reads up to
+ * nargs numbers after it.  Returns the number read, or -1.
+ */
+static int
+_nsCache_parseArgs( char* line, Cache** cache, int* args, int nargs )
+{
+    char buf[ IMPL_SPRINT_MAX_LEN ];
+    oid name[ asnMAX_OID_LEN ];
+    size_t name_len = asnMAX_OID_LEN;
+    int n;
+
+    line = ReadConfig_copyNword( line, buf, sizeof( buf ) );
+    if ( !Mib_parseOid( buf, name, &name_len ) ) {
+        ReadConfig_configPerror( "unknown cache OID" );
+        return -1;
+    }
+    *cache = CacheHandler_findByOid( name, name_len );
+    if ( NULL == *cache ) {
+        ReadConfig_configPerror( "no cache registered at that OID" );
+        return -1;
+    }
+    for ( n = 0; n < nargs && line; n++ ) {
+        line = ReadConfig_copyNword( line, buf, sizeof( buf ) );
+        args[ n ] = atoi( buf );
+    }
+    return n;
+}
+
+void nsCache_parseAdaptive( const char* token, char* line )
+{
+    Cache* cache;
+    int args[ 3 ] = { 0, 0, 0 };
+    int n;
+
+    n = _nsCache_parseArgs( line, &cache, args, 3 );
+    if ( n < 0 )
+        return;
+    if ( n < 2 || args[ 0 ] < 1 || args[ 1 ] < args[ 0 ] ) {
+        ReadConfig_configPerror( "cacheAdaptive needs 1 <= MIN-TIMEOUT <= MAX-TIMEOUT" );
+        return;
+    }
+    CacheHandler_setAdaptiveTimeout( cache, args[ 0 ], args[ 1 ], args[ 2 ] );
+}
+
+void nsCache_parseStaleWhileRevalidate( const char* token, char* line )
+{
+    Cache* cache;
+    int args[ 2 ] = { 0, 0 };
+    int n;
+
+    n = _nsCache_parseArgs( line, &cache, args, 2 );
+    if ( n < 0 )
+        return;
+    if ( n < 2 || args[ 0 ] < 0 || args[ 1 ] < 0 ) {
+        ReadConfig_configPerror( "cacheStaleWhileRevalidate needs REFRESH-AHEAD and STALE-TIMEOUT" );
+        return;
+    }
+    /* a STALE-TIMEOUT of 0 turns the policy off */
+    CacheHandler_setStaleWhileRevalidate( cache, args[ 0 ], args[ 1 ] );
 }
 
 /*
@@ -232,6 +316,7 @@ int handle_nsCacheTable( MibHandler* handler,
     RequestInfo* requests )
 {
     long status;
+    u_long counter;
     RequestInfo* request = NULL;
     TableRequestInfo* table_info = NULL;
     Cache* cache_entry = NULL;
@@ -267,6 +352,28 @@ int handle_nsCacheTable( MibHandler* handler,
                     ( u_char* )&status, sizeof( status ) );
                 break;
 
+            case NSCACHE_LOAD_TIME:
+            case NSCACHE_REQUEST_INTERVAL:
+                if ( !cache_entry ) {
+                    Agent_setRequestError( reqinfo, request, PRIOT_NOSUCHINSTANCE );
+                    continue;
+                }
+                counter = ( table_info->colnum == NSCACHE_LOAD_TIME ? cache_entry->loadTime : cache_entry->requestInterval );
+                Client_setVarTypedValue( request->requestvb, asnGAUGE,
+                    ( u_char* )&counter, sizeof( counter ) );
+                break;
+
+            case NSCACHE_HITS:
+            case NSCACHE_MISSES:
+                if ( !cache_entry ) {
+                    Agent_setRequestError( reqinfo, request, PRIOT_NOSUCHINSTANCE );
+                    continue;
+                }
+                counter = ( table_info->colnum == NSCACHE_HITS ? cache_entry->hits : cache_entry->misses ) & 0xffffffff;
+                Client_setVarTypedValue( request->requestvb, asnCOUNTER,
+                    ( u_char* )&counter, sizeof( counter ) );
+                break;
+
             default:
                 Agent_setRequestError( reqinfo, request, PRIOT_NOSUCHOBJECT );
                 continue;
@@ -316,6 +423,13 @@ int handle_nsCacheTable( MibHandler* handler,
                 }
                 break;
 
+            case NSCACHE_LOAD_TIME:
+            case NSCACHE_REQUEST_INTERVAL:
+            case NSCACHE_HITS:
+            case NSCACHE_MISSES:
+                Agent_setRequestError( reqinfo, request, PRIOT_ERR_NOTWRITABLE );
+                return PRIOT_ERR_NOTWRITABLE;
+
             default:
                 Agent_setRequestError( reqinfo, request, PRIOT_ERR_NOCREATION );
                 return PRIOT_ERR_NOCREATION; /* XXX - is this right ? */
@@ -359,9 +473,7 @@ int handle_nsCacheTable( MibHandler* handler,
                     cache_entry->enabled = 0;
                     break;
                 case NSCACHE_STATUS_EMPTY:
-                    cache_entry->free_cache( cache_entry, cache_entry->magic );
-                    free( cache_entry->timestampM );
-                    cache_entry->timestampM = NULL;
+                    CacheHandler_flush( cache_entry );
                     break;
                 }
                 break;
@@ -9,6 +9,13 @@
  */
 void            init_nsCache(void);
 
+/*
+ * Config directives tuning the policies of a cache
+ */
+void            nsCache_parseAdaptive(const char *token, char *line);
+void            nsCache_parseStaleWhileRevalidate(const char *token,
+                                                  char *line);
+
 /*
  * Handlers for the scalar objects
  */
@@ -3,6 +3,7 @@
 #include "CacheHandler.h"
 #include "System/Util/Trace.h"
 #include "System/Util/Logger.h"
+#include "System/Util/ProcFile.h"
 
 #define CPU_FILE "/proc/cpuinfo"
 #define STAT_FILE "/proc/stat"
@@ -59,106 +60,85 @@ void init_cpu_linux( void )
     cpu_num = n;
 }
 
-void _cpu_load_swap_etc( char* buff, netsnmp_cpu_info* cpu );
+static ProcFile _cpu_stat = PROCFILE_INITIALIZER( STAT_FILE );
+static ProcFile _cpu_vmstat = PROCFILE_INITIALIZER( VMSTAT_FILE );
+
+static void _cpu_load_swap_etc( netsnmp_cpu_info* cpu );
 
 /*
      * Load the latest CPU usage statistics
      */
 int netsnmp_cpu_arch_load( Cache* cache, void* magic )
 {
-    static char* buff = NULL;
-    static int bsize = 0;
     static int first = 1;
-    static int num_cpuline_elem = 0;
-    int bytes_read, statfd, i;
-    char *b1, *b2;
-    unsigned long long cusell = 0, cicell = 0, csysll = 0, cidell = 0,
-                       ciowll = 0, cirqll = 0, csoftll = 0, cstealll = 0,
-                       cguestll = 0, cguest_nicell = 0;
+    int num_cpuline_elem = 0, found = 0;
+    const char *line, *next, *end;
+    unsigned long long vals[ 10 ], idx;
     netsnmp_cpu_info* cpu;
 
-    if ( ( statfd = open( STAT_FILE, O_RDONLY, 0 ) ) == -1 ) {
+    if ( ProcFile_read( &_cpu_stat ) != ErrorCode_SUCCESS ) {
         Logger_logPerror( STAT_FILE );
         return -1;
     }
-    if ( bsize == 0 ) {
-        bsize = getpagesize() - 1;
-        buff = ( char* )malloc( bsize + 1 );
-    }
-    while ( ( bytes_read = read( statfd, buff, bsize ) ) == bsize ) {
-        bsize += BUFSIZ;
-        buff = ( char* )realloc( buff, bsize + 1 );
-        DEBUG_MSGTL( ( "cpu", "/proc/stat buffer increased to %d\n", bsize ) );
-        close( statfd );
-        statfd = open( STAT_FILE, O_RDONLY, 0 );
-        if ( statfd == -1 ) {
-            Logger_logPerror( STAT_FILE );
-            return -1;
-        }
-    }
-    close( statfd );
-
-    if ( bytes_read < 0 ) {
-        Logger_logPerror( STAT_FILE "read error" );
-        return -1;
-    }
-    buff[ bytes_read ] = '\0';
 
     /*
          * CPU statistics (overall and per-CPU)
          */
-    b1 = buff;
-    while ( ( b2 = strstr( b1, "cpu" ) ) ) {
-        if ( b2[ 3 ] == ' ' ) {
+    end = _cpu_stat.buffer + _cpu_stat.length;
+    for ( line = _cpu_stat.buffer; line < end; line = next ) {
+        next = ( const char* )memchr( line, '\n', end - line );
+        next = next ? next + 1 : end;
+        if ( strncmp( line, "cpu", 3 ) != 0 )
+            continue;
+        if ( line[ 3 ] == ' ' ) {
             cpu = netsnmp_cpu_get_byIdx( -1, 0 );
             if ( !cpu ) {
                 Logger_logPerror( "No (overall) CPU info entry" );
                 return -1;
             }
-            b1 = b2 + 4; /* Skip "cpu " */
+            line += 4; /* Skip "cpu " */
         } else {
-            sscanf( b2, "cpu%d", &i );
+            line = ProcFile_parseNumber( line + 3, &idx );
+            if ( !line )
+                break;
             /* Create on the fly to support non-x86 systems - see init */
-            cpu = netsnmp_cpu_get_byIdx( i, 1 );
+            cpu = netsnmp_cpu_get_byIdx( ( int )idx, 1 );
             if ( !cpu ) {
                 Logger_logPerror( "Missing CPU info entry" );
                 break;
             }
-            b1 = b2; /* Skip "cpuN " */
-            while ( *b1 != ' ' )
-                b1++;
-            b1++;
         }
+        found = 1;
 
-        num_cpuline_elem = sscanf( b1, "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
-            &cusell, &cicell, &csysll, &cidell, &ciowll, &cirqll, &csoftll, &cstealll, &cguestll, &cguest_nicell );
+        memset( vals, 0, sizeof( vals ) );
+        num_cpuline_elem = ProcFile_parseNumbers( line, vals, 10 );
         DEBUG_MSGTL( ( "cpu", "/proc/stat cpu line number of elements: %i\n", num_cpuline_elem ) );
 
         /* kernel 2.6.33 and above */
         if ( num_cpuline_elem == 10 ) {
-            cpu->guestnice_ticks = cguest_nicell;
+            cpu->guestnice_ticks = vals[ 9 ];
         }
         /* kernel 2.6.24 and above */
         if ( num_cpuline_elem >= 9 ) {
-            cpu->guest_ticks = cguestll;
+            cpu->guest_ticks = vals[ 8 ];
         }
         /* kernel 2.6.11 and above */
         if ( num_cpuline_elem >= 8 ) {
-            cpu->steal_ticks = cstealll;
+            cpu->steal_ticks = vals[ 7 ];
         }
         /* kernel 2.6 */
         if ( num_cpuline_elem >= 5 ) {
-            cpu->wait_ticks = ciowll;
-            cpu->intrpt_ticks = cirqll;
-            cpu->sirq_ticks = csoftll;
+            cpu->wait_ticks = vals[ 4 ];
+            cpu->intrpt_ticks = vals[ 5 ];
+            cpu->sirq_ticks = vals[ 6 ];
         }
         /* rest */
-        cpu->user_ticks = cusell;
-        cpu->nice_ticks = cicell;
-        cpu->sys_ticks = csysll;
-        cpu->idle_ticks = cidell;
+        cpu->user_ticks = vals[ 0 ];
+        cpu->nice_ticks = vals[ 1 ];
+        cpu->sys_ticks = vals[ 2 ];
+        cpu->idle_ticks = vals[ 3 ];
     }
-    if ( b1 == buff ) {
+    if ( !found ) {
         if ( first )
             Logger_log( LOGGER_PRIORITY_ERR, "No cpu line in %s\n", STAT_FILE );
     }
@@ -168,7 +148,7 @@ int netsnmp_cpu_arch_load( Cache* cache, void* magic )
          *   XXX - Do these really belong here ?
          */
     cpu = netsnmp_cpu_get_byIdx( -1, 0 );
-    _cpu_load_swap_etc( buff, cpu );
+    _cpu_load_swap_etc( cpu );
 
     /*
      * XXX - TODO: extract per-CPU statistics
@@ -179,126 +159,68 @@ int netsnmp_cpu_arch_load( Cache* cache, void* magic )
     return 0;
 }
 
+/*
+ * Gets the numbers after key in file, logging a missing line once
+ */
+static int
+_cpu_keyed_values( const ProcFile* file, const char* key,
+    unsigned long long* vals, int count, int first )
+{
+    const char* cp = ProcFile_findLine( file, key );
+
+    if ( cp && ProcFile_parseNumbers( cp, vals, count ) == count )
+        return 1;
+    if ( first )
+        Logger_log( LOGGER_PRIORITY_ERR, "No %s line in %s\n", key, file->path );
+    return 0;
+}
+
 /*
          * Interrupt/Context Switch statistics
          *   XXX - Do these really belong here ?
          */
-void _cpu_load_swap_etc( char* buff, netsnmp_cpu_info* cpu )
+static void
+_cpu_load_swap_etc( netsnmp_cpu_info* cpu )
 {
     static int has_vmstat = 1;
-    static char* vmbuff = NULL;
-    static int vmbsize = 0;
     static int first = 1;
-    int bytes_read, vmstatfd;
-    char* b;
-    unsigned long long pin, pout, swpin, swpout;
-    unsigned long long itot, iticks, ctx;
+    unsigned long long vals[ 2 ];
 
-    if ( has_vmstat ) {
-        vmstatfd = open( VMSTAT_FILE, O_RDONLY, 0 );
-        if ( vmstatfd == -1 ) {
-            Logger_log( LOGGER_PRIORITY_ERR, "cannot open %s\n", VMSTAT_FILE );
-            has_vmstat = 0;
-        } else {
-            if ( vmbsize == 0 ) {
-                vmbsize = getpagesize() - 1;
-                vmbuff = ( char* )malloc( vmbsize + 1 );
-            }
-            while ( ( bytes_read = read( vmstatfd, vmbuff, vmbsize ) ) == vmbsize ) {
-                vmbsize += BUFSIZ;
-                vmbuff = ( char* )realloc( vmbuff, vmbsize + 1 );
-                close( vmstatfd );
-                vmstatfd = open( VMSTAT_FILE, O_RDONLY, 0 );
-                if ( vmstatfd == -1 ) {
-                    Logger_logPerror( "cannot open " VMSTAT_FILE );
-                    return;
-                }
-            }
-            close( vmstatfd );
-            if ( bytes_read < 0 ) {
-                Logger_logPerror( VMSTAT_FILE "read error" );
-                return;
-            }
-            vmbuff[ bytes_read ] = '\0';
-        }
+    if ( has_vmstat && ProcFile_read( &_cpu_vmstat ) != ErrorCode_SUCCESS ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "cannot open %s\n", VMSTAT_FILE );
+        has_vmstat = 0;
     }
 
     if ( has_vmstat ) {
-        b = strstr( vmbuff, "pgpgin " );
-        if ( b ) {
-            sscanf( b, "pgpgin %llu", &pin );
-            cpu->pageIn = ( unsigned long long )pin * 2; /* ??? */
-        } else {
-            if ( first )
-                Logger_log( LOGGER_PRIORITY_ERR, "No pgpgin line in %s\n", VMSTAT_FILE );
-            cpu->pageIn = 0;
-        }
-        b = strstr( vmbuff, "pgpgout " );
-        if ( b ) {
-            sscanf( b, "pgpgout %llu", &pout );
-            cpu->pageOut = ( unsigned long long )pout * 2; /* ??? */
-        } else {
-            if ( first )
-                Logger_log( LOGGER_PRIORITY_ERR, "No pgpgout line in %s\n", VMSTAT_FILE );
-            cpu->pageOut = 0;
-        }
-        b = strstr( vmbuff, "pswpin " );
-        if ( b ) {
-            sscanf( b, "pswpin %llu", &swpin );
-            cpu->swapIn = ( unsigned long long )swpin;
-        } else {
-            if ( first )
-                Logger_log( LOGGER_PRIORITY_ERR, "No pswpin line in %s\n", VMSTAT_FILE );
-            cpu->swapIn = 0;
-        }
-        b = strstr( vmbuff, "pswpout " );
-        if ( b ) {
-            sscanf( b, "pswpout %llu", &swpout );
-            cpu->swapOut = ( unsigned long long )swpout;
-        } else {
-            if ( first )
-                Logger_log( LOGGER_PRIORITY_ERR, "No pswpout line in %s\n", VMSTAT_FILE );
-            cpu->swapOut = 0;
-        }
+        cpu->pageIn = _cpu_keyed_values( &_cpu_vmstat, "pgpgin", vals, 1, first )
+            ? vals[ 0 ] * 2 /* ??? */
+            : 0;
+        cpu->pageOut = _cpu_keyed_values( &_cpu_vmstat, "pgpgout", vals, 1, first )
+            ? vals[ 0 ] * 2 /* ??? */
+            : 0;
+        cpu->swapIn = _cpu_keyed_values( &_cpu_vmstat, "pswpin", vals, 1, first )
+            ? vals[ 0 ]
+            : 0;
+        cpu->swapOut = _cpu_keyed_values( &_cpu_vmstat, "pswpout", vals, 1, first )
+            ? vals[ 0 ]
+            : 0;
     } else {
-        b = strstr( buff, "page " );
-        if ( b ) {
-            sscanf( b, "page %llu %llu", &pin, &pout );
-            cpu->pageIn = ( unsigned long long )pin;
-            cpu->pageOut = ( unsigned long long )pout;
-        } else {
-            if ( first )
-                Logger_log( LOGGER_PRIORITY_ERR, "No page line in %s\n", STAT_FILE );
+        if ( _cpu_keyed_values( &_cpu_stat, "page", vals, 2, first ) ) {
+            cpu->pageIn = vals[ 0 ];
+            cpu->pageOut = vals[ 1 ];
+        } else
             cpu->pageIn = cpu->pageOut = 0;
-        }
-        b = strstr( buff, "swap " );
-        if ( b ) {
-            sscanf( b, "swap %llu %llu", &swpin, &swpout );
-            cpu->swapIn = ( unsigned long long )swpin;
-            cpu->swapOut = ( unsigned long long )swpout;
-        } else {
-            if ( first )
-                Logger_log( LOGGER_PRIORITY_ERR, "No swap line in %s\n", STAT_FILE );
+        if ( _cpu_keyed_values( &_cpu_stat, "swap", vals, 2, first ) ) {
+            cpu->swapIn = vals[ 0 ];
+            cpu->swapOut = vals[ 1 ];
+        } else
             cpu->swapIn = cpu->swapOut = 0;
-        }
     }
 
-    b = strstr( buff, "intr " );
-    if ( b ) {
-        sscanf( b, "intr %llu %llu", &itot, &iticks );
-        cpu->nInterrupts = ( unsigned long long )itot;
-        /* iticks not used? */
-    } else {
-        if ( first )
-            Logger_log( LOGGER_PRIORITY_ERR, "No intr line in %s\n", STAT_FILE );
-    }
-    b = strstr( buff, "ctxt " );
-    if ( b ) {
-        sscanf( b, "ctxt %llu", &ctx );
-        cpu->nCtxSwitches = ( unsigned long long )ctx;
-    } else {
-        if ( first )
-            Logger_log( LOGGER_PRIORITY_ERR, "No ctxt line in %s\n", STAT_FILE );
-    }
+    /* the interrupt total is the first number of the (long) intr line */
+    if ( _cpu_keyed_values( &_cpu_stat, "intr", vals, 1, first ) )
+        cpu->nInterrupts = vals[ 0 ];
+    if ( _cpu_keyed_values( &_cpu_stat, "ctxt", vals, 1, first ) )
+        cpu->nCtxSwitches = vals[ 0 ];
     first = 0;
 }
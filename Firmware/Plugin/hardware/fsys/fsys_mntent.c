@@ -5,8 +5,15 @@
 #include "DsAgent.h"
 #include "System/Util/Logger.h"
 #include "System/String.h"
+#include "System/Util/Time.h"
+#include <errno.h>
+#include <fcntl.h>
 #include <mntent.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/statfs.h>
+#include <time.h>
+#include <unistd.h>
 
 #undef _NETSNMP_GETMNTENT_TWO_ARGS
 
@@ -23,6 +30,54 @@
 #define NSFS_STATFS statfs
 #define NSFS_SIZE f_bsize
 
+/*
+ * statfs() on a hung network mount can block indefinitely, so the
+ * calls are made by a small pool of worker threads.  A load waits at
+ * most FSYS_PROBE_WAIT_MSEC for the probes it queued; a mount whose
+ * probe has not come back by then keeps its last good values and is
+ * flagged NETSNMP_FS_FLAG_STALE.  Each mount has at most one probe
+ * outstanding, so a hung mount ties up one worker and no more.
+ */
+#define FSYS_PROBE_WORKERS_MAX 8
+#define FSYS_PROBE_WAIT_MSEC 100
+#define FSYS_PROBE_HUNG_SEC 10
+
+#define FSYS_MOUNTINFO "/proc/self/mountinfo"
+
+typedef struct fsys_probe_s {
+    char path[ UTILITIES_MAX_PATH + 1 ];
+    struct NSFS_STATFS buf; /* last good result */
+    int have_result;
+    u_int result_round; /* load round of buf */
+    u_int job_round; /* load round of the outstanding probe */
+    int queued; /* queued, or in statfs() */
+    int orphan; /* mount went away while queued */
+    int err; /* errno of the last probe, 0 if it worked */
+    int logged; /* err or hang already reported */
+    struct timeval started;
+    struct fsys_probe_s* next_job;
+} fsys_probe;
+
+typedef struct fsys_mount_s {
+    netsnmp_fsys_info* entry;
+    long flags; /* as derived from the mount table */
+    fsys_probe* probe;
+} fsys_mount;
+
+static pthread_mutex_t _fsys_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _fsys_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _fsys_done;
+static fsys_probe *_fsys_queue_head = NULL, *_fsys_queue_tail = NULL;
+static int _fsys_queued = 0;
+static int _fsys_workers = 0;
+static int _fsys_idle = 0;
+static u_int _fsys_round = 0;
+static int _fsys_outstanding = 0; /* probes of _fsys_round not back yet */
+
+static fsys_mount* _fsys_mounts = NULL;
+static int _fsys_nmounts = 0;
+static int _fsys_mountinfo_fd = -1;
+
 int _fsys_remote( char* device, int type )
 {
     if ( ( type == NETSNMP_FS_TYPE_NFS ) || ( type == NETSNMP_FS_TYPE_AFS ) )
@@ -91,18 +146,253 @@ int _fsys_type( char* tpname )
         return NETSNMP_FS_TYPE_IGNORE;
 }
 
+static void
+_fsys_done_init( void )
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init( &attr );
+    pthread_condattr_setclock( &attr, CLOCK_MONOTONIC );
+    pthread_cond_init( &_fsys_done, &attr );
+    pthread_condattr_destroy( &attr );
+}
+
+/*
+ * The hrStorage/disk tables are loaded while the configuration is
+ * read, which happens before the agent daemonizes: the forked child
+ * has none of the workers, nor a usable lock if one of them held it.
+ * Hold the lock across fork() and start the child with an empty pool;
+ * the workers are started again as probes get queued.
+ */
+static void
+_fsys_fork_prepare( void )
+{
+    pthread_mutex_lock( &_fsys_lock );
+}
+
+static void
+_fsys_fork_parent( void )
+{
+    pthread_mutex_unlock( &_fsys_lock );
+}
+
+static void
+_fsys_fork_child( void )
+{
+    fsys_probe *probe, *next;
+    int i;
+
+    pthread_mutex_init( &_fsys_lock, NULL );
+    pthread_cond_init( &_fsys_work, NULL );
+    _fsys_done_init();
+
+    /*
+     * nobody runs the queued probes any more. orphans which were
+     * in statfs() at the time are lost with their worker.
+     */
+    for ( probe = _fsys_queue_head; probe; probe = next ) {
+        next = probe->next_job;
+        if ( probe->orphan )
+            free( probe );
+    }
+    for ( i = 0; i < _fsys_nmounts; i++ )
+        if ( _fsys_mounts[ i ].probe )
+            _fsys_mounts[ i ].probe->queued = 0;
+
+    _fsys_queue_head = _fsys_queue_tail = NULL;
+    _fsys_queued = 0;
+    _fsys_workers = 0;
+    _fsys_idle = 0;
+    _fsys_outstanding = 0;
+}
+
 void netsnmp_fsys_arch_init( void )
 {
-    return;
+    _fsys_done_init();
+    pthread_atfork( _fsys_fork_prepare, _fsys_fork_parent, _fsys_fork_child );
+
+    _fsys_mountinfo_fd = open( FSYS_MOUNTINFO, O_RDONLY | O_CLOEXEC );
+    if ( _fsys_mountinfo_fd < 0 )
+        DEBUG_MSGTL( ( "fsys:mount", "cannot watch %s, re-reading %s on every load\n",
+            FSYS_MOUNTINFO, ETC_MNTTAB ) );
 }
 
-void netsnmp_fsys_arch_load( void )
+/*
+ * Worker thread: run the queued statfs() calls.  Only the probe
+ * records are shared with the agent thread, never the fsys entries.
+ */
+static void*
+_fsys_probe_worker( void* arg )
 {
-    FILE* fp = NULL;
+    fsys_probe* probe;
+    struct NSFS_STATFS buf;
+    char path[ UTILITIES_MAX_PATH + 1 ];
+    int rc, err;
+
+    pthread_mutex_lock( &_fsys_lock );
+    for ( ;; ) {
+        while ( _fsys_queue_head == NULL ) {
+            _fsys_idle++;
+            pthread_cond_wait( &_fsys_work, &_fsys_lock );
+            _fsys_idle--;
+        }
+        probe = _fsys_queue_head;
+        _fsys_queue_head = probe->next_job;
+        if ( _fsys_queue_head == NULL )
+            _fsys_queue_tail = NULL;
+        _fsys_queued--;
+        Time_getMonotonicClock( &probe->started );
+        memcpy( path, probe->path, sizeof( path ) );
+        pthread_mutex_unlock( &_fsys_lock );
+
+        rc = NSFS_STATFS( path, &buf );
+        err = errno;
+
+        pthread_mutex_lock( &_fsys_lock );
+        probe->queued = 0;
+        if ( probe->orphan ) {
+            free( probe );
+            continue;
+        }
+        if ( rc == 0 ) {
+            probe->buf = buf;
+            probe->have_result = 1;
+            probe->result_round = probe->job_round;
+            probe->err = 0;
+        } else {
+            probe->err = err;
+        }
+        if ( probe->job_round == _fsys_round && --_fsys_outstanding == 0 )
+            pthread_cond_broadcast( &_fsys_done );
+    }
+    return NULL;
+}
+
+/*
+ * Queue a statfs() of the mount, unless one is already outstanding.
+ * Called with _fsys_lock held.
+ */
+static void
+_fsys_probe_queue( fsys_probe* probe )
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    struct timeval now;
+
+    if ( probe->queued ) {
+        Time_getMonotonicClock( &now );
+        if ( probe->started.tv_sec && !probe->logged
+            && now.tv_sec - probe->started.tv_sec >= FSYS_PROBE_HUNG_SEC ) {
+            Logger_log( LOGGER_PRIORITY_WARNING,
+                "statfs %s has not returned for %d seconds\n",
+                probe->path, FSYS_PROBE_HUNG_SEC );
+            probe->logged = 1;
+        }
+        return;
+    }
+
+    probe->queued = 1;
+    probe->job_round = _fsys_round;
+    probe->started.tv_sec = 0;
+    probe->next_job = NULL;
+    if ( _fsys_queue_tail )
+        _fsys_queue_tail->next_job = probe;
+    else
+        _fsys_queue_head = probe;
+    _fsys_queue_tail = probe;
+    _fsys_queued++;
+    _fsys_outstanding++;
+
+    if ( _fsys_idle < _fsys_queued && _fsys_workers < FSYS_PROBE_WORKERS_MAX ) {
+        pthread_attr_init( &attr );
+        pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+        if ( pthread_create( &thread, &attr, _fsys_probe_worker, NULL ) == 0 )
+            _fsys_workers++;
+        else
+            Logger_log( LOGGER_PRIORITY_ERR, "fsys: cannot start probe thread\n" );
+        pthread_attr_destroy( &attr );
+    }
+    pthread_cond_signal( &_fsys_work );
+}
+
+/*
+ * Has the mount table changed since it was last read?
+ * The kernel reports a change as POLLPRI on an open mountinfo file.
+ */
+static int
+_fsys_mounts_changed( void )
+{
+    struct pollfd pfd;
+
+    if ( _fsys_mountinfo_fd < 0 || _fsys_mounts == NULL )
+        return 1;
 
+    pfd.fd = _fsys_mountinfo_fd;
+    pfd.events = POLLPRI;
+    pfd.revents = 0;
+    if ( poll( &pfd, 1, 0 ) < 0 )
+        return 1;
+    return ( pfd.revents & ( POLLPRI | POLLERR ) ) != 0;
+}
+
+/* a mount of the previous list, by the path of its probe */
+typedef struct fsys_old_s {
+    const char* path;
+    fsys_mount* mount;
+} fsys_old;
+
+static int
+_fsys_old_compare( const void* lhs, const void* rhs )
+{
+    return strcmp( ( ( const fsys_old* )lhs )->path,
+        ( ( const fsys_old* )rhs )->path );
+}
+
+/*
+ * Hand the probe record of path over from the previous mounts (sorted
+ * by path), or create one for a new mount.
+ */
+static fsys_probe*
+_fsys_probe_take( fsys_old* old, int nold, const char* path )
+{
+    fsys_probe* probe;
+    int lo = 0, hi = nold, mid;
+
+    while ( lo < hi ) {
+        mid = ( lo + hi ) / 2;
+        if ( strcmp( old[ mid ].path, path ) < 0 )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    /* the same path may be mounted more than once */
+    for ( ; lo < nold && !strcmp( old[ lo ].path, path ); lo++ ) {
+        probe = old[ lo ].mount->probe;
+        if ( probe ) {
+            old[ lo ].mount->probe = NULL;
+            return probe;
+        }
+    }
+    probe = MEMORY_MALLOC_TYPEDEF( fsys_probe );
+    if ( probe )
+        String_copyTruncate( probe->path, path, sizeof( probe->path ) );
+    return probe;
+}
+
+/*
+ * Re-read the mount table into _fsys_mounts, carrying the probe
+ * records of mounts that are still there over to the new list.
+ */
+static void
+_fsys_read_mounts( void )
+{
+    FILE* fp = NULL;
     struct mntent* m;
-    struct NSFS_STATFS stat_buf;
     netsnmp_fsys_info* entry;
+    fsys_mount *old = _fsys_mounts, *mounts = NULL, *tmp;
+    fsys_old* sorted;
+    int nold = _fsys_nmounts, nsorted = 0, n = 0, max = 0, i;
+    long flags;
     char tmpbuf[ 1024 ];
 
     /*
@@ -115,12 +405,18 @@ void netsnmp_fsys_arch_load( void )
         return;
     }
 
-    /*
-     * ... and insert this into the filesystem container.
-     */
-    while
+    sorted = ( fsys_old* )malloc( ( nold ? nold : 1 ) * sizeof( fsys_old ) );
+    for ( i = 0; sorted && i < nold; i++ ) {
+        if ( old[ i ].probe == NULL )
+            continue;
+        sorted[ nsorted ].path = old[ i ].probe->path;
+        sorted[ nsorted ].mount = &old[ i ];
+        nsorted++;
+    }
+    qsort( sorted, nsorted, sizeof( fsys_old ), _fsys_old_compare );
 
-        ( ( m = getmntent( fp ) ) != NULL ) {
+    pthread_mutex_lock( &_fsys_lock );
+    while ( ( m = getmntent( fp ) ) != NULL ) {
         entry = netsnmp_fsys_by_path( m->NSFS_PATH, NETSNMP_FS_FIND_CREATE );
         if ( !entry ) {
             continue;
@@ -129,13 +425,14 @@ void netsnmp_fsys_arch_load( void )
         String_copyTruncate( entry->path, m->NSFS_PATH, sizeof( entry->path ) );
         String_copyTruncate( entry->device, m->NSFS_DEV, sizeof( entry->device ) );
         entry->type = _fsys_type( m->NSFS_TYPE );
+        flags = 0;
         if ( !( entry->type & _NETSNMP_FS_TYPE_SKIP_BIT ) )
-            entry->flags |= NETSNMP_FS_FLAG_ACTIVE;
+            flags |= NETSNMP_FS_FLAG_ACTIVE;
 
         if ( _fsys_remote( entry->device, entry->type ) )
-            entry->flags |= NETSNMP_FS_FLAG_REMOTE;
+            flags |= NETSNMP_FS_FLAG_REMOTE;
         if ( hasmntopt( m, "ro" ) )
-            entry->flags |= NETSNMP_FS_FLAG_RONLY;
+            flags |= NETSNMP_FS_FLAG_RONLY;
         /*
          *  The root device is presumably bootable.
          *  Other partitions probably aren't!
@@ -143,38 +440,139 @@ void netsnmp_fsys_arch_load( void )
          *  XXX - what about /boot ??
          */
         if ( ( entry->path[ 0 ] == '/' ) && ( entry->path[ 1 ] == '\0' ) )
-            entry->flags |= NETSNMP_FS_FLAG_BOOTABLE;
+            flags |= NETSNMP_FS_FLAG_BOOTABLE;
 
         /*
          *  XXX - identify removeable disks
          */
 
+        if ( n == max ) {
+            max = max ? 2 * max : 32;
+            tmp = ( fsys_mount* )realloc( mounts, max * sizeof( fsys_mount ) );
+            if ( tmp == NULL )
+                break;
+            mounts = tmp;
+        }
+        mounts[ n ].entry = entry;
+        mounts[ n ].flags = flags;
+        mounts[ n ].probe = _fsys_probe_take( sorted, nsorted, entry->path );
+        n++;
+    }
+    fclose( fp );
+    free( sorted );
+
+    /*
+     * probes of mounts that went away; a queued one is freed by
+     * the worker once its statfs() returns
+     */
+    for ( i = 0; i < nold; i++ ) {
+        if ( old[ i ].probe == NULL )
+            continue;
+        if ( old[ i ].probe->queued )
+            old[ i ].probe->orphan = 1;
+        else
+            free( old[ i ].probe );
+    }
+    free( old );
+    _fsys_mounts = mounts;
+    _fsys_nmounts = n;
+    pthread_mutex_unlock( &_fsys_lock );
+
+    DEBUG_MSGTL( ( "fsys:mount", "read %d mounts from %s\n", n, ETC_MNTTAB ) );
+}
+
+void netsnmp_fsys_arch_load( void )
+{
+    fsys_mount* mount;
+    netsnmp_fsys_info* entry;
+    fsys_probe* probe;
+    struct NSFS_STATFS* stat_buf;
+    struct timespec deadline;
+    int skip_remote, i;
+
+    if ( _fsys_mounts_changed() )
+        _fsys_read_mounts();
+
+    skip_remote = DefaultStore_getBoolean( DsStore_APPLICATION_ID,
+        DsAgentBoolean_SKIPNFSINHOSTRESOURCES );
+
+    /*
+     * Re-activate the mounted filesystems, and queue a probe of each
+     */
+    pthread_mutex_lock( &_fsys_lock );
+    _fsys_round++;
+    _fsys_outstanding = 0;
+    for ( i = 0; i < _fsys_nmounts; i++ ) {
+        mount = &_fsys_mounts[ i ];
+        mount->entry->flags |= mount->flags;
+
         /*
          *  Optionally skip retrieving statistics for remote mounts
          */
-        if ( ( entry->flags & NETSNMP_FS_FLAG_REMOTE ) && DefaultStore_getBoolean( DsStore_APPLICATION_ID,
-                                                              DsAgentBoolean_SKIPNFSINHOSTRESOURCES ) )
+        if ( ( mount->flags & NETSNMP_FS_FLAG_REMOTE ) && skip_remote )
             continue;
+        if ( mount->probe )
+            _fsys_probe_queue( mount->probe );
+    }
 
-        if ( NSFS_STATFS( entry->path, &stat_buf ) < 0 ) {
-            snprintf( tmpbuf, sizeof( tmpbuf ), "Cannot statfs %s", entry->path );
-            Logger_logPerror( tmpbuf );
+    /*
+     * Give the probes a short while to come back
+     */
+    clock_gettime( CLOCK_MONOTONIC, &deadline );
+    deadline.tv_nsec += FSYS_PROBE_WAIT_MSEC * 1000000L;
+    if ( deadline.tv_nsec >= 1000000000L ) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while ( _fsys_outstanding > 0 ) {
+        if ( pthread_cond_timedwait( &_fsys_done, &_fsys_lock, &deadline ) == ETIMEDOUT )
+            break;
+    }
+
+    /*
+     * ... and copy the results into the filesystem container.
+     */
+    for ( i = 0; i < _fsys_nmounts; i++ ) {
+        mount = &_fsys_mounts[ i ];
+        entry = mount->entry;
+        probe = mount->probe;
+        if ( probe == NULL || ( ( mount->flags & NETSNMP_FS_FLAG_REMOTE ) && skip_remote ) ) {
+            entry->flags &= ~NETSNMP_FS_FLAG_STALE;
             continue;
         }
-        entry->units = stat_buf.NSFS_SIZE;
-        entry->size = stat_buf.f_blocks;
-        entry->used = ( stat_buf.f_blocks - stat_buf.f_bfree );
+
+        if ( probe->err && !probe->logged ) {
+            Logger_log( LOGGER_PRIORITY_ERR, "Cannot statfs %s: %s\n",
+                entry->path, strerror( probe->err ) );
+            probe->logged = 1;
+        } else if ( !probe->err && !probe->queued ) {
+            probe->logged = 0;
+        }
+
+        if ( probe->result_round != _fsys_round || probe->err )
+            entry->flags |= NETSNMP_FS_FLAG_STALE;
+        else
+            entry->flags &= ~NETSNMP_FS_FLAG_STALE;
+        /* a probe still out is hanging, whatever the one before said */
+        entry->stale_errno = probe->queued ? 0 : probe->err;
+        if ( !probe->have_result )
+            continue;
+
+        stat_buf = &probe->buf;
+        entry->units = stat_buf->NSFS_SIZE;
+        entry->size = stat_buf->f_blocks;
+        entry->used = ( stat_buf->f_blocks - stat_buf->f_bfree );
         /* entry->avail is currently unsigned, so protect against negative
          * values!
          * This should be changed to a signed field.
          */
-        if ( stat_buf.f_bavail < 0 )
+        if ( stat_buf->f_bavail < 0 )
             entry->avail = 0;
         else
-            entry->avail = stat_buf.f_bavail;
-        entry->inums_total = stat_buf.f_files;
-        entry->inums_avail = stat_buf.f_ffree;
+            entry->avail = stat_buf->f_bavail;
+        entry->inums_total = stat_buf->f_files;
+        entry->inums_avail = stat_buf->f_ffree;
         netsnmp_fsys_calculate32( entry );
     }
-    fclose( fp );
+    pthread_mutex_unlock( &_fsys_lock );
 }
@@ -23,6 +23,7 @@
  */
 static int _swrun_init = 0;
 int _swrun_max = 0;
+static u_int _swrun_generation = 0;
 static Cache* swrun_cache = NULL;
 static Container_Container* swrun_container = NULL;
 
@@ -45,6 +46,7 @@ static void _swrun_entry_release( netsnmp_swrun_entry* entry,
 extern void netsnmp_arch_swrun_init( void );
 extern int netsnmp_arch_swrun_container_load( Container_Container* container,
     u_int load_flags );
+extern void netsnmp_arch_swrun_entry_release( netsnmp_swrun_entry* entry );
 
 /**
  * initialization
@@ -99,6 +101,22 @@ int swrun_count_processes_by_name( char* name )
     return i;
 }
 
+/**
+ * reload the process list if it is stale and return it
+ *
+ * @param generation if not NULL, set to a counter that changes each
+ *                   time the process list is reloaded, so callers can
+ *                   keep results derived from it until it moves on
+ */
+Container_Container*
+swrun_processes( u_int* generation )
+{
+    CacheHandler_checkAndReload( swrun_cache );
+    if ( generation )
+        *generation = _swrun_generation;
+    return swrun_container;
+}
+
 /**---------------------------------------------------------------------*/
 /*
  * cache functions
@@ -108,6 +126,7 @@ static int
 _cache_load( Cache* cache, void* magic )
 {
     netsnmp_swrun_container_load( swrun_container, 0 );
+    ++_swrun_generation;
     return 0;
 }
 
@@ -131,8 +150,24 @@ netsnmp_swrun_cache( void )
         swrun_cache = CacheHandler_create( 30, /* timeout in seconds */
             _cache_load, _cache_free,
             hrSWRunTable_oid, hrSWRunTable_oid_len );
-        if ( swrun_cache )
-            swrun_cache->flags = CacheOperation_DONT_INVALIDATE_ON_SET;
+        /*
+         * the arch load updates the entries of surviving processes
+         * in place, so keep them across reloads, and don't let expiry
+         * or the auto-release throw them (and their open stat files) away
+         */
+        if ( swrun_cache ) {
+            swrun_cache->flags = CacheOperation_DONT_INVALIDATE_ON_SET
+                | CacheOperation_DONT_FREE_BEFORE_LOAD
+                | CacheOperation_DONT_FREE_EXPIRED
+                | CacheOperation_DONT_AUTO_RELEASE;
+            /*
+             * a busy poller gets fresher process lists, an idle one
+             * fewer rescans, and neither waits for the rescan.
+             * cacheAdaptive/cacheStaleWhileRevalidate override these.
+             */
+            CacheHandler_setAdaptiveTimeout( swrun_cache, 5, 60, 5 );
+            CacheHandler_setStaleWhileRevalidate( swrun_cache, 2, 30 );
+        }
     }
     return swrun_cache;
 }
@@ -276,6 +311,7 @@ netsnmp_swrun_entry_create( int32_t index )
     entry->hrSWRunIndex = index;
     entry->hrSWRunType = 1; /* unknown */
     entry->hrSWRunStatus = 2; /* runnable */
+    entry->stat_fd = -1;
 
     entry->oid_index.len = 1;
     entry->oid_index.oids = ( oid* )&entry->hrSWRunIndex;
@@ -290,6 +326,8 @@ void netsnmp_swrun_entry_free( netsnmp_swrun_entry* entry )
     if ( NULL == entry )
         return;
 
+    netsnmp_arch_swrun_entry_release( entry );
+
     /*
      * MEMORY_FREE not needed, for any of these, 
      * since the whole entry is about to be freed
@@ -6,34 +6,305 @@
 
 #include "siglog/data_access/swrun.h"
 #include "System/Containers/Container.h"
+#include "System/Containers/ContainerSync.h"
 #include "System/Util/Trace.h"
 #include "System/Util/Logger.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
 static long pagesize;
 static long sc_clk_tck;
 
+/*
+ * the container is reloaded incrementally: name, path and parameters of
+ * a process are read once, later reloads only read /proc/{pid}/stat.
+ */
+static ContainerSync _swrun_sync;
+
+/*
+ * /proc/{pid}/stat of known processes is kept open and re-read with
+ * pread, within a share of the fd limit.
+ */
+static int _swrun_fds_kept = 0;
+static int _swrun_fds_max = 0;
+
 /* ---------------------------------------------------------------------
  */
 void netsnmp_arch_swrun_init( void )
 {
+    struct rlimit rl;
 
     pagesize = getpagesize();
     sc_clk_tck = sysconf( _SC_CLK_TCK );
+
+    if ( 0 == getrlimit( RLIMIT_NOFILE, &rl ) && RLIM_INFINITY != rl.rlim_cur )
+        _swrun_fds_max = rl.rlim_cur / 4;
+    else
+        _swrun_fds_max = 1024;
     return;
 }
 
+void netsnmp_arch_swrun_entry_release( netsnmp_swrun_entry* entry )
+{
+    if ( entry->stat_fd >= 0 ) {
+        close( entry->stat_fd );
+        entry->stat_fd = -1;
+        --_swrun_fds_kept;
+    }
+}
+
+/* ---------------------------------------------------------------------
+ */
+
+/*
+ * read a whole (small) /proc file into buf, nul terminated.
+ * returns the length, -1 on error.
+ */
+static int
+_swrun_read_file( const char* path, char* buf, size_t size )
+{
+    int fd, len;
+
+    fd = open( path, O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 )
+        return -1;
+    len = read( fd, buf, size - 1 );
+    close( fd );
+    if ( len < 0 )
+        return -1;
+    buf[ len ] = '\0';
+    return len;
+}
+
+/*
+ * read /proc/{pid}/stat of row into buf, through its kept-open fd if
+ * it has one. returns the length, -1 if the process is gone.
+ */
+static int
+_swrun_read_stat( netsnmp_swrun_entry* row, netsnmp_swrun_entry* old,
+    char* buf, size_t size )
+{
+    char path[ 32 ];
+    int len;
+
+    if ( row->stat_fd >= 0 ) {
+        len = pread( row->stat_fd, buf, size - 1, 0 );
+        if ( len > 0 ) {
+            buf[ len ] = '\0';
+            return len;
+        }
+        /*
+         * the process it belonged to exited, the pid may have been
+         * reused since: look it up again
+         */
+        netsnmp_arch_swrun_entry_release( old );
+        row->stat_fd = -1;
+    }
+
+    snprintf( path, sizeof( path ), "/proc/%d/stat", ( int )row->hrSWRunIndex );
+    row->stat_fd = open( path, O_RDONLY | O_CLOEXEC );
+    if ( row->stat_fd < 0 )
+        return -1;
+    ++_swrun_fds_kept;
+
+    len = read( row->stat_fd, buf, size - 1 );
+    if ( len <= 0 || _swrun_fds_kept > _swrun_fds_max )
+        netsnmp_arch_swrun_entry_release( row );
+    if ( len <= 0 )
+        return -1;
+    buf[ len ] = '\0';
+    return len;
+}
+
+/*
+ *   {pid} ({comm}) STATUS  {xxx}*10  UTIME STIME  {xxx}*6 STARTTIME {xxx} RSS
+ */
+static int
+_swrun_parse_stat( netsnmp_swrun_entry* row, char* buf )
+{
+    unsigned long long value, cpu = 0;
+    char *cp, *end;
+    int field;
+
+    /* the command may contain anything, even ')' */
+    cp = strrchr( buf, ')' );
+    if ( NULL == cp || '\0' == cp[ 1 ] || '\0' == cp[ 2 ] )
+        return -1;
+    cp += 2;
+
+    switch ( *cp ) {
+    case 'R':
+        row->hrSWRunStatus = HRSWRUNSTATUS_RUNNING;
+        break;
+    case 'S':
+        row->hrSWRunStatus = HRSWRUNSTATUS_RUNNABLE;
+        break;
+    case 'D':
+    case 'T':
+        row->hrSWRunStatus = HRSWRUNSTATUS_NOTRUNNABLE;
+        break;
+    case 'Z':
+    default:
+        row->hrSWRunStatus = HRSWRUNSTATUS_INVALID;
+        break;
+    }
+    ++cp;
+
+    for ( field = 4; field <= 24; field++ ) {
+        value = strtoull( cp, &end, 10 );
+        if ( end == cp )
+            return -1;
+        cp = end;
+
+        switch ( field ) {
+        case 14: /* utime */
+        case 15: /* stime */
+            cpu += value;
+            break;
+        case 22:
+            row->start_time = value;
+            break;
+        case 24:
+            row->hrSWRunPerfMem = value * ( pagesize / 1024 ); /* rss in kB */
+            break;
+        }
+    }
+    row->hrSWRunPerfCPU = cpu * 100 / sc_clk_tck;
+    return 0;
+}
+
+/*
+ * the fields which don't change during the life of a process
+ */
+static int
+_swrun_read_static( netsnmp_swrun_entry* row )
+{
+    char buf[ BUFSIZ ], path[ 32 ], *cp, *end;
+    int pid = row->hrSWRunIndex, len;
+
+    /*
+     *   Name:  process name
+     */
+    snprintf( path, sizeof( path ), "/proc/%d/status", pid );
+    if ( _swrun_read_file( path, buf, sizeof( buf ) ) <= 0 )
+        return -1; /* file (process) probably went away */
+
+    for ( cp = buf; *cp && *cp != ':'; cp++ )
+        ;
+    if ( *cp )
+        cp++; /* Skip ':' */
+    while ( isspace( *cp ) ) /* and following spaces */
+        cp++;
+    end = strchr( cp, '\n' );
+    if ( end )
+        *end = '\0'; /* Stamp on trailing newline */
+    row->hrSWRunName_len = snprintf( row->hrSWRunName,
+        sizeof( row->hrSWRunName ) - 1, "%s", cp );
+    if ( row->hrSWRunName_len > sizeof( row->hrSWRunName ) - 1 )
+        row->hrSWRunName_len = sizeof( row->hrSWRunName ) - 1;
+
+    /*
+     *  Command Line:
+     *     argv[0] '\0' argv[1] '\0' ....
+     */
+    snprintf( path, sizeof( path ), "/proc/%d/cmdline", pid );
+    len = _swrun_read_file( path, buf, sizeof( buf ) - 1 );
+    if ( len < 0 )
+        return -1; /* file (process) probably went away */
+
+    row->hrSWRunType = HRSWRUNTYPE_APPLICATION;
+    if ( len > 0 ) {
+        buf[ len ] = '\0';
+        buf[ len + 1 ] = '\0';
+        /*
+         *     argv[0]   is hrSWRunPath
+         */
+        row->hrSWRunPath_len = snprintf( row->hrSWRunPath,
+            sizeof( row->hrSWRunPath ) - 1, "%s", buf );
+        if ( row->hrSWRunPath_len > sizeof( row->hrSWRunPath ) - 1 )
+            row->hrSWRunPath_len = sizeof( row->hrSWRunPath ) - 1;
+        /*
+         * Stitch together argv[1..] to construct hrSWRunParameters
+         */
+        cp = buf + strlen( buf ) + 1;
+        for ( end = cp; end < buf + len - 1; end++ )
+            if ( '\0' == *end )
+                *end = ' ';
+        row->hrSWRunParameters_len
+            = sprintf( row->hrSWRunParameters, "%.*s",
+                ( int )sizeof( row->hrSWRunParameters ) - 1,
+                ( cp < buf + len ) ? cp : "" );
+    } else {
+        /* empty /proc/PID/cmdline, it's probably a kernel thread */
+        row->hrSWRunPath_len = 0;
+        row->hrSWRunParameters_len = 0;
+        row->hrSWRunType = HRSWRUNTYPE_OPERATINGSYSTEM;
+    }
+    row->hrSWRunPath[ row->hrSWRunPath_len ] = '\0';
+    return 0;
+}
+
+/* ---------------------------------------------------------------------
+ * ContainerSync callbacks
+ */
+static void*
+_swrun_create( const void* row, void* context )
+{
+    netsnmp_swrun_entry* entry;
+
+    entry = netsnmp_swrun_entry_create( ( ( const netsnmp_swrun_entry* )row )->hrSWRunIndex );
+    if ( NULL == entry ) {
+        /* the stat file is ours now, entry or not */
+        if ( ( ( const netsnmp_swrun_entry* )row )->stat_fd >= 0 ) {
+            close( ( ( const netsnmp_swrun_entry* )row )->stat_fd );
+            --_swrun_fds_kept;
+        }
+        return NULL;
+    }
+
+    *entry = *( const netsnmp_swrun_entry* )row;
+    entry->oid_index.oids = ( oid* )&entry->hrSWRunIndex;
+    return entry;
+}
+
+static int
+_swrun_update( void* e, const void* r, void* context )
+{
+    netsnmp_swrun_entry* entry = ( netsnmp_swrun_entry* )e;
+    const netsnmp_swrun_entry* row = ( const netsnmp_swrun_entry* )r;
+    u_int generation = entry->generation;
+    int changed;
+
+    changed = ( entry->start_time != row->start_time )
+        + ( entry->hrSWRunStatus != row->hrSWRunStatus )
+        + ( entry->hrSWRunPerfCPU != row->hrSWRunPerfCPU )
+        + ( entry->hrSWRunPerfMem != row->hrSWRunPerfMem );
+
+    *entry = *row;
+    entry->oid_index.oids = ( oid* )&entry->hrSWRunIndex;
+    entry->generation = generation;
+    return changed;
+}
+
+static void
+_swrun_release( void* entry, void* context )
+{
+    netsnmp_swrun_entry_free( ( netsnmp_swrun_entry* )entry );
+}
+
 /* ---------------------------------------------------------------------
  */
 int netsnmp_arch_swrun_container_load( Container_Container* container, u_int flags )
 {
     DIR* procdir = NULL;
     struct dirent* procentry_p;
-    FILE* fp;
-    int pid, i;
-    unsigned long long cpu;
-    char buf[ BUFSIZ ], buf2[ BUFSIZ ], *cp, *cp1;
-    netsnmp_swrun_entry* entry;
+    int pid;
+    oid index;
+    Types_Index key;
+    char buf[ BUFSIZ ];
+    netsnmp_swrun_entry row, *old;
 
     procdir = opendir( "/proc" );
     if ( NULL == procdir ) {
@@ -41,6 +312,19 @@ int netsnmp_arch_swrun_container_load( Container_Container* container, u_int fla
         return -1;
     }
 
+    if ( _swrun_sync.container != container ) {
+        u_int generation = _swrun_sync.generation;
+
+        ContainerSync_init( &_swrun_sync, container,
+            offsetof( netsnmp_swrun_entry, generation ), _swrun_create,
+            _swrun_update, _swrun_release, NULL );
+        _swrun_sync.generation = generation;
+    }
+    ContainerSync_begin( &_swrun_sync );
+
+    key.len = 1;
+    key.oids = &index;
+
     /*
      * Walk through the list of processes in the /proc tree
      */
@@ -49,152 +333,46 @@ int netsnmp_arch_swrun_container_load( Container_Container* container, u_int fla
         if ( 0 == pid )
             continue; /* Presumably '.' or '..' */
 
-        entry = netsnmp_swrun_entry_create( pid );
-        if ( NULL == entry )
-            continue; /* error already logged by function */
+        index = pid;
+        old = ( netsnmp_swrun_entry* )CONTAINER_FIND( container, &key );
+        if ( old )
+            row = *old;
+        else {
+            memset( &row, 0, sizeof( row ) );
+            row.hrSWRunIndex = pid;
+            row.hrSWRunType = HRSWRUNTYPE_UNKNOWN;
+            row.hrSWRunStatus = HRSWRUNSTATUS_RUNNABLE;
+            row.stat_fd = -1;
+        }
+        row.oid_index.len = 1;
+        row.oid_index.oids = ( oid* )&row.hrSWRunIndex;
 
         /*
          * Now extract the interesting information
          *   from the various /proc{PID}/ interface files
          */
+        if ( _swrun_read_stat( &row, old, buf, sizeof( buf ) ) < 0 )
+            continue; /* process went away */
 
-        /*
-         *   Name:  process name
-         */
-        snprintf( buf2, BUFSIZ, "/proc/%d/status", pid );
-        fp = fopen( buf2, "r" );
-        if ( !fp ) {
-            netsnmp_swrun_entry_free( entry );
-            continue; /* file (process) probably went away */
-        }
-        memset( buf, 0, sizeof( buf ) );
-        if ( fgets( buf, BUFSIZ - 1, fp ) == NULL ) {
-            fclose( fp );
-            netsnmp_swrun_entry_free( entry );
-            continue;
-        }
-        fclose( fp );
-
-        for ( cp = buf; *cp != ':'; cp++ )
-            ;
-        while ( isspace( *( ++cp ) ) ) /* Skip ':' and following spaces */
-            ;
-        entry->hrSWRunName_len = snprintf( entry->hrSWRunName,
-            sizeof( entry->hrSWRunName ) - 1, "%s", cp );
-        if ( '\n' == entry->hrSWRunName[ entry->hrSWRunName_len - 1 ] ) {
-            entry->hrSWRunName[ entry->hrSWRunName_len - 1 ] = '\0';
-            entry->hrSWRunName_len--; /* Stamp on trailing newline */
-        }
-
-        /*
-         *  Command Line:
-         *     argv[0] '\0' argv[1] '\0' ....
-         */
-        snprintf( buf2, BUFSIZ, "/proc/%d/cmdline", pid );
-        fp = fopen( buf2, "r" );
-        if ( !fp ) {
-            netsnmp_swrun_entry_free( entry );
-            continue; /* file (process) probably went away */
-        }
-        entry->hrSWRunType = HRSWRUNTYPE_APPLICATION;
-        memset( buf, 0, sizeof( buf ) );
-        cp = fgets( buf, BUFSIZ - 1, fp );
-        fclose( fp );
-        if ( cp != NULL ) {
-            /*
-             *     argv[0]   is hrSWRunPath
-             */
-            entry->hrSWRunPath_len = snprintf( entry->hrSWRunPath,
-                sizeof( entry->hrSWRunPath ) - 1, "%s", buf );
-            /*
-             * Stitch together argv[1..] to construct hrSWRunParameters
-             */
-            cp = buf + entry->hrSWRunPath_len + 1;
-            while ( 1 ) {
-                while ( *cp )
-                    cp++;
-                if ( '\0' == *( cp + 1 ) )
-                    break; /* '\0''\0' => End of command line */
-                *cp = ' ';
-            }
-            entry->hrSWRunParameters_len
-                = sprintf( entry->hrSWRunParameters, "%.*s",
-                    ( int )sizeof( entry->hrSWRunParameters ) - 1,
-                    buf + entry->hrSWRunPath_len + 1 );
-        } else {
-            /* empty /proc/PID/cmdline, it's probably a kernel thread */
-            entry->hrSWRunPath_len = 0;
-            entry->hrSWRunParameters_len = 0;
-            entry->hrSWRunType = HRSWRUNTYPE_OPERATINGSYSTEM;
-        }
-
-        /*
-         *   {xxx} {xxx} STATUS  {xxx}*10  UTIME STIME  {xxx}*8 RSS
-         */
-        snprintf( buf, BUFSIZ, "/proc/%d/stat", pid );
-        fp = fopen( buf, "r" );
-        if ( !fp ) {
-            netsnmp_swrun_entry_free( entry );
-            continue; /* file (process) probably went away */
-        }
-        if ( fgets( buf, BUFSIZ - 1, fp ) == NULL ) {
-            fclose( fp );
-            netsnmp_swrun_entry_free( entry );
+        if ( _swrun_parse_stat( &row, buf ) < 0
+            || ( ( NULL == old || old->start_time != row.start_time )
+                   && _swrun_read_static( &row ) < 0 ) ) {
+            /* don't leak a stat file the container doesn't know about */
+            if ( NULL == old || old->stat_fd != row.stat_fd )
+                netsnmp_arch_swrun_entry_release( &row );
             continue;
         }
-        fclose( fp );
-
-        cp = buf;
-        while ( ' ' != *( cp++ ) ) /* Skip first field */
-            ;
-        cp1 = cp; /* Skip second field */
-        while ( *cp1 ) {
-            if ( *cp1 == ')' )
-                cp = cp1;
-            cp1++;
-        }
-        cp += 2;
 
-        switch ( *cp ) {
-        case 'R':
-            entry->hrSWRunStatus = HRSWRUNSTATUS_RUNNING;
-            break;
-        case 'S':
-            entry->hrSWRunStatus = HRSWRUNSTATUS_RUNNABLE;
-            break;
-        case 'D':
-        case 'T':
-            entry->hrSWRunStatus = HRSWRUNSTATUS_NOTRUNNABLE;
-            break;
-        case 'Z':
-        default:
-            entry->hrSWRunStatus = HRSWRUNSTATUS_INVALID;
-            break;
-        }
-        for ( i = 11; i; i-- ) { /* Skip STATUS + 10 fields */
-            while ( ' ' != *( ++cp ) )
-                ;
-            cp++;
-        }
-        cpu = atol( cp ); /*  utime */
-        while ( ' ' != *( ++cp ) )
-            ;
-        cpu += atol( cp ); /* +stime */
-        entry->hrSWRunPerfCPU = cpu * 100 / sc_clk_tck;
-
-        for ( i = 9; i; i-- ) { /* Skip stime + 8 fields */
-            while ( ' ' != *( ++cp ) )
-                ;
-            cp++;
-        }
-        entry->hrSWRunPerfMem = atol( cp ); /* rss   */
-        entry->hrSWRunPerfMem *= ( pagesize / 1024 ); /* in kB */
-        CONTAINER_INSERT( container, entry );
+        /* from here on the container owns the stat file */
+        ContainerSync_row( &_swrun_sync, &key, &row );
     }
     closedir( procdir );
 
-    DEBUG_MSGTL( ( "swrun:load:arch", " loaded %" NETSNMP_PRIz "d entries\n",
-        CONTAINER_SIZE( container ) ) );
+    ContainerSync_end( &_swrun_sync );
+
+    DEBUG_MSGTL( ( "swrun:load:arch", " loaded %" NETSNMP_PRIz "d entries"
+                                      " (%" NETSNMP_PRIz "d new, %" NETSNMP_PRIz "d gone)\n",
+        CONTAINER_SIZE( container ), _swrun_sync.inserted, _swrun_sync.deleted ) );
 
     return 0;
 }
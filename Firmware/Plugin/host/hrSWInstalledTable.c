@@ -55,7 +55,7 @@ void initialize_table_hrSWInstalledTable( void )
     size_t hrSWInstalledTable_oid_len = asnOID_LENGTH( hrSWInstalledTable_oid );
     HandlerRegistration* reg;
     MibHandler* handler = NULL;
-    Container_Container* container = NULL;
+    MibHandler* container_handler = NULL;
     Cache* cache = NULL;
 
     DEBUG_MSGTL( ( "hrSWInstalled", "initialize\n" ) );
@@ -70,12 +70,6 @@ void initialize_table_hrSWInstalledTable( void )
         goto bail;
     }
 
-    container = Container_find( "hrSWInstalledTable:tableContainer" );
-    if ( NULL == container ) {
-        Logger_log( LOGGER_PRIORITY_ERR, "error creating container for " MYTABLE "\n" );
-        goto bail;
-    }
-
     table_info = MEMORY_MALLOC_TYPEDEF( TableRegistrationInfo );
     if ( NULL == table_info ) {
         Logger_log( LOGGER_PRIORITY_ERR, "error allocating table registration for " MYTABLE "\n" );
@@ -89,9 +83,10 @@ void initialize_table_hrSWInstalledTable( void )
 
     /*************************************************
      *
-     * inject container_table helper
+     * inject container_table helper; the rows are in the container of
+     * each cache snapshot, set below
      */
-    handler = TableContainer_handlerGet( table_info, container,
+    handler = TableContainer_handlerGet( table_info, NULL,
         TABLE_CONTAINER_KEY_NETSNMP_INDEX );
     if ( NULL == handler ) {
         Logger_log( LOGGER_PRIORITY_ERR, "error allocating table registration for " MYTABLE "\n" );
@@ -101,6 +96,7 @@ void initialize_table_hrSWInstalledTable( void )
         Logger_log( LOGGER_PRIORITY_ERR, "error injecting container_table handler for " MYTABLE "\n" );
         goto bail;
     }
+    container_handler = handler;
     handler = NULL; /* reg has it, will reuse below */
 
     /*************************************************
@@ -116,7 +112,16 @@ void initialize_table_hrSWInstalledTable( void )
         Logger_log( LOGGER_PRIORITY_ERR, "error creating cache for " MYTABLE "\n" );
         goto bail;
     }
-    cache->magic = container;
+
+    /*
+     * every load builds a new container, which requests keep using until
+     * they are done; asking the package database takes a while, so the
+     * list is refreshed before it expires rather than when a request
+     * finds it expired.
+     */
+    cache->flags |= CacheOperation_SNAPSHOT;
+    CacheHandler_setStaleWhileRevalidate( cache, 5, 300 );
+    TableContainer_setCache( container_handler, cache );
 
     handler = CacheHandler_handlerGet( cache );
     if ( NULL == handler ) {
@@ -148,9 +153,6 @@ bail: /* not ok */
     if ( table_info )
         Table_registrationInfoFree( table_info );
 
-    if ( container )
-        CONTAINER_FREE( container );
-
     if ( reg )
         AgentHandler_handlerRegistrationFree( reg );
 }
@@ -235,7 +237,7 @@ _cache_load( Cache* cache, void* vmagic )
 {
     DEBUG_MSGTL( ( "hrSWInstalledTable:cache", "load\n" ) );
 
-    if ( ( NULL == cache ) || ( NULL == cache->magic ) ) {
+    if ( NULL == cache ) {
         Logger_log( LOGGER_PRIORITY_ERR, "invalid cache for hrSWInstalledTable_cache_load\n" );
         return -1;
     }
@@ -243,9 +245,10 @@ _cache_load( Cache* cache, void* vmagic )
     /** should only be called for an invalid or expired cache */
     Assert_assert( ( 0 == cache->valid ) || ( 1 == cache->expired ) );
 
-    cache->magic = netsnmp_swinst_container_load( ( Container_Container* )cache->magic, 0 );
+    /** a new snapshot: the previous one may still be in use */
+    cache->magic = netsnmp_swinst_container_load( NULL, 0 );
 
-    return 0;
+    return cache->magic ? 0 : -1;
 } /* _cache_load */
 
 /**
@@ -254,11 +257,11 @@ _cache_load( Cache* cache, void* vmagic )
 static void
 _cache_free( Cache* cache, void* magic )
 {
-    if ( ( NULL == cache ) || ( NULL == cache->magic ) ) {
+    if ( ( NULL == cache ) || ( NULL == magic ) ) {
         Logger_log( LOGGER_PRIORITY_ERR, "invalid cache in hrSWInstalledTable_cache_free\n" );
         return;
     }
     DEBUG_MSGTL( ( "hrSWInstalledTable:cache", "free\n" ) );
 
-    netsnmp_swinst_container_free_items( ( Container_Container* )cache->magic );
+    netsnmp_swinst_container_free( ( Container_Container* )magic, 0 );
 } /* _cache_free */
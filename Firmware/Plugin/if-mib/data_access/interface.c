@@ -50,6 +50,9 @@ extern int
 netsnmp_arch_set_admin_status( netsnmp_interface_entry* entry,
     int ifAdminStatus );
 extern int netsnmp_arch_interface_index_find( const char* name );
+extern void
+netsnmp_arch_interface_extras_get( netsnmp_interface_entry* entry,
+    u_int which );
 
 /**
  * initialization
@@ -703,6 +706,25 @@ void netsnmp_access_interface_entry_guess_speed( netsnmp_interface_entry* entry
     entry->speed_high = entry->speed / 1000000LL;
 }
 
+/**
+ * fill in values the loader deferred (see NETSNMP_INTERFACE_FLAGS_LAZY_*).
+ * Values already read are left alone.
+ */
+void netsnmp_access_interface_entry_extras_get( netsnmp_interface_entry* entry,
+    u_int which )
+{
+    if ( NULL == entry )
+        return;
+
+    which &= entry->ns_flags & ( NETSNMP_INTERFACE_FLAGS_LAZY_SPEED | NETSNMP_INTERFACE_FLAGS_LAZY_V4_RETRANSMIT );
+    if ( 0 == which )
+        return;
+
+    DEBUG_MSGTL( ( "access:interface:entry", "extras_get %s (%x)\n",
+        entry->name, which ) );
+    netsnmp_arch_interface_extras_get( entry, which );
+}
+
 netsnmp_conf_if_list*
 netsnmp_access_interface_entry_overrides_get( const char* name )
 {
@@ -735,6 +757,7 @@ void netsnmp_access_interface_entry_overrides( netsnmp_interface_entry* entry )
 
     if_ptr = netsnmp_access_interface_entry_overrides_get( entry->name );
     if ( if_ptr ) {
+        entry->ns_flags &= ~NETSNMP_INTERFACE_FLAGS_LAZY_SPEED;
         entry->type = if_ptr->type;
         if ( if_ptr->speed > 0xffffffff ) {
             entry->speed = 0xffffffff;
@@ -69,6 +69,69 @@ _ioctl_get( int fd, int which, struct ifreq* ifrq, const char* name )
     return rc;
 }
 
+/**
+ * map an ARPHRD_* hardware type (if_arp.h) to an IANAifType
+ *
+ * @param arphrd : hardware type, as in sa_family of SIOCGIFHWADDR or
+ *                 ifi_type of an rtnetlink link message
+ */
+int netsnmp_access_interface_type_from_arphrd( int arphrd )
+{
+    /*
+     * arphrd defines vary greatly. ETHER seems to be the only common one
+     */
+    switch ( arphrd ) {
+    case ARPHRD_ETHER:
+        return IANAIFTYPE_ETHERNETCSMACD;
+
+    case ARPHRD_TUNNEL:
+    case ARPHRD_TUNNEL6:
+
+    case ARPHRD_IPGRE:
+
+    case ARPHRD_SIT:
+        return IANAIFTYPE_TUNNEL; /* tunnel */
+
+    case ARPHRD_INFINIBAND:
+        return IANAIFTYPE_INFINIBAND;
+
+    case ARPHRD_SLIP:
+    case ARPHRD_CSLIP:
+    case ARPHRD_SLIP6:
+    case ARPHRD_CSLIP6:
+        return IANAIFTYPE_SLIP; /* slip */
+
+    case ARPHRD_PPP:
+        return IANAIFTYPE_PPP; /* ppp */
+
+    case ARPHRD_LOOPBACK:
+        return IANAIFTYPE_SOFTWARELOOPBACK; /* softwareLoopback */
+
+    case ARPHRD_FDDI:
+        return IANAIFTYPE_FDDI;
+
+    case ARPHRD_ARCNET:
+        return IANAIFTYPE_ARCNET;
+
+    case ARPHRD_LOCALTLK:
+        return IANAIFTYPE_LOCALTALK;
+
+    case ARPHRD_HIPPI:
+        return IANAIFTYPE_HIPPI;
+
+    case ARPHRD_ATM:
+        return IANAIFTYPE_ATM;
+
+    /*
+     * XXX: more if_arp.h:ARPHRD_xxx to IANAifType mappings...
+     */
+    default:
+        DEBUG_MSGTL( ( "access:interface:ioctl", "unknown entry type %d\n",
+            arphrd ) );
+        return IANAIFTYPE_OTHER;
+    } /* switch */
+}
+
 /**
  * interface entry physaddr ioctl wrapper
  *
@@ -116,69 +179,8 @@ int netsnmp_access_interface_ioctl_physaddr_get( int fd,
         } else {
             memcpy( ifentry->paddr, ifrq.ifr_hwaddr.sa_data, IFHWADDRLEN );
 
-            /*
-             * arphrd defines vary greatly. ETHER seems to be the only common one
-             */
-            switch ( ifrq.ifr_hwaddr.sa_family ) {
-            case ARPHRD_ETHER:
-                ifentry->type = IANAIFTYPE_ETHERNETCSMACD;
-                break;
-
-            case ARPHRD_TUNNEL:
-            case ARPHRD_TUNNEL6:
-
-            case ARPHRD_IPGRE:
-
-            case ARPHRD_SIT:
-                ifentry->type = IANAIFTYPE_TUNNEL;
-                break; /* tunnel */
-
-            case ARPHRD_INFINIBAND:
-                ifentry->type = IANAIFTYPE_INFINIBAND;
-                break;
-
-            case ARPHRD_SLIP:
-            case ARPHRD_CSLIP:
-            case ARPHRD_SLIP6:
-            case ARPHRD_CSLIP6:
-                ifentry->type = IANAIFTYPE_SLIP;
-                break; /* slip */
-
-            case ARPHRD_PPP:
-                ifentry->type = IANAIFTYPE_PPP;
-                break; /* ppp */
-
-            case ARPHRD_LOOPBACK:
-                ifentry->type = IANAIFTYPE_SOFTWARELOOPBACK;
-                break; /* softwareLoopback */
-
-            case ARPHRD_FDDI:
-                ifentry->type = IANAIFTYPE_FDDI;
-                break;
-
-            case ARPHRD_ARCNET:
-                ifentry->type = IANAIFTYPE_ARCNET;
-                break;
-
-            case ARPHRD_LOCALTLK:
-                ifentry->type = IANAIFTYPE_LOCALTALK;
-                break;
-
-            case ARPHRD_HIPPI:
-                ifentry->type = IANAIFTYPE_HIPPI;
-                break;
-
-            case ARPHRD_ATM:
-                ifentry->type = IANAIFTYPE_ATM;
-                break;
-            /*
-                 * XXX: more if_arp.h:ARPHRD_xxx to IANAifType mappings... 
-                 */
-            default:
-                DEBUG_MSGTL( ( "access:interface:ioctl", "unknown entry type %d\n",
-                    ifrq.ifr_hwaddr.sa_family ) );
-                ifentry->type = IANAIFTYPE_OTHER;
-            } /* switch */
+            ifentry->type = netsnmp_access_interface_type_from_arphrd(
+                ifrq.ifr_hwaddr.sa_family );
         }
     }
 
@@ -209,38 +211,51 @@ int netsnmp_access_interface_ioctl_flags_get( int fd,
         ifentry->ns_flags &= ~NETSNMP_INTERFACE_FLAGS_HAS_IF_FLAGS;
         return rc; /* msg already logged */
     } else {
-        ifentry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_IF_FLAGS;
-        ifentry->os_flags = ifrq.ifr_flags;
+        netsnmp_access_interface_os_flags_set( ifentry, ifrq.ifr_flags );
+    }
 
-        /*
-         * ifOperStatus description:
-         *   If ifAdminStatus is down(2) then ifOperStatus should be down(2).
-         */
-        if ( ifentry->os_flags & IFF_UP ) {
-            ifentry->admin_status = IFADMINSTATUS_UP;
-            if ( ifentry->os_flags & IFF_RUNNING )
-                ifentry->oper_status = IFOPERSTATUS_UP;
-            else
-                ifentry->oper_status = IFOPERSTATUS_DOWN;
-        } else {
-            ifentry->admin_status = IFADMINSTATUS_DOWN;
-            ifentry->oper_status = IFOPERSTATUS_DOWN;
-        }
+    return rc;
+}
 
-        /*
-         * ifConnectorPresent description:
-         *   This object has the value 'true(1)' if the interface sublayer has a
-         *   physical connector and the value 'false(2)' otherwise."
-         * So, at very least, false(2) should be returned for loopback devices.
-         */
-        if ( ifentry->os_flags & IFF_LOOPBACK ) {
-            ifentry->connector_present = 0;
-        } else {
-            ifentry->connector_present = 1;
-        }
+/**
+ * store the IFF_* flags of an interface and derive ifAdminStatus,
+ * ifOperStatus and ifConnectorPresent from them
+ *
+ * @param  ifentry : ifentry to update
+ * @param os_flags : IFF_* flags, from SIOCGIFFLAGS or an rtnetlink message
+ */
+void netsnmp_access_interface_os_flags_set( netsnmp_interface_entry* ifentry,
+    u_int os_flags )
+{
+    ifentry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_IF_FLAGS;
+    ifentry->os_flags = os_flags;
+
+    /*
+     * ifOperStatus description:
+     *   If ifAdminStatus is down(2) then ifOperStatus should be down(2).
+     */
+    if ( ifentry->os_flags & IFF_UP ) {
+        ifentry->admin_status = IFADMINSTATUS_UP;
+        if ( ifentry->os_flags & IFF_RUNNING )
+            ifentry->oper_status = IFOPERSTATUS_UP;
+        else
+            ifentry->oper_status = IFOPERSTATUS_DOWN;
+    } else {
+        ifentry->admin_status = IFADMINSTATUS_DOWN;
+        ifentry->oper_status = IFOPERSTATUS_DOWN;
     }
 
-    return rc;
+    /*
+     * ifConnectorPresent description:
+     *   This object has the value 'true(1)' if the interface sublayer has a
+     *   physical connector and the value 'false(2)' otherwise."
+     * So, at very least, false(2) should be returned for loopback devices.
+     */
+    if ( ifentry->os_flags & IFF_LOOPBACK ) {
+        ifentry->connector_present = 0;
+    } else {
+        ifentry->connector_present = 1;
+    }
 }
 
 /**
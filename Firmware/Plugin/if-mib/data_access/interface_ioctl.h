@@ -23,6 +23,13 @@ int
 netsnmp_access_interface_ioctl_flags_get(int fd,
                                          netsnmp_interface_entry *ifentry);
 
+void
+netsnmp_access_interface_os_flags_set(netsnmp_interface_entry *ifentry,
+                                      u_int os_flags);
+
+int
+netsnmp_access_interface_type_from_arphrd(int arphrd);
+
 int
 netsnmp_access_interface_ioctl_flags_set(int fd,
                                          netsnmp_interface_entry *ifentry,
@@ -16,6 +16,8 @@
 #include <linux/sockios.h>
 #include <linux/types.h>
 #include <net/if.h>
+#include <linux/if.h>
+#include <linux/rtnetlink.h>
 #include <sys/ioctl.h>
 
 typedef __u64 u64; /* hack, so we may include kernel's ethtool.h */
@@ -40,6 +42,10 @@ static unsigned short retrans_time_factor = 1;
 static const char* proc_sys_basereachable_time;
 static unsigned short basereachable_time_ms = 0;
 
+static int _load_netlink( Container_Container* container, u_int load_flags );
+static int _load_proc_net_dev( Container_Container* container,
+    u_int load_flags );
+
 void netsnmp_arch_interface_init( void )
 {
     /*
@@ -128,6 +134,10 @@ _arch_interface_flags_v4_get( netsnmp_interface_entry* entry )
 /**
  * @internal
  */
+static void
+_store_stats( netsnmp_interface_entry* entry,
+    const struct rtnl_link_stats64* s );
+
 static int
 _parse_stats( netsnmp_interface_entry* entry, char* stats, int expected )
 {
@@ -138,6 +148,7 @@ _parse_stats( netsnmp_interface_entry* entry, char* stats, int expected )
      *  [               OUT                               ]
      *   byte pkts errs drop fifo colls carrier compressed
      */
+    struct rtnl_link_stats64 s;
     uintmax_t rec_pkt, rec_oct, rec_err, rec_drop, rec_mcast;
     uintmax_t snd_pkt, snd_oct, snd_err, snd_drop, coll;
     const char* scan_line_2_2 = "%" SCNuMAX " %" SCNuMAX " %" SCNuMAX " %" SCNuMAX
@@ -205,34 +216,60 @@ _parse_stats( netsnmp_interface_entry* entry, char* stats, int expected )
             expected, scan_count );
         return scan_count;
     }
+
+    memset( &s, 0, sizeof( s ) );
+    s.rx_bytes = rec_oct;
+    s.rx_packets = rec_pkt;
+    s.rx_errors = rec_err;
+    s.rx_dropped = rec_drop;
+    s.multicast = rec_mcast;
+    s.tx_bytes = snd_oct;
+    s.tx_packets = snd_pkt;
+    s.tx_errors = snd_err;
+    s.tx_dropped = snd_drop;
+    s.collisions = coll;
+    _store_stats( entry, &s );
+
+    return 0;
+}
+
+/**
+ * @internal
+ * store the kernel counters in the entry
+ */
+static void
+_store_stats( netsnmp_interface_entry* entry, const struct rtnl_link_stats64* s )
+{
+    uint64_t snd_pkt = s->tx_packets;
+
     entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_ACTIVE;
 
     /*
      * linux previous to 1.3.~13 may miss transmitted loopback pkts: 
      */
-    if ( !strcmp( entry->name, "lo" ) && rec_pkt > 0 && !snd_pkt )
-        snd_pkt = rec_pkt;
+    if ( !strcmp( entry->name, "lo" ) && s->rx_packets > 0 && !snd_pkt )
+        snd_pkt = s->rx_packets;
 
     /*
      * subtract out multicast packets from rec_pkt before
      * we store it as unicast counter.
      */
     entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_CALCULATE_UCAST;
-    entry->stats.ibytes.low = rec_oct & 0xffffffff;
-    entry->stats.iall.low = rec_pkt & 0xffffffff;
-    entry->stats.imcast.low = rec_mcast & 0xffffffff;
-    entry->stats.obytes.low = snd_oct & 0xffffffff;
+    entry->stats.ibytes.low = s->rx_bytes & 0xffffffff;
+    entry->stats.iall.low = s->rx_packets & 0xffffffff;
+    entry->stats.imcast.low = s->multicast & 0xffffffff;
+    entry->stats.obytes.low = s->tx_bytes & 0xffffffff;
     entry->stats.oucast.low = snd_pkt & 0xffffffff;
-    entry->stats.ibytes.high = rec_oct >> 32;
-    entry->stats.iall.high = rec_pkt >> 32;
-    entry->stats.imcast.high = rec_mcast >> 32;
-    entry->stats.obytes.high = snd_oct >> 32;
+    entry->stats.ibytes.high = s->rx_bytes >> 32;
+    entry->stats.iall.high = s->rx_packets >> 32;
+    entry->stats.imcast.high = s->multicast >> 32;
+    entry->stats.obytes.high = s->tx_bytes >> 32;
     entry->stats.oucast.high = snd_pkt >> 32;
-    entry->stats.ierrors = rec_err;
-    entry->stats.idiscards = rec_drop;
-    entry->stats.oerrors = snd_err;
-    entry->stats.odiscards = snd_drop;
-    entry->stats.collisions = coll;
+    entry->stats.ierrors = s->rx_errors;
+    entry->stats.idiscards = s->rx_dropped;
+    entry->stats.oerrors = s->tx_errors;
+    entry->stats.odiscards = s->tx_dropped;
+    entry->stats.collisions = s->collisions;
 
     /*
      * calculated stats.
@@ -241,8 +278,86 @@ _parse_stats( netsnmp_interface_entry* entry, char* stats, int expected )
      */
     entry->stats.inucast = entry->stats.imcast.low + entry->stats.ibcast.low;
     entry->stats.onucast = entry->stats.omcast.low + entry->stats.obcast.low;
+}
 
-    return 0;
+/**
+ * @internal
+ * interface identifier is specified based on physaddr and type
+ */
+static void
+_arch_interface_v6_ifid_set( netsnmp_interface_entry* entry )
+{
+    switch ( entry->type ) {
+    case IANAIFTYPE_ETHERNETCSMACD:
+    case IANAIFTYPE_ETHERNET3MBIT:
+    case IANAIFTYPE_FASTETHER:
+    case IANAIFTYPE_FASTETHERFX:
+    case IANAIFTYPE_GIGABITETHERNET:
+    case IANAIFTYPE_FDDI:
+    case IANAIFTYPE_ISO88025TOKENRING:
+        if ( NULL != entry->paddr && ETH_ALEN != entry->paddr_len )
+            break;
+
+        entry->v6_if_id_len = entry->paddr_len + 2;
+        memcpy( entry->v6_if_id, entry->paddr, 3 );
+        memcpy( entry->v6_if_id + 5, entry->paddr + 3, 3 );
+        entry->v6_if_id[ 0 ] ^= 2;
+        entry->v6_if_id[ 3 ] = 0xFF;
+        entry->v6_if_id[ 4 ] = 0xFE;
+
+        entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_V6_IFID;
+        break;
+
+    case IANAIFTYPE_SOFTWARELOOPBACK:
+        entry->v6_if_id_len = 0;
+        entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_V6_IFID;
+        break;
+    }
+}
+
+/**
+ * @internal
+ * ethernet speed, via ETHTOOL_GSET or MII
+ */
+static void
+_arch_interface_speed_get( int fd, netsnmp_interface_entry* entry )
+{
+    unsigned long long speed;
+    unsigned long long defaultspeed = NOMINAL_LINK_SPEED;
+    if ( !( entry->os_flags & IFF_RUNNING ) ) {
+        /*
+         * use speed 0 if the if speed cannot be determined *and* the
+         * interface is down
+         */
+        defaultspeed = 0;
+    }
+    speed = netsnmp_linux_interface_get_if_speed( fd,
+        entry->name, defaultspeed );
+    if ( speed > 0xffffffffL ) {
+        entry->speed = 0xffffffff;
+    } else
+        entry->speed = speed;
+    entry->speed_high = speed / 1000000LL;
+}
+
+/*
+ * read the values the netlink loader deferred
+ */
+void netsnmp_arch_interface_extras_get( netsnmp_interface_entry* entry,
+    u_int which )
+{
+    int fd;
+
+    if ( which & NETSNMP_INTERFACE_FLAGS_LAZY_SPEED ) {
+        fd = socket( AF_INET, SOCK_DGRAM, 0 );
+        if ( fd < 0 ) {
+            Logger_log( LOGGER_PRIORITY_ERR, "could not create socket\n" );
+        } else {
+            _arch_interface_speed_get( fd, entry );
+            close( fd );
+        }
+        entry->ns_flags &= ~NETSNMP_INTERFACE_FLAGS_LAZY_SPEED;
+    }
 }
 
 /*
@@ -255,11 +370,7 @@ _parse_stats( netsnmp_interface_entry* entry, char* stats, int expected )
 int netsnmp_arch_interface_container_load( Container_Container* container,
     u_int load_flags )
 {
-    FILE* devin;
-    char line[ 256 ];
-    netsnmp_interface_entry* entry = NULL;
-    static char scan_expected = 0;
-    int fd;
+    int rc;
 
     DEBUG_MSGTL( ( "access:interface:container:arch", "load (flags %x)\n",
         load_flags ) );
@@ -269,6 +380,32 @@ int netsnmp_arch_interface_container_load( Container_Container* container,
         return -1;
     }
 
+    /*
+     * one RTM_GETLINK dump has everything but the ethtool speed; fall
+     * back to /proc/net/dev and ioctls if rtnetlink is not usable.
+     */
+    rc = _load_netlink( container, load_flags );
+    if ( rc <= 0 )
+        return rc;
+
+    DEBUG_MSGTL( ( "access:interface:container:arch",
+        "rtnetlink unavailable, using /proc/net/dev\n" ) );
+    return _load_proc_net_dev( container, load_flags );
+}
+
+/**
+ * @internal
+ * load from /proc/net/dev, with ioctls for the rest
+ */
+static int
+_load_proc_net_dev( Container_Container* container, u_int load_flags )
+{
+    FILE* devin;
+    char line[ 256 ];
+    netsnmp_interface_entry* entry = NULL;
+    static char scan_expected = 0;
+    int fd;
+
     if ( !( devin = fopen( "/proc/net/dev", "r" ) ) ) {
         DEBUG_MSGTL( ( "access:interface",
             "Failed to load Interface Table (linux1)\n" ) );
@@ -370,9 +507,7 @@ int netsnmp_arch_interface_container_load( Container_Container* container,
 
         entry = netsnmp_access_interface_entry_create( ifstart, 0 );
         if ( NULL == entry ) {
-
-            netsnmp_access_interface_container_free( container,
-                NETSNMP_ACCESS_INTERFACE_FREE_NOFLAGS );
+            /* the caller frees the container */
             fclose( devin );
             close( fd );
             return -3;
@@ -426,54 +561,11 @@ int netsnmp_arch_interface_container_load( Container_Container* container,
                 entry->type = IANAIFTYPE_OTHER;
         }
 
-        /*
-         * interface identifier is specified based on physaddr and type
-         */
-        switch ( entry->type ) {
-        case IANAIFTYPE_ETHERNETCSMACD:
-        case IANAIFTYPE_ETHERNET3MBIT:
-        case IANAIFTYPE_FASTETHER:
-        case IANAIFTYPE_FASTETHERFX:
-        case IANAIFTYPE_GIGABITETHERNET:
-        case IANAIFTYPE_FDDI:
-        case IANAIFTYPE_ISO88025TOKENRING:
-            if ( NULL != entry->paddr && ETH_ALEN != entry->paddr_len )
-                break;
-
-            entry->v6_if_id_len = entry->paddr_len + 2;
-            memcpy( entry->v6_if_id, entry->paddr, 3 );
-            memcpy( entry->v6_if_id + 5, entry->paddr + 3, 3 );
-            entry->v6_if_id[ 0 ] ^= 2;
-            entry->v6_if_id[ 3 ] = 0xFF;
-            entry->v6_if_id[ 4 ] = 0xFE;
+        _arch_interface_v6_ifid_set( entry );
 
-            entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_V6_IFID;
-            break;
-
-        case IANAIFTYPE_SOFTWARELOOPBACK:
-            entry->v6_if_id_len = 0;
-            entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_V6_IFID;
-            break;
-        }
-
-        if ( IANAIFTYPE_ETHERNETCSMACD == entry->type ) {
-            unsigned long long speed;
-            unsigned long long defaultspeed = NOMINAL_LINK_SPEED;
-            if ( !( entry->os_flags & IFF_RUNNING ) ) {
-                /*
-                 * use speed 0 if the if speed cannot be determined *and* the
-                 * interface is down
-                 */
-                defaultspeed = 0;
-            }
-            speed = netsnmp_linux_interface_get_if_speed( fd,
-                entry->name, defaultspeed );
-            if ( speed > 0xffffffffL ) {
-                entry->speed = 0xffffffff;
-            } else
-                entry->speed = speed;
-            entry->speed_high = speed / 1000000LL;
-        } else
+        if ( IANAIFTYPE_ETHERNETCSMACD == entry->type )
+            _arch_interface_speed_get( fd, entry );
+        else
             netsnmp_access_interface_entry_guess_speed( entry );
 
         netsnmp_access_interface_ioctl_flags_get( fd, entry );
@@ -526,6 +618,370 @@ int netsnmp_arch_interface_container_load( Container_Container* container,
     return 0;
 }
 
+/**---------------------------------------------------------------------*/
+/*
+ * rtnetlink loader
+ */
+#define RTNL_BUF_SIZE 65536
+
+typedef struct rtnl_load_ctx_s {
+    Container_Container* container;
+    u_int load_flags;
+    /** sorted ifindexes of interfaces with an ipv4 address */
+    int* v4_index;
+    size_t v4_count;
+    size_t v4_size;
+} rtnl_load_ctx;
+
+typedef int( rtnl_msg_f )( struct nlmsghdr* h, rtnl_load_ctx* ctx );
+
+/**
+ * @internal
+ * send a dump request and feed every reply to msg_cb
+ *
+ * @retval  0 success
+ * @retval  1 the request was refused (nothing was delivered)
+ * @retval <0 error, or the value returned by msg_cb
+ */
+static int
+_rtnl_dump( int fd, int type, rtnl_msg_f* msg_cb, rtnl_load_ctx* ctx )
+{
+    static char buf[ RTNL_BUF_SIZE ];
+    struct {
+        struct nlmsghdr n;
+        union {
+            struct ifinfomsg i;
+            struct ifaddrmsg a;
+        } u;
+    } req;
+    struct nlmsghdr* h;
+    int len, rc = 0, msgs = 0;
+
+    memset( &req, 0, sizeof( req ) );
+    req.n.nlmsg_type = type;
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.n.nlmsg_seq = type;
+    if ( RTM_GETLINK == type ) {
+        req.n.nlmsg_len = NLMSG_LENGTH( sizeof( struct ifinfomsg ) );
+        req.u.i.ifi_family = AF_UNSPEC;
+    } else {
+        req.n.nlmsg_len = NLMSG_LENGTH( sizeof( struct ifaddrmsg ) );
+        req.u.a.ifa_family = AF_INET;
+    }
+
+    if ( send( fd, &req, req.n.nlmsg_len, 0 ) < 0 ) {
+        DEBUG_MSGTL( ( "access:interface:netlink", "send failed (%d)\n",
+            errno ) );
+        return 1;
+    }
+
+    for ( ;; ) {
+        len = recv( fd, buf, sizeof( buf ), 0 );
+        if ( len < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            Logger_log( LOGGER_PRIORITY_ERR, "interface: netlink recv failed: %s\n",
+                strerror( errno ) );
+            return -2;
+        }
+        if ( 0 == len )
+            return rc;
+
+        for ( h = ( struct nlmsghdr* )buf; NLMSG_OK( h, len );
+              h = NLMSG_NEXT( h, len ) ) {
+            if ( NLMSG_DONE == h->nlmsg_type )
+                return rc;
+            if ( NLMSG_ERROR == h->nlmsg_type ) {
+                DEBUG_MSGTL( ( "access:interface:netlink",
+                    "dump %d refused\n", type ) );
+                return ( 0 == msgs ) ? 1 : -2;
+            }
+            ++msgs;
+            rc = msg_cb( h, ctx );
+            if ( rc < 0 )
+                return rc;
+        }
+    }
+}
+
+/**
+ * @internal
+ * remember which interfaces have an ipv4 address
+ */
+static int
+_rtnl_addr( struct nlmsghdr* h, rtnl_load_ctx* ctx )
+{
+    struct ifaddrmsg* ifa = ( struct ifaddrmsg* )NLMSG_DATA( h );
+    int* tmp;
+
+    if ( RTM_NEWADDR != h->nlmsg_type || AF_INET != ifa->ifa_family )
+        return 0;
+
+    /** addresses come grouped by interface */
+    if ( ctx->v4_count && ctx->v4_index[ ctx->v4_count - 1 ] == ( int )ifa->ifa_index )
+        return 0;
+
+    if ( ctx->v4_count == ctx->v4_size ) {
+        ctx->v4_size = ctx->v4_size ? ctx->v4_size * 2 : 64;
+        tmp = ( int* )realloc( ctx->v4_index, ctx->v4_size * sizeof( int ) );
+        if ( NULL == tmp )
+            return -3;
+        ctx->v4_index = tmp;
+    }
+    ctx->v4_index[ ctx->v4_count++ ] = ifa->ifa_index;
+    return 0;
+}
+
+static int
+_rtnl_index_compare( const void* lhs, const void* rhs )
+{
+    int l = *( const int* )lhs, r = *( const int* )rhs;
+    return ( l > r ) - ( l < r );
+}
+
+/**
+ * @internal
+ * build an entry from one RTM_NEWLINK message. flags holds the
+ * NETSNMP_INTERFACE_FLAGS_HAS_IPV4/IPV6 flags of the interface.
+ *
+ * @retval  0 success (*entry is NULL if the interface is not wanted)
+ * @retval <0 error
+ */
+static int
+_rtnl_link_entry( const struct nlmsghdr* h, u_int flags, u_int load_flags,
+    netsnmp_interface_entry** entry_ptr )
+{
+    struct ifinfomsg* ifi = ( struct ifinfomsg* )NLMSG_DATA( h );
+    struct rtattr *tb[ IFLA_MAX + 1 ], *rta;
+    netsnmp_interface_entry* entry;
+    const char* name;
+    int len;
+
+    *entry_ptr = NULL;
+    if ( RTM_NEWLINK != h->nlmsg_type
+        || h->nlmsg_len < NLMSG_LENGTH( sizeof( *ifi ) ) )
+        return 0;
+
+    memset( tb, 0, sizeof( tb ) );
+    len = IFLA_PAYLOAD( h );
+    for ( rta = IFLA_RTA( ifi ); RTA_OK( rta, len ); rta = RTA_NEXT( rta, len ) )
+        if ( rta->rta_type <= IFLA_MAX )
+            tb[ rta->rta_type ] = rta;
+
+    if ( NULL == tb[ IFLA_IFNAME ] )
+        return 0;
+    name = ( const char* )RTA_DATA( tb[ IFLA_IFNAME ] );
+
+    DEBUG_MSGTL( ( "9:access:ifcontainer", "processing '%s'\n", name ) );
+
+    /*
+     * do we only want one address type?
+     */
+    if ( ( ( load_flags & NETSNMP_ACCESS_INTERFACE_LOAD_IP4_ONLY ) && ( ( flags & NETSNMP_INTERFACE_FLAGS_HAS_IPV4 ) == 0 ) ) || ( ( load_flags & NETSNMP_ACCESS_INTERFACE_LOAD_IP6_ONLY ) && ( ( flags & NETSNMP_INTERFACE_FLAGS_HAS_IPV6 ) == 0 ) ) ) {
+        DEBUG_MSGTL( ( "9:access:ifcontainer",
+            "interface '%s' excluded by ip version\n", name ) );
+        return 0;
+    }
+
+    entry = netsnmp_access_interface_entry_create( name, ifi->ifi_index );
+    if ( NULL == entry )
+        return -3;
+    entry->ns_flags = flags;
+
+    /*
+     * same 6 byte physaddr the SIOCGIFHWADDR loader reports
+     */
+    entry->paddr = ( char* )calloc( 1, IFHWADDRLEN );
+    if ( NULL == entry->paddr ) {
+        netsnmp_access_interface_entry_free( entry );
+        return -3;
+    }
+    entry->paddr_len = IFHWADDRLEN;
+    if ( tb[ IFLA_ADDRESS ] ) {
+        len = RTA_PAYLOAD( tb[ IFLA_ADDRESS ] );
+        memcpy( entry->paddr, RTA_DATA( tb[ IFLA_ADDRESS ] ),
+            len < IFHWADDRLEN ? len : IFHWADDRLEN );
+    }
+    entry->type = netsnmp_access_interface_type_from_arphrd( ifi->ifi_type );
+
+    _arch_interface_v6_ifid_set( entry );
+
+    netsnmp_access_interface_os_flags_set( entry, ifi->ifi_flags );
+    if ( tb[ IFLA_OPERSTATE ] && IFADMINSTATUS_UP == entry->admin_status ) {
+        switch ( *( u_char* )RTA_DATA( tb[ IFLA_OPERSTATE ] ) ) {
+        case IF_OPER_NOTPRESENT:
+            entry->oper_status = IFOPERSTATUS_NOTPRESENT;
+            break;
+        case IF_OPER_LOWERLAYERDOWN:
+            entry->oper_status = IFOPERSTATUS_LOWERLAYERDOWN;
+            break;
+        case IF_OPER_TESTING:
+            entry->oper_status = IFOPERSTATUS_TESTING;
+            break;
+        case IF_OPER_DORMANT:
+            entry->oper_status = IFOPERSTATUS_DORMANT;
+            break;
+        default: /* up, down, unknown: IFF_RUNNING already says it */
+            break;
+        }
+    }
+
+    /*
+     * the ethtool speed is one more ioctl per interface; leave it until
+     * ifSpeed/ifHighSpeed is asked for.
+     */
+    if ( IANAIFTYPE_ETHERNETCSMACD == entry->type )
+        entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_LAZY_SPEED;
+    else
+        netsnmp_access_interface_entry_guess_speed( entry );
+
+    if ( tb[ IFLA_MTU ] )
+        entry->mtu = *( u_int* )RTA_DATA( tb[ IFLA_MTU ] );
+
+    if ( entry->os_flags & IFF_PROMISC ) {
+        entry->promiscuous = 1; /* boolean */
+    }
+
+    /*
+     * hardcoded max packet size
+     * (see ip_frag_reasm: if(len > 65535) goto out_oversize;)
+     */
+    entry->reasm_max_v4 = entry->reasm_max_v6 = 65535;
+    entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_V4_REASMMAX | NETSNMP_INTERFACE_FLAGS_HAS_V6_REASMMAX;
+
+    netsnmp_access_interface_entry_overrides( entry );
+
+    if ( !( load_flags & NETSNMP_ACCESS_INTERFACE_LOAD_NO_STATS ) ) {
+        struct rtnl_link_stats64 s;
+        int have_stats = 1;
+
+        /*
+         * an older kernel sends a shorter attribute: don't read past it
+         */
+        if ( tb[ IFLA_STATS64 ] && RTA_PAYLOAD( tb[ IFLA_STATS64 ] ) >= sizeof( s ) ) {
+            memcpy( &s, RTA_DATA( tb[ IFLA_STATS64 ] ), sizeof( s ) );
+        } else if ( tb[ IFLA_STATS ]
+            && RTA_PAYLOAD( tb[ IFLA_STATS ] ) >= sizeof( struct rtnl_link_stats ) ) {
+            struct rtnl_link_stats* s32 = ( struct rtnl_link_stats* )RTA_DATA( tb[ IFLA_STATS ] );
+            memset( &s, 0, sizeof( s ) );
+            s.rx_packets = s32->rx_packets;
+            s.tx_packets = s32->tx_packets;
+            s.rx_bytes = s32->rx_bytes;
+            s.tx_bytes = s32->tx_bytes;
+            s.rx_errors = s32->rx_errors;
+            s.tx_errors = s32->tx_errors;
+            s.rx_dropped = s32->rx_dropped;
+            s.tx_dropped = s32->tx_dropped;
+            s.multicast = s32->multicast;
+            s.collisions = s32->collisions;
+        } else
+            have_stats = 0;
+        if ( have_stats ) {
+            entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_BYTES
+                | NETSNMP_INTERFACE_FLAGS_HAS_DROPS
+                | NETSNMP_INTERFACE_FLAGS_HAS_MCAST_PKTS
+                | NETSNMP_INTERFACE_FLAGS_HAS_HIGH_SPEED
+                | NETSNMP_INTERFACE_FLAGS_HAS_HIGH_BYTES
+                | NETSNMP_INTERFACE_FLAGS_HAS_HIGH_PACKETS;
+            _store_stats( entry, &s );
+        }
+    }
+
+    /*
+     * nothing reports the /proc/sys retransmit time, so it isn't read
+     * (NETSNMP_INTERFACE_FLAGS_HAS_V4_RETRANSMIT stays clear)
+     */
+
+    *entry_ptr = entry;
+    return 0;
+}
+
+/**
+ * @internal
+ * add the interface of one RTM_NEWLINK dump reply
+ */
+static int
+_rtnl_link( struct nlmsghdr* h, rtnl_load_ctx* ctx )
+{
+    struct ifinfomsg* ifi = ( struct ifinfomsg* )NLMSG_DATA( h );
+    netsnmp_interface_entry* entry;
+    u_int flags = 0;
+    int rc;
+
+    if ( ctx->v4_count && bsearch( &ifi->ifi_index, ctx->v4_index,
+                              ctx->v4_count, sizeof( int ), _rtnl_index_compare ) )
+        flags |= NETSNMP_INTERFACE_FLAGS_HAS_IPV4;
+
+    rc = _rtnl_link_entry( h, flags, ctx->load_flags, &entry );
+    if ( NULL != entry )
+        CONTAINER_INSERT( ctx->container, entry );
+
+    return rc;
+}
+
+/**
+ * build the entry of the interface an RTM_NEWLINK notification is about.
+ * a notification does not say whether the interface has an ipv4
+ * address: flags carries what the caller knows about it.
+ *
+ * @retval  0 success (*entry is NULL if the message is not about a link)
+ * @retval <0 error
+ */
+int netsnmp_access_interface_entry_from_rtnl( const struct nlmsghdr* msg,
+    u_int flags, netsnmp_interface_entry** entry )
+{
+    if ( NULL == msg || NULL == entry )
+        return -1;
+
+    return _rtnl_link_entry( msg, flags & NETSNMP_INTERFACE_FLAGS_HAS_IPV4,
+        NETSNMP_ACCESS_INTERFACE_LOAD_NOFLAGS, entry );
+}
+
+/**
+ * @internal
+ * load all interfaces from one RTM_GETADDR and one RTM_GETLINK dump
+ *
+ * @retval  0 success
+ * @retval  1 rtnetlink not usable, nothing loaded
+ * @retval <0 error
+ */
+static int
+_load_netlink( Container_Container* container, u_int load_flags )
+{
+    rtnl_load_ctx ctx;
+    struct sockaddr_nl sa;
+    int fd, rc;
+
+    fd = socket( AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE );
+    if ( fd < 0 ) {
+        DEBUG_MSGTL( ( "access:interface:netlink", "socket failed (%d)\n",
+            errno ) );
+        return 1;
+    }
+    memset( &sa, 0, sizeof( sa ) );
+    sa.nl_family = AF_NETLINK;
+    if ( bind( fd, ( struct sockaddr* )&sa, sizeof( sa ) ) < 0 ) {
+        close( fd );
+        return 1;
+    }
+
+    memset( &ctx, 0, sizeof( ctx ) );
+    ctx.container = container;
+    ctx.load_flags = load_flags;
+
+    rc = _rtnl_dump( fd, RTM_GETADDR, _rtnl_addr, &ctx );
+    if ( 0 == rc ) {
+        qsort( ctx.v4_index, ctx.v4_count, sizeof( int ), _rtnl_index_compare );
+        rc = _rtnl_dump( fd, RTM_GETLINK, _rtnl_link, &ctx );
+    }
+
+    close( fd );
+    free( ctx.v4_index );
+
+    /* on error, the caller frees the container */
+    return rc;
+}
+
 int netsnmp_arch_set_admin_status( netsnmp_interface_entry* entry,
     int ifAdminStatus_val )
 {
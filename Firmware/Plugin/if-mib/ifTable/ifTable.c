@@ -596,6 +596,8 @@ int ifSpeed_get( ifTable_rowreq_ctx* rowreq_ctx, u_long* ifSpeed_val_ptr )
      * TODO:231:o: |-> Extract the current value of the ifSpeed data.
      * copy (* ifSpeed_val_ptr ) from rowreq_ctx->data
      */
+    netsnmp_access_interface_entry_extras_get( rowreq_ctx->data.ifentry,
+        NETSNMP_INTERFACE_FLAGS_LAZY_SPEED );
     ( *ifSpeed_val_ptr ) = rowreq_ctx->data.ifSpeed;
 
     return MFD_SUCCESS;
@@ -18,6 +18,7 @@
 #include "CacheHandler.h"
 #include "System/Util/Trace.h"
 #include "System/Util/Logger.h"
+#include "utilities/rtnl_events.h"
 #include "Trap.h"
 #include "ifTable_defs.h"
 #include "ifTable_interface.h"
@@ -46,6 +47,13 @@ static int replace_old = 0;
 static void
 _delete_missing_interface( ifTable_rowreq_ctx* rowreq_ctx,
     Container_Container* container );
+static void
+_check_interface_entry_for_updates( ifTable_rowreq_ctx* rowreq_ctx,
+    cd_container* cdc );
+static void
+_add_new_interface( netsnmp_interface_entry* ifentry,
+    Container_Container* container );
+static netsnmp_rtnl_event_f _link_event;
 
 /** @ingroup interface 
  * @defgroup data_access data_access: Routines to access data
@@ -194,8 +202,84 @@ void ifTable_container_init( Container_Container** container_ptr_ptr,
      */
     cache->flags |= ( CacheOperation_DONT_AUTO_RELEASE | CacheOperation_DONT_FREE_EXPIRED
         | CacheOperation_DONT_FREE_BEFORE_LOAD | CacheOperation_PRELOAD | CacheOperation_AUTO_RELOAD | CacheOperation_DONT_INVALIDATE_ON_SET );
+
+    /*
+     * the counters still need the timer, but interfaces coming, going
+     * or changing state are picked up as soon as the kernel announces it.
+     */
+    netsnmp_rtnl_events_register( RTMGRP_LINK, _link_event, cache );
 } /* ifTable_container_init */
 
+/**
+ * @internal
+ * an interface was added, changed or removed: update its row the way a
+ * reload would, without reloading every other interface. only lost
+ * notifications (msg is NULL) cost a full reload.
+ */
+static void
+_link_event( const struct nlmsghdr* msg, void* context )
+{
+    Cache* cache = ( Cache* )context;
+    Container_Container* container = ( Container_Container* )cache->magic;
+    netsnmp_interface_entry* ifentry = NULL;
+    ifTable_rowreq_ctx* rowreq_ctx;
+    ifTable_mib_index mib_idx;
+    cd_container cdc;
+    u_int flags = 0;
+
+    if ( !cache->valid || NULL == container )
+        return;
+
+    if ( NULL == msg ) {
+        CacheHandler_invalidate( cache );
+        return;
+    }
+    if ( ( RTM_NEWLINK != msg->nlmsg_type && RTM_DELLINK != msg->nlmsg_type )
+        || msg->nlmsg_len < NLMSG_LENGTH( sizeof( struct ifinfomsg ) ) )
+        return;
+
+    mib_idx.ifIndex = ( ( struct ifinfomsg* )NLMSG_DATA( msg ) )->ifi_index;
+    rowreq_ctx = ifTable_row_find_by_mib_index( &mib_idx );
+    if ( NULL != rowreq_ctx )
+        flags = rowreq_ctx->data.ifentry->ns_flags;
+
+    cdc.current = netsnmp_access_interface_container_init(
+        NETSNMP_ACCESS_INTERFACE_INIT_NOFLAGS );
+    if ( NULL == cdc.current
+        || ( RTM_NEWLINK == msg->nlmsg_type
+               && netsnmp_access_interface_entry_from_rtnl( msg, flags, &ifentry )
+                   < 0 ) ) {
+        if ( NULL != cdc.current )
+            netsnmp_access_interface_container_free( cdc.current,
+                NETSNMP_ACCESS_INTERFACE_FREE_NOFLAGS );
+        CacheHandler_invalidate( cache );
+        return;
+    }
+    if ( NULL != ifentry )
+        CONTAINER_INSERT( cdc.current, ifentry );
+    cdc.deleted = NULL;
+
+    DEBUG_MSGTL( ( "ifTable:access", "link event for %ld\n",
+        ( long )mib_idx.ifIndex ) );
+
+    /*
+     * the same steps as ifTable_container_load(), for one interface
+     */
+    if ( NULL != rowreq_ctx )
+        _check_interface_entry_for_updates( rowreq_ctx, &cdc );
+    if ( NULL != cdc.deleted ) {
+        CONTAINER_FOR_EACH( cdc.deleted,
+            ( Container_FuncObjFunc* )_delete_missing_interface,
+            container );
+        CONTAINER_FREE( cdc.deleted );
+    }
+    CONTAINER_FOR_EACH( cdc.current,
+        ( Container_FuncObjFunc* )_add_new_interface,
+        container );
+    netsnmp_access_interface_container_free( cdc.current,
+        NETSNMP_ACCESS_INTERFACE_FREE_DONT_CLEAR );
+}
+
 void send_linkUpDownNotifications( oid* notification_oid, size_t notification_oid_len, int if_index, int if_admin_status, int if_oper_status )
 {
     /*
@@ -208,6 +208,11 @@ void _ifTable_initialize_interface( ifTable_registration* reg_ptr, u_long flags
     Table_helperAddIndexes( tbl_info, asnINTEGER,
         /** index: ifIndex */
         0 );
+    /*
+     * ifIndex is a plain integer and nothing below uses the index
+     * varbinds, so let the table helper skip building them.
+     */
+    Table_setTypedIndexes( tbl_info );
 
     /*
      * Define the minimum and maximum accessible columns.  This
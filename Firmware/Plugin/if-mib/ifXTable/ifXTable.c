@@ -1202,6 +1202,8 @@ int ifHighSpeed_get( ifXTable_rowreq_ctx* rowreq_ctx,
      * TODO:231:o: |-> Extract the current value of the ifHighSpeed data.
      * copy (* ifHighSpeed_val_ptr ) from rowreq_ctx->data
      */
+    netsnmp_access_interface_entry_extras_get( rowreq_ctx->data.ifentry,
+        NETSNMP_INTERFACE_FLAGS_LAZY_SPEED );
     if ( 0 == rowreq_ctx->data.ifHighSpeed )
         ( *ifHighSpeed_val_ptr ) = rowreq_ctx->data.ifSpeed / 1000000;
     else
@@ -175,6 +175,11 @@ void _ifXTable_initialize_interface( ifXTable_registration* reg_ptr,
     Table_helperAddIndexes( tbl_info, asnINTEGER,
         /** index: ifIndex */
         0 );
+    /*
+     * ifIndex is a plain integer and nothing below uses the index
+     * varbinds, so let the table helper skip building them.
+     */
+    Table_setTypedIndexes( tbl_info );
 
     /*
      * Define the minimum and maximum accessible columns.  This
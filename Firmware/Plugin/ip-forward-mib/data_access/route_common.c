@@ -5,17 +5,25 @@
  */
 
 #include "siglog/data_access/route.h"
+#include "Api.h"
+#include "System/Containers/ContainerNull.h"
+#include "System/Util/Alarm.h"
 #include "System/Util/Assert.h"
 #include "Client.h"
 #include "System/Util/Trace.h"
 #include "System/Util/Logger.h"
 #include "Priot.h"
+#include "ip-forward-mib/inetCidrRouteTable/inetCidrRouteTable_constants.h"
+#include <arpa/inet.h>
 
 /**---------------------------------------------------------------------*/
 /*
  * local static prototypes
  */
 static void _access_route_entry_release( netsnmp_route_entry* entry, void* unused );
+static int _access_route_compact_cmp( const netsnmp_route_table* table,
+    const netsnmp_route_compact* l, const netsnmp_route_compact* r );
+static int _access_route_compact_compare( const void* lhs, const void* rhs );
 
 /**---------------------------------------------------------------------*/
 /*
@@ -26,6 +34,8 @@ static void _access_route_entry_release( netsnmp_route_entry* entry, void* unuse
  */
 extern int netsnmp_access_route_container_arch_load( Container_Container* container,
     u_int load_flags );
+extern int netsnmp_access_route_table_arch_load( netsnmp_route_table* table,
+    u_int load_flags );
 extern int
 netsnmp_arch_route_create( netsnmp_route_entry* entry );
 extern int
@@ -88,6 +98,315 @@ void netsnmp_access_route_container_free( Container_Container* container, u_int
         CONTAINER_FREE( container );
 }
 
+/**---------------------------------------------------------------------*/
+/*
+ * compact route table functions
+ */
+
+/** nexthops used while sorting, see _access_route_compact_compare */
+static const netsnmp_route_table* _access_route_sort_table = NULL;
+
+/**
+ * load the routing table into table, replacing its contents
+ *
+ * @retval  0 success
+ * @retval <0 error, table is empty
+ */
+int netsnmp_access_route_table_load( netsnmp_route_table* table, u_int load_flags )
+{
+    int rc;
+
+    DEBUG_MSGTL( ( "access:route:table", "load\n" ) );
+
+    if ( NULL == table )
+        return -1;
+
+    table->count = 0;
+    table->nexthop_count = 0;
+    if ( NULL != table->nexthop_hash )
+        memset( table->nexthop_hash, 0,
+            table->nexthop_hash_size * sizeof( uint32_t ) );
+
+    rc = netsnmp_access_route_table_arch_load( table, load_flags );
+    if ( 0 != rc ) {
+        table->count = 0;
+        table->nexthop_count = 0;
+        return rc;
+    }
+
+    netsnmp_access_route_table_sort( table );
+
+    DEBUG_MSGTL( ( "access:route:table", "%" NETSNMP_PRIz "u routes, %" NETSNMP_PRIz "u next hops\n",
+        table->count, table->nexthop_count ) );
+
+    return 0;
+}
+
+void netsnmp_access_route_table_free( netsnmp_route_table* table )
+{
+    if ( NULL == table )
+        return;
+
+    MEMORY_FREE( table->routes );
+    MEMORY_FREE( table->nexthops );
+    MEMORY_FREE( table->nexthop_hash );
+    memset( table, 0, sizeof( *table ) );
+}
+
+static size_t
+_access_route_nexthop_slot( const netsnmp_route_table* table, uint32_t addr,
+    oid if_index )
+{
+    size_t slot;
+
+    slot = ( ( addr * 2654435761U ) ^ ( uint32_t )if_index )
+        & ( table->nexthop_hash_size - 1 );
+    while ( 0 != table->nexthop_hash[ slot ] ) {
+        const netsnmp_route_nexthop* nh = &table->nexthops[ table->nexthop_hash[ slot ] - 1 ];
+        if ( nh->addr == addr && nh->if_index == if_index )
+            break;
+        slot = ( slot + 1 ) & ( table->nexthop_hash_size - 1 );
+    }
+    return slot;
+}
+
+/** double the nexthop hash, keeping it at most half full */
+static int
+_access_route_nexthop_rehash( netsnmp_route_table* table )
+{
+    size_t i, size = table->nexthop_hash_size ? table->nexthop_hash_size * 2 : 64;
+    const netsnmp_route_nexthop* nh;
+    uint32_t* hash;
+
+    hash = ( uint32_t* )calloc( size, sizeof( uint32_t ) );
+    if ( NULL == hash )
+        return -1;
+
+    free( table->nexthop_hash );
+    table->nexthop_hash = hash;
+    table->nexthop_hash_size = size;
+    for ( i = 0; i < table->nexthop_count; ++i ) {
+        nh = &table->nexthops[ i ];
+        hash[ _access_route_nexthop_slot( table, nh->addr, nh->if_index ) ] = i + 1;
+    }
+    return 0;
+}
+
+/** index of the ( addr, if_index ) next hop, added if new. -1 on error. */
+static long
+_access_route_nexthop_intern( netsnmp_route_table* table, uint32_t addr,
+    oid if_index )
+{
+    netsnmp_route_nexthop* tmp;
+    size_t slot;
+
+    if ( ( table->nexthop_count + 1 ) * 2 > table->nexthop_hash_size
+        && _access_route_nexthop_rehash( table ) < 0 )
+        return -1;
+
+    slot = _access_route_nexthop_slot( table, addr, if_index );
+    if ( 0 != table->nexthop_hash[ slot ] )
+        return table->nexthop_hash[ slot ] - 1;
+
+    if ( table->nexthop_count == table->nexthop_size ) {
+        size_t size = table->nexthop_size ? table->nexthop_size * 2 : 16;
+        tmp = ( netsnmp_route_nexthop* )realloc( table->nexthops,
+            size * sizeof( netsnmp_route_nexthop ) );
+        if ( NULL == tmp )
+            return -1;
+        table->nexthops = tmp;
+        table->nexthop_size = size;
+    }
+
+    table->nexthops[ table->nexthop_count ].addr = addr;
+    table->nexthops[ table->nexthop_count ].if_index = if_index;
+    table->nexthop_hash[ slot ] = table->nexthop_count + 1;
+    return table->nexthop_count++;
+}
+
+/**
+ * add a route to a table being loaded
+ *
+ * @retval  0 success
+ * @retval -1 out of memory
+ */
+int netsnmp_access_route_table_add( netsnmp_route_table* table,
+    uint32_t dest, u_char pfx_len, uint32_t nexthop, oid if_index,
+    int32_t metric, u_char type, u_char proto )
+{
+    netsnmp_route_compact *tmp, *route;
+    long nh;
+
+    nh = _access_route_nexthop_intern( table, nexthop, if_index );
+    if ( nh < 0 )
+        return -1;
+
+    if ( table->count == table->size ) {
+        size_t size = table->size ? table->size * 2 : 256;
+        tmp = ( netsnmp_route_compact* )realloc( table->routes,
+            size * sizeof( netsnmp_route_compact ) );
+        if ( NULL == tmp ) {
+            Logger_log( LOGGER_PRIORITY_ERR, "could not grow route table to %" NETSNMP_PRIz "u\n",
+                size );
+            return -1;
+        }
+        table->routes = tmp;
+        table->size = size;
+    }
+
+    route = &table->routes[ table->count++ ];
+    route->dest = dest;
+    route->nexthop = ( uint32_t )nh;
+    route->metric = metric;
+    route->pfx_len = pfx_len;
+    route->type = type;
+    route->proto = proto;
+    return 0;
+}
+
+/** sort a loaded table into index order */
+void netsnmp_access_route_table_sort( netsnmp_route_table* table )
+{
+    if ( NULL == table || table->count < 2 )
+        return;
+
+    _access_route_sort_table = table;
+    qsort( table->routes, table->count, sizeof( netsnmp_route_compact ),
+        _access_route_compact_compare );
+    _access_route_sort_table = NULL;
+}
+
+size_t
+netsnmp_access_route_table_lower_bound( const netsnmp_route_table* table,
+    uint32_t dest )
+{
+    size_t first = 0, len, half;
+
+    if ( NULL == table )
+        return 0;
+
+    len = table->count;
+    while ( len > 0 ) {
+        half = len >> 1;
+        if ( ntohl( table->routes[ first + half ].dest ) < dest ) {
+            first += half + 1;
+            len -= half + 1;
+        } else
+            len = half;
+    }
+    return first;
+}
+
+/** index of the first route which is not before route */
+static size_t
+_access_route_table_find( const netsnmp_route_table* table,
+    const netsnmp_route_compact* route )
+{
+    size_t first = 0, len = table->count, half;
+
+    while ( len > 0 ) {
+        half = len >> 1;
+        if ( _access_route_compact_cmp( table, &table->routes[ first + half ],
+                 route )
+            < 0 ) {
+            first += half + 1;
+            len -= half + 1;
+        } else
+            len = half;
+    }
+    return first;
+}
+
+/**
+ * add a route to a sorted table, or update the route with the same
+ * index and metric
+ *
+ * @retval  0 success
+ * @retval -1 out of memory
+ */
+int netsnmp_access_route_table_insert( netsnmp_route_table* table,
+    uint32_t dest, u_char pfx_len, uint32_t nexthop, oid if_index,
+    int32_t metric, u_char type, u_char proto )
+{
+    netsnmp_route_compact route;
+    size_t pos;
+    long nh;
+
+    if ( NULL == table )
+        return -1;
+
+    nh = _access_route_nexthop_intern( table, nexthop, if_index );
+    if ( nh < 0 )
+        return -1;
+
+    route.dest = dest;
+    route.nexthop = ( uint32_t )nh;
+    route.metric = metric;
+    route.pfx_len = pfx_len;
+    route.type = type;
+    route.proto = proto;
+
+    for ( pos = _access_route_table_find( table, &route );
+          pos < table->count
+          && 0 == _access_route_compact_cmp( table, &table->routes[ pos ], &route );
+          ++pos ) {
+        if ( table->routes[ pos ].metric == metric ) {
+            table->routes[ pos ] = route;
+            return 0;
+        }
+    }
+
+    /** append, then move into place */
+    if ( netsnmp_access_route_table_add( table, dest, pfx_len, nexthop,
+             if_index, metric, type, proto )
+        < 0 )
+        return -1;
+    memmove( &table->routes[ pos + 1 ], &table->routes[ pos ],
+        ( table->count - 1 - pos ) * sizeof( netsnmp_route_compact ) );
+    table->routes[ pos ] = route;
+    return 0;
+}
+
+/**
+ * remove routes from a sorted table. next hops are left interned, a
+ * full load drops the unused ones.
+ *
+ * @return the number of routes removed
+ */
+int netsnmp_access_route_table_remove( netsnmp_route_table* table,
+    uint32_t dest, u_char pfx_len, const netsnmp_route_nexthop* nexthop,
+    int32_t metric )
+{
+    const netsnmp_route_compact* route;
+    const netsnmp_route_nexthop* nh;
+    size_t i, keep, end;
+
+    if ( NULL == table )
+        return 0;
+
+    i = netsnmp_access_route_table_lower_bound( table, ntohl( dest ) );
+    for ( end = i; end < table->count && table->routes[ end ].dest == dest; )
+        ++end;
+
+    for ( keep = i; i < end; ++i ) {
+        route = &table->routes[ i ];
+        nh = &table->nexthops[ route->nexthop ];
+        if ( route->pfx_len == pfx_len && route->metric == metric
+            && ( NULL == nexthop
+                   || ( nh->addr == nexthop->addr
+                          && nh->if_index == nexthop->if_index ) ) )
+            continue;
+        table->routes[ keep++ ] = *route;
+    }
+    if ( keep == end )
+        return 0;
+
+    memmove( &table->routes[ keep ], &table->routes[ end ],
+        ( table->count - end ) * sizeof( netsnmp_route_compact ) );
+    table->count -= end - keep;
+    return ( int )( end - keep );
+}
+
 /**---------------------------------------------------------------------*/
 /*
  * ifentry functions
@@ -137,6 +456,88 @@ void netsnmp_access_route_entry_free( netsnmp_route_entry* entry )
     free( entry );
 }
 
+/**
+ * @internal
+ * fill entry from a compact route. policy, if not NULL, holds the
+ * policy of directly connected routes instead of an allocated copy.
+ */
+static void
+_access_route_entry_fill( const netsnmp_route_table* table,
+    const netsnmp_route_compact* route, u_long index,
+    netsnmp_route_entry* entry, oid* policy )
+{
+    const netsnmp_route_nexthop* nh = &table->nexthops[ route->nexthop ];
+
+    entry->ns_rt_index = index;
+    entry->if_index = nh->if_index;
+    entry->rt_metric1 = route->metric;
+
+    entry->rt_mask = route->pfx_len ? htonl( 0xffffffffU << ( 32 - route->pfx_len ) ) : 0;
+    entry->rt_pfx_len = route->pfx_len;
+
+    /*
+     * copy dest & next hop
+     */
+    entry->rt_dest_type = INETADDRESSTYPE_IPV4;
+    entry->rt_dest_len = 4;
+    memcpy( entry->rt_dest, &route->dest, 4 );
+
+    entry->rt_nexthop_type = INETADDRESSTYPE_IPV4;
+    entry->rt_nexthop_len = 4;
+    memcpy( entry->rt_nexthop, &nh->addr, 4 );
+
+    /*
+    inetCidrRoutePolicy OBJECT-TYPE 
+        SYNTAX     OBJECT IDENTIFIER 
+        MAX-ACCESS not-accessible 
+        STATUS     current 
+        DESCRIPTION 
+               "This object is an opaque object without any defined 
+                semantics.  Its purpose is to serve as an additional 
+                index which may delineate between multiple entries to 
+                the same destination.  The value { 0 0 } shall be used 
+                as the default value for this object."
+        */
+    /*
+     * on linux, default routes all look alike, and would have the same
+     * indexed based on dest and next hop. So we use the if index
+     * as the policy, to distinguise between them. Hopefully this is
+     * unique.
+     * xxx-rks: It should really only be for the duplicate case, but that
+     *     would be more complicated than I want to get into now. Fix later.
+     */
+    if ( 0 == nh->addr ) {
+        if ( NULL != policy ) {
+            entry->rt_policy = policy;
+            entry->flags |= NETSNMP_ACCESS_ROUTE_POLICY_STATIC;
+        } else
+            entry->rt_policy = ( oid* )calloc( 3, sizeof( oid ) );
+        if ( NULL != entry->rt_policy ) {
+            entry->rt_policy[ 0 ] = 0;
+            entry->rt_policy[ 1 ] = 0;
+            entry->rt_policy[ 2 ] = entry->if_index;
+            entry->rt_policy_len = sizeof( oid ) * 3;
+        }
+    }
+
+    entry->rt_type = route->type;
+    entry->rt_proto = route->proto;
+}
+
+netsnmp_route_entry*
+netsnmp_access_route_entry_from_compact( const netsnmp_route_table* table,
+    const netsnmp_route_compact* route, u_long index )
+{
+    netsnmp_route_entry* entry;
+
+    entry = netsnmp_access_route_entry_create();
+    if ( NULL == entry )
+        return NULL;
+
+    _access_route_entry_fill( table, route, index, entry, NULL );
+    return entry;
+}
+
 /**
  * update underlying data store (kernel) for entry
  *
@@ -236,11 +637,434 @@ int netsnmp_access_route_entry_copy( netsnmp_route_entry* lhs,
     return 0;
 }
 
+/**---------------------------------------------------------------------*/
+/*
+ * compact route container
+ */
+
+typedef struct _access_route_compact_container_s {
+    netsnmp_route_table table;
+
+    /** rows built for the requests being processed */
+    Container_Container* built;
+    /** rows the table inserted itself */
+    Container_Container* rows;
+
+    size_t index_len;
+    netsnmp_route_index_f* index_get;
+    netsnmp_route_row_f* row_get;
+    Container_FuncObjFunc* row_free;
+    u_int flags;
+
+    /** alarm releasing the built rows, 0 if none is pending */
+    u_int release_id;
+} _access_route_compact_container;
+
+static int
+_access_route_cc_shown( const _access_route_compact_container* cc, size_t i )
+{
+    return !( cc->flags & NETSNMP_ACCESS_ROUTE_COMPACT_SKIP_DOWN )
+        || 0 != cc->table.routes[ i ].type;
+}
+
+/** the table index of route i, in index (whose oids have asnMAX_OID_LEN room) */
+static int
+_access_route_cc_index( const _access_route_compact_container* cc,
+    size_t i, Types_Index* index )
+{
+    netsnmp_route_entry entry;
+    oid policy[ 3 ];
+
+    memset( &entry, 0, sizeof( entry ) );
+    _access_route_entry_fill( &cc->table, &cc->table.routes[ i ], i + 1,
+        &entry, policy );
+    index->len = asnMAX_OID_LEN;
+    return cc->index_get( &entry, index );
+}
+
+/** compares the destination and prefix length part of route i and key */
+static int
+_access_route_cc_prefix_cmp( const _access_route_compact_container* cc,
+    size_t i, const Types_Index* key )
+{
+    oid buf[ asnMAX_OID_LEN ];
+    Types_Index index;
+
+    index.oids = buf;
+    if ( _access_route_cc_index( cc, i, &index ) < 0 )
+        return -1;
+    return Api_oidCompare( index.oids,
+        index.len < cc->index_len ? index.len : cc->index_len, key->oids,
+        key->len < cc->index_len ? key->len : cc->index_len );
+}
+
+/**
+ * position of the route whose index is key (exact), or of the route
+ * with the smallest index after key (NULL for the first one). its
+ * index is copied to found. -1 if there is no such route.
+ */
+static long
+_access_route_cc_lookup( const _access_route_compact_container* cc,
+    const Types_Index* key, int exact, Types_Index* found )
+{
+    const netsnmp_route_compact* routes = cc->table.routes;
+    size_t i, group, first = 0, len, half;
+    long best = -1;
+    oid buf[ asnMAX_OID_LEN ];
+    Types_Index index;
+    int rc;
+
+    if ( NULL != key ) {
+        /** the first route whose destination and prefix are not before key's */
+        len = cc->table.count;
+        while ( len > 0 ) {
+            half = len >> 1;
+            if ( _access_route_cc_prefix_cmp( cc, first + half, key ) < 0 ) {
+                first += half + 1;
+                len -= half + 1;
+            } else
+                len = half;
+        }
+    } else if ( exact )
+        return -1;
+
+    index.oids = buf;
+    for ( i = first; i < cc->table.count && best < 0 && ( !exact || i == first );
+          i = group ) {
+        /*
+         * the routes to one destination and prefix length are not in
+         * the index order of every table: look at all of them.
+         */
+        for ( group = i; group < cc->table.count
+              && routes[ group ].dest == routes[ i ].dest
+              && routes[ group ].pfx_len == routes[ i ].pfx_len;
+              ++group ) {
+            if ( !_access_route_cc_shown( cc, group )
+                || _access_route_cc_index( cc, group, &index ) < 0 )
+                continue;
+            if ( NULL != key ) {
+                rc = Api_oidCompare( index.oids, index.len, key->oids, key->len );
+                if ( exact ? 0 != rc : rc <= 0 )
+                    continue;
+            }
+            if ( best < 0
+                || Api_oidCompare( index.oids, index.len, found->oids, found->len ) < 0 ) {
+                best = group;
+                memcpy( found->oids, index.oids, index.len * sizeof( oid ) );
+                found->len = index.len;
+            }
+        }
+    }
+    return best;
+}
+
+static void
+_access_route_cc_release( unsigned int alarmId, void* clientarg )
+{
+    _access_route_compact_container* cc = ( _access_route_compact_container* )clientarg;
+
+    cc->release_id = 0;
+    CONTAINER_CLEAR( cc->built, cc->row_free, NULL );
+}
+
+/** the row for route i, whose index is index */
+static void*
+_access_route_cc_row( _access_route_compact_container* cc, size_t i,
+    const Types_Index* index )
+{
+    netsnmp_route_entry* entry;
+    void* row;
+
+    row = CONTAINER_FIND( cc->built, index );
+    if ( NULL != row )
+        return row;
+
+    entry = netsnmp_access_route_entry_from_compact( &cc->table,
+        &cc->table.routes[ i ], i + 1 );
+    if ( NULL == entry )
+        return NULL;
+    row = cc->row_get( entry );
+    if ( NULL == row )
+        return NULL;
+
+    if ( CONTAINER_INSERT( cc->built, row ) < 0 ) {
+        cc->row_free( row, NULL );
+        return NULL;
+    }
+
+    /*
+     * the agent keeps pointers to the rows only while it processes a
+     * request: release them as soon as it is done.
+     */
+    if ( 0 == cc->release_id )
+        cc->release_id = Alarm_register( 0, 0, _access_route_cc_release, cc );
+    return row;
+}
+
+static void*
+_access_route_cc_find( Container_Container* container, const void* key )
+{
+    _access_route_compact_container* cc = ( _access_route_compact_container* )container->containerData;
+    oid buf[ asnMAX_OID_LEN ];
+    Types_Index found;
+    void* row;
+    long i;
+
+    if ( NULL == key )
+        return NULL;
+
+    row = CONTAINER_FIND( cc->built, key );
+    if ( NULL == row )
+        row = CONTAINER_FIND( cc->rows, key );
+    if ( NULL != row )
+        return row;
+
+    found.oids = buf;
+    i = _access_route_cc_lookup( cc, ( const Types_Index* )key, 1, &found );
+    return i < 0 ? NULL : _access_route_cc_row( cc, i, &found );
+}
+
+static void*
+_access_route_cc_find_next( Container_Container* container, const void* key )
+{
+    _access_route_compact_container* cc = ( _access_route_compact_container* )container->containerData;
+    oid buf[ asnMAX_OID_LEN ];
+    Types_Index found;
+    void* next;
+    long i;
+
+    next = ( NULL == key ) ? CONTAINER_FIRST( cc->rows ) : CONTAINER_NEXT( cc->rows, key );
+
+    found.oids = buf;
+    i = _access_route_cc_lookup( cc, ( const Types_Index* )key, 0, &found );
+    if ( i < 0
+        || ( NULL != next && Container_compareIndex( next, &found ) <= 0 ) )
+        return next;
+    return _access_route_cc_row( cc, i, &found );
+}
+
+static int
+_access_route_cc_insert( Container_Container* container, const void* row )
+{
+    _access_route_compact_container* cc = ( _access_route_compact_container* )container->containerData;
+
+    return CONTAINER_INSERT( cc->rows, row );
+}
+
+static int
+_access_route_cc_remove( Container_Container* container, const void* row )
+{
+    _access_route_compact_container* cc = ( _access_route_compact_container* )container->containerData;
+    oid buf[ asnMAX_OID_LEN ];
+    Types_Index found;
+    long i;
+
+    if ( CONTAINER_FIND( cc->rows, row ) == row )
+        return CONTAINER_REMOVE( cc->rows, row );
+
+    if ( CONTAINER_FIND( cc->built, row ) != row )
+        return -1;
+    CONTAINER_REMOVE( cc->built, row );
+
+    /** the route goes away with its row, until the next load */
+    found.oids = buf;
+    i = _access_route_cc_lookup( cc, ( const Types_Index* )row, 1, &found );
+    if ( i >= 0 ) {
+        memmove( &cc->table.routes[ i ], &cc->table.routes[ i + 1 ],
+            ( cc->table.count - i - 1 ) * sizeof( netsnmp_route_compact ) );
+        --cc->table.count;
+    }
+    return 0;
+}
+
+static size_t
+_access_route_cc_size( Container_Container* container )
+{
+    _access_route_compact_container* cc = ( _access_route_compact_container* )container->containerData;
+    size_t i, count = 0;
+
+    for ( i = 0; i < cc->table.count; ++i )
+        if ( _access_route_cc_shown( cc, i ) )
+            ++count;
+    return count + CONTAINER_SIZE( cc->rows );
+}
+
+static void
+_access_route_cc_for_each( Container_Container* container,
+    Container_FuncObjFunc* f, void* context )
+{
+    void* row;
+
+    for ( row = _access_route_cc_find_next( container, NULL ); NULL != row;
+          row = _access_route_cc_find_next( container, row ) )
+        f( row, context );
+}
+
+static void
+_access_route_cc_clear( Container_Container* container,
+    Container_FuncObjFunc* f, void* context )
+{
+    _access_route_compact_container* cc = ( _access_route_compact_container* )container->containerData;
+
+    CONTAINER_CLEAR( cc->built, f, context );
+    CONTAINER_CLEAR( cc->rows, f, context );
+    cc->table.count = 0;
+}
+
+static int
+_access_route_cc_free( Container_Container* container )
+{
+    _access_route_compact_container* cc = ( _access_route_compact_container* )container->containerData;
+
+    if ( 0 != cc->release_id )
+        Alarm_unregister( cc->release_id );
+    CONTAINER_FREE( cc->built );
+    CONTAINER_FREE( cc->rows );
+    netsnmp_access_route_table_free( &cc->table );
+    free( cc );
+    free( container );
+    return 0;
+}
+
+/**
+ * @retval NULL  error
+ * @retval !NULL pointer to container
+ */
+Container_Container*
+netsnmp_access_route_compact_container_create( size_t index_len,
+    netsnmp_route_index_f* index_get, netsnmp_route_row_f* row_get,
+    Container_FuncObjFunc* row_free, u_int flags )
+{
+    _access_route_compact_container* cc;
+    Container_Container* container;
+
+    if ( NULL == index_get || NULL == row_get || NULL == row_free )
+        return NULL;
+
+    cc = MEMORY_MALLOC_TYPEDEF( _access_route_compact_container );
+    if ( NULL == cc )
+        return NULL;
+    cc->index_len = index_len;
+    cc->index_get = index_get;
+    cc->row_get = row_get;
+    cc->row_free = row_free;
+    cc->flags = flags;
+
+    cc->built = Container_find( "access:_route:compact:tableContainer" );
+    cc->rows = Container_find( "access:_route:compact:tableContainer" );
+    container = ContainerNull_get();
+    if ( NULL == cc->built || NULL == cc->rows || NULL == container ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "could not create route container\n" );
+        if ( cc->built )
+            CONTAINER_FREE( cc->built );
+        if ( cc->rows )
+            CONTAINER_FREE( cc->rows );
+        free( container );
+        free( cc );
+        return NULL;
+    }
+
+    container->containerData = cc;
+    container->compare = Container_compareIndex;
+    container->nCompare = Container_nCompareIndex;
+    container->find = _access_route_cc_find;
+    container->findNext = _access_route_cc_find_next;
+    container->insert = _access_route_cc_insert;
+    container->remove = _access_route_cc_remove;
+    container->getSize = _access_route_cc_size;
+    container->forEach = _access_route_cc_for_each;
+    container->clear = _access_route_cc_clear;
+    container->cfree = _access_route_cc_free;
+
+    return container;
+}
+
+/**
+ * load the routing table into container, replacing the routes it had
+ *
+ * @retval  0 success
+ * @retval <0 error
+ */
+int netsnmp_access_route_compact_container_load( Container_Container* container,
+    u_int load_flags )
+{
+    _access_route_compact_container* cc;
+
+    if ( NULL == container || NULL == container->containerData )
+        return -1;
+    cc = ( _access_route_compact_container* )container->containerData;
+
+    CONTAINER_CLEAR( cc->built, cc->row_free, NULL );
+    return netsnmp_access_route_table_load( &cc->table, load_flags );
+}
+
+/**
+ * apply a route change notification to the routes in container
+ *
+ * @retval  0 success
+ * @retval <0 error, the container needs a full load
+ */
+int netsnmp_access_route_compact_container_update( Container_Container* container,
+    const struct nlmsghdr* msg )
+{
+    _access_route_compact_container* cc;
+
+    if ( NULL == container || NULL == container->containerData )
+        return -1;
+    cc = ( _access_route_compact_container* )container->containerData;
+
+    /** notifications come between requests: no row is in use */
+    CONTAINER_CLEAR( cc->built, cc->row_free, NULL );
+    return netsnmp_access_route_table_update( &cc->table, msg );
+}
+
 /**---------------------------------------------------------------------*/
 /*
  * Utility routines
  */
 
+/**
+ * order of the inetCidrRouteTable index: destination, prefix length,
+ * policy (directly connected routes use { 0 0 ifIndex }, others the
+ * shorter { 0 0 }), then next hop. for routes with a next hop this is
+ * the ipCidrRouteTable order as well.
+ */
+static int
+_access_route_compact_cmp( const netsnmp_route_table* table,
+    const netsnmp_route_compact* l, const netsnmp_route_compact* r )
+{
+    const netsnmp_route_nexthop *lnh, *rnh;
+    uint32_t la, ra;
+
+    la = ntohl( l->dest );
+    ra = ntohl( r->dest );
+    if ( la != ra )
+        return la < ra ? -1 : 1;
+    if ( l->pfx_len != r->pfx_len )
+        return l->pfx_len < r->pfx_len ? -1 : 1;
+
+    lnh = &table->nexthops[ l->nexthop ];
+    rnh = &table->nexthops[ r->nexthop ];
+    if ( ( 0 == lnh->addr ) != ( 0 == rnh->addr ) )
+        return ( 0 == lnh->addr ) ? 1 : -1;
+    if ( 0 == lnh->addr && lnh->if_index != rnh->if_index )
+        return lnh->if_index < rnh->if_index ? -1 : 1;
+
+    la = ntohl( lnh->addr );
+    ra = ntohl( rnh->addr );
+    if ( la != ra )
+        return la < ra ? -1 : 1;
+    return 0;
+}
+
+static int
+_access_route_compact_compare( const void* lhs, const void* rhs )
+{
+    return _access_route_compact_cmp( _access_route_sort_table,
+        ( const netsnmp_route_compact* )lhs,
+        ( const netsnmp_route_compact* )rhs );
+}
+
 /**
  */
 void _access_route_entry_release( netsnmp_route_entry* entry, void* context )
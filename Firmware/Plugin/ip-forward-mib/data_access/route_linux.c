@@ -14,8 +14,13 @@
 #include "ip-forward-mib/data_access/route_ioctl.h"
 #include "ip-forward-mib/inetCidrRouteTable/inetCidrRouteTable_constants.h"
 #include "siglog/data_access/ipaddress.h"
+#include <errno.h>
+#include <linux/rtnetlink.h>
 #include <net/route.h>
 
+/* a dump recv carries a few hundred routes */
+#define ROUTE_NETLINK_BUF_SIZE 32768
+
 static int
 _type_from_flags( unsigned int flags )
 {
@@ -34,20 +39,22 @@ _type_from_flags( unsigned int flags )
     } else
         return 0; /* route not up */
 }
+/**
+ * @internal
+ * load ipv4 routes from /proc/net/route
+ */
 static int
-_load_ipv4( Container_Container* container, u_long* index )
+_load_proc_ipv4( netsnmp_route_table* table )
 {
     FILE* in;
     char line[ 256 ];
-    netsnmp_route_entry* entry = NULL;
-    char name[ 16 ];
+    char name[ 16 ], last_name[ 16 ] = "";
+    oid if_index = 0;
     int fd;
 
     DEBUG_MSGTL( ( "access:route:container",
         "route_container_arch_load ipv4\n" ) );
 
-    Assert_assert( NULL != container );
-
     /*
      * fetch routes from the proc file-system:
      */
@@ -70,12 +77,10 @@ _load_ipv4( Container_Container* container, u_long* index )
 
     while ( fgets( line, sizeof( line ), in ) ) {
         char rtent_name[ 32 ];
-        int refcnt, rc;
+        int refcnt, rc, metric;
         uint32_t dest, nexthop, mask;
         unsigned flags, use;
 
-        entry = netsnmp_access_route_entry_create();
-
         /*
          * as with 1.99.14:
          *    Iface Dest     GW       Flags RefCnt Use Met Mask     MTU  Win IRTT
@@ -87,15 +92,13 @@ _load_ipv4( Container_Container* container, u_long* index )
             /*
                      * XXX: fix type of the args 
                      */
-            &flags, &refcnt, &use, &entry->rt_metric1,
+            &flags, &refcnt, &use, &metric,
             &mask );
         DEBUG_MSGTL( ( "9:access:route:container", "line |%s|\n", line ) );
         if ( 8 != rc ) {
             Logger_log( LOGGER_PRIORITY_ERR,
                 "/proc/net/route data format error (%d!=8), line ==|%s|",
                 rc, line );
-
-            netsnmp_access_route_entry_free( entry );
             continue;
         }
 
@@ -110,87 +113,300 @@ _load_ipv4( Container_Container* container, u_long* index )
          * NOTE[1]: normally we'd use netsnmp_access_interface_index_find,
          * but since that will open/close a socket, and we might
          * have a lot of routes, call the ioctl routine directly.
+         * routes through the same interface come in runs, so only
+         * ask when the name changes.
          */
-        if ( '*' != name[ 0 ] )
-            entry->if_index = netsnmp_access_interface_ioctl_ifindex_get( fd, name );
+        if ( '*' == name[ 0 ] ) {
+            if_index = 0;
+            last_name[ 0 ] = '\0';
+        } else if ( 0 != strcmp( name, last_name ) ) {
+            if_index = netsnmp_access_interface_ioctl_ifindex_get( fd, name );
+            strcpy( last_name, name );
+        }
 
         /*
-         * arbitrary index
+         * get protocol and type from flags
          */
-        entry->ns_rt_index = ++( *index );
+        if ( netsnmp_access_route_table_add( table, dest,
+                 netsnmp_ipaddress_ipv4_prefix_len( mask ), nexthop,
+                 if_index, metric, _type_from_flags( flags ),
+                 ( flags & RTF_DYNAMIC ) ? IANAIPROUTEPROTOCOL_ICMP
+                                         : IANAIPROUTEPROTOCOL_LOCAL )
+            < 0 ) {
+            fclose( in );
+            close( fd );
+            return -3;
+        }
+    }
 
-        memcpy( &entry->rt_mask, &mask, 4 );
-        /** entry->rt_tos = XXX; */
-        /** rt info ?? */
-        /*
-         * copy dest & next hop
-         */
-        entry->rt_dest_type = INETADDRESSTYPE_IPV4;
-        entry->rt_dest_len = 4;
-        memcpy( entry->rt_dest, &dest, 4 );
+    fclose( in );
+    close( fd );
+    return 0;
+}
 
-        entry->rt_nexthop_type = INETADDRESSTYPE_IPV4;
-        entry->rt_nexthop_len = 4;
-        memcpy( entry->rt_nexthop, &nexthop, 4 );
+/**
+ * @internal
+ * map the routing protocol that installed a route to IANAipRouteProtocol
+ */
+static u_char
+_proto_from_rtprot( u_char protocol )
+{
+    switch ( protocol ) {
+    case RTPROT_REDIRECT:
+        return IANAIPROUTEPROTOCOL_ICMP;
+    case RTPROT_KERNEL:
+    case RTPROT_BOOT:
+        return IANAIPROUTEPROTOCOL_LOCAL;
+    case RTPROT_STATIC:
+        return IANAIPROUTEPROTOCOL_NETMGMT;
+#ifdef RTPROT_BGP
+    case RTPROT_BGP:
+        return IANAIPROUTEPROTOCOL_BGP;
+    case RTPROT_ISIS:
+        return IANAIPROUTEPROTOCOL_ISIS;
+    case RTPROT_OSPF:
+        return IANAIPROUTEPROTOCOL_OSPF;
+    case RTPROT_RIP:
+        return IANAIPROUTEPROTOCOL_RIP;
+    case RTPROT_EIGRP:
+        return IANAIPROUTEPROTOCOL_CISCOEIGRP;
+#endif
+    }
+    return IANAIPROUTEPROTOCOL_OTHER;
+}
 
-        /*
-         * count bits in mask
-         */
-        entry->rt_pfx_len = netsnmp_ipaddress_ipv4_prefix_len( mask );
+/** adds a route to, or removes it from, a table */
+typedef int( _route_op_f )( netsnmp_route_table* table, uint32_t dest,
+    u_char pfx_len, uint32_t nexthop, oid if_index, int32_t metric,
+    u_char type, u_char proto );
 
-        /*
-    inetCidrRoutePolicy OBJECT-TYPE 
-        SYNTAX     OBJECT IDENTIFIER 
-        MAX-ACCESS not-accessible 
-        STATUS     current 
-        DESCRIPTION 
-               "This object is an opaque object without any defined 
-                semantics.  Its purpose is to serve as an additional 
-                index which may delineate between multiple entries to 
-                the same destination.  The value { 0 0 } shall be used 
-                as the default value for this object."
-        */
-        /*
-         * on linux, default routes all look alike, and would have the same
-         * indexed based on dest and next hop. So we use the if index
-         * as the policy, to distinguise between them. Hopefully this is
-         * unique.
-         * xxx-rks: It should really only be for the duplicate case, but that
-         *     would be more complicated than I want to get into now. Fix later.
-         */
-        if ( 0 == nexthop ) {
-            entry->rt_policy = ( oid* )calloc( 3, sizeof( oid ) );
-            entry->rt_policy[ 2 ] = entry->if_index;
-            entry->rt_policy_len = sizeof( oid ) * 3;
+static int
+_route_remove( netsnmp_route_table* table, uint32_t dest, u_char pfx_len,
+    uint32_t nexthop, oid if_index, int32_t metric, u_char type, u_char proto )
+{
+    netsnmp_route_nexthop nh;
+
+    nh.addr = nexthop;
+    nh.if_index = if_index;
+    netsnmp_access_route_table_remove( table, dest, pfx_len, &nh, metric );
+    return 0;
+}
+
+/**
+ * @internal
+ * apply one RTM_NEWROUTE or RTM_DELROUTE message to table (one route
+ * per hop of a multipath route)
+ */
+static int
+_netlink_route( netsnmp_route_table* table, const struct nlmsghdr* h,
+    _route_op_f* op )
+{
+    struct rtmsg* rtm = ( struct rtmsg* )NLMSG_DATA( h );
+    struct rtattr* rta;
+    struct rtnexthop* rtnh = NULL;
+    uint32_t dest = 0, gateway = 0, rt_table = rtm->rtm_table;
+    int len, mp_len = 0, if_index = 0, metric = 0;
+    u_char type, proto;
+
+    if ( h->nlmsg_len < NLMSG_LENGTH( sizeof( *rtm ) )
+        || AF_INET != rtm->rtm_family || ( rtm->rtm_flags & RTM_F_CLONED ) )
+        return 0;
+
+    len = RTM_PAYLOAD( h );
+    for ( rta = RTM_RTA( rtm ); RTA_OK( rta, len ); rta = RTA_NEXT( rta, len ) ) {
+        switch ( rta->rta_type ) {
+        case RTA_DST:
+            memcpy( &dest, RTA_DATA( rta ), sizeof( dest ) );
+            break;
+        case RTA_GATEWAY:
+            memcpy( &gateway, RTA_DATA( rta ), sizeof( gateway ) );
+            break;
+        case RTA_OIF:
+            if_index = *( int* )RTA_DATA( rta );
+            break;
+        case RTA_PRIORITY:
+            metric = *( int* )RTA_DATA( rta );
+            break;
+        case RTA_TABLE:
+            rt_table = *( uint32_t* )RTA_DATA( rta );
+            break;
+        case RTA_MULTIPATH:
+            rtnh = ( struct rtnexthop* )RTA_DATA( rta );
+            mp_len = RTA_PAYLOAD( rta );
+            break;
         }
+    }
 
-        /*
-         * get protocol and type from flags
-         */
-        entry->rt_type = _type_from_flags( flags );
+    /** /proc/net/route only ever showed the main table */
+    if ( RT_TABLE_MAIN != rt_table )
+        return 0;
+
+    switch ( rtm->rtm_type ) {
+    case RTN_UNICAST:
+        type = 0; /* per hop */
+        break;
+    case RTN_BLACKHOLE:
+        type = INETCIDRROUTETYPE_BLACKHOLE;
+        break;
+    case RTN_UNREACHABLE:
+    case RTN_PROHIBIT:
+        type = INETCIDRROUTETYPE_REJECT;
+        break;
+    default:
+        type = INETCIDRROUTETYPE_OTHER;
+        break;
+    }
+    proto = _proto_from_rtprot( rtm->rtm_protocol );
+
+    /** a replaced route may have had other next hops */
+    if ( ( h->nlmsg_flags & NLM_F_REPLACE ) && op != _route_remove )
+        netsnmp_access_route_table_remove( table, dest, rtm->rtm_dst_len,
+            NULL, metric );
+
+    if ( NULL == rtnh )
+        return op( table, dest, rtm->rtm_dst_len,
+            gateway, if_index, metric,
+            type ? type : ( gateway ? INETCIDRROUTETYPE_REMOTE : INETCIDRROUTETYPE_LOCAL ),
+            proto );
+
+    for ( ; RTNH_OK( rtnh, mp_len ); mp_len -= RTNH_ALIGN( rtnh->rtnh_len ),
+          rtnh = RTNH_NEXT( rtnh ) ) {
+        len = rtnh->rtnh_len - sizeof( *rtnh );
+        gateway = 0;
+        for ( rta = RTNH_DATA( rtnh ); RTA_OK( rta, len ); rta = RTA_NEXT( rta, len ) )
+            if ( RTA_GATEWAY == rta->rta_type )
+                memcpy( &gateway, RTA_DATA( rta ), sizeof( gateway ) );
+        if ( op( table, dest, rtm->rtm_dst_len,
+                 gateway, rtnh->rtnh_ifindex, metric,
+                 type ? type : ( gateway ? INETCIDRROUTETYPE_REMOTE : INETCIDRROUTETYPE_LOCAL ),
+                 proto )
+            < 0 )
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * @internal
+ * load ipv4 routes with one rtnetlink RTM_GETROUTE dump
+ *
+ * @retval  0 success
+ * @retval  1 rtnetlink not available, use /proc/net/route
+ * @retval <0 error
+ */
+static int
+_load_netlink_ipv4( netsnmp_route_table* table )
+{
+    static char buf[ ROUTE_NETLINK_BUF_SIZE ];
+    struct {
+        struct nlmsghdr n;
+        struct rtmsg r;
+    } req;
+    struct nlmsghdr* h;
+    int fd, len, rc = 0, msgs = 0;
+
+    fd = socket( AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_ROUTE );
+    if ( fd < 0 ) {
+        DEBUG_MSGTL( ( "access:route:netlink", "socket failed (%d)\n", errno ) );
+        return 1;
+    }
 
-        entry->rt_proto = ( flags & RTF_DYNAMIC )
-            ? IANAIPROUTEPROTOCOL_ICMP
-            : IANAIPROUTEPROTOCOL_LOCAL;
+    memset( &req, 0, sizeof( req ) );
+    req.n.nlmsg_len = NLMSG_LENGTH( sizeof( struct rtmsg ) );
+    req.n.nlmsg_type = RTM_GETROUTE;
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.n.nlmsg_seq = 1;
+    req.r.rtm_family = AF_INET;
+
+    if ( send( fd, &req, req.n.nlmsg_len, 0 ) < 0 ) {
+        DEBUG_MSGTL( ( "access:route:netlink", "send failed (%d)\n", errno ) );
+        close( fd );
+        return 1;
+    }
 
-        /*
-         * insert into container
-         */
-        if ( CONTAINER_INSERT( container, entry ) < 0 ) {
-            DEBUG_MSGTL( ( "access:route:container", "error with route_entry: insert into container failed.\n" ) );
-            netsnmp_access_route_entry_free( entry );
-            continue;
+    for ( ;; ) {
+        len = recv( fd, buf, sizeof( buf ), 0 );
+        if ( len < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            Logger_log( LOGGER_PRIORITY_ERR, "route: netlink recv failed: %s\n",
+                strerror( errno ) );
+            rc = -2;
+            break;
+        }
+        if ( 0 == len )
+            break;
+
+        for ( h = ( struct nlmsghdr* )buf; NLMSG_OK( h, len );
+              h = NLMSG_NEXT( h, len ) ) {
+            if ( NLMSG_DONE == h->nlmsg_type )
+                goto done;
+            if ( NLMSG_ERROR == h->nlmsg_type ) {
+                DEBUG_MSGTL( ( "access:route:netlink", "dump refused\n" ) );
+                rc = ( 0 == msgs ) ? 1 : -2;
+                goto done;
+            }
+            ++msgs;
+            if ( RTM_NEWROUTE == h->nlmsg_type
+                && _netlink_route( table, h, netsnmp_access_route_table_add ) < 0 ) {
+                rc = -3;
+                goto done;
+            }
         }
     }
 
-    fclose( in );
+done:
     close( fd );
+    return rc;
+}
+
+/** arch specific compact table load
+ * @internal
+ *
+ * @retval  0 success
+ * @retval <0 error
+ */
+int netsnmp_access_route_table_arch_load( netsnmp_route_table* table,
+    u_int load_flags )
+{
+    int rc;
+
+    rc = _load_netlink_ipv4( table );
+    if ( rc > 0 ) {
+        table->count = 0;
+        table->nexthop_count = 0;
+        rc = _load_proc_ipv4( table );
+    }
+    return rc;
+}
+
+/** arch specific update
+ * @internal
+ *
+ * @retval  0 success
+ * @retval <0 error
+ */
+int netsnmp_access_route_table_update( netsnmp_route_table* table,
+    const struct nlmsghdr* msg )
+{
+    if ( NULL == table || NULL == msg )
+        return -1;
+
+    switch ( msg->nlmsg_type ) {
+    case RTM_NEWROUTE:
+        return _netlink_route( table, msg, netsnmp_access_route_table_insert );
+    case RTM_DELROUTE:
+        return _netlink_route( table, msg, _route_remove );
+    }
     return 0;
 }
 
 /** arch specific load
  * @internal
  *
+ * the entries are inserted in index order, so the tables copying them
+ * into their own sorted containers only ever append.
+ *
  * @retval  0 success
  * @retval -1 no container specified
  * @retval -2 could not open data file
@@ -198,7 +414,9 @@ _load_ipv4( Container_Container* container, u_long* index )
 int netsnmp_access_route_container_arch_load( Container_Container* container,
     u_int load_flags )
 {
-    u_long count = 0;
+    netsnmp_route_table table;
+    netsnmp_route_entry* entry;
+    size_t i;
     int rc;
 
     DEBUG_MSGTL( ( "access:route:container",
@@ -209,7 +427,26 @@ int netsnmp_access_route_container_arch_load( Container_Container* container,
         return -1;
     }
 
-    rc = _load_ipv4( container, &count );
+    memset( &table, 0, sizeof( table ) );
+    rc = netsnmp_access_route_table_load( &table, load_flags );
+
+    for ( i = 0; 0 == rc && i < table.count; ++i ) {
+        entry = netsnmp_access_route_entry_from_compact( &table,
+            &table.routes[ i ], i + 1 );
+        if ( NULL == entry )
+            break;
+
+        /*
+         * insert into container
+         */
+        if ( CONTAINER_INSERT( container, entry ) < 0 ) {
+            DEBUG_MSGTL( ( "access:route:container", "error with route_entry: insert into container failed.\n" ) );
+            netsnmp_access_route_entry_free( entry );
+            continue;
+        }
+    }
+
+    netsnmp_access_route_table_free( &table );
 
     return rc;
 }
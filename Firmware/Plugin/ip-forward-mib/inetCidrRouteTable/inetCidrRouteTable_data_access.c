@@ -12,11 +12,17 @@
 #include "System/Util/Assert.h"
 #include "System/Util/Trace.h"
 #include "System/Util/Logger.h"
+#include "utilities/rtnl_events.h"
 #include "inetCidrRouteTable.h"
 #include "inetCidrRouteTable_constants.h"
 #include "inetCidrRouteTable_interface.h"
 #include "siglog/agent/mfd.h"
 
+static netsnmp_route_index_f _route_index_get;
+static netsnmp_route_row_f _route_row_get;
+static void _route_row_free( void* rowreq_ctx, void* context );
+static netsnmp_rtnl_event_f _route_event;
+
 /** @ingroup interface 
  * @addtogroup data_access data_access: Routines to access data
  *
@@ -108,8 +114,17 @@ void inetCidrRouteTable_container_init( Container_Container** container_ptr_ptr,
     /*
      * For advanced users, you can use a custom container. If you
      * do not create one, one will be created for you.
+     *
+     * the rows are served from a compact copy of the routing table,
+     * and only built for the routes requests look at. per
+     * inetCidrRouteType, routes which do not result in traffic
+     * forwarding or rejection are not displayed. the destination
+     * type and address and the prefix length are the first 7
+     * sub-identifiers of the index.
      */
-    *container_ptr_ptr = NULL;
+    *container_ptr_ptr = netsnmp_access_route_compact_container_create( 7,
+        _route_index_get, _route_row_get, _route_row_free,
+        NETSNMP_ACCESS_ROUTE_COMPACT_SKIP_DOWN );
 
     if ( NULL == cache ) {
         Logger_log( LOGGER_PRIORITY_ERR,
@@ -126,36 +141,87 @@ void inetCidrRouteTable_container_init( Container_Container** container_ptr_ptr,
      * cache->enabled to 0.
      */
     cache->timeout = INETCIDRROUTETABLE_CACHE_TIMEOUT; /* seconds */
+
+    /*
+     * apply the route changes the kernel announces to the loaded
+     * routes instead of polling for them.
+     */
+    if ( netsnmp_rtnl_events_register( RTMGRP_IPV4_ROUTE, _route_event, cache )
+        == 0 )
+        cache->timeout = INETCIDRROUTETABLE_EVENTS_CACHE_TIMEOUT;
 } /* inetCidrRouteTable_container_init */
 
 /**
- * check entry for update
+ * @internal
+ * a route was added or removed. only a lost notification (msg is NULL)
+ * or a change which cannot be applied costs a full reload.
  */
 static void
-_snarf_route_entry( netsnmp_route_entry* route_entry,
-    Container_Container* container )
+_route_event( const struct nlmsghdr* msg, void* context )
 {
-    inetCidrRouteTable_rowreq_ctx* rowreq_ctx;
+    Cache* cache = ( Cache* )context;
 
-    Assert_assert( NULL != route_entry );
-    Assert_assert( NULL != container );
-
-    /*
-     * per  inetCidrRouteType:
-     *
-     * Routes which do not result in traffic forwarding or 
-     * rejection should not be displayed even if the  
-     * implementation keeps them stored internally.
-     */
-    if ( route_entry->rt_type == 0 ) { /* set when route not up */
-        DEBUG_MSGT( ( "verbose:inetCidrRouteTable:inetCidrRouteTable_cache_load", "skipping route\n" ) );
-        netsnmp_access_route_entry_free( route_entry );
+    if ( !cache->valid || NULL == cache->magic )
         return;
+
+    if ( NULL == msg
+        || netsnmp_access_route_compact_container_update(
+               ( Container_Container* )cache->magic, msg )
+            < 0 ) {
+        DEBUG_MSGTL( ( "inetCidrRouteTable:events", "reloading\n" ) );
+        CacheHandler_invalidate( cache );
+    }
+}
+
+/**
+ * index of a route, as inetCidrRouteTable_index_to_oid() encodes it.
+ * the compact route container asks for it at every step of a lookup,
+ * so it is built directly rather than through varbinds.
+ */
+static int
+_route_index_get( const netsnmp_route_entry* route_entry, Types_Index* index )
+{
+    static const oid null_policy[] = { 0, 0 };
+    const oid* policy = route_entry->rt_policy;
+    size_t i, n = 0, policy_len = route_entry->rt_policy_len / sizeof( oid );
+
+    if ( NULL == policy || 0 == policy_len ) {
+        policy = null_policy;
+        policy_len = 2;
     }
+    if ( 6 + route_entry->rt_dest_len + policy_len + route_entry->rt_nexthop_len
+        > index->len )
+        return MFD_ERROR;
+
+    index->oids[ n++ ] = route_entry->rt_dest_type;
+    index->oids[ n++ ] = route_entry->rt_dest_len;
+    for ( i = 0; i < route_entry->rt_dest_len; ++i )
+        index->oids[ n++ ] = route_entry->rt_dest[ i ];
+    index->oids[ n++ ] = route_entry->rt_pfx_len;
+    index->oids[ n++ ] = policy_len;
+    for ( i = 0; i < policy_len; ++i )
+        index->oids[ n++ ] = policy[ i ];
+    index->oids[ n++ ] = route_entry->rt_nexthop_type;
+    index->oids[ n++ ] = route_entry->rt_nexthop_len;
+    for ( i = 0; i < route_entry->rt_nexthop_len; ++i )
+        index->oids[ n++ ] = route_entry->rt_nexthop[ i ];
+    index->len = n;
+
+    return MFD_SUCCESS;
+}
+
+/**
+ * build the row for a route the agent is looking at
+ */
+static void*
+_route_row_get( netsnmp_route_entry* route_entry )
+{
+    inetCidrRouteTable_rowreq_ctx* rowreq_ctx;
+
+    Assert_assert( NULL != route_entry );
 
     /*
-     * allocate an row context and set the index(es), then add it to
-     * the container
+     * allocate an row context and set the index(es)
      */
     rowreq_ctx = inetCidrRouteTable_allocate_rowreq_ctx( route_entry, NULL );
     if ( ( NULL != rowreq_ctx ) && ( MFD_SUCCESS == inetCidrRouteTable_indexes_set( rowreq_ctx, route_entry->rt_dest_type,
@@ -164,16 +230,23 @@ _snarf_route_entry( netsnmp_route_entry* route_entry,
                                                         route_entry->rt_policy, route_entry->rt_policy_len,
                                                         route_entry->rt_nexthop_type,
                                                         ( char* )route_entry->rt_nexthop, route_entry->rt_nexthop_len ) ) ) {
-        CONTAINER_INSERT( container, rowreq_ctx );
         rowreq_ctx->row_status = ROWSTATUS_ACTIVE;
-    } else {
-        if ( rowreq_ctx ) {
-            Logger_log( LOGGER_PRIORITY_ERR, "error setting index while loading "
-                                             "inetCidrRoute cache.\n" );
-            inetCidrRouteTable_release_rowreq_ctx( rowreq_ctx );
-        } else
-            netsnmp_access_route_entry_free( route_entry );
+        return rowreq_ctx;
     }
+
+    if ( rowreq_ctx ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "error setting index while loading "
+                                         "inetCidrRoute cache.\n" );
+        inetCidrRouteTable_release_rowreq_ctx( rowreq_ctx );
+    } else
+        netsnmp_access_route_entry_free( route_entry );
+    return NULL;
+}
+
+static void
+_route_row_free( void* rowreq_ctx, void* context )
+{
+    inetCidrRouteTable_release_rowreq_ctx( ( inetCidrRouteTable_rowreq_ctx* )rowreq_ctx );
 }
 
 /**
@@ -239,8 +312,6 @@ void inetCidrRouteTable_container_shutdown( Container_Container* container_ptr )
  */
 int inetCidrRouteTable_container_load( Container_Container* container )
 {
-    Container_Container* route_container;
-
     DEBUG_MSGTL( ( "verbose:inetCidrRouteTable:inetCidrRouteTable_container_load", "called\n" ) );
 
     /*
@@ -249,29 +320,15 @@ int inetCidrRouteTable_container_load( Container_Container* container )
      * set the index(es) [and data, optionally] and insert into
      * the container.
      *
-     * we use the netsnmp data access api to get the data
-     */
-    route_container = netsnmp_access_route_container_load( NULL,
-        NETSNMP_ACCESS_ROUTE_LOAD_NOFLAGS );
-    DEBUG_MSGT( ( "verbose:inetCidrRouteTable:inetCidrRouteTable_cache_load",
-        "%d records\n", ( int )CONTAINER_SIZE( route_container ) ) );
-
-    if ( NULL == route_container )
-        return MFD_RESOURCE_UNAVAILABLE; /* msg already logged */
-
-    /*
-     * we just got a fresh copy of route data. snarf data
-     */
-    CONTAINER_FOR_EACH( route_container,
-        ( Container_FuncObjFunc* )_snarf_route_entry,
-        container );
-
-    /*
-     * free the container. we've either claimed each ifentry, or released it,
-     * so the dal function doesn't need to clear the container.
+     * we use the netsnmp data access api to get the data, straight
+     * into the compact route container: rows are built on demand.
      */
-    netsnmp_access_route_container_free( route_container,
-        NETSNMP_ACCESS_ROUTE_FREE_DONT_CLEAR );
+    if ( netsnmp_access_route_compact_container_load( container,
+             NETSNMP_ACCESS_ROUTE_LOAD_NOFLAGS )
+        < 0 ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "could not load the inetCidrRoute cache\n" );
+        return MFD_RESOURCE_UNAVAILABLE;
+    }
 
     DEBUG_MSGT( ( "verbose:inetCidrRouteTable:inetCidrRouteTable_cache_load",
         "%d records\n", ( int )CONTAINER_SIZE( container ) ) );
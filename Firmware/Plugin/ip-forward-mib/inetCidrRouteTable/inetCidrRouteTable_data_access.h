@@ -44,6 +44,12 @@
      */
 #define INETCIDRROUTETABLE_CACHE_TIMEOUT   60
 
+    /*
+     * cache timeout while rtnetlink route notifications keep the
+     * routes up to date; the timer is only a safety net then.
+     */
+#define INETCIDRROUTETABLE_EVENTS_CACHE_TIMEOUT   600
+
     void            inetCidrRouteTable_container_init(Container_Container
                                                       **container_ptr_ptr,
                                                       Cache *
@@ -12,10 +12,16 @@
 #include "System/Util/Assert.h"
 #include "System/Util/Trace.h"
 #include "System/Util/Logger.h"
+#include "utilities/rtnl_events.h"
 #include "ipCidrRouteTable_constants.h"
 #include "ipCidrRouteTable_interface.h"
 #include "siglog/agent/mfd.h"
 
+static netsnmp_route_index_f _route_index_get;
+static netsnmp_route_row_f _route_row_get;
+static netsnmp_rtnl_event_f _route_event;
+static void _route_row_free( void* rowreq_ctx, void* context );
+
 /** @ingroup interface 
  * @addtogroup data_access data_access: Routines to access data
  *
@@ -108,8 +114,13 @@ void ipCidrRouteTable_container_init( Container_Container** container_ptr_ptr,
     /*
      * For advanced users, you can use a custom container. If you
      * do not create one, one will be created for you.
+     *
+     * the rows are served from a compact copy of the routing table,
+     * and only built for the routes requests look at. the destination
+     * and mask are the first 8 sub-identifiers of the index.
      */
-    *container_ptr_ptr = NULL;
+    *container_ptr_ptr = netsnmp_access_route_compact_container_create( 8,
+        _route_index_get, _route_row_get, _route_row_free, 0 );
 
     if ( NULL == cache ) {
         Logger_log( LOGGER_PRIORITY_ERR,
@@ -126,42 +137,100 @@ void ipCidrRouteTable_container_init( Container_Container** container_ptr_ptr,
      * cache->enabled to 0.
      */
     cache->timeout = IPCIDRROUTETABLE_CACHE_TIMEOUT; /* seconds */
+
+    /*
+     * apply the route changes the kernel announces to the loaded
+     * routes instead of polling for them.
+     */
+    if ( netsnmp_rtnl_events_register( RTMGRP_IPV4_ROUTE, _route_event, cache )
+        == 0 )
+        cache->timeout = IPCIDRROUTETABLE_EVENTS_CACHE_TIMEOUT;
 } /* ipCidrRouteTable_container_init */
 
 /**
- * check entry for update
- *
+ * @internal
+ * a route was added or removed. only a lost notification (msg is NULL)
+ * or a change which cannot be applied costs a full reload.
  */
 static void
-_snarf_route_entry( netsnmp_route_entry* route_entry,
-    Container_Container* container )
+_route_event( const struct nlmsghdr* msg, void* context )
+{
+    Cache* cache = ( Cache* )context;
+
+    if ( !cache->valid || NULL == cache->magic )
+        return;
+
+    if ( NULL == msg
+        || netsnmp_access_route_compact_container_update(
+               ( Container_Container* )cache->magic, msg )
+            < 0 ) {
+        DEBUG_MSGTL( ( "ipCidrRouteTable:events", "reloading\n" ) );
+        CacheHandler_invalidate( cache );
+    }
+}
+
+/**
+ * index of a route, as ipCidrRouteTable_index_to_oid() encodes it.
+ * the compact route container asks for it at every step of a lookup,
+ * so it is built directly rather than through varbinds.
+ */
+static int
+_route_index_get( const netsnmp_route_entry* route_entry, Types_Index* index )
+{
+    const u_char* mask = ( const u_char* )&route_entry->rt_mask;
+    size_t i;
+
+    if ( index->len < 13 || 4 != route_entry->rt_dest_len
+        || 4 != route_entry->rt_nexthop_len )
+        return MFD_ERROR;
+
+    for ( i = 0; i < 4; ++i ) {
+        index->oids[ i ] = route_entry->rt_dest[ i ];
+        index->oids[ 4 + i ] = mask[ i ];
+        index->oids[ 9 + i ] = route_entry->rt_nexthop[ i ];
+    }
+    index->oids[ 8 ] = route_entry->rt_tos;
+    index->len = 13;
+
+    return MFD_SUCCESS;
+}
+
+/**
+ * build the row for a route the agent is looking at
+ */
+static void*
+_route_row_get( netsnmp_route_entry* route_entry )
 {
     ipCidrRouteTable_rowreq_ctx* rowreq_ctx;
 
     DEBUG_TRACE;
 
     Assert_assert( NULL != route_entry );
-    Assert_assert( NULL != container );
 
     /*
-     * allocate an row context and set the index(es), then add it to
-     * the container
+     * allocate an row context and set the index(es)
      */
     rowreq_ctx = ipCidrRouteTable_allocate_rowreq_ctx( route_entry, NULL );
     if ( ( NULL != rowreq_ctx ) && ( MFD_SUCCESS == ipCidrRouteTable_indexes_set( rowreq_ctx, *( ( in_addr_t* )route_entry->rt_dest ),
                                                         route_entry->rt_mask, route_entry->rt_tos,
                                                         *( ( in_addr_t* )route_entry->rt_nexthop ) ) ) ) {
-
-        CONTAINER_INSERT( container, rowreq_ctx );
         rowreq_ctx->ipCidrRouteStatus = ROWSTATUS_ACTIVE;
-    } else {
-        if ( rowreq_ctx ) {
-            Logger_log( LOGGER_PRIORITY_ERR, "error setting index while loading "
-                                             "ipCidrRoute cache.\n" );
-            ipCidrRouteTable_release_rowreq_ctx( rowreq_ctx );
-        } else
-            netsnmp_access_route_entry_free( route_entry );
+        return rowreq_ctx;
     }
+
+    if ( rowreq_ctx ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "error setting index while loading "
+                                         "ipCidrRoute cache.\n" );
+        ipCidrRouteTable_release_rowreq_ctx( rowreq_ctx );
+    } else
+        netsnmp_access_route_entry_free( route_entry );
+    return NULL;
+}
+
+static void
+_route_row_free( void* rowreq_ctx, void* context )
+{
+    ipCidrRouteTable_release_rowreq_ctx( ( ipCidrRouteTable_rowreq_ctx* )rowreq_ctx );
 }
 
 /**
@@ -227,8 +296,6 @@ void ipCidrRouteTable_container_shutdown( Container_Container* container_ptr )
  */
 int ipCidrRouteTable_container_load( Container_Container* container )
 {
-    Container_Container* route_container;
-
     DEBUG_MSGTL( ( "verbose:ipCidrRouteTable:ipCidrRouteTable_cache_load",
         "called\n" ) );
 
@@ -237,26 +304,16 @@ int ipCidrRouteTable_container_load( Container_Container* container )
      * loop over your ipCidrRouteTable data, allocate a rowreq context,
      * set the index(es) [and data, optionally] and insert into
      * the container.
+     *
+     * the routes go straight into the compact route container: rows
+     * are built on demand.
      */
-    route_container = netsnmp_access_route_container_load( NULL,
-        NETSNMP_ACCESS_ROUTE_LOAD_IPV4_ONLY );
-
-    if ( NULL == route_container )
-        return MFD_RESOURCE_UNAVAILABLE; /* msg already logged */
-
-    /*
-     * we just got a fresh copy of route data. snarf data
-     */
-    CONTAINER_FOR_EACH( route_container,
-        ( Container_FuncObjFunc* )_snarf_route_entry,
-        container );
-
-    /*
-     * free the container. we've either claimed each ifentry, or released it,
-     * so the dal function doesn't need to clear the container.
-     */
-    netsnmp_access_route_container_free( route_container,
-        NETSNMP_ACCESS_ROUTE_FREE_DONT_CLEAR );
+    if ( netsnmp_access_route_compact_container_load( container,
+             NETSNMP_ACCESS_ROUTE_LOAD_IPV4_ONLY )
+        < 0 ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "could not load the ipCidrRoute cache\n" );
+        return MFD_RESOURCE_UNAVAILABLE;
+    }
 
     DEBUG_MSGT( ( "verbose:ipCidrRouteTable:ipCidrRouteTable_cache_load",
         "%d records\n", ( int )CONTAINER_SIZE( container ) ) );
@@ -45,6 +45,12 @@
      */
 #define IPCIDRROUTETABLE_CACHE_TIMEOUT   60
 
+    /*
+     * cache timeout while rtnetlink route notifications keep the
+     * routes up to date; the timer is only a safety net then.
+     */
+#define IPCIDRROUTETABLE_EVENTS_CACHE_TIMEOUT   600
+
     void            ipCidrRouteTable_container_init(Container_Container
                                                     **container_ptr_ptr,
                                                     Cache * cache);
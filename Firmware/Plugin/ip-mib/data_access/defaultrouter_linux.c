@@ -23,6 +23,8 @@
  * local static prototypes
  */
 static int _load( Container_Container* container );
+static int _entry_from_rtmsg( const struct nlmsghdr* nlmhp,
+    netsnmp_defaultrouter_entry** entry_ptr );
 
 /*
  * initialize arch specific storage
@@ -88,7 +90,6 @@ _load( Container_Container* container )
     struct rtmsg* rthdr;
     int count;
     int end_of_message = 0;
-    long hz = sysconf( _SC_CLK_TCK );
 
     Assert_assert( NULL != container );
 
@@ -141,11 +142,7 @@ _load( Container_Container* container )
      */
     do {
         struct nlmsghdr* nlmhp;
-        struct rtmsg* rtmp;
-        struct rtattr* rtap;
-        struct rta_cacheinfo* rtci;
         socklen_t sock_len;
-        int rtcount;
 
         memset( rcvbuf, '\0', RCVBUF_SIZE );
         sock_len = sizeof( struct sockaddr_nl );
@@ -167,13 +164,6 @@ _load( Container_Container* container )
          */
         nlmhp = &rcvbuf_union.hdr;
         while ( NLMSG_OK( nlmhp, count ) ) {
-            u_char addresstype;
-            char address[ NETSNMP_ACCESS_DEFAULTROUTER_BUF_SIZE + 1 ];
-            size_t address_len = 0;
-            int if_index = -1;
-            u_long lifetime = 0;
-            int preference = -3;
-
             /*
              * Make sure the message is ok
              */
@@ -191,81 +181,11 @@ _load( Container_Container* container )
                 break;
             }
 
-            /*
-             * Get the pointer to the rtmsg struct
-             */
-            rtmp = ( struct rtmsg* )NLMSG_DATA( nlmhp );
-
-            /*
-             * zero length destination is a default route
-             */
-            if ( rtmp->rtm_dst_len != 0 )
-                goto next_nlmsghdr;
-
-            /*
-             * Start scanning the attributes for needed info
-             */
-            if ( rtmp->rtm_family == AF_INET ) {
-                addresstype = INETADDRESSTYPE_IPV4;
-                lifetime = IPDEFAULTROUTERLIFETIME_MAX; /* infinity */
-            }
-
-            else
-                goto next_nlmsghdr; /* skip, we don't care about this route */
-
-            preference = 0; /* preference is medium(0) for now */
-
-            rtap = RTM_RTA( rtmp );
-            rtcount = RTM_PAYLOAD( nlmhp );
-            while ( RTA_OK( rtap, rtcount ) ) {
-                switch ( rtap->rta_type ) {
-                case RTA_OIF:
-                    if_index = *( int* )( RTA_DATA( rtap ) );
-                    break;
-
-                case RTA_GATEWAY:
-                    address_len = RTA_PAYLOAD( rtap );
-                    memset( address, '\0', sizeof( address ) );
-                    memcpy( address, RTA_DATA( rtap ), address_len );
-                    break;
-
-                default:
-                    break;
-                } /* switch */
-
-                rtap = RTA_NEXT( rtap, rtcount );
-            } /* while RTA_OK(rtap) */
-
-            if ( address_len != 0 && if_index != -1 && lifetime != 0 && preference != -3 ) {
-                DEBUG_IF( "access:defaultrouter" )
-                {
-                    char addr_str[ DR_ADDRSTRLEN ];
-                    memset( addr_str, '\0', DR_ADDRSTRLEN );
-
-                    if ( rtmp->rtm_family == AF_INET )
-                        inet_ntop( AF_INET, address, addr_str, DR_ADDRSTRLEN );
-
-                    DEBUG_MSGTL( ( "access:defaultrouter",
-                        "found default route: %s if_index %d "
-                        "lifetime %lu preference %d\n",
-                        addr_str, if_index, lifetime, preference ) );
-                }
-
-                entry = netsnmp_access_defaultrouter_entry_create();
-                if ( NULL == entry ) {
-                    rc = -3;
-                    break;
-                }
-
+            rc = _entry_from_rtmsg( nlmhp, &entry );
+            if ( rc < 0 )
+                break;
+            if ( NULL != entry ) {
                 entry->ns_dr_index = ++idx_offset;
-                entry->dr_addresstype = addresstype;
-                entry->dr_address_len = address_len;
-                memcpy( entry->dr_address, address,
-                    NETSNMP_ACCESS_DEFAULTROUTER_BUF_SIZE );
-                entry->dr_if_index = if_index;
-                entry->dr_lifetime = lifetime;
-                entry->dr_preference = preference;
-
                 if ( CONTAINER_INSERT( container, entry ) < 0 ) {
                     DEBUG_MSGTL( ( "access:arp:container",
                         "error with defaultrouter_entry: "
@@ -274,7 +194,6 @@ _load( Container_Container* container )
                 }
             }
 
-        next_nlmsghdr:
             nlmhp = NLMSG_NEXT( nlmhp, count );
         } /* while NLMSG_OK(nlmhp) */
 
@@ -286,3 +205,128 @@ _load( Container_Container* container )
     close( nlsk );
     return rc;
 }
+
+/**
+ * @internal
+ * build the entry of a default route from one route message
+ *
+ * @retval  0 success (*entry_ptr is NULL if it is not a default route)
+ * @retval <0 error
+ */
+static int
+_entry_from_rtmsg( const struct nlmsghdr* nlmhp,
+    netsnmp_defaultrouter_entry** entry_ptr )
+{
+    struct rtmsg* rtmp;
+    struct rtattr* rtap;
+    int rtcount;
+    netsnmp_defaultrouter_entry* entry;
+    u_char addresstype;
+    char address[ NETSNMP_ACCESS_DEFAULTROUTER_BUF_SIZE + 1 ];
+    size_t address_len = 0;
+    int if_index = -1;
+    u_long lifetime = 0;
+    int preference = -3;
+
+    *entry_ptr = NULL;
+    if ( nlmhp->nlmsg_len < NLMSG_LENGTH( sizeof( struct rtmsg ) ) )
+        return 0;
+
+    /*
+     * Get the pointer to the rtmsg struct
+     */
+    rtmp = ( struct rtmsg* )NLMSG_DATA( nlmhp );
+
+    /*
+     * zero length destination is a default route
+     */
+    if ( rtmp->rtm_dst_len != 0 )
+        return 0;
+
+    /*
+     * Start scanning the attributes for needed info
+     */
+    if ( rtmp->rtm_family == AF_INET ) {
+        addresstype = INETADDRESSTYPE_IPV4;
+        lifetime = IPDEFAULTROUTERLIFETIME_MAX; /* infinity */
+    }
+
+    else
+        return 0; /* skip, we don't care about this route */
+
+    preference = 0; /* preference is medium(0) for now */
+
+    rtap = RTM_RTA( rtmp );
+    rtcount = RTM_PAYLOAD( nlmhp );
+    while ( RTA_OK( rtap, rtcount ) ) {
+        switch ( rtap->rta_type ) {
+        case RTA_OIF:
+            if_index = *( int* )( RTA_DATA( rtap ) );
+            break;
+
+        case RTA_GATEWAY:
+            address_len = RTA_PAYLOAD( rtap );
+            if ( address_len > NETSNMP_ACCESS_DEFAULTROUTER_BUF_SIZE )
+                address_len = NETSNMP_ACCESS_DEFAULTROUTER_BUF_SIZE;
+            memset( address, '\0', sizeof( address ) );
+            memcpy( address, RTA_DATA( rtap ), address_len );
+            break;
+
+        default:
+            break;
+        } /* switch */
+
+        rtap = RTA_NEXT( rtap, rtcount );
+    } /* while RTA_OK(rtap) */
+
+    if ( address_len == 0 || if_index == -1 || lifetime == 0 || preference == -3 )
+        return 0;
+
+    DEBUG_IF( "access:defaultrouter" )
+    {
+        char addr_str[ DR_ADDRSTRLEN ];
+        memset( addr_str, '\0', DR_ADDRSTRLEN );
+
+        if ( rtmp->rtm_family == AF_INET )
+            inet_ntop( AF_INET, address, addr_str, DR_ADDRSTRLEN );
+
+        DEBUG_MSGTL( ( "access:defaultrouter",
+            "found default route: %s if_index %d "
+            "lifetime %lu preference %d\n",
+            addr_str, if_index, lifetime, preference ) );
+    }
+
+    entry = netsnmp_access_defaultrouter_entry_create();
+    if ( NULL == entry )
+        return -3;
+
+    entry->dr_addresstype = addresstype;
+    entry->dr_address_len = address_len;
+    memcpy( entry->dr_address, address,
+        NETSNMP_ACCESS_DEFAULTROUTER_BUF_SIZE );
+    entry->dr_if_index = if_index;
+    entry->dr_lifetime = lifetime;
+    entry->dr_preference = preference;
+
+    *entry_ptr = entry;
+    return 0;
+}
+
+/**
+ * build the entry of the default route an RTM_NEWROUTE or RTM_DELROUTE
+ * notification is about
+ *
+ * @retval  0 success (*entry is NULL if it is not about a default route)
+ * @retval <0 error
+ */
+int netsnmp_access_defaultrouter_entry_from_rtnl( const struct nlmsghdr* msg,
+    netsnmp_defaultrouter_entry** entry )
+{
+    if ( NULL == msg || NULL == entry )
+        return -1;
+    *entry = NULL;
+    if ( RTM_NEWROUTE != msg->nlmsg_type && RTM_DELROUTE != msg->nlmsg_type )
+        return 0;
+
+    return _entry_from_rtmsg( msg, entry );
+}
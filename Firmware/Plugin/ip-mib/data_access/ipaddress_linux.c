@@ -9,6 +9,9 @@
 #include "System/Util/Trace.h"
 #include "ipaddress_ioctl.h"
 #include "siglog/data_access/ipaddress.h"
+#include "ip-mib/ipAddressTable/ipAddressTable_constants.h"
+#include <linux/rtnetlink.h>
+#include <sys/ioctl.h>
 
 int _load_v6( Container_Container* container, int idx_offset );
 int netsnmp_access_ipaddress_extra_prefix_info( int index,
@@ -139,3 +142,90 @@ int netsnmp_arch_ipaddress_container_load( Container_Container* container,
 
     return rc;
 }
+
+/**
+ * build the entry of the address an RTM_NEWADDR or RTM_DELADDR
+ * notification is about, the way the ioctl loader would have.
+ *
+ * @retval  0 success (*entry is NULL if the table does not show it)
+ * @retval <0 error
+ */
+int netsnmp_access_ipaddress_entry_from_rtnl( const struct nlmsghdr* msg,
+    netsnmp_ipaddress_entry** entry_ptr )
+{
+    struct ifaddrmsg* ifa;
+    struct rtattr *rta, *local = NULL, *address = NULL, *label = NULL;
+    netsnmp_ipaddress_entry* entry;
+    _ioctl_extras* extras;
+    struct ifreq ifr;
+    in_addr_t ipval;
+    int len, sd;
+
+    if ( NULL == msg || NULL == entry_ptr )
+        return -1;
+    *entry_ptr = NULL;
+
+    if ( ( RTM_NEWADDR != msg->nlmsg_type && RTM_DELADDR != msg->nlmsg_type )
+        || msg->nlmsg_len < NLMSG_LENGTH( sizeof( *ifa ) ) )
+        return 0;
+    ifa = ( struct ifaddrmsg* )NLMSG_DATA( msg );
+
+    /** the ioctl loader only knows ipv4 addresses */
+    if ( AF_INET != ifa->ifa_family )
+        return 0;
+
+    len = IFA_PAYLOAD( msg );
+    for ( rta = IFA_RTA( ifa ); RTA_OK( rta, len ); rta = RTA_NEXT( rta, len ) ) {
+        if ( IFA_LOCAL == rta->rta_type )
+            local = rta;
+        else if ( IFA_ADDRESS == rta->rta_type )
+            address = rta;
+        else if ( IFA_LABEL == rta->rta_type )
+            label = rta;
+    }
+    /** IFA_ADDRESS is the peer of point to point links */
+    if ( NULL != local )
+        address = local;
+    if ( NULL == address || RTA_PAYLOAD( address ) < sizeof( ipval ) )
+        return 0;
+    memcpy( &ipval, RTA_DATA( address ), sizeof( ipval ) );
+
+    entry = netsnmp_access_ipaddress_entry_create();
+    if ( NULL == entry )
+        return -3;
+
+    entry->ia_address_len = sizeof( ipval );
+    memcpy( entry->ia_address, &ipval, sizeof( ipval ) );
+    entry->if_index = ifa->ifa_index;
+    entry->ia_prefix_len = ifa->ifa_prefixlen;
+    entry->ia_type = IPADDRESSTYPE_UNICAST;
+    entry->ia_status = IPADDRESSSTATUSTC_PREFERRED;
+    entry->ia_origin = IS_APIPA( ipval ) ? IPADDRESSORIGINTC_RANDOM
+                                         : IPADDRESSORIGINTC_MANUAL;
+
+    extras = netsnmp_ioctl_ipaddress_extras_get( entry );
+    if ( NULL != extras && NULL != label ) {
+        len = RTA_PAYLOAD( label );
+        if ( len > ( int )sizeof( extras->name ) )
+            len = sizeof( extras->name );
+        memcpy( extras->name, RTA_DATA( label ), len );
+        extras->name[ sizeof( extras->name ) - 1 ] = 0;
+        if ( NULL != strchr( ( char* )extras->name, ':' ) )
+            entry->flags |= NETSNMP_ACCESS_IPADDRESS_ISALIAS;
+
+        /*
+         * the interface flags, as SIOCGIFFLAGS reports them to the loader
+         */
+        if ( RTM_NEWADDR == msg->nlmsg_type
+            && ( sd = socket( AF_INET, SOCK_DGRAM, 0 ) ) >= 0 ) {
+            memset( &ifr, 0, sizeof( ifr ) );
+            memcpy( ifr.ifr_name, extras->name, sizeof( ifr.ifr_name ) );
+            if ( ioctl( sd, SIOCGIFFLAGS, &ifr ) == 0 )
+                extras->flags = ifr.ifr_flags;
+            close( sd );
+        }
+    }
+
+    *entry_ptr = entry;
+    return 0;
+}
@@ -12,10 +12,16 @@
 #include "System/Util/Assert.h"
 #include "System/Util/Trace.h"
 #include "System/Util/Logger.h"
+#include "utilities/rtnl_events.h"
 #include "ipAddressTable_constants.h"
 #include "ipAddressTable_interface.h"
 #include "siglog/agent/mfd.h"
 
+static netsnmp_rtnl_event_f _address_event;
+static void
+_add_new_entry( netsnmp_ipaddress_entry* ipaddress_entry,
+    Container_Container* container );
+
 /** @ingroup interface 
  * @addtogroup data_access data_access: Routines to access data
  *
@@ -152,8 +158,66 @@ void ipAddressTable_container_init( Container_Container** container_ptr_ptr,
     cache->flags |= ( CacheOperation_DONT_AUTO_RELEASE | CacheOperation_DONT_FREE_EXPIRED
         | CacheOperation_DONT_FREE_BEFORE_LOAD | CacheOperation_AUTO_RELOAD
         | CacheOperation_DONT_INVALIDATE_ON_SET );
+
+    /*
+     * apply the address changes the kernel announces instead of
+     * polling for them.
+     */
+    if ( netsnmp_rtnl_events_register( RTMGRP_IPV4_IFADDR, _address_event, cache )
+        == 0 )
+        cache->timeout = IPADDRESSTABLE_EVENTS_CACHE_TIMEOUT;
 } /* ipAddressTable_container_init */
 
+/**
+ * @internal
+ * an address was added, changed or removed: update its row the way a
+ * reload would. only lost notifications (msg is NULL) cost a full
+ * reload.
+ */
+static void
+_address_event( const struct nlmsghdr* msg, void* context )
+{
+    Cache* cache = ( Cache* )context;
+    Container_Container* container = ( Container_Container* )cache->magic;
+    netsnmp_ipaddress_entry* entry;
+    ipAddressTable_rowreq_ctx* rowreq_ctx;
+    ipAddressTable_mib_index mib_idx;
+
+    if ( !cache->valid || NULL == container )
+        return;
+
+    if ( NULL == msg
+        || netsnmp_access_ipaddress_entry_from_rtnl( msg, &entry ) < 0 ) {
+        CacheHandler_invalidate( cache );
+        return;
+    }
+    if ( NULL == entry )
+        return;
+
+    if ( MFD_SUCCESS != ipAddressTable_indexes_set_tbl_idx( &mib_idx,
+                            entry->ia_address_len, entry->ia_address,
+                            entry->ia_address_len ) ) {
+        netsnmp_access_ipaddress_entry_free( entry );
+        return;
+    }
+    rowreq_ctx = ipAddressTable_row_find_by_mib_index( &mib_idx );
+
+    if ( RTM_DELADDR == msg->nlmsg_type ) {
+        netsnmp_access_ipaddress_entry_free( entry );
+        if ( NULL != rowreq_ctx ) {
+            DEBUG_MSGTL( ( "ipAddressTable:access", "removing entry\n" ) );
+            CONTAINER_REMOVE( container, rowreq_ctx );
+            ipAddressTable_release_rowreq_ctx( rowreq_ctx );
+        }
+    } else if ( NULL != rowreq_ctx ) {
+        DEBUG_MSGTL( ( "ipAddressTable:access", "updating existing entry\n" ) );
+        if ( netsnmp_access_ipaddress_entry_update( rowreq_ctx->data, entry ) > 0 )
+            rowreq_ctx->ipAddressLastChanged = Agent_getAgentUptime();
+        netsnmp_access_ipaddress_entry_free( entry );
+    } else
+        _add_new_entry( entry, container );
+}
+
 /**
  * container shutdown
  *
@@ -44,6 +44,12 @@
      */
 #define IPADDRESSTABLE_CACHE_TIMEOUT   60
 
+    /*
+     * cache timeout while rtnetlink address notifications trigger the
+     * reloads; the timer is only a safety net then.
+     */
+#define IPADDRESSTABLE_EVENTS_CACHE_TIMEOUT   600
+
     void            ipAddressTable_container_init(Container_Container
                                                   **container_ptr_ptr,
                                                   Cache * cache);
@@ -15,11 +15,17 @@
 #include "System/Util/Assert.h"
 #include "System/Util/Trace.h"
 #include "System/Util/Logger.h"
+#include "utilities/rtnl_events.h"
 #include "ipDefaultRouterTable_data_access.h"
 #include "ipDefaultRouterTable_data_get.h"
 #include "ipDefaultRouterTable_interface.h"
 #include "siglog/agent/mfd.h"
 
+static netsnmp_rtnl_event_f _route_event;
+static void
+_add_new_entry( netsnmp_defaultrouter_entry* defaultrouter_entry,
+    Container_Container* container );
+
 /** @ingroup interface
  * @addtogroup data_access data_access: Routines to access data
  *
@@ -128,8 +134,71 @@ void ipDefaultRouterTable_container_init( Container_Container** container_ptr_pt
      * cache->enabled to 0.
      */
     cache->timeout = IPDEFAULTROUTERTABLE_CACHE_TIMEOUT; /* seconds */
+
+    /*
+     * apply the default route changes the kernel announces instead of
+     * polling for them.
+     */
+    if ( netsnmp_rtnl_events_register( RTMGRP_IPV4_ROUTE, _route_event, cache )
+        == 0 )
+        cache->timeout = IPDEFAULTROUTERTABLE_EVENTS_CACHE_TIMEOUT;
 } /* ipDefaultRouterTable_container_init */
 
+/**
+ * @internal
+ * a route was added or removed: add or remove its row if it is a
+ * default route. lost notifications (msg is NULL) cost a full reload,
+ * and so does a replaced route, since the rows do not say which one
+ * (of the same metric) it replaced.
+ */
+static void
+_route_event( const struct nlmsghdr* msg, void* context )
+{
+    Cache* cache = ( Cache* )context;
+    Container_Container* container = ( Container_Container* )cache->magic;
+    netsnmp_defaultrouter_entry* entry;
+    ipDefaultRouterTable_rowreq_ctx* rowreq_ctx;
+    ipDefaultRouterTable_mib_index mib_idx;
+
+    if ( !cache->valid || NULL == container )
+        return;
+
+    if ( NULL == msg
+        || netsnmp_access_defaultrouter_entry_from_rtnl( msg, &entry ) < 0 ) {
+        CacheHandler_invalidate( cache );
+        return;
+    }
+    if ( NULL == entry )
+        return;
+    if ( RTM_NEWROUTE == msg->nlmsg_type && ( msg->nlmsg_flags & NLM_F_REPLACE ) ) {
+        netsnmp_access_defaultrouter_entry_free( entry );
+        CacheHandler_invalidate( cache );
+        return;
+    }
+
+    if ( MFD_SUCCESS != ipDefaultRouterTable_indexes_set_tbl_idx( &mib_idx,
+                            entry->dr_addresstype, entry->dr_address,
+                            entry->dr_address_len, entry->dr_if_index ) ) {
+        netsnmp_access_defaultrouter_entry_free( entry );
+        return;
+    }
+    rowreq_ctx = ipDefaultRouterTable_row_find_by_mib_index( &mib_idx );
+
+    if ( RTM_DELROUTE == msg->nlmsg_type ) {
+        netsnmp_access_defaultrouter_entry_free( entry );
+        if ( NULL != rowreq_ctx ) {
+            DEBUG_MSGTL( ( "ipDefaultRouterTable:access", "removing entry\n" ) );
+            CONTAINER_REMOVE( container, rowreq_ctx );
+            ipDefaultRouterTable_release_rowreq_ctx( rowreq_ctx );
+        }
+    } else if ( NULL != rowreq_ctx ) {
+        DEBUG_MSGTL( ( "ipDefaultRouterTable:access", "updating existing entry\n" ) );
+        netsnmp_access_defaultrouter_entry_update( rowreq_ctx->data, entry );
+        netsnmp_access_defaultrouter_entry_free( entry );
+    } else
+        _add_new_entry( entry, container );
+}
+
 /**
  * container shutdown
  *
@@ -45,6 +45,12 @@
      */
 #define IPDEFAULTROUTERTABLE_CACHE_TIMEOUT   60
 
+    /*
+     * cache timeout while rtnetlink route notifications trigger the
+     * reloads; the timer is only a safety net then.
+     */
+#define IPDEFAULTROUTERTABLE_EVENTS_CACHE_TIMEOUT   600
+
     void            ipDefaultRouterTable_container_init(Container_Container
                                                         **
                                                         container_ptr_ptr,
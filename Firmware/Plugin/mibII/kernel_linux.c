@@ -4,8 +4,10 @@
  */
 
 #include "kernel_linux.h"
+#include "CacheHandler.h"
 #include "System/Util/Trace.h"
 #include "System/String.h"
+#include "System/Util/ProcFile.h"
 #include <errno.h>
 #include <string.h>
 #include <sys/param.h>
@@ -20,186 +22,145 @@ struct tcp_mib cached_tcp_mib;
 struct udp_mib cached_udp_mib;
 struct udp6_mib cached_udp6_mib;
 
-#define IP_STATS_LINE "Ip: %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu"
-#define ICMP_STATS_LINE "Icmp: %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu"
-#define ICMP_MSG_STATS_LINE "IcmpMsg: "
-#define TCP_STATS_LINE "Tcp: %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu"
-#define UDP_STATS_LINE "Udp: %lu %lu %lu %lu"
-#define IP6_STATS_LINE "Ip6"
-#define ICMP6_STATS_LINE "Icmp6"
-#define UDP6_STATS_LINE "Udp6"
-
-#define IP_STATS_PREFIX_LEN 4
-#define ICMP_STATS_PREFIX_LEN 6
-#define ICMP_MSG_STATS_PREFIX_LEN 9
-#define TCP_STATS_PREFIX_LEN 5
-#define UDP_STATS_PREFIX_LEN 5
-#define IP6_STATS_PREFIX_LEN 3
-#define ICMP6_STATS_PREFIX_LEN 5
-#define UDP6_STATS_PREFIX_LEN 4
-
-static int decode_icmp_msg( char* line, char* data, struct icmp4_msg_mib* msg )
-{
-    char *token, *saveptr, *lineptr, *saveptr1, *dataptr, *delim = NULL;
-    char line_cpy[ 1024 ];
-    char data_cpy[ 1024 ];
-    long index;
+#define NET_SNMP_FILE "/proc/net/snmp"
 
-    if ( data == NULL )
-        return -1;
+/*
+ * The mib structures list their counters in the order of the kernel's
+ * columns, so column i of a table below lands in counter i.  The
+ * columns are matched by name, so counters added by newer kernels
+ * (e.g. Icmp InCsumErrors) don't shift the others.
+ */
+static const char* const _ip_columns[] = {
+    "Forwarding", "DefaultTTL", "InReceives", "InHdrErrors",
+    "InAddrErrors", "ForwDatagrams", "InUnknownProtos", "InDiscards",
+    "InDelivers", "OutRequests", "OutDiscards", "OutNoRoutes",
+    "ReasmTimeout", "ReasmReqds", "ReasmOKs", "ReasmFails", "FragOKs",
+    "FragFails", "FragCreates"
+};
+static const char* const _icmp_columns[] = {
+    "InMsgs", "InErrors", "InDestUnreachs", "InTimeExcds", "InParmProbs",
+    "InSrcQuenchs", "InRedirects", "InEchos", "InEchoReps", "InTimestamps",
+    "InTimestampReps", "InAddrMasks", "InAddrMaskReps", "OutMsgs",
+    "OutErrors", "OutDestUnreachs", "OutTimeExcds", "OutParmProbs",
+    "OutSrcQuenchs", "OutRedirects", "OutEchos", "OutEchoReps",
+    "OutTimestamps", "OutTimestampReps", "OutAddrMasks", "OutAddrMaskReps"
+};
+static const char* const _tcp_columns[] = {
+    "RtoAlgorithm", "RtoMin", "RtoMax", "MaxConn", "ActiveOpens",
+    "PassiveOpens", "AttemptFails", "EstabResets", "CurrEstab", "InSegs",
+    "OutSegs", "RetransSegs", "InErrs", "OutRsts"
+};
+static const char* const _udp_columns[] = {
+    "InDatagrams", "NoPorts", "InErrors", "OutDatagrams"
+};
+
+#define _COLUMNS( a ) ( a ), ( int )( sizeof( a ) / sizeof( ( a )[ 0 ] ) )
 
-    /*
-     * Since we are using strtok, there is a possiblity of the orginal data
-     * getting modified. So we take a local copy for this purpose even though
-     * its expensive.
-     */
-    String_copyTruncate( line_cpy, line, sizeof( line_cpy ) );
-    String_copyTruncate( data_cpy, data, sizeof( data_cpy ) );
-
-    lineptr = line_cpy;
-    dataptr = data_cpy;
-    saveptr1 = NULL;
-    while ( 1 ) {
-        if ( NULL == ( token = strtok_r( lineptr, " ", &saveptr ) ) )
-            break;
-        lineptr = NULL;
-        errno = 0;
-        if ( 0 == strncmp( strsep( &token, "e" ), "OutTyp", 6 ) ) {
-            index = strtol( token, &delim, 0 );
-            if ( ERANGE == errno ) {
-                continue;
-            } else if ( index > 255 ) {
-                continue;
-            } else if ( index < 0 ) {
-                continue;
-            }
-            if ( NULL == ( token = strtok_r( dataptr, " ", &saveptr1 ) ) )
-                break;
-            dataptr = NULL;
-            msg->vals[ index ].OutType = atoi( token );
-        } else {
-            index = strtol( token, &delim, 0 );
-            if ( ERANGE == errno ) {
-                continue;
-            } else if ( index > 255 ) {
-                continue;
-            } else if ( index < 0 ) {
-                continue;
-            }
-            if ( NULL == ( token = strtok_r( dataptr, " ", &saveptr1 ) ) )
-                break;
-            dataptr = NULL;
-            msg->vals[ index ].InType = atoi( token );
-        }
-    }
-    return 0;
+static int
+_read_columns( const ProcFile* file, const char* prefix,
+    const char* const* names, int count, unsigned long* counters,
+    uint64_t* found )
+{
+    unsigned long long values[ 32 ];
+    uint64_t mask = 0;
+    int i, n;
+
+    n = ProcFile_headerFields( file, prefix, names, count, values, &mask );
+    for ( i = 0; i < count; i++ )
+        if ( mask & ( ( uint64_t )1 << i ) )
+            counters[ i ] = values[ i ];
+    if ( found )
+        *found = mask;
+    return n;
+}
+
+/*
+ * IcmpMsg has a column per ICMP type seen so far, named InType<n> or
+ * OutType<n>
+ */
+static void
+_icmp_msg_column( const char* name, size_t nameLength,
+    unsigned long long value, void* context )
+{
+    struct icmp4_msg_mib* msg = ( struct icmp4_msg_mib* )context;
+    const char* cp;
+    long index;
+    int out;
+
+    if ( nameLength > 6 && !strncmp( name, "InType", 6 ) ) {
+        cp = name + 6;
+        out = 0;
+    } else if ( nameLength > 7 && !strncmp( name, "OutType", 7 ) ) {
+        cp = name + 7;
+        out = 1;
+    } else
+        return;
+
+    index = strtol( cp, NULL, 10 );
+    if ( index < 0 || index > 255 )
+        return;
+    if ( out )
+        msg->vals[ index ].OutType = value;
+    else
+        msg->vals[ index ].InType = value;
 }
 
 static int
 linux_read_mibII_stats( void )
 {
-    FILE* in = fopen( "/proc/net/snmp", "r" );
-    char line[ 1024 ], data[ 1024 ];
+    static u_int parsed_generation = 0;
+    static int parsed_ret = 0;
+    ProcFile* file = ProcFile_shared( NET_SNMP_FILE );
+    uint64_t found;
     int ret = 0;
-    if ( !in ) {
-        DEBUG_MSGTL( ( "mibII/kernel_linux", "Unable to open /proc/net/snmp" ) );
+
+    /*
+     * the ip, icmp, tcp and udp groups each ask for the file in turn,
+     * and ipSystemStatsTable reads it too: share one read of it per
+     * load generation, and parse each read once
+     */
+    if ( !file || ProcFile_refresh( file, CacheHandler_loadGeneration() ) != ErrorCode_SUCCESS ) {
+        DEBUG_MSGTL( ( "mibII/kernel_linux", "Unable to read " NET_SNMP_FILE "\n" ) );
         return -1;
     }
+    if ( parsed_generation == file->generation )
+        return parsed_ret;
+
+    /*
+     * columns missing from this read must not keep older values
+     */
+    memset( &cached_ip_mib, 0, sizeof( cached_ip_mib ) );
+    memset( &cached_icmp_mib, 0, sizeof( cached_icmp_mib ) );
+    memset( &cached_icmp4_msg_mib, 0, sizeof( cached_icmp4_msg_mib ) );
+    memset( &cached_tcp_mib, 0, sizeof( cached_tcp_mib ) );
+    memset( &cached_udp_mib, 0, sizeof( cached_udp_mib ) );
+
+    _read_columns( file, "Ip", _COLUMNS( _ip_columns ),
+        &cached_ip_mib.ipForwarding, NULL );
+    cached_ip_mib.ipRoutingDiscards = 0; /* XXX */
+
+    _read_columns( file, "Icmp", _COLUMNS( _icmp_columns ),
+        &cached_icmp_mib.icmpInMsgs, NULL );
 
-    memset( line, '\0', sizeof( line ) );
-    memset( data, '\0', sizeof( data ) );
-    while ( line == fgets( line, sizeof( line ), in ) ) {
-        if ( !strncmp( line, IP_STATS_LINE, IP_STATS_PREFIX_LEN ) ) {
-            sscanf( line, IP_STATS_LINE,
-                &cached_ip_mib.ipForwarding,
-                &cached_ip_mib.ipDefaultTTL,
-                &cached_ip_mib.ipInReceives,
-                &cached_ip_mib.ipInHdrErrors,
-                &cached_ip_mib.ipInAddrErrors,
-                &cached_ip_mib.ipForwDatagrams,
-                &cached_ip_mib.ipInUnknownProtos,
-                &cached_ip_mib.ipInDiscards,
-                &cached_ip_mib.ipInDelivers,
-                &cached_ip_mib.ipOutRequests,
-                &cached_ip_mib.ipOutDiscards,
-                &cached_ip_mib.ipOutNoRoutes,
-                &cached_ip_mib.ipReasmTimeout,
-                &cached_ip_mib.ipReasmReqds,
-                &cached_ip_mib.ipReasmOKs,
-                &cached_ip_mib.ipReasmFails,
-                &cached_ip_mib.ipFragOKs,
-                &cached_ip_mib.ipFragFails,
-                &cached_ip_mib.ipFragCreates );
-            cached_ip_mib.ipRoutingDiscards = 0; /* XXX */
-        } else if ( !strncmp( line, ICMP_STATS_LINE, ICMP_STATS_PREFIX_LEN ) ) {
-            sscanf( line, ICMP_STATS_LINE,
-                &cached_icmp_mib.icmpInMsgs,
-                &cached_icmp_mib.icmpInErrors,
-                &cached_icmp_mib.icmpInDestUnreachs,
-                &cached_icmp_mib.icmpInTimeExcds,
-                &cached_icmp_mib.icmpInParmProbs,
-                &cached_icmp_mib.icmpInSrcQuenchs,
-                &cached_icmp_mib.icmpInRedirects,
-                &cached_icmp_mib.icmpInEchos,
-                &cached_icmp_mib.icmpInEchoReps,
-                &cached_icmp_mib.icmpInTimestamps,
-                &cached_icmp_mib.icmpInTimestampReps,
-                &cached_icmp_mib.icmpInAddrMasks,
-                &cached_icmp_mib.icmpInAddrMaskReps,
-                &cached_icmp_mib.icmpOutMsgs,
-                &cached_icmp_mib.icmpOutErrors,
-                &cached_icmp_mib.icmpOutDestUnreachs,
-                &cached_icmp_mib.icmpOutTimeExcds,
-                &cached_icmp_mib.icmpOutParmProbs,
-                &cached_icmp_mib.icmpOutSrcQuenchs,
-                &cached_icmp_mib.icmpOutRedirects,
-                &cached_icmp_mib.icmpOutEchos,
-                &cached_icmp_mib.icmpOutEchoReps,
-                &cached_icmp_mib.icmpOutTimestamps,
-                &cached_icmp_mib.icmpOutTimestampReps,
-                &cached_icmp_mib.icmpOutAddrMasks,
-                &cached_icmp_mib.icmpOutAddrMaskReps );
-        } else if ( !strncmp( line, ICMP_MSG_STATS_LINE, ICMP_MSG_STATS_PREFIX_LEN ) ) {
-            /*
-             * Note: We have to do this differently from other stats as the
-             * counters to this stats are dynamic. So we will not know the
-             * number of counters at a given time.
-             */
-            fgets( data, sizeof( data ), in );
-            if ( decode_icmp_msg( line + ICMP_MSG_STATS_PREFIX_LEN,
-                     data + ICMP_MSG_STATS_PREFIX_LEN,
-                     &cached_icmp4_msg_mib )
-                < 0 ) {
-                continue;
-            }
-            ret = 1;
-        } else if ( !strncmp( line, TCP_STATS_LINE, TCP_STATS_PREFIX_LEN ) ) {
-            int ret = sscanf( line, TCP_STATS_LINE,
-                &cached_tcp_mib.tcpRtoAlgorithm,
-                &cached_tcp_mib.tcpRtoMin,
-                &cached_tcp_mib.tcpRtoMax,
-                &cached_tcp_mib.tcpMaxConn,
-                &cached_tcp_mib.tcpActiveOpens,
-                &cached_tcp_mib.tcpPassiveOpens,
-                &cached_tcp_mib.tcpAttemptFails,
-                &cached_tcp_mib.tcpEstabResets,
-                &cached_tcp_mib.tcpCurrEstab,
-                &cached_tcp_mib.tcpInSegs,
-                &cached_tcp_mib.tcpOutSegs,
-                &cached_tcp_mib.tcpRetransSegs,
-                &cached_tcp_mib.tcpInErrs,
-                &cached_tcp_mib.tcpOutRsts );
-            cached_tcp_mib.tcpInErrsValid = ( ret > 12 ) ? 1 : 0;
-            cached_tcp_mib.tcpOutRstsValid = ( ret > 13 ) ? 1 : 0;
-        } else if ( !strncmp( line, UDP_STATS_LINE, UDP_STATS_PREFIX_LEN ) ) {
-            sscanf( line, UDP_STATS_LINE,
-                &cached_udp_mib.udpInDatagrams,
-                &cached_udp_mib.udpNoPorts,
-                &cached_udp_mib.udpInErrors,
-                &cached_udp_mib.udpOutDatagrams );
-        }
+    /*
+     * Note: We have to do this differently from other stats as the
+     * counters to this stats are dynamic. So we will not know the
+     * number of counters at a given time.
+     */
+    if ( ProcFile_forEachField( file, "IcmpMsg", _icmp_msg_column,
+             &cached_icmp4_msg_mib )
+        >= 0 )
+        ret = 1;
+
+    if ( _read_columns( file, "Tcp", _COLUMNS( _tcp_columns ),
+             &cached_tcp_mib.tcpRtoAlgorithm, &found )
+        >= 0 ) {
+        cached_tcp_mib.tcpInErrsValid = ( found >> 12 ) & 1;
+        cached_tcp_mib.tcpOutRstsValid = ( found >> 13 ) & 1;
     }
-    fclose( in );
+
+    _read_columns( file, "Udp", _COLUMNS( _udp_columns ),
+        &cached_udp_mib.udpInDatagrams, NULL );
 
     /*
      * Tweak illegal values:
@@ -217,6 +178,8 @@ linux_read_mibII_stats( void )
     if ( !cached_tcp_mib.tcpRtoAlgorithm )
         cached_tcp_mib.tcpRtoAlgorithm = 1;
 
+    parsed_generation = file->generation;
+    parsed_ret = ret;
     return ret;
 }
 
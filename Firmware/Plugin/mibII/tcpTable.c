@@ -21,6 +21,8 @@
 #include "System/Containers/MapList.h"
 #include "System/Util/Logger.h"
 #include "siglog/system/generic.h"
+#include "utilities/sock_diag.h"
+#include <netinet/tcp.h>
 
 #define TCPTABLE_ENTRY_TYPE struct inpcb
 #define TCPTABLE_STATE inp_state
@@ -282,6 +284,31 @@ void tcpTable_free( Cache* cache, void* magic )
 
 const static int linux_states[ 12 ] = { 1, 5, 3, 4, 6, 7, 11, 1, 8, 9, 2, 10 };
 
+static int
+_tcpTable_addDiag( const struct inet_diag_msg* msg, void* context )
+{
+    struct inpcb* nnew;
+
+    nnew = MEMORY_MALLOC_TYPEDEF( struct inpcb );
+    if ( nnew == NULL )
+        return -1;
+
+    /* sock_diag hands out addresses and ports in network order */
+    nnew->inp_laddr.s_addr = msg->id.idiag_src[ 0 ];
+    nnew->inp_lport = msg->id.idiag_sport;
+    nnew->inp_faddr.s_addr = msg->id.idiag_dst[ 0 ];
+    nnew->inp_fport = msg->id.idiag_dport;
+
+    nnew->inp_state = ( msg->idiag_state & 0xf ) < 12 ? linux_states[ msg->idiag_state & 0xf ] : 2;
+    if ( nnew->inp_state == 5 /* established */ || nnew->inp_state == 8 /*  closeWait  */ )
+        tcp_estab++;
+    nnew->uid = msg->idiag_uid;
+
+    nnew->inp_next = tcp_head;
+    tcp_head = nnew;
+    return 0;
+}
+
 int tcpTable_load( Cache* cache, void* vmagic )
 {
     FILE* in;
@@ -289,6 +316,16 @@ int tcpTable_load( Cache* cache, void* vmagic )
 
     tcpTable_free( cache, NULL );
 
+    if ( 0 == netsnmp_sock_diag_dump( AF_INET, IPPROTO_TCP, TCP_ALL,
+                  _tcpTable_addDiag, NULL ) ) {
+        DEBUG_MSGTL( ( "mibII/tcpTable", "Loaded TCP Table (sock_diag)\n" ) );
+        return 0;
+    }
+    /*
+     * no sock_diag, or the dump broke off: start over from procfs
+     */
+    tcpTable_free( cache, NULL );
+
     if ( !( in = fopen( "/proc/net/tcp", "r" ) ) ) {
         DEBUG_MSGTL( ( "mibII/tcpTable", "Failed to load TCP Table (linux1)\n" ) );
         LOGGER_LOGONCE( ( LOGGER_PRIORITY_ERR, "snmpd: cannot open /proc/net/tcp ...\n" ) );
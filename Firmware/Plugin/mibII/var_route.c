@@ -57,22 +57,27 @@ PERFORMANCE OF THIS SOFTWARE.
 #include "route_headers.h"
 #include "siglog/agent/auto_nlist.h"
 #include "siglog/data_access/interface.h"
+#include "siglog/data_access/route.h"
+#include "ip-forward-mib/inetCidrRouteTable/inetCidrRouteTable_constants.h"
 #include "struct.h"
 #include <net/route.h>
 
 extern WriteMethodFT write_rte;
 
-static struct rtentry** rthead = NULL;
-static int rtsize = 0, rtallocate = 0;
+/*
+ * compact copy of the routing table, sorted by destination: a lookup
+ * is a binary search, whatever the size of the table.
+ */
+static netsnmp_route_table _routes;
 
 static void Route_Scan_Reload( void );
 
-struct rtentry** netsnmp_get_routes( size_t* size )
+netsnmp_route_table* netsnmp_get_routes( size_t* size )
 {
     Route_Scan_Reload();
     if ( size )
-        *size = rtsize;
-    return rthead;
+        *size = _routes.count;
+    return &_routes;
 }
 
 void init_var_route( void )
@@ -83,6 +88,55 @@ void init_var_route( void )
     auto_nlist( RTNET_SYMBOL, 0, 0 );
 }
 
+/*
+ * index of the route for the instance part of name ( A.B.C.D ), or of
+ * the first route after it when !exact. -1 if there is none.
+ */
+static long
+_route_lookup( const oid* name, size_t length, int exact )
+{
+    uint32_t dest = 0;
+    size_t i, pos;
+
+    if ( exact ) {
+        if ( 14 != length )
+            return -1;
+        for ( i = 10; i < 14; ++i ) {
+            if ( name[ i ] > 255 )
+                return -1;
+            dest = ( dest << 8 ) | name[ i ];
+        }
+        pos = netsnmp_access_route_table_lower_bound( &_routes, dest );
+        if ( pos >= _routes.count || ntohl( _routes.routes[ pos ].dest ) != dest )
+            return -1;
+        return pos;
+    }
+
+    /*
+     * the first destination greater than the (possibly partial, or out
+     * of range) instance in name
+     */
+    for ( i = 10; i < 14; ++i ) {
+        if ( i >= length ) {
+            /** a.b is before a.b.0.0: look for >= a.b.0.0 */
+            dest = ( i > 10 ) ? dest << 8 * ( 14 - i ) : 0;
+            pos = netsnmp_access_route_table_lower_bound( &_routes, dest );
+            return pos < _routes.count ? ( long )pos : -1;
+        }
+        if ( name[ i ] > 255 ) {
+            /** a.300 is after a.255.255.255 */
+            dest = ( ( dest << 8 ) | 255 ) << 8 * ( 13 - i );
+            dest |= ( 1U << 8 * ( 13 - i ) ) - 1;
+            break;
+        }
+        dest = ( dest << 8 ) | name[ i ];
+    }
+    if ( 0xffffffffU == dest )
+        return -1;
+    pos = netsnmp_access_route_table_lower_bound( &_routes, dest + 1 );
+    return pos < _routes.count ? ( long )pos : -1;
+}
+
 u_char*
 var_ipRouteEntry( struct Variable_s* vp,
     oid* name,
@@ -94,98 +148,57 @@ var_ipRouteEntry( struct Variable_s* vp,
      * 1.3.6.1.2.1.4.21.1.1.A.B.C.D,  where A.B.C.D is IP address.
      * IPADDR starts at offset 10.
      */
-    register int Save_Valid, result, RtIndex;
-    static size_t saveNameLen = 0;
-    static int saveExact = 0, saveRtIndex = 0;
-    static oid saveName[ asnMAX_OID_LEN ], Current[ asnMAX_OID_LEN ];
+    const netsnmp_route_compact* rt;
+    const netsnmp_route_nexthop* nh;
+    long RtIndex;
     u_char* cp;
-    oid* op;
+    oid Current[ 14 ];
     static in_addr_t addr_ret;
 
     *write_method = NULL; /* write_rte;  XXX:  SET support not really implemented */
 
-    /**
-     ** this optimisation fails, if there is only a single route avail.
-     ** it is a very special case, but better leave it out ...
-     **/
-    saveNameLen = 0;
-    if ( rtsize <= 1 )
-        Save_Valid = 0;
-    else
-        /*
-         *  OPTIMIZATION:
-         *
-         *  If the name was the same as the last name, with the possible
-         *  exception of the [9]th token, then don't read the routing table
-         *
-         */
-
-        if ( ( saveNameLen == *length ) && ( saveExact == exact ) ) {
-        register int temp = name[ 9 ];
-        name[ 9 ] = 0;
-        Save_Valid = ( Api_oidCompare( name, *length, saveName, saveNameLen ) == 0 );
-        name[ 9 ] = temp;
-    } else
-        Save_Valid = 0;
-
-    if ( Save_Valid ) {
-        register int temp = name[ 9 ]; /* Fix up 'lowest' found entry */
-        memcpy( ( char* )name, ( char* )Current, 14 * sizeof( oid ) );
-        name[ 9 ] = temp;
-        *length = 14;
-        RtIndex = saveRtIndex;
-    } else {
-        /*
-         * fill in object part of name for current (less sizeof instance part) 
-         */
-
-        memcpy( ( char* )Current, ( char* )vp->name,
-            ( int )( vp->namelen ) * sizeof( oid ) );
-
-        Route_Scan_Reload();
+    Route_Scan_Reload();
 
-        for ( RtIndex = 0; RtIndex < rtsize; RtIndex++ ) {
+    /*
+     * a request for a different column starts at its first row
+     */
+    if ( Api_oidCompare( name, UTILITIES_MIN_VALUE( *length, vp->namelen ), vp->name, vp->namelen ) < 0 )
+        RtIndex = exact ? -1 : ( _routes.count ? 0 : -1 );
+    else if ( Api_oidCompare( name, UTILITIES_MIN_VALUE( *length, vp->namelen ), vp->name, vp->namelen ) > 0 )
+        RtIndex = -1;
+    else
+        RtIndex = _route_lookup( name, *length, exact );
+    if ( RtIndex < 0 )
+        return ( NULL );
 
-            cp = ( u_char* )&( ( ( struct sockaddr_in* )&( rthead[ RtIndex ]->rt_dst ) )->sin_addr.s_addr );
-            op = Current + 10;
-            *op++ = *cp++;
-            *op++ = *cp++;
-            *op++ = *cp++;
-            *op++ = *cp++;
+    rt = &_routes.routes[ RtIndex ];
+    nh = &_routes.nexthops[ rt->nexthop ];
 
-            result = Api_oidCompare( name, *length, Current, 14 );
-            if ( ( exact && ( result == 0 ) ) || ( !exact && ( result < 0 ) ) )
-                break;
-        }
-        if ( RtIndex >= rtsize )
-            return ( NULL );
-        /*
-         *  Save in the 'cache'
-         */
-        memcpy( ( char* )saveName, ( char* )name,
-            UTILITIES_MIN_VALUE( *length, asnMAX_OID_LEN ) * sizeof( oid ) );
-        saveName[ 9 ] = 0;
-        saveNameLen = *length;
-        saveExact = exact;
-        saveRtIndex = RtIndex;
-        /*
-         *  Return the name
-         */
-        memcpy( ( char* )name, ( char* )Current, 14 * sizeof( oid ) );
-        *length = 14;
-    }
+    /*
+     *  Return the name
+     */
+    memcpy( ( char* )Current, ( char* )vp->name,
+        ( int )( vp->namelen ) * sizeof( oid ) );
+    cp = ( u_char* )&rt->dest;
+    Current[ 10 ] = cp[ 0 ];
+    Current[ 11 ] = cp[ 1 ];
+    Current[ 12 ] = cp[ 2 ];
+    Current[ 13 ] = cp[ 3 ];
+    memcpy( ( char* )name, ( char* )Current, 14 * sizeof( oid ) );
+    *length = 14;
 
     *var_len = sizeof( vars_longReturn );
 
     switch ( vp->magic ) {
     case IPROUTEDEST:
         *var_len = sizeof( addr_ret );
-        return ( u_char* )&( ( struct sockaddr_in* )&rthead[ RtIndex ]->rt_dst )->sin_addr.s_addr;
+        addr_ret = rt->dest;
+        return ( u_char* )&addr_ret;
     case IPROUTEIFINDEX:
-        vars_longReturn = ( u_long )rthead[ RtIndex ]->rt_unit;
+        vars_longReturn = ( u_long )nh->if_index;
         return ( u_char* )&vars_longReturn;
     case IPROUTEMETRIC1:
-        vars_longReturn = ( rthead[ RtIndex ]->rt_flags & RTF_GATEWAY ) ? 1 : 0;
+        vars_longReturn = ( 0 != nh->addr ) ? 1 : 0;
         return ( u_char* )&vars_longReturn;
     case IPROUTEMETRIC2:
         return NULL;
@@ -207,22 +220,30 @@ var_ipRouteEntry( struct Variable_s* vp,
         return ( u_char* )&vars_longReturn;
     case IPROUTENEXTHOP:
         *var_len = sizeof( addr_ret );
-
-        return ( u_char* )&( ( struct sockaddr_in* )&rthead[ RtIndex ]->rt_gateway )->sin_addr.s_addr;
+        addr_ret = nh->addr;
+        return ( u_char* )&addr_ret;
     case IPROUTETYPE:
-        if ( rthead[ RtIndex ]->rt_flags & RTF_UP ) {
-            if ( rthead[ RtIndex ]->rt_flags & RTF_GATEWAY ) {
-                vars_longReturn = 4; /*  indirect(4)  */
-            } else {
-                vars_longReturn = 3; /*  direct(3)  */
-            }
-        } else {
+        switch ( rt->type ) {
+        case INETCIDRROUTETYPE_REMOTE:
+            vars_longReturn = 4; /*  indirect(4)  */
+            break;
+        case INETCIDRROUTETYPE_LOCAL:
+            vars_longReturn = 3; /*  direct(3)  */
+            break;
+        case 0:
             vars_longReturn = 2; /*  invalid(2)  */
+            break;
+        default:
+            vars_longReturn = 1; /*  other(1)  */
+            break;
         }
         return ( u_char* )&vars_longReturn;
     case IPROUTEPROTO:
-
-        vars_longReturn = ( rthead[ RtIndex ]->rt_flags & RTF_DYNAMIC ) ? 4 : 2;
+        /*
+         * ipRouteProto shares its values with IANAipRouteProtocol
+         * up to bgp(14)
+         */
+        vars_longReturn = ( rt->proto <= IANAIPROUTEPROTOCOL_BGP ) ? rt->proto : 1;
         return ( u_char* )&vars_longReturn;
     case IPROUTEAGE:
 
@@ -231,14 +252,7 @@ var_ipRouteEntry( struct Variable_s* vp,
         return ( u_char* )&vars_longReturn;
     case IPROUTEMASK:
         *var_len = sizeof( addr_ret );
-
-        if ( ( ( struct sockaddr_in* )&rthead[ RtIndex ]->rt_dst )->sin_addr.s_addr == 0 )
-            addr_ret = 0; /* Default route */
-        else {
-
-            cp = ( u_char* )&( ( ( struct sockaddr_in* )&( rthead[ RtIndex ]->rt_dst ) )->sin_addr.s_addr );
-            return ( u_char* )&( ( ( struct sockaddr_in* )&( rthead[ RtIndex ]->rt_genmask ) )->sin_addr.s_addr );
-        }
+        addr_ret = rt->pfx_len ? htonl( 0xffffffffU << ( 32 - rt->pfx_len ) ) : 0;
         return ( u_char* )&addr_ret;
     case IPROUTEINFO:
         *var_len = vars_nullOidLen;
@@ -250,15 +264,9 @@ var_ipRouteEntry( struct Variable_s* vp,
     return NULL;
 }
 
-static int qsort_compare( const void*, const void* );
-
 static void
 Route_Scan_Reload( void )
 {
-    FILE* in;
-    char line[ 256 ];
-    struct rtentry* rt;
-    char name[ 16 ];
     static time_t Time_Of_Last_Reload;
     struct timeval now;
 
@@ -267,109 +275,8 @@ Route_Scan_Reload( void )
         return;
     Time_Of_Last_Reload = now.tv_sec;
 
-    /*
-     *  Makes sure we have SOME space allocated for new routing entries
-     */
-    if ( !rthead ) {
-        rthead = ( struct rtentry** )calloc( 100, sizeof( struct rtentry* ) );
-        if ( !rthead ) {
-            Logger_log( LOGGER_PRIORITY_ERR, "route table malloc fail\n" );
-            return;
-        }
-        rtallocate = 100;
-    }
-
-    /*
-     * fetch routes from the proc file-system:
-     */
-
-    rtsize = 0;
-
-    if ( !( in = fopen( "/proc/net/route", "r" ) ) ) {
-        LOGGER_LOGONCE( ( LOGGER_PRIORITY_ERR, "cannot open /proc/net/route - burps\n" ) );
-        return;
-    }
-
-    while ( fgets( line, sizeof( line ), in ) ) {
-        struct rtentry rtent;
-        char rtent_name[ 32 ];
-        int refcnt, metric;
-        unsigned flags, use;
-
-        rt = &rtent;
-        memset( ( char* )rt, ( 0 ), sizeof( *rt ) );
-        rt->rt_dev = rtent_name;
-
-        /*
-         * as with 1.99.14:
-         * Iface Dest GW Flags RefCnt Use Metric Mask MTU Win IRTT
-         * eth0 0A0A0A0A 00000000 05 0 0 0 FFFFFFFF 1500 0 0 
-         */
-        if ( 8 != sscanf( line, "%s %x %x %x %d %u %d %x %*d %*d %*d\n",
-                      rt->rt_dev,
-                      &( ( ( struct sockaddr_in* )&( rtent.rt_dst ) )->sin_addr.s_addr ),
-                      &( ( ( struct sockaddr_in* )&( rtent.rt_gateway ) )->sin_addr.s_addr ),
-                      /*
-                         * XXX: fix type of the args 
-                         */
-                      &flags, &refcnt, &use, &metric,
-                      &( ( ( struct sockaddr_in* )&( rtent.rt_genmask ) )->sin_addr.s_addr ) ) )
-            continue;
-
-        String_copyTruncate( name, rt->rt_dev, sizeof( name ) );
-
-        rt->rt_flags = flags, rt->rt_refcnt = refcnt;
-        rt->rt_use = use, rt->rt_metric = metric;
-
-        rt->rt_unit = netsnmp_access_interface_index_find( name );
-
-        /*
-         *  Allocate a block to hold it and add it to the database
-         */
-        if ( rtsize >= rtallocate ) {
-            rthead = ( struct rtentry** )realloc( ( char* )rthead,
-                2 * rtallocate * sizeof( struct rtentry* ) );
-            memset( &rthead[ rtallocate ], 0,
-                rtallocate * sizeof( struct rtentry* ) );
-            rtallocate *= 2;
-        }
-        if ( !rthead[ rtsize ] )
-            rthead[ rtsize ] = ( struct rtentry* )malloc( sizeof( struct rtentry ) );
-        /*
-         *  Add this to the database
-         */
-        memcpy( ( char* )rthead[ rtsize ], ( char* )rt,
-            sizeof( struct rtentry ) );
-        rtsize++;
-    }
-
-    fclose( in );
-
-    /*
-     *  Sort it!
-     */
-    qsort( ( char* )rthead, rtsize, sizeof( rthead[ 0 ] ), qsort_compare );
-}
-
-/*
- *      Create a host table
- */
-
-static int
-qsort_compare( const void* v1, const void* v2 )
-{
-    struct rtentry* const* r1 = ( struct rtentry * const* )v1;
-    struct rtentry* const* r2 = ( struct rtentry * const* )v2;
-
-    register u_long dst1 = ntohl( ( ( const struct sockaddr_in* )&( ( *r1 )->rt_dst ) )->sin_addr.s_addr );
-    register u_long dst2 = ntohl( ( ( const struct sockaddr_in* )&( ( *r2 )->rt_dst ) )->sin_addr.s_addr );
-
-    /*
-     *      Do the comparison
-     */
-    if ( dst1 == dst2 )
-        return ( 0 );
-    if ( dst1 > dst2 )
-        return ( 1 );
-    return ( -1 );
+    if ( netsnmp_access_route_table_load( &_routes,
+             NETSNMP_ACCESS_ROUTE_LOAD_IPV4_ONLY )
+        < 0 )
+        Logger_log( LOGGER_PRIORITY_ERR, "could not load the route table\n" );
 }
@@ -6,11 +6,12 @@
 #define _MIBGROUP_VAR_ROUTE_H
 
 #include "Vars.h"
+#include "siglog/data_access/route.h"
 
 void            init_var_route(void);
 
 extern FindVarMethodFT var_ipRouteEntry;
 
-struct rtentry **netsnmp_get_routes(size_t *out_numroutes);
+netsnmp_route_table *netsnmp_get_routes(size_t *out_numroutes);
 
 #endif                          /* _MIBGROUP_VAR_ROUTE_H */
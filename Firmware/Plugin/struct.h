@@ -29,6 +29,8 @@ struct myproc {
     char            fixcmd[STRMAX];
     int             min;
     int             max;
+    int             regex;      /* name is an extended regex */
+    int             count;      /* matching processes, see proc.c */
     struct myproc  *next;
 };
 
@@ -27,6 +27,9 @@ extern int
 netsnmp_arch_tcpconn_container_load( Container_Container* container,
     u_int load_flags );
 extern int
+netsnmp_arch_tcpconn_load_rows( u_int load_flags,
+    netsnmp_tcpconn_row_f* row_cb, void* context );
+extern int
 netsnmp_arch_tcpconn_entry_init( netsnmp_tcpconn_entry* entry );
 extern int
 netsnmp_arch_tcpconn_entry_copy( netsnmp_tcpconn_entry* lhs,
@@ -88,6 +91,25 @@ netsnmp_access_tcpconn_container_load( Container_Container* container, u_int loa
     return container;
 }
 
+/**
+ * read the connections one at a time, without building a container
+ *
+ * @retval  0 no errors
+ * @retval !0 errors (or the value returned by a failing row_cb)
+ */
+int netsnmp_access_tcpconn_load_rows( u_int load_flags,
+    netsnmp_tcpconn_row_f* row_cb, void* context )
+{
+    DEBUG_MSGTL( ( "access:tcpconn:container", "load rows\n" ) );
+
+    if ( NULL == row_cb ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "no row callback for access_tcpconn\n" );
+        return -1;
+    }
+
+    return netsnmp_arch_tcpconn_load_rows( load_flags, row_cb, context );
+}
+
 void netsnmp_access_tcpconn_container_free( Container_Container* container, u_int free_flags )
 {
     DEBUG_MSGTL( ( "access:tcpconn:container", "free\n" ) );
@@ -141,6 +163,31 @@ netsnmp_access_tcpconn_entry_create( void )
     return entry;
 }
 
+/**
+ * allocate an entry for a row passed to a netsnmp_tcpconn_row_f callback
+ */
+netsnmp_tcpconn_entry*
+netsnmp_access_tcpconn_entry_dup( const netsnmp_tcpconn_entry* row )
+{
+    netsnmp_tcpconn_entry* entry = netsnmp_access_tcpconn_entry_create();
+
+    if ( NULL == entry )
+        return NULL;
+
+    entry->arbitrary_index = row->arbitrary_index;
+    entry->flags = row->flags;
+    memcpy( entry->loc_addr, row->loc_addr, sizeof( entry->loc_addr ) );
+    memcpy( entry->rmt_addr, row->rmt_addr, sizeof( entry->rmt_addr ) );
+    entry->loc_addr_len = row->loc_addr_len;
+    entry->rmt_addr_len = row->rmt_addr_len;
+    entry->loc_port = row->loc_port;
+    entry->rmt_port = row->rmt_port;
+    entry->tcpConnState = row->tcpConnState;
+    entry->pid = row->pid;
+
+    return entry;
+}
+
 /**
  */
 void netsnmp_access_tcpconn_entry_free( netsnmp_tcpconn_entry* entry )
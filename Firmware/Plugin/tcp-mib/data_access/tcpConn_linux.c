@@ -12,12 +12,15 @@
 #include "tcpConn.h"
 #include "tcpConn_private.h"
 #include "utilities/get_pid_from_inode.h"
+#include "utilities/sock_diag.h"
+#include <netinet/tcp.h>
 
 static int
     linux_states[ 12 ]
     = { 1, 5, 3, 4, 6, 7, 11, 1, 8, 9, 2, 10 };
 
-static int _load4( Container_Container* container, u_int flags );
+static int _load4( u_int flags, netsnmp_tcpconn_row_f* row_cb, void* context );
+static int _load_diag( u_int flags, netsnmp_tcpconn_row_f* row_cb, void* context );
 
 /*
  * initialize arch specific storage
@@ -57,40 +60,80 @@ int netsnmp_arch_tcpconn_entry_copy( netsnmp_tcpconn_entry* lhs,
  * @retval  0 no errors
  * @retval !0 errors
  */
-int netsnmp_arch_tcpconn_container_load( Container_Container* container,
-    u_int load_flags )
+int netsnmp_arch_tcpconn_load_rows( u_int load_flags,
+    netsnmp_tcpconn_row_f* row_cb, void* context )
 {
-    int rc = 0;
-
     DEBUG_MSGTL( ( "access:tcpconn:container",
-        "tcpconn_container_arch_load (flags %x)\n", load_flags ) );
+        "tcpconn_arch_load_rows (flags %x)\n", load_flags ) );
+
+    int rc;
 
     /* Setup the pid_from_inode table, and fill it.*/
     netsnmp_get_pid_from_inode_init();
 
+    /*
+     * prefer the binary sock_diag dump; fall back to /proc/net/tcp on
+     * kernels that don't have it.
+     */
+    rc = _load_diag( load_flags, row_cb, context );
+    if ( rc <= 0 )
+        return rc;
+
+    DEBUG_MSGTL( ( "access:tcpconn:container",
+        "sock_diag unavailable, using /proc/net/tcp\n" ) );
+    return _load4( load_flags, row_cb, context );
+}
+
+/**
+ * row callback used to fill a container
+ */
+static int
+_add_to_container( netsnmp_tcpconn_entry* row, void* context )
+{
+    Container_Container* container = ( Container_Container* )context;
+    netsnmp_tcpconn_entry* entry;
+
+    entry = netsnmp_access_tcpconn_entry_dup( row );
+    if ( NULL == entry )
+        return -3;
+
+    entry->arbitrary_index = CONTAINER_SIZE( container ) + 1;
+    CONTAINER_INSERT( container, entry );
+
+    return 0;
+}
+
+int netsnmp_arch_tcpconn_container_load( Container_Container* container,
+    u_int load_flags )
+{
+    DEBUG_MSGTL( ( "access:tcpconn:container",
+        "tcpconn_container_arch_load (flags %x)\n", load_flags ) );
+
     if ( NULL == container ) {
         Logger_log( LOGGER_PRIORITY_ERR, "no container specified/found for access_tcpconn\n" );
         return -1;
     }
 
-    rc = _load4( container, load_flags );
-
-    return rc;
+    return netsnmp_arch_tcpconn_load_rows( load_flags, _add_to_container,
+        container );
 }
 
 /**
+ * parse each connection into a single (reused) row, and pass it to row_cb
  *
  * @retval  0 no errors
  * @retval !0 errors
  */
 static int
-_load4( Container_Container* container, u_int load_flags )
+_load4( u_int load_flags, netsnmp_tcpconn_row_f* row_cb, void* context )
 {
     int rc = 0;
     FILE* in;
     char line[ 160 ];
+    netsnmp_tcpconn_entry row;
+    oid count = 0;
 
-    Assert_assert( NULL != container );
+    Assert_assert( NULL != row_cb );
 
 #define PROCFILE "/proc/net/tcp"
     if ( !( in = fopen( PROCFILE, "r" ) ) ) {
@@ -105,7 +148,7 @@ _load4( Container_Container* container, u_int load_flags )
      *   0: 00000000:8000 00000000:0000 0A 00000000:00000000 00:00000000 00000000    29        0 1028 1 df7b1b80 300 0 0 2 -1
      */
     while ( fgets( line, sizeof( line ), in ) ) {
-        netsnmp_tcpconn_entry* entry;
+        netsnmp_tcpconn_entry* entry = &row;
         unsigned int state, local_port, remote_port, tmp_state;
         unsigned long long inode;
         size_t buf_len, offset;
@@ -142,13 +185,9 @@ _load4( Container_Container* container, u_int load_flags )
             }
         }
 
-        /*
-         */
-        entry = netsnmp_access_tcpconn_entry_create();
-        if ( NULL == entry ) {
-            rc = -3;
-            break;
-        }
+        memset( entry, 0, sizeof( *entry ) );
+        entry->oid_index.len = 1;
+        entry->oid_index.oids = &entry->arbitrary_index;
 
         /** oddly enough, these appear to already be in network order */
         entry->loc_port = ( unsigned short )local_port;
@@ -161,7 +200,6 @@ _load4( Container_Container* container, u_int load_flags )
         if ( ( 8 != buf_len ) || ( -1 == Utilities_addrStringHton( local_addr, 8 ) ) ) {
             DEBUG_MSGT( ( "verbose:access:tcpconn:container",
                 " error processing local address\n" ) );
-            netsnmp_access_tcpconn_entry_free( entry );
             continue;
         }
         offset = 0;
@@ -174,7 +212,6 @@ _load4( Container_Container* container, u_int load_flags )
                 "error parsing local addr (%d != 4)\n",
                 entry->loc_addr_len ) );
             DEBUG_MSGT( ( "access:tcpconn:container", " line '%s'\n", line ) );
-            netsnmp_access_tcpconn_entry_free( entry );
             continue;
         }
 
@@ -183,7 +220,6 @@ _load4( Container_Container* container, u_int load_flags )
         if ( ( 8 != buf_len ) || ( -1 == Utilities_addrStringHton( remote_addr, 8 ) ) ) {
             DEBUG_MSGT( ( "verbose:access:tcpconn:container",
                 " error processing remote address\n" ) );
-            netsnmp_access_tcpconn_entry_free( entry );
             continue;
         }
         offset = 0;
@@ -196,15 +232,16 @@ _load4( Container_Container* container, u_int load_flags )
                 "error parsing remote addr (%d != 4)\n",
                 entry->rmt_addr_len ) );
             DEBUG_MSGT( ( "access:tcpconn:container", " line '%s'\n", line ) );
-            netsnmp_access_tcpconn_entry_free( entry );
             continue;
         }
 
         /*
-         * add entry to container
+         * hand the row over
          */
-        entry->arbitrary_index = CONTAINER_SIZE( container ) + 1;
-        CONTAINER_INSERT( container, entry );
+        entry->arbitrary_index = ++count;
+        rc = row_cb( entry, context );
+        if ( rc < 0 )
+            break;
     }
 
     fclose( in );
@@ -214,3 +251,84 @@ _load4( Container_Container* container, u_int load_flags )
 
     return 0;
 }
+
+/*
+ * state for the sock_diag row callback
+ */
+typedef struct tcpconn_diag_ctx_s {
+    netsnmp_tcpconn_row_f* row_cb;
+    void* context;
+    netsnmp_tcpconn_entry row;
+    oid count;
+} tcpconn_diag_ctx;
+
+static int
+_diag_row( const struct inet_diag_msg* msg, void* context )
+{
+    tcpconn_diag_ctx* ctx = ( tcpconn_diag_ctx* )context;
+    netsnmp_tcpconn_entry* entry = &ctx->row;
+    u_char addr_len;
+
+    if ( AF_INET == msg->idiag_family )
+        addr_len = 4;
+    else if ( AF_INET6 == msg->idiag_family )
+        addr_len = 16;
+    else
+        return 0;
+
+    memset( entry, 0, sizeof( *entry ) );
+    entry->oid_index.len = 1;
+    entry->oid_index.oids = &entry->arbitrary_index;
+
+    /** addresses are in network order, ports too (unlike procfs) */
+    memcpy( entry->loc_addr, msg->id.idiag_src, addr_len );
+    memcpy( entry->rmt_addr, msg->id.idiag_dst, addr_len );
+    entry->loc_addr_len = entry->rmt_addr_len = addr_len;
+    entry->loc_port = ntohs( msg->id.idiag_sport );
+    entry->rmt_port = ntohs( msg->id.idiag_dport );
+    entry->tcpConnState = ( msg->idiag_state & 0xf ) < 12 ? linux_states[ msg->idiag_state & 0xf ] : 2;
+    entry->pid = netsnmp_get_pid_from_inode( msg->idiag_inode );
+
+    entry->arbitrary_index = ++ctx->count;
+    return ctx->row_cb( entry, ctx->context );
+}
+
+/**
+ * dump tcp sockets over NETLINK_SOCK_DIAG. Listen filtering is done by
+ * the kernel through the state mask.
+ *
+ * @retval  0 no errors
+ * @retval  1 sock_diag not available for ipv4, nothing loaded
+ * @retval <0 errors
+ */
+static int
+_load_diag( u_int load_flags, netsnmp_tcpconn_row_f* row_cb, void* context )
+{
+    tcpconn_diag_ctx ctx;
+    u_int states = ( 1 << ( TCP_CLOSING + 1 ) ) - 1;
+    int rc;
+
+    Assert_assert( NULL != row_cb );
+
+    if ( load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_ONLYLISTEN )
+        states = 1 << TCP_LISTEN;
+    else if ( load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_NOLISTEN )
+        states &= ~( 1 << TCP_LISTEN );
+
+    ctx.row_cb = row_cb;
+    ctx.context = context;
+    ctx.count = 0;
+
+    rc = netsnmp_sock_diag_dump( AF_INET, IPPROTO_TCP, states, _diag_row, &ctx );
+    if ( 0 != rc )
+        return rc;
+
+    if ( load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_IPV4_ONLY )
+        return 0;
+
+    /*
+     * no ipv6 in the kernel is not an error, there just are no rows
+     */
+    rc = netsnmp_sock_diag_dump( AF_INET6, IPPROTO_TCP, states, _diag_row, &ctx );
+    return ( rc < 0 ) ? rc : 0;
+}
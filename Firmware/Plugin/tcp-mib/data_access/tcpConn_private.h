@@ -5,6 +5,7 @@
 #include "siglog/data_access/tcpConn.h"
 
 int netsnmp_arch_tcpconn_container_load(Container_Container *, u_int);
+int netsnmp_arch_tcpconn_load_rows(u_int, netsnmp_tcpconn_row_f *, void *);
 int netsnmp_arch_tcpconn_entry_init(netsnmp_tcpconn_entry *);
 void netsnmp_arch_tcpconn_entry_cleanup(netsnmp_tcpconn_entry *);
 int netsnmp_arch_tcpconn_entry_delete(netsnmp_tcpconn_entry *);
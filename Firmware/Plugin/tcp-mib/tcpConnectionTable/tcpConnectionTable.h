@@ -157,6 +157,7 @@
         /*
          * TODO:131:o: |   |-> Add useful data to tcpConnectionTable rowreq context.
          */
+        u_int           sync_generation;  /* last reload that saw the row */
 
         /*
          * storage for future expansion
@@ -12,10 +12,16 @@
 #include "System/Util/Assert.h"
 #include "System/Util/Trace.h"
 #include "System/Util/Logger.h"
+#include "System/Containers/ContainerSync.h"
 #include "siglog/agent/mfd.h"
 #include "tcpConnectionTable_data_access.h"
 #include "tcpConnectionTable_interface.h"
 
+/*
+ * the table container is reloaded incrementally: see ContainerSync.h
+ */
+static ContainerSync _tcpConnectionTable_sync;
+
 /** @ingroup interface 
  * @addtogroup data_access data_access: Routines to access data
  *
@@ -126,6 +132,14 @@ void tcpConnectionTable_container_init( Container_Container** container_ptr_ptr,
      */
     cache->timeout = TCPCONNECTIONTABLE_CACHE_TIMEOUT; /* seconds */
     cache->flags |= CacheOperation_DONT_INVALIDATE_ON_SET;
+
+    /*
+     * tcpConnectionTable_container_load updates the rows in place,
+     * so keep them across reloads, and across expiry and the
+     * auto-release too.
+     */
+    cache->flags |= CacheOperation_DONT_FREE_BEFORE_LOAD
+        | CacheOperation_DONT_FREE_EXPIRED | CacheOperation_DONT_AUTO_RELEASE;
 } /* tcpConnectionTable_container_init */
 
 /**
@@ -156,47 +170,107 @@ void tcpConnectionTable_container_shutdown( Container_Container* container_ptr )
 
 } /* tcpConnectionTable_container_shutdown */
 
+/**
+ * set the index(es) of a row context from a connection
+ */
+static int
+_set_indexes( tcpConnectionTable_rowreq_ctx* rowreq_ctx,
+    const netsnmp_tcpconn_entry* entry )
+{
+    return tcpConnectionTable_indexes_set( rowreq_ctx,
+        entry->loc_addr_len,
+        entry->loc_addr,
+        entry->loc_addr_len,
+        entry->loc_port,
+        entry->rmt_addr_len,
+        entry->rmt_addr,
+        entry->rmt_addr_len,
+        entry->rmt_port );
+}
+
 /**
  * add new entry
  */
-static void
-_add_connection( netsnmp_tcpconn_entry* entry, Container_Container* container )
+static void*
+_add_connection( const void* row, void* context )
 {
     tcpConnectionTable_rowreq_ctx* rowreq_ctx;
+    netsnmp_tcpconn_entry* entry;
 
     DEBUG_MSGTL( ( "tcpConnectionTable:access", "creating new entry\n" ) );
 
+    entry = netsnmp_access_tcpconn_entry_dup( ( const netsnmp_tcpconn_entry* )row );
+    if ( NULL == entry ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "memory allocation failed while loading "
+                                         "tcpConnectionTable cache.\n" );
+        return NULL;
+    }
+
     /*
-     * allocate an row context and set the index(es), then add it to
-     * the container
+     * allocate an row context and set the index(es)
      */
     rowreq_ctx = tcpConnectionTable_allocate_rowreq_ctx( entry, NULL );
-    if ( ( NULL != rowreq_ctx ) && ( MFD_SUCCESS == tcpConnectionTable_indexes_set( rowreq_ctx,
-                                                        entry->loc_addr_len,
-                                                        entry->loc_addr,
-                                                        entry->loc_addr_len,
-                                                        entry->loc_port,
-                                                        entry->rmt_addr_len,
-                                                        entry->rmt_addr,
-                                                        entry->rmt_addr_len,
-                                                        entry->rmt_port ) ) ) {
-        if ( CONTAINER_INSERT( container, rowreq_ctx ) ) {
-            LOGGER_LOGONCE( ( LOGGER_PRIORITY_DEBUG,
-                "Error inserting entry to tcpConnectionTable,"
-                " entry already exists.\n" ) );
-            tcpConnectionTable_release_rowreq_ctx( rowreq_ctx );
-        }
-    } else {
-        if ( rowreq_ctx ) {
-            Logger_log( LOGGER_PRIORITY_ERR, "error setting index while loading "
-                                             "tcpConnectionTable cache.\n" );
-            tcpConnectionTable_release_rowreq_ctx( rowreq_ctx );
-        } else {
-            Logger_log( LOGGER_PRIORITY_ERR, "memory allocation failed while loading "
-                                             "tcpConnectionTable cache.\n" );
-            netsnmp_access_tcpconn_entry_free( entry );
-        }
+    if ( NULL == rowreq_ctx ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "memory allocation failed while loading "
+                                         "tcpConnectionTable cache.\n" );
+        netsnmp_access_tcpconn_entry_free( entry );
+        return NULL;
+    }
+    if ( MFD_SUCCESS != _set_indexes( rowreq_ctx, entry ) ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "error setting index while loading "
+                                         "tcpConnectionTable cache.\n" );
+        tcpConnectionTable_release_rowreq_ctx( rowreq_ctx );
+        return NULL;
     }
+
+    return rowreq_ctx;
+}
+
+/**
+ * refresh an existing entry
+ */
+static int
+_update_connection( void* entry, const void* row, void* context )
+{
+    tcpConnectionTable_rowreq_ctx* rowreq_ctx = ( tcpConnectionTable_rowreq_ctx* )entry;
+
+    return netsnmp_access_tcpconn_entry_update( rowreq_ctx->data,
+        ( netsnmp_tcpconn_entry* )row );
+}
+
+/**
+ * remove a closed connection
+ */
+static void
+_release_connection( void* entry, void* context )
+{
+    tcpConnectionTable_release_rowreq_ctx( ( tcpConnectionTable_rowreq_ctx* )entry );
+}
+
+/**
+ * apply one connection read by the data access layer
+ */
+static int
+_sync_connection( netsnmp_tcpconn_entry* row, void* context )
+{
+    tcpConnectionTable_rowreq_ctx key;
+
+    /*
+     * a stack row context is enough to look the connection up
+     */
+    memset( &key, 0, sizeof( key ) );
+    key.oid_idx.oids = key.oid_tmp;
+    if ( MFD_SUCCESS != _set_indexes( &key, row ) ) {
+        DEBUG_MSGTL( ( "tcpConnectionTable:access", "bad index, row skipped\n" ) );
+        return 0;
+    }
+
+    if ( ErrorCode_SUCCESS != ContainerSync_row( &_tcpConnectionTable_sync, &key, row ) )
+        LOGGER_LOGONCE( ( LOGGER_PRIORITY_DEBUG,
+            "Error inserting entry to tcpConnectionTable,"
+            " entry already exists.\n" ) );
+
+    return 0;
 }
 
 /**
@@ -234,27 +308,30 @@ _add_connection( netsnmp_tcpconn_entry* entry, Container_Container* container )
  */
 int tcpConnectionTable_container_load( Container_Container* container )
 {
-    Container_Container* raw_data = netsnmp_access_tcpconn_container_load( NULL,
-        NETSNMP_ACCESS_TCPCONN_LOAD_NOLISTEN );
+    int rc;
 
     DEBUG_MSGTL( ( "verbose:tcpConnectionTable:tcpConnectionTable_container_load", "called\n" ) );
 
-    if ( NULL == raw_data )
-        return MFD_RESOURCE_UNAVAILABLE; /* msg already logged */
+    if ( _tcpConnectionTable_sync.container != container )
+        ContainerSync_init( &_tcpConnectionTable_sync, container,
+            offsetof( tcpConnectionTable_rowreq_ctx, sync_generation ),
+            _add_connection, _update_connection, _release_connection, NULL );
 
     /*
-     * got all the connections. pull out the active ones.
+     * update the rows we already have in place, add the new
+     * connections, and drop the ones that are gone.
      */
-    CONTAINER_FOR_EACH( raw_data, ( Container_FuncObjFunc* )
-                                      _add_connection,
-        container );
-
-    /*
-     * free the container. we've either claimed each entry, or released it,
-     * so the dal function doesn't need to clear the container.
-     */
-    netsnmp_access_tcpconn_container_free( raw_data,
-        NETSNMP_ACCESS_TCPCONN_FREE_DONT_CLEAR );
+    ContainerSync_begin( &_tcpConnectionTable_sync );
+    rc = netsnmp_access_tcpconn_load_rows( NETSNMP_ACCESS_TCPCONN_LOAD_NOLISTEN,
+        _sync_connection, NULL );
+    if ( 0 != rc ) {
+        /*
+         * rows of the failed pass are mixed with stale ones
+         */
+        ContainerSync_abort( &_tcpConnectionTable_sync );
+        return MFD_RESOURCE_UNAVAILABLE; /* msg already logged */
+    }
+    ContainerSync_end( &_tcpConnectionTable_sync );
 
     DEBUG_MSGT( ( "verbose:tcpConnectionTable:tcpConnectionTable_cache_load",
         "%d records\n", ( int )CONTAINER_SIZE( container ) ) );
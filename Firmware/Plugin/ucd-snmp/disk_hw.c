@@ -273,7 +273,7 @@ var_extensible_disk( struct Variable_s* vp,
     netsnmp_fsys_info* entry;
     unsigned long long val;
     static long long_ret;
-    static char errmsg[ 300 ];
+    static char errmsg[ UTILITIES_MAX_PATH + 100 ];
     Cache* cache;
 
     /* Update the fsys H/W module */
@@ -361,7 +361,9 @@ tryAgain:
     case ERRORFLAG:
         long_ret = 0;
         val = netsnmp_fsys_avail_ull( entry );
-        if ( ( entry->minspace >= 0 ) && ( val < entry->minspace ) )
+        if ( entry->flags & NETSNMP_FS_FLAG_STALE )
+            long_ret = 1;
+        else if ( ( entry->minspace >= 0 ) && ( val < entry->minspace ) )
             long_ret = 1;
         else if ( ( entry->minpercent >= 0 ) && ( _percent( entry->avail, entry->size ) < entry->minpercent ) )
             long_ret = 1;
@@ -370,7 +372,15 @@ tryAgain:
     case ERRORMSG:
         errmsg[ 0 ] = 0;
         val = netsnmp_fsys_avail_ull( entry );
-        if ( ( entry->minspace >= 0 ) && ( val < entry->minspace ) )
+        if ( ( entry->flags & NETSNMP_FS_FLAG_STALE ) && entry->stale_errno )
+            snprintf( errmsg, sizeof( errmsg ),
+                "%s: %s, statistics are stale",
+                entry->path, strerror( entry->stale_errno ) );
+        else if ( entry->flags & NETSNMP_FS_FLAG_STALE )
+            snprintf( errmsg, sizeof( errmsg ),
+                "%s: not responding, statistics are stale",
+                entry->path );
+        else if ( ( entry->minspace >= 0 ) && ( val < entry->minspace ) )
             snprintf( errmsg, sizeof( errmsg ),
                 "%s: less than %d free (= %d)",
                 entry->path, entry->minspace,
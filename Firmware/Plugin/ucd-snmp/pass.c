@@ -3,6 +3,7 @@
 #include "AgentRegistry.h"
 #include "System/Util/Trace.h"
 #include "Impl.h"
+#include "OldApi.h"
 #include "System/Util/Logger.h"
 #include "ReadConfig.h"
 #include "System/String.h"
@@ -106,10 +107,14 @@ void pass_parse_config( const char* token, char* cptr )
     String_copyTruncate( ( *ppass )->name, ( *ppass )->command, sizeof( ( *ppass )->name ) );
     ( *ppass )->next = NULL;
 
-    AgentRegistry_registerMibPriority( "pass",
+    /*
+     * the command is waited for on a coroutine, leaving the agent free
+     */
+    AgentRegistry_registerMibContext( "pass",
         ( struct Variable_s* )extensible_passthru_variables,
         sizeof( struct Variable2_s ), 1, ( *ppass )->miboid,
-        ( *ppass )->miblen, ( *ppass )->mibpriority );
+        ( *ppass )->miblen, ( *ppass )->mibpriority, 0, 0, NULL, "", -1,
+        OLDAPI_AWAIT );
 
     /*
      * argggg -- passthrus must be sorted 
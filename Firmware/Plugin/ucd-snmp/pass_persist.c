@@ -1,49 +1,97 @@
 #include "pass_persist.h"
+#include "AgentHandler.h"
 #include "AgentReadConfig.h"
 #include "AgentRegistry.h"
+#include "BulkToNext.h"
+#include "Client.h"
+#include "System/Dispatcher/FdEventManager.h"
 #include "System/Util/Alarm.h"
 #include "System/Util/Trace.h"
 #include "Impl.h"
 #include "System/Util/Logger.h"
 #include "ReadConfig.h"
 #include "System/String.h"
-#include "System/String.h"
+#include "Transports/SocketBaseDomain.h"
 #include "pass_common.h"
 #include "util_funcs.h"
 #include <sys/wait.h>
 
-struct extensible* persistpassthrus = NULL;
-int numpersistpassthrus = 0;
+/*
+ * Every pass_persist line has a script of its own, fed from the fd
+ * dispatcher rather than waited on: the varbinds of a request are delegated,
+ * their commands written to the script back to back (at most
+ * PERSIST_WINDOW of them ahead of the replies), and the replies, which come
+ * back in the order the commands went out, are matched to them as they
+ * arrive.  A script that doesn't answer its oldest command within its
+ * timeout is killed and restarted on the next request.
+ */
+
+/* commands written to a script ahead of its replies */
+#define PERSIST_WINDOW 32
+
+/* seconds a script has to answer a command, unless told otherwise (-t) */
+#define PERSIST_DEFAULT_TIMEOUT 5
+
+enum {
+    PERSIST_PING,
+    PERSIST_GET,
+    PERSIST_GETNEXT,
+    PERSIST_SET
+};
+
+struct persist_request {
+    int type;
+    DelegatedCache* cache; /* NULL for a PING */
+    char* command;
+    size_t len, off; /* off: bytes written so far */
+    int handling; /* queued by the handler still running: see answer_persist_request() */
+    struct persist_request* next;
+};
+
 struct persist_pipe_type {
-    FILE *fIn, *fOut;
+    char name[ STRMAX ];
+    oid miboid[ MIBMAX ];
+    size_t miblen;
+    int mibpriority;
+    int timeout;
+
     int fdIn, fdOut;
     Types_PidT pid;
-}* persist_pipes = ( struct persist_pipe_type* )NULL;
+
+    /* what the script has written that isn't a whole line yet */
+    char buf[ UTILITIES_MAX_BUFFER ];
+    size_t buflen;
+    /* the lines of the oldest command's reply, so far */
+    char lines[ 3 ][ UTILITIES_MAX_BUFFER ];
+    int nlines;
+
+    /* in the order written; the first nsent have gone out */
+    struct persist_request *head, *tail;
+    int nsent;
+    unsigned alarm;
+
+    struct persist_pipe_type* next;
+};
+
+static struct persist_pipe_type* persist_pipes = NULL;
+static int persist_handling = 0;
 static unsigned pipe_check_alarm_id;
-static int init_persist_pipes( void );
-static void close_persist_pipe( int iindex );
-static int open_persist_pipe( int iindex, char* command );
+static NodeHandlerFT pass_persist_handler;
+static void close_persist_pipe( struct persist_pipe_type* p );
+static int open_persist_pipe( struct persist_pipe_type* p );
 static void check_persist_pipes( unsigned clientreg, void* clientarg );
 static void destruct_persist_pipes( void );
-static int write_persist_pipe( int iindex, const char* data );
-
-/*
- * the relocatable extensible commands variables 
- */
-struct Variable2_s extensible_persist_passthru_variables[] = {
-    /*
-     * bogus entry.  Only some of it is actually used. 
-     */
-    { MIBINDEX, asnINTEGER, IMPL_OLDAPI_RWRITE,
-        var_extensible_pass_persist, 0, { MIBINDEX } },
-};
+static void fail_persist_pipe( struct persist_pipe_type* p );
+static void flush_persist_pipe( struct persist_pipe_type* p );
+static void read_persist_pipe( int fd, void* data );
+static void persist_timed_out( unsigned clientreg, void* clientarg );
 
 void init_pass_persist( void )
 {
     AgentReadConfig_priotdRegisterConfigHandler( "pass_persist",
         pass_persist_parse_config,
         pass_persist_free_config,
-        "miboid program" );
+        "[-p priority] [-t timeout] miboid program" );
     pipe_check_alarm_id = Alarm_register( 10, AlarmFlag_REPEAT, check_persist_pipes, NULL );
 }
 
@@ -60,15 +108,16 @@ void shutdown_pass_persist( void )
 
 void pass_persist_parse_config( const char* token, char* cptr )
 {
-    struct extensible **ppass = &persistpassthrus, **etmp, *ptmp;
+    struct persist_pipe_type **pp = &persist_pipes, *p;
+    HandlerRegistration* reginfo;
     char *tcptr, *endopt;
-    int i;
-    long int priority;
+    long int priority, timeout;
 
     /*
      * options
      */
     priority = DEFAULT_MIB_PRIORITY;
+    timeout = PERSIST_DEFAULT_TIMEOUT;
     while ( *cptr == '-' ) {
         cptr++;
         switch ( *cptr ) {
@@ -88,6 +137,22 @@ void pass_persist_parse_config( const char* token, char* cptr )
             cptr = endopt;
             cptr = ReadConfig_skipWhite( cptr );
             break;
+        case 't':
+            /* seconds the script has to answer */
+            cptr++;
+            cptr = ReadConfig_skipWhite( cptr );
+            if ( !isdigit( ( unsigned char )( *cptr ) ) ) {
+                ReadConfig_configPerror( "timeout must be an integer" );
+                return;
+            }
+            timeout = strtol( ( const char* )cptr, &endopt, 0 );
+            if ( timeout <= 0 || timeout > INT_MAX ) {
+                ReadConfig_configPerror( "timeout out of range" );
+                return;
+            }
+            cptr = endopt;
+            cptr = ReadConfig_skipWhite( cptr );
+            break;
         default:
             ReadConfig_configPerror( "unknown option for pass directive" );
             return;
@@ -103,17 +168,16 @@ void pass_persist_parse_config( const char* token, char* cptr )
         ReadConfig_configPerror( "second token is not a OID" );
         return;
     }
-    numpersistpassthrus++;
 
-    while ( *ppass != NULL )
-        ppass = &( ( *ppass )->next );
-    ( *ppass ) = ( struct extensible* )malloc( sizeof( struct extensible ) );
-    if ( *ppass == NULL )
+    p = ( struct persist_pipe_type* )calloc( 1, sizeof( struct persist_pipe_type ) );
+    if ( p == NULL )
         return;
-    ( *ppass )->type = PASSTHRU_PERSIST;
-    ( *ppass )->mibpriority = priority;
+    p->mibpriority = priority;
+    p->timeout = timeout;
+    p->fdIn = p->fdOut = -1;
+    p->pid = NETSNMP_NO_SUCH_PROCESS;
 
-    ( *ppass )->miblen = parse_miboid( cptr, ( *ppass )->miboid );
+    p->miblen = parse_miboid( cptr, p->miboid );
     while ( isdigit( ( unsigned char )( *cptr ) ) || *cptr == '.' )
         cptr++;
     /*
@@ -122,298 +186,408 @@ void pass_persist_parse_config( const char* token, char* cptr )
     cptr = ReadConfig_skipWhite( cptr );
     if ( cptr == NULL ) {
         ReadConfig_configPerror( "No command specified on pass_persist line" );
-        ( *ppass )->command[ 0 ] = 0;
+        p->name[ 0 ] = 0;
     } else {
         for ( tcptr = cptr; *tcptr != 0 && *tcptr != '#' && *tcptr != ';';
               tcptr++ )
             ;
-        sprintf( ( *ppass )->command, "%.*s", ( int )( tcptr - cptr ), cptr );
+        snprintf( p->name, sizeof( p->name ), "%.*s", ( int )( tcptr - cptr ), cptr );
     }
-    String_copyTruncate( ( *ppass )->name, ( *ppass )->command, sizeof( ( *ppass )->name ) );
-    ( *ppass )->next = NULL;
-
-    AgentRegistry_registerMibPriority( "pass_persist",
-        ( struct Variable_s* )extensible_persist_passthru_variables,
-        sizeof( struct Variable2_s ), 1, ( *ppass )->miboid,
-        ( *ppass )->miblen, ( *ppass )->mibpriority );
 
-    /*
-     * argggg -- pasthrus must be sorted 
-     */
-    if ( numpersistpassthrus > 1 ) {
-        etmp = ( struct extensible** )
-            malloc( ( ( sizeof( struct extensible* ) ) * numpersistpassthrus ) );
-        if ( etmp == NULL )
-            return;
-        for ( i = 0, ptmp = ( struct extensible* )persistpassthrus;
-              i < numpersistpassthrus && ptmp != NULL; i++, ptmp = ptmp->next )
-            etmp[ i ] = ptmp;
-        qsort( etmp, numpersistpassthrus, sizeof( struct extensible* ),
-            pass_persist_compare );
-        persistpassthrus = ( struct extensible* )etmp[ 0 ];
-        ptmp = ( struct extensible* )etmp[ 0 ];
-
-        for ( i = 0; i < numpersistpassthrus - 1; i++ ) {
-            ptmp->next = etmp[ i + 1 ];
-            ptmp = ptmp->next;
-        }
-        ptmp->next = NULL;
-        free( etmp );
+    reginfo = AgentHandler_createHandlerRegistration( "pass_persist",
+        pass_persist_handler, p->miboid, p->miblen, HANDLER_CAN_RWRITE );
+    if ( reginfo == NULL ) {
+        free( p );
+        return;
+    }
+    reginfo->priority = p->mibpriority;
+    reginfo->handler->myvoid = p;
+    if ( AgentHandler_registerHandler( reginfo ) != MIB_REGISTERED_OK ) {
+        ReadConfig_configPerror( "failed to register pass_persist" );
+        free( p );
+        return;
     }
+
+    while ( *pp != NULL )
+        pp = &( ( *pp )->next );
+    *pp = p;
 }
 
 void pass_persist_free_config( void )
 {
-    struct extensible *etmp, *etmp2;
-    int i;
-
-    for ( etmp = persistpassthrus; etmp != NULL; ) {
-        etmp2 = etmp;
-        etmp = etmp->next;
-        AgentRegistry_unregisterMibPriority( etmp2->miboid, etmp2->miblen, etmp2->mibpriority );
-        free( etmp2 );
-    }
-    if ( persist_pipes ) {
-        for ( i = 0; i <= numpersistpassthrus; i++ ) {
-            close_persist_pipe( i );
-        }
+    struct persist_pipe_type* p;
+
+    while ( ( p = persist_pipes ) != NULL ) {
+        persist_pipes = p->next;
+        AgentRegistry_unregisterMibPriority( p->miboid, p->miblen, p->mibpriority );
+        fail_persist_pipe( p );
+        free( p );
     }
-    persistpassthrus = NULL;
-    numpersistpassthrus = 0;
 }
 
-u_char*
-var_extensible_pass_persist( struct Variable_s* vp,
-    oid* name,
-    size_t* length,
-    int exact,
-    size_t* var_len, WriteMethodFT** write_method )
+/*
+ * Queues a command for the script, starting it if it isn't running
+ */
+static int
+queue_persist_request( struct persist_pipe_type* p, int type,
+    DelegatedCache* cache, const char* command )
 {
-    oid newname[ asnMAX_OID_LEN ];
-    int i, rtest, newlen;
-    char buf[ UTILITIES_MAX_BUFFER ];
-    static char buf2[ UTILITIES_MAX_BUFFER ];
-    struct extensible* persistpassthru;
-    FILE* file;
+    struct persist_request* req;
 
-    /*
-     * Make sure that our basic pipe structure is malloced 
-     */
-    init_persist_pipes();
-
-    for ( i = 1; i <= numpersistpassthrus; i++ ) {
-        persistpassthru = get_exten_instance( persistpassthrus, i );
-        rtest = Api_oidtreeCompare( name, *length,
-            persistpassthru->miboid,
-            persistpassthru->miblen );
-        if ( ( exact && rtest == 0 ) || ( !exact && rtest <= 0 ) ) {
-            /*
-             * setup args 
-             */
-            if ( persistpassthru->miblen >= *length || rtest < 0 )
-                sprint_mib_oid( buf, persistpassthru->miboid,
-                    persistpassthru->miblen );
-            else
-                sprint_mib_oid( buf, name, *length );
+    if ( p->pid == NETSNMP_NO_SUCH_PROCESS && type != PERSIST_PING
+        && !open_persist_pipe( p ) )
+        return 0;
 
-            /*
-             * Open our pipe if necessary 
-             */
-            if ( !open_persist_pipe( i, persistpassthru->name ) ) {
-                return ( NULL );
-            }
+    req = MEMORY_MALLOC_TYPEDEF( struct persist_request );
+    if ( req == NULL )
+        return 0;
+    req->command = strdup( command );
+    if ( req->command == NULL ) {
+        free( req );
+        return 0;
+    }
+    req->type = type;
+    req->cache = cache;
+    req->handling = persist_handling;
+    req->len = strlen( command );
+
+    if ( p->tail )
+        p->tail->next = req;
+    else
+        p->head = req;
+    p->tail = req;
+
+    DEBUG_MSGTL( ( "ucd-snmp/pass_persist", "queued for %s:\n%s",
+        p->name, command ) );
+    flush_persist_pipe( p );
+    return 1;
+}
 
-            if ( exact )
-                snprintf( persistpassthru->command,
-                    sizeof( persistpassthru->command ), "get\n%s\n", buf );
-            else
-                snprintf( persistpassthru->command,
-                    sizeof( persistpassthru->command ), "getnext\n%s\n", buf );
-            persistpassthru->command[ sizeof( persistpassthru->command ) - 1 ] = 0;
+static int
+pass_persist_handler( MibHandler* handler,
+    HandlerRegistration* reginfo,
+    AgentRequestInfo* reqinfo,
+    RequestInfo* requests )
+{
+    struct persist_pipe_type* p = ( struct persist_pipe_type* )handler->myvoid;
+    RequestInfo* request;
+    VariableList* var;
+    DelegatedCache* cache;
+    struct persist_request* req;
+    char buf[ UTILITIES_MAX_BUFFER ], command[ UTILITIES_MAX_BUFFER ];
+    int type, rtest;
+
+    switch ( reqinfo->mode ) {
+    case MODE_GET:
+        type = PERSIST_GET;
+        break;
+    case MODE_GETNEXT:
+        type = PERSIST_GETNEXT;
+        break;
+    case MODE_SET_ACTION:
+        type = PERSIST_SET;
+        break;
+    default:
+        /* the script is only told about a SET once, when it's to be done */
+        return PRIOT_ERR_NOERROR;
+    }
 
-            DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
-                "persistpass-sending:\n%s",
-                persistpassthru->command ) );
-            if ( !write_persist_pipe( i, persistpassthru->command ) ) {
-                *var_len = 0;
-                /*
-                 * close_persist_pipes is called in write_persist_pipe 
-                 */
-                return ( NULL );
-            }
+    persist_handling = 1;
+    for ( request = requests; request; request = request->next ) {
+        var = request->requestvb;
 
-            /*
-             * valid call.  Exec and get output 
-             */
+        /*
+         * setup args
+         */
+        rtest = Api_oidtreeCompare( var->name, var->nameLength,
+            p->miboid, p->miblen );
+        if ( p->miblen >= var->nameLength || rtest < 0 )
+            sprint_mib_oid( buf, p->miboid, p->miblen );
+        else
+            sprint_mib_oid( buf, var->name, var->nameLength );
+
+        switch ( type ) {
+        case PERSIST_GET:
+            snprintf( command, sizeof( command ), "get\n%s\n", buf );
+            break;
+        case PERSIST_GETNEXT:
+            snprintf( command, sizeof( command ), "getnext\n%s\n", buf );
+            break;
+        case PERSIST_SET:
+            snprintf( command, sizeof( command ), "set\n%s\n", buf );
+            netsnmp_internal_pass_set_format( buf, var->value.string,
+                var->type, var->valueLength );
+            String_appendTruncate( command, buf, sizeof( command ) );
+            command[ sizeof( command ) - 2 ] = '\n';
+            command[ sizeof( command ) - 1 ] = 0;
+            break;
+        }
 
-            if ( ( file = persist_pipes[ i ].fIn ) ) {
-                if ( fgets( buf, sizeof( buf ), file ) == NULL ) {
-                    *var_len = 0;
-                    close_persist_pipe( i );
-                    return ( NULL );
-                }
-                /*
-                 * persistent scripts return "NONE\n" on invalid items 
-                 */
-                if ( !strncmp( buf, "NONE", 4 ) ) {
-                    if ( exact ) {
-                        *var_len = 0;
-                        return ( NULL );
-                    }
-                    continue;
-                }
-                newlen = parse_miboid( buf, newname );
-
-                /*
-                 * its good, so copy onto name/length 
-                 */
-                memcpy( ( char* )name, ( char* )newname,
-                    ( int )newlen * sizeof( oid ) );
-                *length = newlen;
-
-                /*
-                 * set up return pointer for setable stuff 
-                 */
-                *write_method = setPassPersist;
-
-                if ( newlen == 0 || fgets( buf, sizeof( buf ), file ) == NULL
-                    || fgets( buf2, sizeof( buf2 ), file ) == NULL ) {
-                    *var_len = 0;
-                    close_persist_pipe( i );
-                    return ( NULL );
-                }
-                return netsnmp_internal_pass_parse( buf, buf2, var_len, vp );
-            }
-            *var_len = 0;
-            return ( NULL );
+        /*
+         * delegated first: a script dying on the spot answers at once
+         */
+        request->delegated = 1;
+        cache = AgentHandler_createDelegatedCache( handler, reginfo, reqinfo,
+            request, p );
+        if ( cache == NULL || !queue_persist_request( p, type, cache, command ) ) {
+            AgentHandler_freeDelegatedCache( cache );
+            request->delegated = 0;
+            Agent_setRequestError( reqinfo, request,
+                type == PERSIST_SET ? PRIOT_ERR_NOTWRITABLE : PRIOT_ERR_GENERR );
         }
     }
-    if ( var_len )
-        *var_len = 0;
-    *write_method = NULL;
-    return ( NULL );
+    persist_handling = 0;
+    for ( req = p->head; req; req = req->next )
+        req->handling = 0;
+    return PRIOT_ERR_NOERROR;
 }
 
-int setPassPersist( int action,
-    u_char* var_val,
-    u_char var_val_type,
-    size_t var_val_len,
-    u_char* statP, oid* name, size_t name_len )
+/*
+ * Answers a request from the lines of its reply, or with err when the
+ * script failed it.  No lines and no error: the script had nothing there.
+ */
+static void
+answer_persist_request( struct persist_pipe_type* p,
+    struct persist_request* req, char lines[][ UTILITIES_MAX_BUFFER ], int err )
 {
-    int i, rtest;
-    struct extensible* persistpassthru;
-
-    char buf[ UTILITIES_MAX_BUFFER ], buf2[ UTILITIES_MAX_BUFFER ];
+    DelegatedCache* cache;
+    RequestInfo* request;
+    oid newname[ asnMAX_OID_LEN ];
+    struct Variable_s vp;
+    u_char* val;
+    size_t len;
+    int newlen, rc;
 
+    if ( req->cache == NULL )
+        return;
     /*
-     * Make sure that our basic pipe structure is malloced 
+     * the script failing while the handler still runs (a write getting
+     * EPIPE), the agent doesn't know of the cache yet: it would be found
+     * invalid, and the request left delegated
      */
-    init_persist_pipes();
-
-    for ( i = 1; i <= numpersistpassthrus; i++ ) {
-        persistpassthru = get_exten_instance( persistpassthrus, i );
-        rtest = Api_oidtreeCompare( name, name_len,
-            persistpassthru->miboid,
-            persistpassthru->miblen );
-        if ( rtest <= 0 ) {
-            if ( action != IMPL_ACTION )
-                return PRIOT_ERR_NOERROR;
+    if ( req->handling )
+        cache = req->cache;
+    else
+        cache = AgentHandler_handlerCheckCache( req->cache );
+    if ( cache == NULL ) {
+        DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
+            "a pass_persist request was no longer valid.\n" ) );
+        AgentHandler_freeDelegatedCache( req->cache );
+        return;
+    }
+    request = cache->requests;
+    request->delegated = 0;
+
+    if ( err != PRIOT_ERR_NOERROR ) {
+        /*
+         * as for the proxy, a GETNEXT the script failed is left to the
+         * subtrees which follow
+         */
+        if ( req->type != PERSIST_GETNEXT )
+            Agent_setRequestError( cache->reqinfo, request, err );
+    } else if ( lines ) {
+        newlen = parse_miboid( lines[ 0 ], newname );
+        memset( &vp, 0, sizeof( vp ) );
+        val = newlen ? netsnmp_internal_pass_parse( lines[ 1 ], lines[ 2 ], &len, &vp )
+                     : NULL;
+        if ( val == NULL ) {
+            DEBUG_MSGTL( ( "ucd-snmp/pass_persist", "bad reply from %s\n",
+                p->name ) );
+        } else if ( req->type == PERSIST_GETNEXT
+            && ( Api_oidIsSubtree( p->miboid, p->miblen, newname, newlen ) != 0
+                   || ( rc = Api_oidCompare( newname, newlen, request->requestvb->name,
+                            request->requestvb->nameLength ) )
+                       < 0
+                   || ( rc == 0 && !request->inclusive ) ) ) {
             /*
-             * setup args 
+             * an answer going backwards, or out of the registration, would
+             * have a walk loop or wander off
              */
-            if ( persistpassthru->miblen >= name_len || rtest < 0 )
-                sprint_mib_oid( buf, persistpassthru->miboid,
-                    persistpassthru->miblen );
-            else
-                sprint_mib_oid( buf, name, name_len );
-            snprintf( persistpassthru->command,
-                sizeof( persistpassthru->command ), "set\n%s\n", buf );
-            persistpassthru->command[ sizeof( persistpassthru->command ) - 1 ] = 0;
-            netsnmp_internal_pass_set_format( buf, var_val, var_val_type, var_val_len );
-            String_appendTruncate( persistpassthru->command, buf,
-                sizeof( persistpassthru->command ) );
-            persistpassthru->command[ sizeof( persistpassthru->command ) - 2 ] = '\n';
-            persistpassthru->command[ sizeof( persistpassthru->command ) - 1 ] = 0;
-
-            if ( !open_persist_pipe( i, persistpassthru->name ) ) {
-                return PRIOT_ERR_NOTWRITABLE;
-            }
+            DEBUG_MSGTL( ( "ucd-snmp/pass_persist", "%s answered out of order: ",
+                p->name ) );
+            DEBUG_MSGOID( ( "ucd-snmp/pass_persist", newname, newlen ) );
+            DEBUG_MSG( ( "ucd-snmp/pass_persist", "\n" ) );
+        } else {
+            if ( req->type == PERSIST_GETNEXT )
+                Client_setVarObjid( request->requestvb, newname, newlen );
+            Client_setVarTypedValue( request->requestvb, vp.type, val, len );
+        }
+    } else if ( req->type == PERSIST_GET ) {
+        Client_setVarTypedValue( request->requestvb, PRIOT_NOSUCHINSTANCE, NULL, 0 );
+    }
 
-            DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
-                "persistpass-writing:  %s\n",
-                persistpassthru->command ) );
-            if ( !write_persist_pipe( i, persistpassthru->command ) ) {
-                close_persist_pipe( i );
-                return PRIOT_ERR_NOTWRITABLE;
-            }
+    /* fix bulk_to_next operations */
+    if ( cache->reqinfo->mode == MODE_GETBULK )
+        BulkToNext_fixRequests( request );
 
-            if ( fgets( buf, sizeof( buf ), persist_pipes[ i ].fIn ) == NULL ) {
-                close_persist_pipe( i );
-                return PRIOT_ERR_NOTWRITABLE;
-            }
+    AgentHandler_freeDelegatedCache( cache );
+}
 
-            return netsnmp_internal_pass_str_to_errno( buf );
-        }
+static void
+free_persist_request( struct persist_request* req )
+{
+    free( req->command );
+    free( req );
+}
+
+/*
+ * Done with the oldest command: answers it, and lets the next one out
+ */
+static void
+pop_persist_request( struct persist_pipe_type* p,
+    char lines[][ UTILITIES_MAX_BUFFER ], int err )
+{
+    struct persist_request* req = p->head;
+
+    if ( p->alarm ) {
+        Alarm_unregister( p->alarm );
+        p->alarm = 0;
+    }
+    p->head = req->next;
+    if ( p->head == NULL )
+        p->tail = NULL;
+    p->nsent--;
+    p->nlines = 0;
+
+    answer_persist_request( p, req, lines, err );
+    free_persist_request( req );
+
+    if ( p->nsent > 0 )
+        p->alarm = Alarm_register( p->timeout, AlarmFlag_NO_REPEAT,
+            persist_timed_out, p );
+    flush_persist_pipe( p );
+}
+
+/*
+ * Fails every command written or queued, and stops the script
+ */
+static void
+fail_persist_pipe( struct persist_pipe_type* p )
+{
+    struct persist_request* req;
+
+    if ( p->alarm ) {
+        Alarm_unregister( p->alarm );
+        p->alarm = 0;
     }
-    if ( Debug_getDoDebugging() ) {
-        sprint_mib_oid( buf2, name, name_len );
-        DEBUG_MSGTL( ( "ucd-snmp/pass_persist", "persistpass-notfound:  %s\n",
-            buf2 ) );
+    while ( ( req = p->head ) != NULL ) {
+        p->head = req->next;
+        answer_persist_request( p, req, NULL,
+            req->type == PERSIST_SET ? PRIOT_ERR_NOTWRITABLE : PRIOT_ERR_GENERR );
+        free_persist_request( req );
     }
-    return PRIOT_ERR_NOSUCHNAME;
+    p->tail = NULL;
+    p->nsent = 0;
+    p->nlines = 0;
+    p->buflen = 0;
+    close_persist_pipe( p );
 }
 
-int pass_persist_compare( const void* a, const void* b )
+static void
+persist_timed_out( unsigned clientreg, void* clientarg )
 {
-    const struct extensible *const *ap, *const *bp;
-    ap = ( const struct extensible* const* )a;
-    bp = ( const struct extensible* const* )b;
-    return Api_oidCompare( ( *ap )->miboid, ( *ap )->miblen, ( *bp )->miboid,
-        ( *bp )->miblen );
+    struct persist_pipe_type* p = ( struct persist_pipe_type* )clientarg;
+
+    p->alarm = 0;
+    Logger_log( LOGGER_PRIORITY_WARNING,
+        "pass_persist: %s didn't answer within %ds - restarting it\n",
+        p->name, p->timeout );
+    fail_persist_pipe( p );
 }
 
 /*
- * Initialize our persistent pipes
- *   - Returns 1 on success, 0 on failure.
- *   - Initializes all FILE pointers to NULL to indicate "closed"
+ * One line of the script's reply to its oldest command
  */
-static int
-init_persist_pipes( void )
+static void
+got_persist_line( struct persist_pipe_type* p, char* line )
 {
-    int i;
+    struct persist_request* req = p->head;
 
-    /*
-     * if we are already taken care of, just return 
-     */
-    if ( persist_pipes ) {
-        return persist_pipes ? 1 : 0;
+    if ( req == NULL || p->nsent == 0 ) {
+        Logger_log( LOGGER_PRIORITY_WARNING,
+            "pass_persist: %s wrote without being asked: %s", p->name, line );
+        fail_persist_pipe( p );
+        return;
     }
 
-    /*
-     * Otherwise malloc and initialize 
-     */
-    persist_pipes = ( struct persist_pipe_type* )
-        malloc( sizeof( struct persist_pipe_type ) * ( numpersistpassthrus + 1 ) );
-    if ( persist_pipes ) {
-        for ( i = 0; i <= numpersistpassthrus; i++ ) {
-            persist_pipes[ i ].fIn = persist_pipes[ i ].fOut = ( FILE* )0;
-            persist_pipes[ i ].fdIn = persist_pipes[ i ].fdOut = -1;
-            persist_pipes[ i ].pid = NETSNMP_NO_SUCH_PROCESS;
+    switch ( req->type ) {
+    case PERSIST_PING:
+        if ( strncmp( line, "PONG", 4 ) ) {
+            DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
+                "%s: got %s instead of PONG!\n", p->name, line ) );
+            fail_persist_pipe( p );
+            return;
+        }
+        pop_persist_request( p, NULL, PRIOT_ERR_NOERROR );
+        break;
+
+    case PERSIST_SET:
+        pop_persist_request( p, NULL, netsnmp_internal_pass_str_to_errno( line ) );
+        break;
+
+    default:
+        /*
+         * persistent scripts return "NONE\n" on invalid items
+         */
+        if ( p->nlines == 0 && !strncmp( line, "NONE", 4 ) ) {
+            pop_persist_request( p, NULL, PRIOT_ERR_NOERROR );
+            break;
         }
+        String_copyTruncate( p->lines[ p->nlines ], line, sizeof( p->lines[ 0 ] ) );
+        if ( ++p->nlines == 3 )
+            pop_persist_request( p, p->lines, PRIOT_ERR_NOERROR );
+        break;
+    }
+}
+
+static void
+read_persist_pipe( int fd, void* data )
+{
+    struct persist_pipe_type* p = ( struct persist_pipe_type* )data;
+    char line[ UTILITIES_MAX_BUFFER + 1 ];
+    char* eol;
+    ssize_t n;
+    size_t len;
+
+    n = read( fd, p->buf + p->buflen, sizeof( p->buf ) - p->buflen );
+    if ( n < 0 && ( errno == EAGAIN || errno == EINTR ) )
+        return;
+    if ( n <= 0 ) {
+        Logger_log( LOGGER_PRIORITY_INFO, "pass_persist: %s %s - closing pipe\n",
+            p->name, n == 0 ? "exited" : strerror( errno ) );
+        fail_persist_pipe( p );
+        return;
+    }
+    p->buflen += n;
+
+    while ( ( eol = memchr( p->buf, '\n', p->buflen ) ) != NULL ) {
+        len = eol - p->buf + 1; /* with the newline, which the parsers want */
+        memcpy( line, p->buf, len );
+        line[ len ] = 0;
+        p->buflen -= len;
+        memmove( p->buf, p->buf + len, p->buflen );
+
+        got_persist_line( p, line );
+        if ( p->fdIn != fd )
+            return; /* the line made us close the pipe */
+    }
+    if ( p->buflen == sizeof( p->buf ) ) {
+        Logger_log( LOGGER_PRIORITY_WARNING,
+            "pass_persist: %s wrote a line too long\n", p->name );
+        fail_persist_pipe( p );
     }
-    return persist_pipes ? 1 : 0;
 }
 
 /**
  * Return true if and only if the process associated with the persistent
  * pipe has stopped.
  *
- * @param[in] idx Persistent pipe index.
+ * @param[in] p Persistent pipe.
  */
-static int process_stopped( int idx )
+static int process_stopped( struct persist_pipe_type* p )
 {
-    if ( persist_pipes[ idx ].pid != NETSNMP_NO_SUCH_PROCESS ) {
-        return waitpid( persist_pipes[ idx ].pid, NULL, WNOHANG ) > 0;
+    if ( p->pid != NETSNMP_NO_SUCH_PROCESS ) {
+        return waitpid( p->pid, NULL, WNOHANG ) > 0;
     }
     return 0;
 }
@@ -424,15 +598,13 @@ static int process_stopped( int idx )
  */
 static void check_persist_pipes( unsigned clientreg, void* clientarg )
 {
-    int i;
-
-    if ( !persist_pipes )
-        return;
+    struct persist_pipe_type* p;
 
-    for ( i = 0; i <= numpersistpassthrus; i++ ) {
-        if ( process_stopped( i ) ) {
-            Logger_log( LOGGER_PRIORITY_INFO, "pass_persist[%d]: child process stopped - closing pipe\n", i );
-            close_persist_pipe( i );
+    for ( p = persist_pipes; p; p = p->next ) {
+        if ( process_stopped( p ) ) {
+            Logger_log( LOGGER_PRIORITY_INFO, "pass_persist: %s: child process stopped - closing pipe\n", p->name );
+            p->pid = NETSNMP_NO_SUCH_PROCESS;
+            fail_persist_pipe( p );
         }
     }
 }
@@ -444,203 +616,144 @@ static void check_persist_pipes( unsigned clientreg, void* clientarg )
 static void
 destruct_persist_pipes( void )
 {
-    int i;
-
-    /*
-     * Return if there are no pipes 
-     */
-    if ( !persist_pipes ) {
-        return;
-    }
+    struct persist_pipe_type* p;
 
-    for ( i = 0; i <= numpersistpassthrus; i++ ) {
-        close_persist_pipe( i );
-    }
-
-    free( persist_pipes );
-    persist_pipes = ( struct persist_pipe_type* )0;
+    for ( p = persist_pipes; p; p = p->next )
+        fail_persist_pipe( p );
 }
 
 /*
- * returns 0 on failure, 1 on success 
+ * Starts the script, and queues the PING it must answer first.
+ * returns 0 on failure, 1 on success
  */
 static int
-open_persist_pipe( int iindex, char* command )
+open_persist_pipe( struct persist_pipe_type* p )
 {
-    static int recurse = 0; /* used to allow one level of recursion */
-
-    DEBUG_MSGTL( ( "ucd-snmp/pass_persist", "open_persist_pipe(%d,'%s') recurse=%d\n",
-        iindex, command, recurse ) );
-    /*
-     * Open if it's not already open 
-     */
-    if ( persist_pipes[ iindex ].pid == NETSNMP_NO_SUCH_PROCESS ) {
-        int fdIn, fdOut;
-        Types_PidT pid;
-
-        /*
-         * Did we fail? 
-         */
-        if ( ( 0 == get_exec_pipes( command, &fdIn, &fdOut, &pid ) ) || ( pid == NETSNMP_NO_SUCH_PROCESS ) ) {
-            DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
-                "open_persist_pipe: pid == -1\n" ) );
-            recurse = 0;
-            return 0;
-        }
+    int fdIn, fdOut;
+    Types_PidT pid;
 
-        /*
-         * If not, fill out our structure 
-         */
-        persist_pipes[ iindex ].pid = pid;
-        persist_pipes[ iindex ].fdIn = fdIn;
-        persist_pipes[ iindex ].fdOut = fdOut;
-        persist_pipes[ iindex ].fIn = fdopen( fdIn, "r" );
-        persist_pipes[ iindex ].fOut = fdopen( fdOut, "w" );
+    DEBUG_MSGTL( ( "ucd-snmp/pass_persist", "open_persist_pipe('%s')\n",
+        p->name ) );
 
-        /*
-         * Setup our -non-buffered-io- 
-         */
-        setbuf( persist_pipes[ iindex ].fOut, ( char* )0 );
-        DEBUG_MSGTL( ( "ucd-snmp/pass_persist", "open_persist_pipe: opened the pipes\n" ) );
+    if ( ( 0 == get_exec_pipes( p->name, &fdIn, &fdOut, &pid ) ) || ( pid == NETSNMP_NO_SUCH_PROCESS ) ) {
+        DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
+            "open_persist_pipe: pid == -1\n" ) );
+        return 0;
     }
+    p->pid = pid;
+    p->fdIn = fdIn;
+    p->fdOut = fdOut;
+    p->buflen = 0;
+    p->nlines = 0;
 
     /*
-     * Send test packet always so we can self-catch 
+     * neither end may hold the agent up: replies are read as they come, and
+     * what doesn't fit in the pipe waits for the script to catch up
      */
-    {
-        char buf[ UTILITIES_MAX_BUFFER ];
-        /*
-         * Should catch SIGPIPE around this call! 
-         */
-        if ( !write_persist_pipe( iindex, "PING\n" ) ) {
-            DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
-                "open_persist_pipe: Error writing PING\n" ) );
-            close_persist_pipe( iindex );
-
-            /*
-             * Recurse one time if we get a SIGPIPE 
-             */
-            if ( !recurse ) {
-                DEBUG_MSGTL( ( "ucd-snmp/pass_persist", "open_persist_pipe: recursing to reopen\n" ) );
-                recurse = 1;
-                return open_persist_pipe( iindex, command );
-            }
-            recurse = 0;
-            return 0;
-        }
-        if ( fgets( buf, sizeof( buf ), persist_pipes[ iindex ].fIn ) == NULL ) {
-            DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
-                "open_persist_pipe: Error reading for PONG\n" ) );
-            close_persist_pipe( iindex );
-            recurse = 0;
-            return 0;
-        }
-        if ( strncmp( buf, "PONG", 4 ) ) {
-            DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
-                "open_persist_pipe: Got %s instead of PONG!\n", buf ) );
-            close_persist_pipe( iindex );
-            recurse = 0;
-            return 0;
-        }
+    if ( SocketBaseDomain_setNonBlockingMode( fdIn, 1 ) < 0
+        || SocketBaseDomain_setNonBlockingMode( fdOut, 1 ) < 0
+        || FdEventManager_registerReadFD( fdIn, read_persist_pipe, p ) != 0 ) {
+        DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
+            "open_persist_pipe: can't watch the pipe\n" ) );
+        close_persist_pipe( p );
+        return 0;
     }
+    DEBUG_MSGTL( ( "ucd-snmp/pass_persist", "open_persist_pipe: opened the pipes\n" ) );
 
-    recurse = 0;
-    return 1;
+    /*
+     * Send test packet always so we can self-catch
+     */
+    if ( !queue_persist_request( p, PERSIST_PING, NULL, "PING\n" ) ) {
+        close_persist_pipe( p );
+        return 0;
+    }
+    return p->pid != NETSNMP_NO_SUCH_PROCESS;
 }
 
-static int
-write_persist_pipe( int iindex, const char* data )
+/*
+ * Writes what the window allows of the queued commands
+ */
+static void
+flush_persist_pipe( struct persist_pipe_type* p )
 {
     struct sigaction sa, osa;
-    int wret = 0, werrno = 0;
+    struct persist_request* req;
+    ssize_t wret;
+    int i, werrno = 0;
 
-    /*
-     * Don't write to a non-existant process 
-     */
-    if ( persist_pipes[ iindex ].pid == NETSNMP_NO_SUCH_PROCESS ) {
-        DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
-            "write_persist_pipe: not writing %s, process is non-existent",
-            data ) );
-        return 0;
-    }
+    if ( p->fdOut == -1 )
+        return;
+
+    for ( i = 0, req = p->head; req && i < p->nsent; i++ )
+        req = req->next;
+    if ( req == NULL || p->nsent >= PERSIST_WINDOW )
+        return;
 
     /*
-     * Setup our signal action to ignore SIGPIPEs 
+     * Setup our signal action to ignore SIGPIPEs
      */
     sa.sa_handler = SIG_IGN;
     sigemptyset( &sa.sa_mask );
     sa.sa_flags = 0;
     if ( sigaction( SIGPIPE, &sa, &osa ) ) {
         DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
-            "write_persist_pipe: sigaction failed: %d", errno ) );
+            "flush_persist_pipe: sigaction failed: %d", errno ) );
     }
 
-    /*
-     * Do the write 
-     */
-    wret = write( persist_pipes[ iindex ].fdOut, data, strlen( data ) );
-    werrno = errno;
+    for ( ; req && p->nsent < PERSIST_WINDOW; req = req->next ) {
+        wret = write( p->fdOut, req->command + req->off, req->len - req->off );
+        if ( wret < 0 ) {
+            werrno = errno;
+            break;
+        }
+        req->off += wret;
+        if ( req->off < req->len )
+            break; /* the pipe is full */
+        if ( p->nsent++ == 0 )
+            p->alarm = Alarm_register( p->timeout, AlarmFlag_NO_REPEAT,
+                persist_timed_out, p );
+    }
 
     /*
-     * Reset the signal handler 
+     * Reset the signal handler
      */
     sigaction( SIGPIPE, &osa, ( struct sigaction* )0 );
 
-    if ( wret < 0 ) {
+    if ( werrno && werrno != EAGAIN && werrno != EINTR ) {
         if ( werrno != EPIPE ) {
             DEBUG_MSGTL( ( "ucd-snmp/pass_persist",
-                "write_persist_pipe: write returned unknown error %d (%s)\n",
+                "flush_persist_pipe: write returned unknown error %d (%s)\n",
                 werrno, strerror( werrno ) ) );
         }
-        close_persist_pipe( iindex );
-        return 0;
+        fail_persist_pipe( p );
     }
-
-    return 1;
 }
 
 static void
-close_persist_pipe( int iindex )
+close_persist_pipe( struct persist_pipe_type* p )
 {
     /*
-     * Check and nix every item 
+     * Check and nix every item
      */
-    if ( persist_pipes[ iindex ].fOut ) {
-        fclose( persist_pipes[ iindex ].fOut );
-        persist_pipes[ iindex ].fOut = ( FILE* )0;
+    if ( p->fdOut != -1 ) {
+        close( p->fdOut );
+        p->fdOut = -1;
     }
-    if ( persist_pipes[ iindex ].fdOut != -1 ) {
-        /*
-         * The sequence open()/fdopen()/fclose()/close() triggers an access
-         * violation with the MSVC runtime. Hence skip the close() call when
-         * using the MSVC runtime.
-         */
-        close( persist_pipes[ iindex ].fdOut );
-        persist_pipes[ iindex ].fdOut = -1;
-    }
-    if ( persist_pipes[ iindex ].fIn ) {
-        fclose( persist_pipes[ iindex ].fIn );
-        persist_pipes[ iindex ].fIn = ( FILE* )0;
-    }
-    if ( persist_pipes[ iindex ].fdIn != -1 ) {
-        /*
-         * The sequence open()/fdopen()/fclose()/close() triggers an access
-         * violation with the MSVC runtime. Hence skip the close() call when
-         * using the MSVC runtime.
-         */
-        close( persist_pipes[ iindex ].fdIn );
-        persist_pipes[ iindex ].fdIn = -1;
+    if ( p->fdIn != -1 ) {
+        FdEventManager_unregisterReadFD( p->fdIn );
+        close( p->fdIn );
+        p->fdIn = -1;
     }
 
-    if ( persist_pipes[ iindex ].pid != NETSNMP_NO_SUCH_PROCESS ) {
+    if ( p->pid != NETSNMP_NO_SUCH_PROCESS ) {
         /*
          * kill the child, in case we got an error and the child is not
          * cooperating.  Ignore the return code.
          */
-        ( void )kill( persist_pipes[ iindex ].pid, SIGKILL );
+        ( void )kill( p->pid, SIGKILL );
 
-        waitpid( persist_pipes[ iindex ].pid, NULL, 0 );
+        waitpid( p->pid, NULL, 0 );
 
-        persist_pipes[ iindex ].pid = NETSNMP_NO_SUCH_PROCESS;
+        p->pid = NETSNMP_NO_SUCH_PROCESS;
     }
 }
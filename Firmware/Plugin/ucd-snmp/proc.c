@@ -11,12 +11,34 @@
 #include "struct.h"
 #include "util_funcs.h"
 #include "utilities/header_simple_table.h"
+#include <regex.h>
 
 static struct myproc* get_proc_instance( struct myproc*, oid );
+static void _proc_index_free( void );
+static void _proc_count( void );
 struct myproc* procwatch = NULL;
 static struct extensible fixproc;
 int numprocs = 0;
 
+/*
+ * Index of the configured entries, used to count the processes of the
+ * whole table in one pass over the swrun container.  It is rebuilt
+ * when the configuration changes, and the counts are redone once per
+ * process list generation.
+ */
+static struct {
+    int stale; /* configuration changed since the last build */
+    int counted; /* counts are valid for generation */
+    u_int generation;
+    struct myproc** names; /* exact names, sorted */
+    size_t nnames;
+    struct myproc** patterns; /* regex entries */
+    regex_t* regex;
+    size_t npatterns;
+    regex_t combined; /* matches if any pattern does */
+    int have_combined;
+} _proc_index = { .stale = 1 };
+
 void init_proc( void )
 {
 
@@ -60,6 +82,9 @@ void init_proc( void )
     AgentReadConfig_priotdRegisterConfigHandler( "proc", proc_parse_config,
         proc_free_config,
         "process-name [max-num] [min-num]" );
+    AgentReadConfig_priotdRegisterConfigHandler( "procregex", proc_parse_config,
+        NULL,
+        "regex [max-num] [min-num]" );
     AgentReadConfig_priotdRegisterConfigHandler( "procfix", procfix_parse_config, NULL,
         "process-name program [arguments...]" );
 }
@@ -80,6 +105,8 @@ void proc_free_config( void )
     }
     procwatch = NULL;
     numprocs = 0;
+    _proc_index_free();
+    _proc_index.stale = 1;
 }
 
 /*
@@ -125,6 +152,8 @@ void proc_parse_config( const char* token, char* cptr )
 {
     char tmpname[ STRMAX ];
     struct myproc** procp = &procwatch;
+    int is_regex = ( 0 == strcmp( token, "procregex" ) );
+    regex_t re;
 
     /*
      * don't allow two entries with the same name 
@@ -134,6 +163,13 @@ void proc_parse_config( const char* token, char* cptr )
         ReadConfig_configPerror( "Already have an entry for this process." );
         return;
     }
+    if ( is_regex ) {
+        if ( regcomp( &re, tmpname, REG_EXTENDED | REG_NOSUB ) != 0 ) {
+            ReadConfig_configPerror( "Invalid regular expression." );
+            return;
+        }
+        regfree( &re );
+    }
 
     /*
      * skip past used ones 
@@ -145,6 +181,8 @@ void proc_parse_config( const char* token, char* cptr )
     if ( *procp == NULL )
         return; /* memory alloc error */
     numprocs++;
+    _proc_index.stale = 1;
+    ( *procp )->regex = is_regex;
     /*
      * not blank and not a comment 
      */
@@ -166,10 +204,170 @@ void proc_parse_config( const char* token, char* cptr )
          * processes that should _not_ be running. */
     }
 
-    DEBUG_MSGTL( ( "ucd-snmp/proc", "Read:  %s (%d) (%d)\n",
+    DEBUG_MSGTL( ( "ucd-snmp/proc", "Read:  %s%s (%d) (%d)\n",
+        ( *procp )->regex ? "regex " : "",
         ( *procp )->name, ( *procp )->max, ( *procp )->min ) );
 }
 
+/*
+ * build and use the name index
+ */
+
+static int
+_proc_name_compare( const void* lhs, const void* rhs )
+{
+    return strcmp( ( *( struct myproc* const* )lhs )->name,
+        ( *( struct myproc* const* )rhs )->name );
+}
+
+static int
+_proc_name_find( const void* key, const void* elem )
+{
+    return strcmp( ( const char* )key, ( *( struct myproc* const* )elem )->name );
+}
+
+static void
+_proc_index_free( void )
+{
+    size_t i;
+
+    for ( i = 0; i < _proc_index.npatterns; i++ )
+        regfree( &_proc_index.regex[ i ] );
+    if ( _proc_index.have_combined )
+        regfree( &_proc_index.combined );
+    MEMORY_FREE( _proc_index.names );
+    MEMORY_FREE( _proc_index.patterns );
+    MEMORY_FREE( _proc_index.regex );
+    _proc_index.nnames = 0;
+    _proc_index.npatterns = 0;
+    _proc_index.have_combined = 0;
+    _proc_index.counted = 0;
+}
+
+/*
+ * The combined pattern "(p1)|(p2)|..." only rules out processes that
+ * match none of the entries; a process that passes is then tried
+ * against each pattern, since it may match several of them.
+ */
+static void
+_proc_index_combine( void )
+{
+    size_t i, len = 1;
+    char *buf, *cp;
+
+    if ( _proc_index.npatterns < 2 )
+        return;
+    for ( i = 0; i < _proc_index.npatterns; i++ ) {
+        /* wrapping in groups would renumber back references */
+        if ( strchr( _proc_index.patterns[ i ]->name, '\\' ) )
+            return;
+        len += strlen( _proc_index.patterns[ i ]->name ) + 3;
+    }
+    if ( ( buf = ( char* )malloc( len ) ) == NULL )
+        return;
+    for ( i = 0, cp = buf; i < _proc_index.npatterns; i++ )
+        cp += sprintf( cp, "%s(%s)", i ? "|" : "", _proc_index.patterns[ i ]->name );
+    _proc_index.have_combined = ( regcomp( &_proc_index.combined, buf,
+                                      REG_EXTENDED | REG_NOSUB )
+        == 0 );
+    free( buf );
+}
+
+static void
+_proc_index_build( void )
+{
+    struct myproc* proc;
+
+    _proc_index_free();
+    _proc_index.stale = 0;
+    if ( numprocs == 0 )
+        return;
+
+    _proc_index.names = ( struct myproc** )calloc( numprocs, sizeof( struct myproc* ) );
+    _proc_index.patterns = ( struct myproc** )calloc( numprocs, sizeof( struct myproc* ) );
+    _proc_index.regex = ( regex_t* )calloc( numprocs, sizeof( regex_t ) );
+    if ( !_proc_index.names || !_proc_index.patterns || !_proc_index.regex ) {
+        _proc_index_free();
+        _proc_index.stale = 1;
+        return;
+    }
+
+    for ( proc = procwatch; proc != NULL; proc = proc->next ) {
+        if ( !proc->regex ) {
+            _proc_index.names[ _proc_index.nnames++ ] = proc;
+            continue;
+        }
+        if ( regcomp( &_proc_index.regex[ _proc_index.npatterns ], proc->name,
+                 REG_EXTENDED | REG_NOSUB )
+            != 0 ) {
+            Logger_log( LOGGER_PRIORITY_ERR, "proc: could not compile %s\n",
+                proc->name );
+            continue;
+        }
+        _proc_index.patterns[ _proc_index.npatterns++ ] = proc;
+    }
+    qsort( _proc_index.names, _proc_index.nnames, sizeof( struct myproc* ),
+        _proc_name_compare );
+    _proc_index_combine();
+
+    DEBUG_MSGTL( ( "ucd-snmp/proc", "index: %" NETSNMP_PRIz "d names, %" NETSNMP_PRIz "d patterns%s\n",
+        _proc_index.nnames, _proc_index.npatterns,
+        _proc_index.have_combined ? " (combined)" : "" ) );
+}
+
+/*
+ * bring proc->count up to date for every entry
+ */
+static void
+_proc_count( void )
+{
+    Container_Container* container;
+    Container_Iterator* it;
+    netsnmp_swrun_entry* entry;
+    struct myproc* proc;
+    struct myproc** found;
+    u_int generation;
+    size_t i;
+
+    if ( _proc_index.stale ) {
+        _proc_index_build();
+        _proc_index.counted = 0;
+    }
+
+    container = swrun_processes( &generation );
+    if ( _proc_index.counted && generation == _proc_index.generation )
+        return;
+
+    for ( proc = procwatch; proc != NULL; proc = proc->next )
+        proc->count = 0;
+    if ( container == NULL || ( it = CONTAINER_ITERATOR( container ) ) == NULL ) {
+        _proc_index.counted = 0;
+        return;
+    }
+
+    while ( ( entry = ( netsnmp_swrun_entry* )CONTAINER_ITERATOR_NEXT( it ) ) != NULL ) {
+        if ( _proc_index.nnames ) {
+            found = ( struct myproc** )bsearch( entry->hrSWRunName,
+                _proc_index.names, _proc_index.nnames,
+                sizeof( struct myproc* ), _proc_name_find );
+            if ( found )
+                ( *found )->count++;
+        }
+        if ( _proc_index.npatterns == 0 )
+            continue;
+        if ( _proc_index.have_combined
+            && regexec( &_proc_index.combined, entry->hrSWRunName, 0, NULL, 0 ) != 0 )
+            continue;
+        for ( i = 0; i < _proc_index.npatterns; i++ )
+            if ( regexec( &_proc_index.regex[ i ], entry->hrSWRunName, 0, NULL, 0 ) == 0 )
+                _proc_index.patterns[ i ]->count++;
+    }
+    CONTAINER_ITERATOR_RELEASE( it );
+
+    _proc_index.counted = 1;
+    _proc_index.generation = generation;
+}
+
 /*
  * The routine that handles everything 
  */
@@ -190,6 +388,7 @@ var_extensible_proc( struct Variable_s* vp,
         return ( NULL );
 
     if ( ( proc = get_proc_instance( procwatch, name[ *length - 1 ] ) ) ) {
+        _proc_count();
         switch ( vp->magic ) {
         case MIBINDEX:
             long_ret = name[ *length - 1 ];
@@ -204,10 +403,10 @@ var_extensible_proc( struct Variable_s* vp,
             long_ret = proc->max;
             return ( ( u_char* )( &long_ret ) );
         case PROCCOUNT:
-            long_ret = sh_count_procs( proc->name );
+            long_ret = proc->count;
             return ( ( u_char* )( &long_ret ) );
         case ERRORFLAG:
-            long_ret = sh_count_procs( proc->name );
+            long_ret = proc->count;
             if ( long_ret >= 0 &&
                 /* Too few processes running */
                 ( ( proc->min && long_ret < proc->min ) ||
@@ -221,7 +420,7 @@ var_extensible_proc( struct Variable_s* vp,
             }
             return ( ( u_char* )( &long_ret ) );
         case ERRORMSG:
-            long_ret = sh_count_procs( proc->name );
+            long_ret = proc->count;
             if ( long_ret < 0 ) {
                 errmsg[ 0 ] = 0; /* catch out of mem errors return 0 count */
             } else if ( proc->min && long_ret < proc->min ) {
@@ -304,5 +503,10 @@ get_proc_instance( struct myproc* proc, oid inst )
 
 int sh_count_procs( char* procname )
 {
-    return swrun_count_processes_by_name( procname );
+    struct myproc* proc = get_proc_by_name( procname );
+
+    if ( proc == NULL )
+        return swrun_count_processes_by_name( procname );
+    _proc_count();
+    return proc->count;
 }
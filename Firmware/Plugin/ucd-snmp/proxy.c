@@ -18,22 +18,69 @@
 #include "System/Util/DefaultStore.h"
 #include "Impl.h"
 #include "System/Util/Logger.h"
+#include "System/Util/Time.h"
 #include "Mib.h"
 #include "ParseArgs.h"
 #include "Priot.h"
 #include "ReadConfig.h"
 #include "Session.h"
 
+#include <sys/time.h>
+
+/*
+ * a PDU on its way to a target, and what to do with the answer
+ */
+struct proxy_request {
+    DelegatedCache* cache;
+    struct proxy_target* target;
+    int command; /* the PDU type sent upstream */
+    Types_Pdu* pdu; /* until it has been sent */
+    VariableList* asked; /* what a GETNEXT or GETBULK asked about */
+    size_t nvars;
+    struct proxy_request* next;
+};
+
+/*
+ * an answer a target gave: the value of name for MODE_GET, or what
+ * follows name for MODE_GETNEXT
+ */
+struct proxy_cached {
+    int mode;
+    oid name[ asnMAX_OID_LEN ];
+    size_t name_len;
+    VariableList* var;
+    struct timeval expires;
+    struct proxy_cached* next;
+};
+
 static struct simple_proxy* proxies = NULL;
+static struct proxy_target* proxy_targets = NULL;
 
 oid testoid[] = { 1, 3, 6, 1, 4, 1, 2021, 8888, 1 };
 
 /*
- * this must be standardized somewhere, right? 
+ * this must be standardized somewhere, right?
  */
 #define MAX_ARGS 128
 
 char* context_string;
+static int proxy_window, proxy_bulk, proxy_ttl;
+
+static void
+proxyOptNumber( int argc, char* const* argv, int* value, int min,
+    const char* opt )
+{
+    char buf[ 64 ];
+    int n;
+
+    optind++;
+    if ( optind < argc && ( n = atoi( argv[ optind - 1 ] ) ) >= min ) {
+        *value = n;
+        return;
+    }
+    snprintf( buf, sizeof( buf ), "%s needs a number of at least %d", opt, min );
+    ReadConfig_configPerror( buf );
+}
 
 static void
 proxyOptProc( int argc, char* const* argv, int opt )
@@ -54,6 +101,15 @@ proxyOptProc( int argc, char* const* argv, int opt )
                 DefaultStore_setBoolean( DsStore_LIBRARY_ID,
                     DsBool_IGNORE_NO_COMMUNITY, 1 );
                 break;
+            case 'w':
+                proxyOptNumber( argc, argv, &proxy_window, 1, "-Cw" );
+                break;
+            case 'b':
+                proxyOptNumber( argc, argv, &proxy_bulk, 0, "-Cb" );
+                break;
+            case 't':
+                proxyOptNumber( argc, argv, &proxy_ttl, 0, "-Ct" );
+                break;
             default:
                 ReadConfig_configPerror( "unknown argument passed to -C" );
                 break;
@@ -63,30 +119,264 @@ proxyOptProc( int argc, char* const* argv, int opt )
     default:
         break;
         /*
-         * shouldn't get here 
+         * shouldn't get here
+         */
+    }
+}
+
+static unsigned int
+proxy_cache_hash( int mode, const oid* name, size_t len )
+{
+    unsigned int h = mode;
+    size_t i;
+
+    for ( i = 0; i < len; i++ )
+        h = h * 31 + name[ i ];
+    return h % PROXY_CACHE_BUCKETS;
+}
+
+static void
+proxy_cache_expire( struct proxy_target* t, const struct timeval* now )
+{
+    struct proxy_cached **prev, *c;
+    int i;
+
+    for ( i = 0; i < PROXY_CACHE_BUCKETS; i++ ) {
+        for ( prev = &t->cache[ i ]; ( c = *prev ) != NULL; ) {
+            if ( now == NULL || timercmp( &c->expires, now, < ) ) {
+                *prev = c->next;
+                Api_freeVar( c->var );
+                free( c );
+                t->ncached--;
+            } else {
+                prev = &c->next;
+            }
+        }
+    }
+}
+
+static void
+proxy_cache_flush( struct proxy_target* t )
+{
+    if ( t->ncached ) {
+        DEBUG_MSGTL( ( "proxy/cache", "dropping %d answers from %s\n",
+            t->ncached, t->key ) );
+        proxy_cache_expire( t, NULL );
+    }
+}
+
+const VariableList*
+proxy_cache_find( struct proxy_target* t, int mode, const oid* name,
+    size_t len )
+{
+    struct proxy_cached **prev, *c;
+    struct timeval now;
+
+    if ( t->ncached == 0 )
+        return NULL;
+
+    for ( prev = &t->cache[ proxy_cache_hash( mode, name, len ) ];
+          ( c = *prev ) != NULL; prev = &c->next ) {
+        if ( c->mode != mode
+            || Api_oidEquals( c->name, c->name_len, name, len ) != 0 )
+            continue;
+        Time_getMonotonicClock( &now );
+        if ( timercmp( &c->expires, &now, < ) ) {
+            *prev = c->next;
+            Api_freeVar( c->var );
+            free( c );
+            t->ncached--;
+            return NULL;
+        }
+        return c->var;
+    }
+    return NULL;
+}
+
+static void
+proxy_cache_store( struct proxy_target* t, int mode, const oid* name,
+    size_t len, VariableList* var, const struct timeval* expires )
+{
+    struct proxy_cached* c;
+    VariableList *copy, *next;
+    struct timeval now;
+    unsigned int h;
+
+    if ( len > asnMAX_OID_LEN || var->type == PRIOT_NOSUCHOBJECT
+        || var->type == PRIOT_NOSUCHINSTANCE || var->type == PRIOT_ENDOFMIBVIEW )
+        return;
+
+    next = var->next;
+    var->next = NULL;
+    copy = Client_cloneVarbind( var );
+    var->next = next;
+    if ( copy == NULL )
+        return;
+
+    h = proxy_cache_hash( mode, name, len );
+    for ( c = t->cache[ h ]; c; c = c->next )
+        if ( c->mode == mode && Api_oidEquals( c->name, c->name_len, name, len ) == 0 )
+            break;
+
+    if ( c == NULL ) {
+        if ( t->ncached >= PROXY_CACHE_MAX ) {
+            Time_getMonotonicClock( &now );
+            proxy_cache_expire( t, &now );
+        }
+        if ( t->ncached >= PROXY_CACHE_MAX
+            || ( c = MEMORY_MALLOC_TYPEDEF( struct proxy_cached ) ) == NULL ) {
+            Api_freeVar( copy );
+            return;
+        }
+        c->mode = mode;
+        memcpy( c->name, name, len * sizeof( oid ) );
+        c->name_len = len;
+        c->next = t->cache[ h ];
+        t->cache[ h ] = c;
+        t->ncached++;
+    } else {
+        Api_freeVar( c->var );
+    }
+    c->var = copy;
+    c->expires = *expires;
+}
+
+/*
+ * Remember what a target answered.  A GETNEXT that went out as a GETBULK
+ * comes back with, for each varbind, the rows that follow it; each of
+ * those is kept as the answer to a GETNEXT on the one before, so that the
+ * rest of a walk needn't go upstream again.
+ */
+void proxy_cache_response( struct proxy_target* t, int command,
+    VariableList* asked, size_t nvars, Types_Pdu* pdu )
+{
+    VariableList *var, **before;
+    struct timeval expires;
+    size_t i;
+
+    if ( command == PRIOT_MSG_SET ) {
+        proxy_cache_flush( t );
+        return;
+    }
+    if ( t->ttl <= 0 || pdu->errstat != PRIOT_ERR_NOERROR )
+        return;
+
+    Time_getMonotonicClock( &expires );
+    expires.tv_sec += t->ttl;
+
+    if ( command == PRIOT_MSG_GET ) {
+        for ( var = pdu->variables; var; var = var->next )
+            proxy_cache_store( t, MODE_GET, var->name, var->nameLength, var,
+                &expires );
+        return;
+    }
+
+    if ( asked == NULL
+        || ( before = ( VariableList** )calloc( nvars, sizeof( VariableList* ) ) ) == NULL )
+        return;
+    for ( i = 0, var = asked; var && i < nvars; var = var->next )
+        before[ i++ ] = var;
+
+    /*
+     * the i-th varbind of a row follows the i-th of the row before it; a
+     * column ends at its first exception
+     */
+    for ( i = 0, var = pdu->variables; var; var = var->next ) {
+        if ( before[ i ] ) {
+            proxy_cache_store( t, MODE_GETNEXT, before[ i ]->name,
+                before[ i ]->nameLength, var, &expires );
+            before[ i ] = ( var->type == PRIOT_ENDOFMIBVIEW
+                              || var->type == PRIOT_NOSUCHOBJECT
+                              || var->type == PRIOT_NOSUCHINSTANCE )
+                ? NULL
+                : var;
+        }
+        if ( ++i == nvars )
+            i = 0;
+    }
+    free( before );
+
+    DEBUG_MSGTL( ( "proxy/cache", "%d answers kept for %s\n", t->ncached,
+        t->key ) );
+}
+
+static struct proxy_target*
+proxy_get_target( const char* key, Types_Session* session )
+{
+    struct proxy_target* t;
+    Types_Session* ss;
+
+    for ( t = proxy_targets; t; t = t->next ) {
+        if ( strcmp( t->key, key ) == 0 ) {
+            DEBUG_MSGTL( ( "proxy_init", "sharing the session to %s\n", key ) );
+            t->refcount++;
+            return t;
+        }
+    }
+
+    /*
+     * usm_set_reportErrorOnUnknownID(0);
+     *
+     * hack, stupid v3 ASIs.
+     */
+    /*
+     * XXX: on a side note, we don't really need to be a reference
+     * platform any more so the proper thing to do would be to fix
+     * snmplib/snmpusm.c to pass in the pdu type to usm_process_incoming
+     * so this isn't needed.
+     */
+    ss = Api_open( session );
+    /*
+     * usm_set_reportErrorOnUnknownID(1);
+     */
+    if ( ss == NULL ) {
+        /*
+         * diagnose snmp_open errors with the input Types_Session pointer
          */
+        Api_sessPerror( "snmpget", session );
+        return NULL;
+    }
+
+    t = MEMORY_MALLOC_TYPEDEF( struct proxy_target );
+    if ( t == NULL || ( t->key = strdup( key ) ) == NULL ) {
+        free( t );
+        Api_close( ss );
+        return NULL;
     }
+    t->sess = ss;
+    t->refcount = 1;
+    t->window = proxy_window;
+    t->bulk = proxy_bulk;
+    t->ttl = proxy_ttl;
+    t->next = proxy_targets;
+    proxy_targets = t;
+    return t;
 }
 
 void proxy_parse_config( const char* token, char* line )
 {
     /*
-     * proxy args [base-oid] [remap-to-remote-oid] 
+     * proxy args [base-oid] [remap-to-remote-oid]
      */
 
-    Types_Session session, *ss;
+    Types_Session session;
     struct simple_proxy *newp, **listpp;
+    struct proxy_target* target;
     char args[ MAX_ARGS ][ IMPL_SPRINT_MAX_LEN ], *argv[ MAX_ARGS ];
-    int argn, arg;
-    char* cp;
+    int argn, arg, nopts;
+    char *cp, *key;
+    size_t keylen;
     HandlerRegistration* reg;
 
     context_string = NULL;
+    proxy_window = PROXY_DEFAULT_WINDOW;
+    proxy_bulk = PROXY_DEFAULT_BULK;
+    proxy_ttl = PROXY_DEFAULT_TTL;
 
     DEBUG_MSGTL( ( "proxy_config", "entering\n" ) );
 
     /*
-     * create the argv[] like array 
+     * create the argv[] like array
      */
     strcpy( argv[ 0 ] = args[ 0 ], "snmpd-proxy" ); /* bogus entry for getopt() */
     for ( argn = 1, cp = line; cp && argn < MAX_ARGS; ) {
@@ -119,38 +409,18 @@ void proxy_parse_config( const char* token, char* line )
         ReadConfig_configPerror( "missing base oid" );
         return;
     }
-
-    /*
-     * usm_set_reportErrorOnUnknownID(0); 
-     *
-     * hack, stupid v3 ASIs. 
-     */
-    /*
-     * XXX: on a side note, we don't really need to be a reference
-     * platform any more so the proper thing to do would be to fix
-     * snmplib/snmpusm.c to pass in the pdu type to usm_process_incoming
-     * so this isn't needed. 
-     */
-    ss = Api_open( &session );
-    /*
-     * usm_set_reportErrorOnUnknownID(1); 
-     */
-    if ( ss == NULL ) {
-        /*
-         * diagnose snmp_open errors with the input Types_Session pointer 
-         */
-        Api_sessPerror( "snmpget", &session );
-        return;
-    }
+    nopts = arg;
 
     newp = ( struct simple_proxy* )calloc( 1, sizeof( struct simple_proxy ) );
+    if ( newp == NULL )
+        return;
 
-    newp->sess = ss;
     DEBUG_MSGTL( ( "proxy_init", "name = %s\n", args[ arg ] ) );
     newp->name_len = asnMAX_OID_LEN;
     if ( !Mib_parseOid( args[ arg++ ], newp->name, &newp->name_len ) ) {
         Api_perror( "proxy" );
         ReadConfig_configPerror( "illegal proxy oid specified\n" );
+        free( newp );
         return;
     }
 
@@ -160,9 +430,36 @@ void proxy_parse_config( const char* token, char* line )
         if ( !Mib_parseOid( args[ arg++ ], newp->base, &newp->base_len ) ) {
             Api_perror( "proxy" );
             ReadConfig_configPerror( "illegal variable name specified (base oid)\n" );
+            free( newp );
             return;
         }
     }
+
+    /*
+     * the options and the host name up to the oids say which session
+     * this is
+     */
+    for ( keylen = 1, arg = 1; arg < nopts; arg++ )
+        keylen += strlen( argv[ arg ] ) + 1;
+    key = ( char* )malloc( keylen );
+    if ( key == NULL ) {
+        free( newp );
+        return;
+    }
+    for ( *key = '\0', arg = 1; arg < nopts; arg++ ) {
+        if ( arg > 1 )
+            strcat( key, " " );
+        strcat( key, argv[ arg ] );
+    }
+    target = proxy_get_target( key, &session );
+    free( key );
+    if ( target == NULL ) {
+        free( newp );
+        return;
+    }
+
+    newp->target = target;
+    newp->sess = target->sess;
     if ( context_string )
         newp->context = strdup( context_string );
 
@@ -171,10 +468,10 @@ void proxy_parse_config( const char* token, char* line )
     DEBUG_MSG( ( "proxy_init", "\n" ) );
 
     /*
-     * add to our chain 
+     * add to our chain
      */
     /*
-     * must be sorted! 
+     * must be sorted!
      */
     listpp = &proxies;
     while ( *listpp && Api_oidCompare( newp->name, newp->name_len, ( *listpp )->name, ( *listpp )->name_len ) > 0 ) {
@@ -182,16 +479,16 @@ void proxy_parse_config( const char* token, char* line )
     }
 
     /*
-     * listpp should be next in line from us. 
+     * listpp should be next in line from us.
      */
     if ( *listpp ) {
         /*
-         * make our next in the link point to the current link 
+         * make our next in the link point to the current link
          */
         newp->next = *listpp;
     }
     /*
-     * replace current link with us 
+     * replace current link with us
      */
     *listpp = newp;
 
@@ -207,6 +504,75 @@ void proxy_parse_config( const char* token, char* line )
     AgentHandler_registerHandler( reg );
 }
 
+static void
+proxy_free_request( struct proxy_request* pr )
+{
+    if ( pr->pdu )
+        Api_freePdu( pr->pdu );
+    if ( pr->asked )
+        Api_freeVarbind( pr->asked );
+    free( pr );
+}
+
+/*
+ * No answer is coming: a GETNEXT moves on past the proxied tree, anything
+ * else fails
+ */
+static void
+proxy_timed_out( DelegatedCache* cache )
+{
+    cache = AgentHandler_handlerCheckCache( cache );
+    if ( !cache ) {
+        DEBUG_MSGTL( ( "proxy", "a proxy request was no longer valid.\n" ) );
+        return;
+    }
+
+    DEBUG_MSGTL( ( "proxy", "got timed out... requests = %8p\n",
+        cache->requests ) );
+    AgentHandler_handlerMarkRequestsAsDelegated( cache->requests,
+        REQUEST_IS_NOT_DELEGATED );
+    if ( cache->reqinfo->mode != MODE_GETNEXT ) {
+        DEBUG_MSGTL( ( "proxy", "  ignoring timeout\n" ) );
+        Agent_setRequestError( cache->reqinfo, cache->requests, /* XXXWWW: should be index = 0 */
+            PRIOT_ERR_GENERR );
+    }
+    AgentHandler_freeDelegatedCache( cache );
+}
+
+static void
+proxy_release_target( struct proxy_target* t )
+{
+    struct proxy_target** prev;
+    struct proxy_request* pr;
+
+    if ( --t->refcount > 0 )
+        return;
+
+    for ( prev = &proxy_targets; *prev; prev = &( *prev )->next ) {
+        if ( *prev == t ) {
+            *prev = t->next;
+            break;
+        }
+    }
+
+    /*
+     * what is still queued is never sent; closing the session times out
+     * what is outstanding
+     */
+    t->closing = 1;
+    while ( ( pr = t->head ) != NULL ) {
+        t->head = pr->next;
+        proxy_timed_out( pr->cache );
+        proxy_free_request( pr );
+    }
+    t->tail = NULL;
+    Api_close( t->sess );
+
+    proxy_cache_flush( t );
+    MEMORY_FREE( t->key );
+    MEMORY_FREE( t );
+}
+
 void proxy_free_config( void )
 {
     struct simple_proxy* rm;
@@ -224,14 +590,14 @@ void proxy_free_config( void )
             rm->context );
         MEMORY_FREE( rm->variables );
         MEMORY_FREE( rm->context );
-        Api_close( rm->sess );
+        proxy_release_target( rm->target );
         MEMORY_FREE( rm );
     }
 }
 
 /*
  * Configure special parameters on the session.
- * Currently takes the parameter configured and changes it if something 
+ * Currently takes the parameter configured and changes it if something
  * was configured.  It becomes "-c" if the community string from the pdu
  * is placed on the session.
  */
@@ -280,7 +646,7 @@ void init_proxy( void )
 {
     AgentReadConfig_priotdRegisterConfigHandler( "proxy", proxy_parse_config,
         proxy_free_config,
-        "[snmpcmd args] host oid [remoteoid]" );
+        "[snmpcmd args] [-Cw window] [-Cb max-repetitions] [-Ct seconds] host oid [remoteoid]" );
 }
 
 void shutdown_proxy( void )
@@ -288,6 +654,119 @@ void shutdown_proxy( void )
     proxy_free_config();
 }
 
+/*
+ * Answer request with var, named in the target's tree.  An answer from
+ * outside the proxied tree is discarded, leaving a GETNEXT to move on.
+ */
+static int
+proxy_answer( struct simple_proxy* sp, RequestInfo* request,
+    const VariableList* var )
+{
+    oid myname[ asnMAX_OID_LEN ];
+    size_t myname_len;
+
+    /*
+     * XXX - should this be done here?
+     *       Or wait until we know it's OK?
+     */
+    Client_setVarTypedValue( request->requestvb, var->type,
+        var->value.string, var->valueLength );
+
+    DEBUG_MSGTL( ( "proxy", "got response... " ) );
+    DEBUG_MSGOID( ( "proxy", var->name, var->nameLength ) );
+    DEBUG_MSG( ( "proxy", "\n" ) );
+    request->delegated = 0;
+
+    /*
+     * Check the response oid is legitimate,
+     *   and discard the value if not.
+     *
+     * XXX - what's the difference between these cases?
+     */
+    if ( sp->base_len && ( var->nameLength < sp->base_len || Api_oidCompare( var->name, sp->base_len, sp->base, sp->base_len ) != 0 ) ) {
+        DEBUG_MSGTL( ( "proxy", "out of registered range... " ) );
+        DEBUG_MSGOID( ( "proxy", var->name, sp->base_len ) );
+        DEBUG_MSG( ( "proxy", " (%d) != ", ( int )sp->base_len ) );
+        DEBUG_MSGOID( ( "proxy", sp->base, sp->base_len ) );
+        DEBUG_MSG( ( "proxy", "\n" ) );
+        Client_setVarTypedValue( request->requestvb, asnNULL, NULL, 0 );
+    } else if ( !sp->base_len && ( var->nameLength < sp->name_len || Api_oidCompare( var->name, sp->name_len, sp->name, sp->name_len ) != 0 ) ) {
+        DEBUG_MSGTL( ( "proxy", "out of registered base range... " ) );
+        DEBUG_MSGOID( ( "proxy", var->name, sp->name_len ) );
+        DEBUG_MSG( ( "proxy", " (%d) != ", ( int )sp->name_len ) );
+        DEBUG_MSGOID( ( "proxy", sp->name, sp->name_len ) );
+        DEBUG_MSG( ( "proxy", "\n" ) );
+        Client_setVarTypedValue( request->requestvb, asnNULL, NULL, 0 );
+    } else if ( sp->base_len ) {
+        /*
+         * If the returned OID is legitimate, then update
+         *   the original request varbind accordingly.
+         */
+        myname_len = sp->name_len + var->nameLength - sp->base_len;
+        if ( myname_len > asnMAX_OID_LEN ) {
+            Logger_log( LOGGER_PRIORITY_WARNING,
+                "proxy OID return length too long.\n" );
+            return PRIOT_ERR_GENERR;
+        }
+        memcpy( myname, sp->name, sizeof( oid ) * sp->name_len );
+        if ( var->nameLength > sp->base_len )
+            memcpy( &myname[ sp->name_len ],
+                &var->name[ sp->base_len ],
+                sizeof( oid ) * ( var->nameLength - sp->base_len ) );
+        Client_setVarObjid( request->requestvb, myname, myname_len );
+    } else {
+        Client_setVarObjid( request->requestvb, var->name,
+            var->nameLength );
+    }
+    return PRIOT_ERR_NOERROR;
+}
+
+/*
+ * Returns -1 if the request couldn't be sent, pr being left to the caller
+ */
+static int
+proxy_send( struct proxy_request* pr )
+{
+    struct proxy_target* t = pr->target;
+
+    DEBUG_MSGTL( ( "proxy", "sending pdu\n" ) );
+    if ( Session_asyncSend( t->sess, pr->pdu, proxy_got_response, pr ) == 0 ) {
+        Api_sessPerror( "proxy", t->sess );
+        return -1;
+    }
+    pr->pdu = NULL;
+    t->outstanding++;
+    return 0;
+}
+
+/*
+ * Send what the window of a target has room for.  Requests the agent gave
+ * up on while they waited aren't sent at all.
+ */
+static void
+proxy_dispatch( struct proxy_target* t )
+{
+    struct proxy_request* pr;
+
+    while ( !t->closing && t->outstanding < t->window
+        && ( pr = t->head ) != NULL ) {
+        t->head = pr->next;
+        if ( t->head == NULL )
+            t->tail = NULL;
+        pr->next = NULL;
+
+        if ( AgentHandler_handlerCheckCache( pr->cache ) == NULL ) {
+            DEBUG_MSGTL( ( "proxy", "a queued proxy request was no longer valid.\n" ) );
+            proxy_free_request( pr );
+            continue;
+        }
+        if ( proxy_send( pr ) < 0 ) {
+            proxy_timed_out( pr->cache );
+            proxy_free_request( pr );
+        }
+    }
+}
+
 int proxy_handler( MibHandler* handler,
     HandlerRegistration* reginfo,
     AgentRequestInfo* reqinfo,
@@ -296,8 +775,12 @@ int proxy_handler( MibHandler* handler,
 
     Types_Pdu* pdu;
     struct simple_proxy* sp;
+    struct proxy_target* target;
+    struct proxy_request* pr;
+    const VariableList* var;
+    oid name[ asnMAX_OID_LEN + 1 ];
     oid* ourname;
-    size_t ourlength;
+    size_t ourlength, nvars = 0;
     RequestInfo* request = requests;
     u_char* configured = NULL;
 
@@ -353,8 +836,9 @@ int proxy_handler( MibHandler* handler,
             Api_freePdu( pdu );
         return PRIOT_ERR_NOERROR;
     }
+    target = sp->target;
 
-    while ( request ) {
+    for ( ; request; request = request->next ) {
         ourname = request->requestvb->name;
         ourlength = request->requestvb->nameLength;
 
@@ -366,7 +850,8 @@ int proxy_handler( MibHandler* handler,
              * Create GETNEXT request with an OID so the
              * master returns the first OID in the registered range.
              */
-            memcpy( ourname, sp->base, sp->base_len * sizeof( oid ) );
+            memcpy( name, sp->base, sp->base_len * sizeof( oid ) );
+            ourname = name;
             ourlength = sp->base_len;
             if ( ourname[ ourlength - 1 ] <= 1 ) {
                 /*
@@ -386,24 +871,34 @@ int proxy_handler( MibHandler* handler,
         } else if ( sp->base_len > 0 ) {
             if ( ( ourlength - sp->name_len + sp->base_len ) > asnMAX_OID_LEN ) {
                 /*
-                 * too large 
+                 * too large
                  */
-                if ( pdu )
-                    Api_freePdu( pdu );
                 Logger_log( LOGGER_PRIORITY_ERR,
                     "proxy oid request length is too long\n" );
-                return PRIOT_ERR_NOERROR;
+                Agent_requestSetError( request, PRIOT_ERR_GENERR );
+                continue;
             }
             /*
-             * suffix appended? 
+             * suffix appended?
              */
             DEBUG_MSGTL( ( "proxy", "length=%d, base_len=%d, name_len=%d\n",
                 ( int )ourlength, ( int )sp->base_len, ( int )sp->name_len ) );
+            memcpy( name, sp->base, sizeof( oid ) * sp->base_len );
             if ( ourlength > sp->name_len )
-                memcpy( &( sp->base[ sp->base_len ] ), &( ourname[ sp->name_len ] ),
+                memcpy( &name[ sp->base_len ], &ourname[ sp->name_len ],
                     sizeof( oid ) * ( ourlength - sp->name_len ) );
             ourlength = ourlength - sp->name_len + sp->base_len;
-            ourname = sp->base;
+            ourname = name;
+        }
+
+        if ( reqinfo->mode != MODE_SET_ACTION
+            && ( var = proxy_cache_find( target, reqinfo->mode, ourname,
+                     ourlength ) )
+                != NULL ) {
+            DEBUG_MSGTL( ( "proxy/cache", "answered without asking\n" ) );
+            if ( proxy_answer( sp, request, var ) != PRIOT_ERR_NOERROR )
+                Agent_requestSetError( request, PRIOT_ERR_GENERR );
+            continue;
         }
 
         Api_pduAddVariable( pdu, ourname, ourlength,
@@ -411,7 +906,24 @@ int proxy_handler( MibHandler* handler,
             request->requestvb->value.string,
             request->requestvb->valueLength );
         request->delegated = 1;
-        request = request->next;
+        nvars++;
+    }
+
+    if ( nvars == 0 ) {
+        Api_freePdu( pdu );
+        return PRIOT_ERR_NOERROR;
+    }
+
+    /*
+     * a GETNEXT asks for the rows after it as well, for the walk that is
+     * most likely going on to find in the cache
+     */
+    if ( reqinfo->mode == MODE_GETNEXT && target->ttl > 0 && target->bulk > 1 ) {
+        pdu->command = PRIOT_MSG_GETBULK;
+        pdu->non_repeaters = 0;
+        pdu->max_repetitions = target->bulk;
+    } else if ( reqinfo->mode == MODE_SET_ACTION ) {
+        proxy_cache_flush( target );
     }
 
     /*
@@ -424,14 +936,48 @@ int proxy_handler( MibHandler* handler,
         return PRIOT_ERR_NOERROR;
     }
 
+    pr = MEMORY_MALLOC_TYPEDEF( struct proxy_request );
+    if ( pr == NULL ) {
+        AgentHandler_handlerMarkRequestsAsDelegated( requests,
+            REQUEST_IS_NOT_DELEGATED );
+        Agent_setRequestError( reqinfo, requests, PRIOT_ERR_GENERR );
+        Api_freePdu( pdu );
+        proxy_free_filled_in_session_args( sp->sess, ( void** )&configured );
+        return PRIOT_ERR_NOERROR;
+    }
+    pr->target = target;
+    pr->command = pdu->command;
+    pr->pdu = pdu;
+    pr->nvars = nvars;
+    if ( target->ttl > 0 && pdu->command != PRIOT_MSG_GET
+        && pdu->command != PRIOT_MSG_SET )
+        pr->asked = Client_cloneVarbind( pdu->variables );
+    pr->cache = AgentHandler_createDelegatedCache( handler, reginfo,
+        reqinfo, requests,
+        ( void* )sp );
+
     /*
-     * send the request out 
+     * send the request out, or queue it behind those already waiting for
+     * the target.  Failing here, the requests are still ours to answer:
+     * the agent doesn't know of the cache yet, so the error is set at once
      */
-    DEBUG_MSGTL( ( "proxy", "sending pdu\n" ) );
-    Session_asyncSend( sp->sess, pdu, proxy_got_response,
-        AgentHandler_createDelegatedCache( handler, reginfo,
-                           reqinfo, requests,
-                           ( void* )sp ) );
+    if ( target->head == NULL && !target->closing
+        && target->outstanding < target->window ) {
+        if ( proxy_send( pr ) < 0 ) {
+            AgentHandler_handlerMarkRequestsAsDelegated( requests,
+                REQUEST_IS_NOT_DELEGATED );
+            Agent_setRequestError( reqinfo, requests, PRIOT_ERR_GENERR );
+            AgentHandler_freeDelegatedCache( pr->cache );
+            proxy_free_request( pr );
+        }
+    } else {
+        if ( target->tail )
+            target->tail->next = pr;
+        else
+            target->head = pr;
+        target->tail = pr;
+        proxy_dispatch( target );
+    }
 
     /* Free any special parameters generated on the session */
     proxy_free_filled_in_session_args( sp->sess, ( void** )&configured );
@@ -439,18 +985,15 @@ int proxy_handler( MibHandler* handler,
     return PRIOT_ERR_NOERROR;
 }
 
-int proxy_got_response( int operation, Types_Session* sess, int reqid,
-    Types_Pdu* pdu, void* cb_data )
+static int
+proxy_handle_response( struct proxy_request* pr, Types_Pdu* pdu )
 {
-    DelegatedCache* cache = ( DelegatedCache* )cb_data;
+    DelegatedCache* cache;
     RequestInfo *requests, *request = NULL;
     VariableList *vars, *var = NULL;
-
     struct simple_proxy* sp;
-    oid myname[ asnMAX_OID_LEN ];
-    size_t myname_len = asnMAX_OID_LEN;
 
-    cache = AgentHandler_handlerCheckCache( cache );
+    cache = AgentHandler_handlerCheckCache( pr->cache );
 
     if ( !cache ) {
         DEBUG_MSGTL( ( "proxy", "a proxy request was no longer valid.\n" ) );
@@ -466,174 +1009,124 @@ int proxy_got_response( int operation, Types_Session* sess, int reqid,
         return PRIOT_ERR_NOERROR;
     }
 
-    switch ( operation ) {
-    case API_CALLBACK_OP_TIMED_OUT:
+    vars = pdu->variables;
+
+    if ( pdu->errstat != PRIOT_ERR_NOERROR ) {
         /*
-         * WWWXXX: don't leave requests delayed if operation is
-         * something like TIMEOUT 
+         *  If we receive an error from the proxy agent, pass it on up.
+         *  The higher-level processing seems to Do The Right Thing.
+         *
+         * 2005/06 rks: actually, it doesn't do the right thing for
+         * a get-next request that returns NOSUCHNAME. If we do nothing,
+         * it passes that error back to the comman initiator. What it should
+         * do is ignore the error and move on to the next tree. To
+         * accomplish that, all we need to do is clear the delegated flag.
+         * Not sure if any other error codes need the same treatment. Left
+         * as an exercise to the reader...
          */
-        DEBUG_MSGTL( ( "proxy", "got timed out... requests = %8p\n", requests ) );
-
-        AgentHandler_handlerMarkRequestsAsDelegated( requests,
-            REQUEST_IS_NOT_DELEGATED );
-        if ( cache->reqinfo->mode != MODE_GETNEXT ) {
-            DEBUG_MSGTL( ( "proxy", "  ignoring timeout\n" ) );
-            Agent_setRequestError( cache->reqinfo, requests, /* XXXWWW: should be index = 0 */
-                PRIOT_ERR_GENERR );
-        }
-        AgentHandler_freeDelegatedCache( cache );
-        return 0;
-
-    case API_CALLBACK_OP_RECEIVED_MESSAGE:
-        vars = pdu->variables;
-
-        if ( pdu->errstat != PRIOT_ERR_NOERROR ) {
+        DEBUG_MSGTL( ( "proxy", "got error response (%ld)\n", pdu->errstat ) );
+        if ( ( cache->reqinfo->mode == MODE_GETNEXT ) && ( PRIOT_ERR_NOSUCHNAME == pdu->errstat ) ) {
+            DEBUG_MSGTL( ( "proxy", "  ignoring error response\n" ) );
+            AgentHandler_handlerMarkRequestsAsDelegated( requests,
+                REQUEST_IS_NOT_DELEGATED );
+        } else if ( cache->reqinfo->mode == MODE_SET_ACTION ) {
             /*
-             *  If we receive an error from the proxy agent, pass it on up.
-             *  The higher-level processing seems to Do The Right Thing.
-             *
-             * 2005/06 rks: actually, it doesn't do the right thing for
-             * a get-next request that returns NOSUCHNAME. If we do nothing,
-             * it passes that error back to the comman initiator. What it should
-             * do is ignore the error and move on to the next tree. To
-             * accomplish that, all we need to do is clear the delegated flag.
-             * Not sure if any other error codes need the same treatment. Left
-             * as an exercise to the reader...
+             * In order for netsnmp_wrap_up_request to consider the
+             * SET request complete,
+             * there must be no delegated requests pending.
+             * https://sourceforge.net/tracker/
+             *	?func=detail&atid=112694&aid=1554261&group_id=12694
              */
-            DEBUG_MSGTL( ( "proxy", "got error response (%ld)\n", pdu->errstat ) );
-            if ( ( cache->reqinfo->mode == MODE_GETNEXT ) && ( PRIOT_ERR_NOSUCHNAME == pdu->errstat ) ) {
-                DEBUG_MSGTL( ( "proxy", "  ignoring error response\n" ) );
-                AgentHandler_handlerMarkRequestsAsDelegated( requests,
-                    REQUEST_IS_NOT_DELEGATED );
-            } else if ( cache->reqinfo->mode == MODE_SET_ACTION ) {
-                /*
-		 * In order for netsnmp_wrap_up_request to consider the
-		 * SET request complete,
-		 * there must be no delegated requests pending.
-		 * https://sourceforge.net/tracker/
-		 *	?func=detail&atid=112694&aid=1554261&group_id=12694
-		 */
-                DEBUG_MSGTL( ( "proxy",
-                    "got SET error %s, index %ld\n",
-                    Client_errstring( pdu->errstat ), pdu->errindex ) );
-                AgentHandler_handlerMarkRequestsAsDelegated(
-                    requests, REQUEST_IS_NOT_DELEGATED );
-                Agent_requestSetErrorIdx( requests, pdu->errstat,
-                    pdu->errindex );
-            } else {
-                AgentHandler_handlerMarkRequestsAsDelegated( requests,
-                    REQUEST_IS_NOT_DELEGATED );
-                Agent_requestSetErrorIdx( requests, pdu->errstat,
-                    pdu->errindex );
+            DEBUG_MSGTL( ( "proxy",
+                "got SET error %s, index %ld\n",
+                Client_errstring( pdu->errstat ), pdu->errindex ) );
+            AgentHandler_handlerMarkRequestsAsDelegated(
+                requests, REQUEST_IS_NOT_DELEGATED );
+            Agent_requestSetErrorIdx( requests, pdu->errstat,
+                pdu->errindex );
+        } else {
+            AgentHandler_handlerMarkRequestsAsDelegated( requests,
+                REQUEST_IS_NOT_DELEGATED );
+            Agent_requestSetErrorIdx( requests, pdu->errstat,
+                pdu->errindex );
+        }
+    } else {
+        /*
+         * update the original request varbinds with the results; those
+         * answered from the cache weren't sent
+         */
+        for ( var = vars, request = requests;; request = request->next, var = var->next ) {
+            while ( request && !request->delegated )
+                request = request->next;
+            if ( !request || !var )
+                break;
+            if ( proxy_answer( sp, request, var ) != PRIOT_ERR_NOERROR ) {
+                Agent_setRequestError( cache->reqinfo, requests,
+                    PRIOT_ERR_GENERR );
+                AgentHandler_freeDelegatedCache( cache );
+                return 1;
             }
+        }
+    }
 
-            /*
-         * update the original request varbinds with the results 
+    /*
+     * the rows a GETBULK brought back after the first are for the cache
+     */
+    if ( request || ( var && pr->command != PRIOT_MSG_GETBULK ) ) {
+        /*
+         * ack, this is bad.  The # of varbinds don't match and
+         * there is no way to fix the problem
          */
-        } else
-            for ( var = vars, request = requests;
-                  request && var;
-                  request = request->next, var = var->next ) {
-                /*
-             * XXX - should this be done here?
-             *       Or wait until we know it's OK?
-             */
-                Client_setVarTypedValue( request->requestvb, var->type,
-                    var->value.string, var->valueLength );
+        Logger_log( LOGGER_PRIORITY_ERR,
+            "response to proxy request illegal.  We're screwed.\n" );
+        Agent_setRequestError( cache->reqinfo, requests,
+            PRIOT_ERR_GENERR );
+    }
 
-                DEBUG_MSGTL( ( "proxy", "got response... " ) );
-                DEBUG_MSGOID( ( "proxy", var->name, var->nameLength ) );
-                DEBUG_MSG( ( "proxy", "\n" ) );
-                request->delegated = 0;
+    /* fix bulk_to_next operations */
+    if ( cache->reqinfo->mode == MODE_GETBULK )
+        BulkToNext_fixRequests( requests );
 
-                /*
-             * Check the response oid is legitimate,
-             *   and discard the value if not.
-             *
-             * XXX - what's the difference between these cases?
-             */
-                if ( sp->base_len && ( var->nameLength < sp->base_len || Api_oidCompare( var->name, sp->base_len, sp->base, sp->base_len ) != 0 ) ) {
-                    DEBUG_MSGTL( ( "proxy", "out of registered range... " ) );
-                    DEBUG_MSGOID( ( "proxy", var->name, sp->base_len ) );
-                    DEBUG_MSG( ( "proxy", " (%d) != ", ( int )sp->base_len ) );
-                    DEBUG_MSGOID( ( "proxy", sp->base, sp->base_len ) );
-                    DEBUG_MSG( ( "proxy", "\n" ) );
-                    Client_setVarTypedValue( request->requestvb, asnNULL, NULL, 0 );
-
-                    continue;
-                } else if ( !sp->base_len && ( var->nameLength < sp->name_len || Api_oidCompare( var->name, sp->name_len, sp->name, sp->name_len ) != 0 ) ) {
-                    DEBUG_MSGTL( ( "proxy", "out of registered base range... " ) );
-                    DEBUG_MSGOID( ( "proxy", var->name, sp->name_len ) );
-                    DEBUG_MSG( ( "proxy", " (%d) != ", ( int )sp->name_len ) );
-                    DEBUG_MSGOID( ( "proxy", sp->name, sp->name_len ) );
-                    DEBUG_MSG( ( "proxy", "\n" ) );
-                    Client_setVarTypedValue( request->requestvb, asnNULL, NULL, 0 );
-                    continue;
-                } else {
-                    /*
-                 * If the returned OID is legitimate, then update
-                 *   the original request varbind accordingly.
-                 */
-                    if ( sp->base_len ) {
-                        /*
-                     * XXX: oid size maxed? 
-                     */
-                        memcpy( myname, sp->name, sizeof( oid ) * sp->name_len );
-                        myname_len = sp->name_len + var->nameLength - sp->base_len;
-                        if ( myname_len > asnMAX_OID_LEN ) {
-                            Logger_log( LOGGER_PRIORITY_WARNING,
-                                "proxy OID return length too long.\n" );
-                            Agent_setRequestError( cache->reqinfo, requests,
-                                PRIOT_ERR_GENERR );
-                            if ( pdu )
-                                Api_freePdu( pdu );
-                            AgentHandler_freeDelegatedCache( cache );
-                            return 1;
-                        }
-
-                        if ( var->nameLength > sp->base_len )
-                            memcpy( &myname[ sp->name_len ],
-                                &var->name[ sp->base_len ],
-                                sizeof( oid ) * ( var->nameLength - sp->base_len ) );
-                        Client_setVarObjid( request->requestvb, myname,
-                            myname_len );
-                    } else {
-                        Client_setVarObjid( request->requestvb, var->name,
-                            var->nameLength );
-                    }
-                }
-            }
+    AgentHandler_freeDelegatedCache( cache );
+    return 1;
+}
 
-        if ( request || var ) {
-            /*
-             * ack, this is bad.  The # of varbinds don't match and
-             * there is no way to fix the problem 
-             */
-            if ( pdu )
-                Api_freePdu( pdu );
-            Logger_log( LOGGER_PRIORITY_ERR,
-                "response to proxy request illegal.  We're screwed.\n" );
-            Agent_setRequestError( cache->reqinfo, requests,
-                PRIOT_ERR_GENERR );
-        }
+int proxy_got_response( int operation, Types_Session* sess, int reqid,
+    Types_Pdu* pdu, void* cb_data )
+{
+    struct proxy_request* pr = ( struct proxy_request* )cb_data;
+    struct proxy_target* target = pr->target;
+    DelegatedCache* cache;
+    int rc = 1;
 
-        /* fix bulk_to_next operations */
-        if ( cache->reqinfo->mode == MODE_GETBULK )
-            BulkToNext_fixRequests( requests );
+    target->outstanding--;
 
+    switch ( operation ) {
+    case API_CALLBACK_OP_TIMED_OUT:
         /*
-         * free the response 
+         * WWWXXX: don't leave requests delayed if operation is
+         * something like TIMEOUT
          */
-        if ( pdu && 0 )
-            Api_freePdu( pdu );
+        proxy_timed_out( pr->cache );
+        rc = 0;
+        break;
+
+    case API_CALLBACK_OP_RECEIVED_MESSAGE:
+        proxy_cache_response( target, pr->command, pr->asked, pr->nvars,
+            pdu );
+        rc = proxy_handle_response( pr, pdu );
         break;
 
     default:
         DEBUG_MSGTL( ( "proxy", "no response received: op = %d\n",
             operation ) );
+        cache = AgentHandler_handlerCheckCache( pr->cache );
+        if ( cache )
+            AgentHandler_freeDelegatedCache( cache );
         break;
     }
 
-    AgentHandler_freeDelegatedCache( cache );
-    return 1;
+    proxy_free_request( pr );
+    proxy_dispatch( target );
+    return rc;
 }
@@ -3,6 +3,42 @@
 
 #include "AgentHandler.h"
 
+/*
+ * defaults for the -Cw, -Cb and -Ct options
+ */
+#define PROXY_DEFAULT_WINDOW    8
+#define PROXY_DEFAULT_BULK      10
+#define PROXY_DEFAULT_TTL       2
+
+/*
+ * answers kept for one upstream agent at most
+ */
+#define PROXY_CACHE_MAX         4096
+#define PROXY_CACHE_BUCKETS     521
+
+struct proxy_request;
+struct proxy_cached;
+
+/*
+ * An upstream agent.  proxy lines naming it with the same arguments share
+ * one session to it, the window of requests outstanding on that session,
+ * and the answers it gave recently.
+ */
+struct proxy_target {
+    char           *key;
+    Types_Session *sess;
+    int             refcount;
+    int             closing;
+    int             window;     /* requests outstanding at once */
+    int             outstanding;
+    int             bulk;       /* max-repetitions a GETNEXT goes out with */
+    int             ttl;        /* seconds an answer is kept */
+    struct proxy_request *head, *tail;  /* waiting for the window */
+    struct proxy_cached *cache[PROXY_CACHE_BUCKETS];
+    int             ncached;
+    struct proxy_target *next;
+};
+
 struct simple_proxy {
     struct variable2 *variables;
     oid             name[asnMAX_OID_LEN];
@@ -11,12 +47,23 @@ struct simple_proxy {
     size_t          base_len;
     char           *context;
     Types_Session *sess;
+    struct proxy_target *target;
     struct simple_proxy *next;
 };
 
 int             proxy_got_response(int, Types_Session *, int,
                                    Types_Pdu *, void *);
 void            proxy_parse_config(const char *, char *);
+
+/*
+ * the answers of a target: those to the command it was sent about asked
+ * (nvars varbinds) are kept from pdu, and looked up by the mode of a
+ * request and the name it is for upstream
+ */
+void            proxy_cache_response(struct proxy_target *, int,
+                                     VariableList *, size_t, Types_Pdu *);
+const VariableList *proxy_cache_find(struct proxy_target *, int,
+                                     const oid *, size_t);
 void            init_proxy(void);
 void            shutdown_proxy(void);
 NodeHandlerFT proxy_handler;
@@ -10,8 +10,10 @@
 #include "System/Util/FileParser.h"
 #include "udp_endpoint_private.h"
 #include "utilities/get_pid_from_inode.h"
+#include "utilities/sock_diag.h"
 
 static int _load4( Container_Container* container, u_int flags );
+static int _load_diag( Container_Container* container, u_int flags );
 
 /*
  * initialize arch specific storage
@@ -70,7 +72,16 @@ int netsnmp_arch_udp_endpoint_container_load( Container_Container* container,
     /* Setup the pid_from_inode table, and fill it.*/
     netsnmp_get_pid_from_inode_init();
 
-    rc = _load4( container, load_flags );
+    /*
+     * prefer the binary sock_diag dump (ipv4 and ipv6); fall back to
+     * /proc/net/udp on kernels that don't have it.
+     */
+    rc = _load_diag( container, load_flags );
+    if ( rc > 0 ) {
+        DEBUG_MSGTL( ( "access:udp_endpoint",
+            "sock_diag unavailable, using /proc/net/udp\n" ) );
+        rc = _load4( container, load_flags );
+    }
     if ( rc < 0 ) {
         u_int flags = NETSNMP_ACCESS_UDP_ENDPOINT_FREE_KEEP_CONTAINER;
         netsnmp_access_udp_endpoint_container_free( container, flags );
@@ -244,3 +255,85 @@ _load4( Container_Container* container, u_int load_flags )
     File_release( fp );
     return ( NULL == container );
 }
+
+/*
+ * state for the sock_diag row callback
+ */
+typedef struct udp_endpoint_diag_ctx_s {
+    Container_Container* container;
+    oid count;
+} udp_endpoint_diag_ctx;
+
+static int
+_diag_row( const struct inet_diag_msg* msg, void* context )
+{
+    udp_endpoint_diag_ctx* ctx = ( udp_endpoint_diag_ctx* )context;
+    netsnmp_udp_endpoint_entry* ep;
+    u_char addr_len;
+
+    if ( AF_INET == msg->idiag_family )
+        addr_len = 4;
+    else if ( AF_INET6 == msg->idiag_family )
+        addr_len = 16;
+    else
+        return 0;
+
+    ep = netsnmp_access_udp_endpoint_entry_create();
+    if ( NULL == ep )
+        return -3;
+
+    /** addresses are in network order, ports too (unlike procfs) */
+    memcpy( ep->loc_addr, msg->id.idiag_src, addr_len );
+    memcpy( ep->rmt_addr, msg->id.idiag_dst, addr_len );
+    ep->loc_addr_len = ep->rmt_addr_len = addr_len;
+    ep->loc_port = ntohs( msg->id.idiag_sport );
+    ep->rmt_port = ntohs( msg->id.idiag_dport );
+    ep->state = msg->idiag_state;
+
+    /*
+     * Use inode as instance value.
+     */
+    ep->instance = ( u_int )msg->idiag_inode;
+    ep->pid = netsnmp_get_pid_from_inode( msg->idiag_inode );
+
+    /** same numbering as the procfs 'sl' counter */
+    ep->index = ctx->count++;
+
+    if ( CONTAINER_INSERT( ctx->container, ep ) < 0 ) {
+        netsnmp_access_udp_endpoint_entry_free( ep );
+        return 0;
+    }
+    return 0;
+}
+
+/**
+ * dump udp sockets of both families over NETLINK_SOCK_DIAG
+ *
+ * @retval  0 no errors
+ * @retval  1 sock_diag not available for ipv4, nothing loaded
+ * @retval <0 errors
+ */
+static int
+_load_diag( Container_Container* container, u_int load_flags )
+{
+    udp_endpoint_diag_ctx ctx;
+    int rc;
+
+    if ( NULL == container )
+        return -1;
+
+    ctx.container = container;
+    ctx.count = 0;
+
+    rc = netsnmp_sock_diag_dump( AF_INET, IPPROTO_UDP,
+        NETSNMP_SOCK_DIAG_ALL_STATES, _diag_row, &ctx );
+    if ( 0 != rc )
+        return rc;
+
+    /*
+     * no ipv6 in the kernel is not an error, there just are no rows
+     */
+    rc = netsnmp_sock_diag_dump( AF_INET6, IPPROTO_UDP,
+        NETSNMP_SOCK_DIAG_ALL_STATES, _diag_row, &ctx );
+    return ( rc < 0 ) ? rc : 0;
+}
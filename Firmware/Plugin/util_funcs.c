@@ -11,11 +11,13 @@
 #include "util_funcs.h"
 #include "Impl.h"
 #include "ReadConfig.h"
+#include "System/String.h"
 #include "System/Util/Assert.h"
 #include "System/Util/Logger.h"
 #include "System/Util/System.h"
 #include "System/Util/Trace.h"
 #include "utilities/ExecuteCmd.h"
+#include <sys/mman.h>
 
 static long cachetime;
 
@@ -30,29 +32,17 @@ make_tempfile( void )
 
 int shell_command( struct extensible* ex )
 {
-    const char* ofname;
-    char shellline[ STRMAX ];
-    FILE* shellout;
+    int len = sizeof( ex->output );
+    char* eol;
 
-    ofname = make_tempfile();
-    if ( ofname == NULL ) {
-        ex->output[ 0 ] = 0;
-        ex->result = 127;
-        return ex->result;
-    }
-
-    snprintf( shellline, sizeof( shellline ), "%s > %s", ex->command, ofname );
-    shellline[ sizeof( shellline ) - 1 ] = 0;
-    ex->result = system( shellline );
+    ex->result = ExecuteCmd_runShellCommand( ex->command, NULL, ex->output, &len );
     ex->result = WEXITSTATUS( ex->result );
-    shellout = fopen( ofname, "r" );
-    if ( shellout != NULL ) {
-        if ( fgets( ex->output, sizeof( ex->output ), shellout ) == NULL ) {
-            ex->output[ 0 ] = 0;
-        }
-        fclose( shellout );
-    }
-    unlink( ofname );
+
+    /*
+     * only the first line (with its newline) is of interest
+     */
+    if ( ( eol = strchr( ex->output, '\n' ) ) != NULL )
+        eol[ 1 ] = 0;
 
     return ( ex->result );
 }
@@ -99,50 +89,52 @@ void wait_on_exec( struct extensible* ex )
 int get_exec_output( struct extensible* ex )
 {
 
-    char cachefile[ STRMAX ];
-    char cache[ NETSNMP_MAXCACHESIZE ];
-    int cachebytes;
-    int cfd;
+    static char cache[ NETSNMP_MAXCACHESIZE ];
+    static int cachebytes;
+    int cfd, bytes;
     long curtime;
     static char lastcmd[ STRMAX ];
     static int lastresult;
+    char cmd[ STRMAX ];
 
     DEBUG_MSGTL( ( "exec:get_exec_output", "calling %s\n", ex->command ) );
 
-    sprintf( cachefile, "%s/%s", ReadConfig_getPersistentDirectory(), NETSNMP_CACHEFILE );
     curtime = time( NULL );
     if ( curtime > ( cachetime + NETSNMP_EXCACHETIME ) || strcmp( ex->command, lastcmd ) != 0 ) {
-        strcpy( lastcmd, ex->command );
-        cachetime = curtime;
-
-        cachebytes = NETSNMP_MAXCACHESIZE;
-        ex->result = ExecuteCmd_runExecCommand( ex->command, NULL, cache, &cachebytes );
-
-        unlink( cachefile );
         /*
-             * XXX  Use SNMP_FILEMODE_CLOSED instead of 644? 
-             */
-        if ( ( cfd = open( cachefile, O_WRONLY | O_TRUNC | O_CREAT, 0600 ) ) < 0 ) {
-            Logger_log( LOGGER_PRIORITY_ERR, "can not create cache file\n" );
-            Logger_logPerror( cachefile );
-            cachetime = 0;
-            return -1;
-        }
-        if ( cachebytes > 0 )
-            write( cfd, ( void* )cache, cachebytes );
-        close( cfd );
+         * on a coroutine, others may come through here while the command
+         * runs: the cache is only brought up to date once it is done
+         */
+        String_copyTruncate( cmd, ex->command, sizeof( cmd ) );
+        bytes = NETSNMP_MAXCACHESIZE;
+        ex->result = ExecuteCmd_runExecCommand( cmd, NULL, cache, &bytes );
+        cachebytes = bytes;
         lastresult = ex->result;
+        strcpy( lastcmd, cmd );
+        cachetime = curtime;
     } else {
         ex->result = lastresult;
+        DEBUG_MSGTL( ( "exec:get_exec_output", "using cached value\n" ) );
     }
-    DEBUG_MSGTL( ( "exec:get_exec_output", "using cached value\n" ) );
-    if ( ( cfd = open( cachefile, O_RDONLY ) ) < 0 ) {
-        Logger_log( LOGGER_PRIORITY_ERR, "can not open cache file\n" );
-        Logger_logPerror( cachefile );
+
+    /*
+     * the output is kept in memory, and handed out as a file of its own
+     * to each caller
+     */
+    if ( ( cfd = memfd_create( "priot-exec-cache", MFD_CLOEXEC ) ) < 0 ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "can not create cache file\n" );
+        Logger_logPerror( "memfd_create" );
+        cachetime = 0;
+        return -1;
+    }
+    if ( ( cachebytes > 0 && write( cfd, cache, cachebytes ) != cachebytes )
+        || lseek( cfd, 0, SEEK_SET ) != 0 ) {
+        Logger_logPerror( "exec cache" );
+        close( cfd );
+        cachetime = 0;
         return -1;
     }
     return ( cfd );
-    return -1;
 }
 int get_exec_pipes( char* cmd, int* fdIn, int* fdOut, Types_PidT* pid )
 {
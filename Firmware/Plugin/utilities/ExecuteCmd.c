@@ -1,107 +1,511 @@
 #include "ExecuteCmd.h"
 #include "../Plugin/Struct.h"
+#include "Await.h"
 #include "PriotSettings.h"
 #include "ReadConfig.h"
+#include "System/Dispatcher/FdEventManager.h"
+#include "System/Util/Alarm.h"
 #include "System/Util/Logger.h"
-#include "System/Util/System.h"
+#include "System/Util/Time.h"
 #include "System/Util/Trace.h"
+#include <spawn.h>
 #include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 
 #define setPerrorstatus( x ) Logger_logPerror( x )
 
-int ExecuteCmd_runShellCommand( char* command, char* input,
-    char* output, int* out_len ) /* Or realloc style ? */
+extern char** environ;
+
+/*
+ * Commands are started with posix_spawn, their stdin and stdout being
+ * pipes, and their output is read by the fd dispatcher as it comes.  Each
+ * run is a job; a job whose result may be reused stays on the list once
+ * done, until the result is too old.  Jobs run at most
+ * EXECUTECMD_MAX_RUNNING at a time, the others waiting their turn, those
+ * somebody waits for first.  A handler on a coroutine waits for its job
+ * without blocking, the main loop doing the reading; if its requests are
+ * dropped meanwhile, it leaves the job to the main loop.  A caller that
+ * can only block has its job started at once.
+ */
+enum {
+    _ExecuteCmd_QUEUED,
+    _ExecuteCmd_RUNNING,
+    _ExecuteCmd_DONE
+};
+
+typedef struct ExecuteCmd_Job_s {
+    char* command;
+    char* input;
+    int flags;
+    int cacheTime; /* seconds the result is kept for; 0: not at all */
+
+    int state;
+    Types_PidT pid;
+    int fd; /* the child's stdout, until read to the end */
+    int pidfd; /* then, if the child hasn't exited, what says it has */
+    unsigned reapId;
+
+    char* output;
+    size_t outLen, outMax;
+    int result; /* what ExecuteCmd_run*Command() returns */
+    struct timeval expires; /* monotonic, once done */
+    Await_Queue waiters;
+    int nwaiters; /* while some, the job is kept */
+    int orphaned; /* nobody wants the result: freed once done */
+
+    struct ExecuteCmd_Job_s* next;
+} ExecuteCmd_Job;
+
+static ExecuteCmd_Job* _ExecuteCmd_jobs = NULL;
+
+static void
+_ExecuteCmd_startQueued( void );
+
+static void
+_ExecuteCmd_freeJob( ExecuteCmd_Job* job )
 {
-    int result; /* and the return value of the command */
+    free( job->command );
+    free( job->input );
+    free( job->output );
+    free( job );
+}
 
-    if ( !command )
-        return -1;
+static void
+_ExecuteCmd_unlink( ExecuteCmd_Job* job )
+{
+    ExecuteCmd_Job** prev;
 
-    DEBUG_MSGTL( ( "ExecuteCmd_runShellCommand", "running %s\n", command ) );
-    DEBUG_MSGTL( ( "run:shell", "running '%s'\n", command ) );
+    for ( prev = &_ExecuteCmd_jobs; *prev; prev = &( *prev )->next )
+        if ( *prev == job ) {
+            *prev = job->next;
+            break;
+        }
+}
 
-    result = -1;
+static ExecuteCmd_Job*
+_ExecuteCmd_newJob( const char* command, const char* input, int flags,
+    int cacheTime, size_t outMax )
+{
+    ExecuteCmd_Job* job;
+
+    job = MEMORY_MALLOC_TYPEDEF( ExecuteCmd_Job );
+    if ( job == NULL )
+        return NULL;
+    job->command = strdup( command );
+    job->input = input ? strdup( input ) : NULL;
+    if ( job->command == NULL || ( input && job->input == NULL ) ) {
+        _ExecuteCmd_freeJob( job );
+        return NULL;
+    }
+    job->flags = flags;
+    job->cacheTime = cacheTime;
+    job->state = _ExecuteCmd_QUEUED;
+    job->pid = -1;
+    job->fd = -1;
+    job->pidfd = -1;
+    job->outMax = outMax;
+    job->result = -1;
+
+    job->next = _ExecuteCmd_jobs;
+    _ExecuteCmd_jobs = job;
+    return job;
+}
 
+static void
+_ExecuteCmd_done( ExecuteCmd_Job* job, int status )
+{
     /*
-     * Set up the command and run it.
+     * as system() and pclose() did, a shell command returns the raw wait
+     * status, an exec'd one its exit code
      */
-    if ( input ) {
-        FILE* file;
-
-        if ( output ) {
-            const char* ifname;
-            const char* ofname; /* Filename for output redirection */
-            char shellline[ STRMAX ]; /* The full command to run */
-
-            ifname = System_makeTemporaryFile();
-            if ( NULL == ifname )
-                return -1;
-            file = fopen( ifname, "w" );
-            if ( NULL == file ) {
-                Logger_log( LOGGER_PRIORITY_ERR, "couldn't open temporary file %s\n", ifname );
-                unlink( ifname );
-                return -1;
-            }
-            fprintf( file, "%s", input );
-            fclose( file );
-
-            ofname = System_makeTemporaryFile();
-            if ( NULL == ofname ) {
-                if ( ifname )
-                    unlink( ifname );
-                return -1;
-            }
-            snprintf( shellline, sizeof( shellline ), "(%s) < \"%s\" > \"%s\"",
-                command, ifname, ofname );
-            result = system( shellline );
-            /*
-             * If output was requested, then retrieve & return it.
-             * Tidy up, and return the result of the command.
-             */
-            if ( out_len && *out_len != 0 ) {
-                int fd; /* For processing any output */
-                int len = 0;
-                fd = open( ofname, O_RDONLY );
-                if ( fd >= 0 )
-                    len = read( fd, output, *out_len - 1 );
-                *out_len = len;
-                if ( len >= 0 )
-                    output[ len ] = 0;
-                else
-                    output[ 0 ] = 0;
-                if ( fd >= 0 )
-                    close( fd );
-            }
-            unlink( ofname );
-            unlink( ifname );
+    job->result = ( job->flags & ExecuteCmdFlag_SHELL ) ? status : WEXITSTATUS( status );
+    job->state = _ExecuteCmd_DONE;
+    job->pid = -1;
+    Time_getMonotonicClock( &job->expires );
+    job->expires.tv_sec += job->cacheTime;
+
+    DEBUG_MSGTL( ( "run:exec", "  '%s' finished. result=%d, %d bytes\n",
+        job->command, job->result, ( int )job->outLen ) );
+    Await_wakeAll( &job->waiters );
+    if ( job->orphaned ) {
+        _ExecuteCmd_unlink( job );
+        _ExecuteCmd_freeJob( job );
+    }
+    _ExecuteCmd_startQueued();
+}
+
+/*
+ * Collects the child of a job whose output has been read to the end
+ */
+static int
+_ExecuteCmd_reap( ExecuteCmd_Job* job, int options )
+{
+    int status = 0, rc;
+
+    rc = waitpid( job->pid, &status, options );
+    if ( rc == 0 )
+        return 0;
+    if ( rc < 0 ) {
+        Logger_logPerror( "waitpid" );
+        status = -1;
+    }
+    if ( job->pidfd >= 0 ) {
+        FdEventManager_unregisterReadFD( job->pidfd );
+        close( job->pidfd );
+        job->pidfd = -1;
+    }
+    if ( job->reapId ) {
+        Alarm_unregister( job->reapId );
+        job->reapId = 0;
+    }
+    _ExecuteCmd_done( job, status );
+    return 1;
+}
+
+static void
+_ExecuteCmd_reapAlarm( unsigned int clientreg, void* clientarg )
+{
+    config_UNUSED( clientreg );
+
+    _ExecuteCmd_reap( ( ExecuteCmd_Job* )clientarg, WNOHANG );
+}
+
+static void
+_ExecuteCmd_exited( int fd, void* data )
+{
+    config_UNUSED( fd );
+
+    _ExecuteCmd_reap( ( ExecuteCmd_Job* )data, WNOHANG );
+}
+
+static void
+_ExecuteCmd_closeOutput( ExecuteCmd_Job* job )
+{
+    FdEventManager_unregisterReadFD( job->fd );
+    close( job->fd );
+    job->fd = -1;
+
+    /*
+     * the child is usually gone by now; if not, it's collected when its
+     * pidfd says it has exited (or, failing that, looked for every second)
+     * rather than held the agent up for
+     */
+    if ( _ExecuteCmd_reap( job, WNOHANG ) )
+        return;
+    job->pidfd = syscall( SYS_pidfd_open, job->pid, 0 );
+    if ( job->pidfd >= 0
+        && FdEventManager_registerReadFD( job->pidfd, _ExecuteCmd_exited, job ) == 0 )
+        return;
+    if ( job->pidfd >= 0 ) {
+        close( job->pidfd );
+        job->pidfd = -1;
+    }
+    job->reapId = Alarm_register( 1, AlarmFlag_REPEAT, _ExecuteCmd_reapAlarm, job );
+}
+
+static void
+_ExecuteCmd_read( int fd, void* data )
+{
+    ExecuteCmd_Job* job = ( ExecuteCmd_Job* )data;
+    char discard[ 4096 ];
+    ssize_t count;
+
+    /*
+     * past outMax the output is read all the same, so the child doesn't
+     * block on a full pipe before exiting
+     */
+    if ( job->outLen < job->outMax )
+        count = read( fd, job->output + job->outLen, job->outMax - job->outLen );
+    else
+        count = read( fd, discard, sizeof( discard ) );
+    DEBUG_MSGTL( ( "verbose:run:exec", "    read %d bytes\n", ( int )count ) );
+
+    if ( count < 0 && ( errno == EAGAIN || errno == EINTR ) )
+        return;
+    if ( count <= 0 ) {
+        if ( count < 0 )
+            setPerrorstatus( "read" );
+        _ExecuteCmd_closeOutput( job );
+        return;
+    }
+    if ( job->outLen < job->outMax )
+        job->outLen += count;
+}
+
+static void
+_ExecuteCmd_start( ExecuteCmd_Job* job )
+{
+    posix_spawn_file_actions_t actions;
+    int ipipe[ 2 ], opipe[ 2 ];
+    char *shellArgv[ 4 ], **argv;
+    int argc = 0, rc, i;
+
+    DEBUG_MSGTL( ( "run:exec", "running '%s'\n", job->command ) );
+    job->state = _ExecuteCmd_RUNNING;
+    job->output = ( char* )malloc( job->outMax ? job->outMax : 1 );
+    if ( job->output == NULL ) {
+        _ExecuteCmd_done( job, -1 );
+        return;
+    }
+
+    if ( pipe2( ipipe, O_CLOEXEC ) < 0 ) {
+        setPerrorstatus( "pipe" );
+        _ExecuteCmd_done( job, -1 );
+        return;
+    }
+    if ( pipe2( opipe, O_CLOEXEC ) < 0 ) {
+        setPerrorstatus( "pipe" );
+        close( ipipe[ 0 ] );
+        close( ipipe[ 1 ] );
+        _ExecuteCmd_done( job, -1 );
+        return;
+    }
+
+    /*
+     * Set stdin/out (and, exec'd, stderr) to use the pipes
+     *   and close everything else
+     */
+    posix_spawn_file_actions_init( &actions );
+    posix_spawn_file_actions_adddup2( &actions, ipipe[ 0 ], 0 );
+    posix_spawn_file_actions_adddup2( &actions, opipe[ 1 ], 1 );
+    if ( !( job->flags & ExecuteCmdFlag_SHELL ) )
+        posix_spawn_file_actions_adddup2( &actions, opipe[ 1 ], 2 );
+    posix_spawn_file_actions_addclosefrom_np( &actions, 3 );
+
+    if ( job->flags & ExecuteCmdFlag_SHELL ) {
+        shellArgv[ 0 ] = ( char* )"/bin/sh";
+        shellArgv[ 1 ] = ( char* )"-c";
+        shellArgv[ 2 ] = job->command;
+        shellArgv[ 3 ] = NULL;
+        argv = shellArgv;
+    } else {
+        argv = ExecuteCmd_tokenizeExecCommand( job->command, &argc );
+    }
+    rc = posix_spawn( &job->pid, argv[ 0 ], &actions, NULL, argv, environ );
+    posix_spawn_file_actions_destroy( &actions );
+    close( ipipe[ 0 ] );
+    close( opipe[ 1 ] );
+
+    if ( rc != 0 ) {
+        close( ipipe[ 1 ] );
+        close( opipe[ 0 ] );
+        /*
+         * what the child used to say, and exit with, when execv() failed
+         */
+        if ( !( job->flags & ExecuteCmdFlag_SHELL ) ) {
+            job->outLen = snprintf( job->output, job->outMax, "%s: %s\n",
+                argv[ 0 ], strerror( rc ) );
+            if ( job->outLen > job->outMax )
+                job->outLen = job->outMax;
+            _ExecuteCmd_done( job, 1 << 8 );
         } else {
-            file = popen( command, "w" );
-            if ( file ) {
-                fwrite( input, 1, strlen( input ), file );
-                result = pclose( file );
-            }
+            Logger_log( LOGGER_PRIORITY_ERR, "can't run /bin/sh: %s\n", strerror( rc ) );
+            _ExecuteCmd_done( job, -1 );
         }
-    } else {
-        if ( output ) {
-            FILE* file;
-
-            file = popen( command, "r" );
-            if ( file ) {
-                *out_len = fread( output, 1, *out_len - 1, file );
-                if ( *out_len >= 0 )
-                    output[ *out_len ] = 0;
-                else
-                    output[ 0 ] = 0;
-                result = pclose( file );
+    }
+    if ( argv != shellArgv ) {
+        for ( i = 0; i < argc; i++ )
+            free( argv[ i ] );
+        free( argv );
+    }
+    if ( rc != 0 )
+        return;
+
+    /*
+     * Pass the input message (if any) to the child
+     */
+    if ( job->input )
+        write( ipipe[ 1 ], job->input, strlen( job->input ) );
+    close( ipipe[ 1 ] );
+
+    job->fd = opipe[ 0 ];
+    if ( FdEventManager_registerReadFD( job->fd, _ExecuteCmd_read, job ) != 0 )
+        Logger_log( LOGGER_PRIORITY_WARNING,
+            "run:exec: can't watch the output of '%s'\n", job->command );
+}
+
+static void
+_ExecuteCmd_startQueued( void )
+{
+    ExecuteCmd_Job *job, *next = NULL;
+    int running;
+
+    for ( ;; ) {
+        running = 0;
+        /*
+         * the list is newest first: the oldest job somebody waits for, or
+         * else the oldest
+         */
+        for ( job = _ExecuteCmd_jobs; job; job = job->next ) {
+            if ( job->state == _ExecuteCmd_RUNNING )
+                running++;
+            else if ( job->state == _ExecuteCmd_QUEUED
+                && ( next == NULL || job->nwaiters > 0 || next->nwaiters == 0 ) )
+                next = job;
+        }
+        if ( next == NULL || running >= EXECUTECMD_MAX_RUNNING )
+            return;
+        _ExecuteCmd_start( next );
+        next = NULL;
+    }
+}
+
+/*
+ * Runs the dispatcher for the jobs' output only, until job is done.
+ * Returns -1, the job still running, if the caller's requests were dropped
+ */
+static int
+_ExecuteCmd_wait( ExecuteCmd_Job* job )
+{
+    ExecuteCmd_Job *j, *jnext;
+    fd_set readfds;
+    struct timeval timeout;
+    int numfds, count, i = NETSNMP_MAXREADCOUNT, status = AwaitStatus_READY;
+
+    if ( Await_isAwaiting() ) {
+        DEBUG_MSGTL( ( "verbose:run:exec", "  awaiting '%s'...\n", job->command ) );
+        job->nwaiters++;
+        _ExecuteCmd_startQueued();
+        while ( job->state != _ExecuteCmd_DONE
+            && ( status = Await_wait( &job->waiters, i * 1000L ) ) == AwaitStatus_READY )
+            ;
+        job->nwaiters--;
+        if ( job->state == _ExecuteCmd_DONE )
+            return 0;
+        /*
+         * nobody to answer: the dispatcher reads the job to its end, rather
+         * than the agent being held up for it
+         */
+        if ( status == AwaitStatus_CANCELLED )
+            return -1;
+        if ( job->state == _ExecuteCmd_QUEUED )
+            return 0; /* its turn never came: no result */
+        i = 0;
+    } else if ( job->state == _ExecuteCmd_QUEUED ) {
+        _ExecuteCmd_start( job );
+    }
+
+    DEBUG_MSGTL( ( "verbose:run:exec", "  waiting for child %d...\n", job->pid ) );
+    while ( job->state != _ExecuteCmd_DONE && ( job->fd >= 0 || job->pidfd >= 0 ) && i ) {
+        FD_ZERO( &readfds );
+        numfds = 0;
+        for ( j = _ExecuteCmd_jobs; j; j = j->next ) {
+            if ( j->fd >= 0 ) {
+                FD_SET( j->fd, &readfds );
+                if ( j->fd >= numfds )
+                    numfds = j->fd + 1;
+            }
+            if ( j->pidfd >= 0 ) {
+                FD_SET( j->pidfd, &readfds );
+                if ( j->pidfd >= numfds )
+                    numfds = j->pidfd + 1;
             }
-        } else
-            result = system( command );
+        }
+        timeout.tv_sec = 1;
+        timeout.tv_usec = 0;
+
+        count = select( numfds, &readfds, NULL, NULL, &timeout );
+        if ( count == -1 ) {
+            if ( errno == EINTR || errno == EAGAIN )
+                continue;
+            DEBUG_MSGTL( ( "verbose:run:exec", "      errno %d\n", errno ) );
+            setPerrorstatus( "select" );
+            break;
+        } else if ( count == 0 ) {
+            DEBUG_MSGTL( ( "verbose:run:exec", "      timeout\n" ) );
+            i--;
+            continue;
+        }
+        for ( j = _ExecuteCmd_jobs; j; j = jnext ) {
+            jnext = j->next;
+            if ( j->fd >= 0 && FD_ISSET( j->fd, &readfds ) )
+                _ExecuteCmd_read( j->fd, j );
+            else if ( j->pidfd >= 0 && FD_ISSET( j->pidfd, &readfds ) )
+                _ExecuteCmd_exited( j->pidfd, j );
+        }
     }
+    DEBUG_MSGTL( ( "verbose:run:exec", "  done reading\n" ) );
+
+    /*
+     * the output may not have come to an end; all the same, close the pipe
+     * to signal that we aren't listening any more, and wait for the child
+     */
+    if ( job->fd >= 0 ) {
+        FdEventManager_unregisterReadFD( job->fd );
+        close( job->fd );
+        job->fd = -1;
+    }
+    if ( job->state != _ExecuteCmd_DONE )
+        _ExecuteCmd_reap( job, 0 );
+    return 0;
+}
+
+/*
+ * Copies a job's output to the caller's buffer (if any)
+ */
+static int
+_ExecuteCmd_result( ExecuteCmd_Job* job, char* output, int* out_len )
+{
+    size_t len;
+
+    if ( output && out_len && *out_len > 0 ) {
+        len = job->outLen;
+        if ( len > ( size_t )*out_len - 1 )
+            len = *out_len - 1;
+        memcpy( output, job->output, len );
+        output[ len ] = 0;
+        *out_len = len;
+        DEBUG_MSGTL( ( "run:exec", "  got %d bytes\n", *out_len ) );
+    }
+    return job->result;
+}
 
+/*
+ * Runs a command to the end, nothing kept
+ */
+static int
+_ExecuteCmd_run( char* command, char* input, int flags,
+    char* output, int* out_len )
+{
+    ExecuteCmd_Job* job;
+    size_t outMax = 0;
+    int result;
+
+    if ( !command )
+        return -1;
+    if ( output && out_len && *out_len > 0 )
+        outMax = *out_len - 1;
+    else if ( output )
+        DEBUG_MSGTL( ( "run:exec",
+            "invalid params; no output will be returned\n" ) );
+
+    job = _ExecuteCmd_newJob( command, input, flags, 0, outMax );
+    if ( job == NULL )
+        return -1;
+    if ( _ExecuteCmd_wait( job ) < 0 ) {
+        if ( job->state == _ExecuteCmd_QUEUED ) {
+            _ExecuteCmd_unlink( job );
+            _ExecuteCmd_freeJob( job );
+        } else {
+            job->orphaned = 1;
+        }
+        return -1;
+    }
+    result = _ExecuteCmd_result( job, output, out_len );
+    _ExecuteCmd_unlink( job );
+    _ExecuteCmd_freeJob( job );
     return result;
 }
 
+int ExecuteCmd_runShellCommand( char* command, char* input,
+    char* output, int* out_len ) /* Or realloc style ? */
+{
+    DEBUG_MSGTL( ( "run:shell", "running '%s'\n", command ? command : "" ) );
+    return _ExecuteCmd_run( command, input, ExecuteCmdFlag_SHELL, output, out_len );
+}
+
 /*
  * Split the given command up into separate tokens,
  * ready to be passed to 'execv'
@@ -136,222 +540,67 @@ ExecuteCmd_tokenizeExecCommand( char* command, int* argc )
 int ExecuteCmd_runExecCommand( char* command, char* input,
     char* output, int* out_len ) /* Or realloc style ? */
 {
-    int ipipe[ 2 ];
-    int opipe[ 2 ];
-    int i;
-    int pid;
-    int result;
-    char** argv;
-    int argc;
-
-    DEBUG_MSGTL( ( "run:exec", "running '%s'\n", command ) );
-    pipe( ipipe );
-    pipe( opipe );
-    if ( ( pid = fork() ) == 0 ) {
-        /*
-         * Child process
-         */
-
-        /*
-         * Set stdin/out/err to use the pipe
-         *   and close everything else
-         */
-        close( 0 );
-        dup( ipipe[ 0 ] );
-        close( ipipe[ 1 ] );
-
-        close( 1 );
-        dup( opipe[ 1 ] );
-        close( opipe[ 0 ] );
-        close( 2 );
-        dup( 1 );
-        for ( i = getdtablesize() - 1; i > 2; i-- )
-            close( i );
-
-        /*
-         * Set up the argv array and execute it
-         * This is being run in the child process,
-         *   so will release resources when it terminates.
-         */
-        argv = ExecuteCmd_tokenizeExecCommand( command, &argc );
-        execv( argv[ 0 ], argv );
-        perror( argv[ 0 ] );
-        exit( 1 ); /* End of child */
-
-    } else if ( pid > 0 ) {
-        char cache[ NETSNMP_MAXCACHESIZE ];
-        char* cache_ptr;
-        ssize_t count, cache_size, offset = 0;
-        int waited = 0, numfds;
-        fd_set readfds;
-        struct timeval timeout;
-
-        /*
-         * Parent process
-         */
-
-        /*
-     * Pass the input message (if any) to the child,
-         * wait for the child to finish executing, and read
-         *    any output into the output buffer (if provided)
-         */
-        close( ipipe[ 0 ] );
-        close( opipe[ 1 ] );
-        if ( input ) {
-            write( ipipe[ 1 ], input, strlen( input ) );
-            close( ipipe[ 1 ] ); /* or flush? */
-        } else
-            close( ipipe[ 1 ] );
-
-        /*
-         * child will block if it writes a lot of data and
-         * fills up the pipe before exiting, so we read data
-         * to keep the pipe empty.
-         */
-        if ( output && ( ( NULL == out_len ) || ( 0 == *out_len ) ) ) {
-            DEBUG_MSGTL( ( "run:exec",
-                "invalid params; no output will be returned\n" ) );
-            output = NULL;
-        }
-        if ( output ) {
-            cache_ptr = output;
-            cache_size = *out_len - 1;
-        } else {
-            cache_ptr = cache;
-            cache_size = sizeof( cache );
-        }
-
-        /*
-         * xxx: some of this code was lifted from get_exec_output
-         * in util_funcs.c. Probably should be moved to a common
-         * routine for both to use.
-         */
-        DEBUG_MSGTL( ( "verbose:run:exec", "  waiting for child %d...\n", pid ) );
-        numfds = opipe[ 0 ] + 1;
-        i = NETSNMP_MAXREADCOUNT;
-        for ( ; i; --i ) {
-            /*
-             * set up data for select
-             */
-            FD_ZERO( &readfds );
-            FD_SET( opipe[ 0 ], &readfds );
-            timeout.tv_sec = 1;
-            timeout.tv_usec = 0;
-
-            DEBUG_MSGTL( ( "verbose:run:exec", "    calling select\n" ) );
-            count = select( numfds, &readfds, NULL, NULL, &timeout );
-            if ( count == -1 ) {
-                if ( EAGAIN == errno )
-                    continue;
-                else {
-                    DEBUG_MSGTL( ( "verbose:run:exec", "      errno %d\n",
-                        errno ) );
-                    setPerrorstatus( "read" );
-                    break;
-                }
-            } else if ( 0 == count ) {
-                DEBUG_MSGTL( ( "verbose:run:exec", "      timeout\n" ) );
-                continue;
-            }
-
-            if ( !FD_ISSET( opipe[ 0 ], &readfds ) ) {
-                DEBUG_MSGTL( ( "verbose:run:exec", "    fd not ready!\n" ) );
-                continue;
-            }
+    return _ExecuteCmd_run( command, input, 0, output, out_len );
+}
 
-            /*
-             * read data from the pipe, optionally saving to output buffer
-             */
-            count = read( opipe[ 0 ], &cache_ptr[ offset ], cache_size );
-            DEBUG_MSGTL( ( "verbose:run:exec",
-                "    read %d bytes\n", ( int )count ) );
-            if ( 0 == count ) {
-                int rc;
-                /*
-                 * we shouldn't get no data, because select should
-                 * wait til the fd is ready. before we go back around,
-                 * check to see if the child exited.
-                 */
-                DEBUG_MSGTL( ( "verbose:run:exec", "    no data!\n" ) );
-                if ( ( rc = waitpid( pid, &result, WNOHANG ) ) <= 0 ) {
-                    if ( rc < 0 ) {
-                        Logger_logPerror( "waitpid" );
-                        break;
-                    } else
-                        DEBUG_MSGTL( ( "verbose:run:exec",
-                            "      child not done!?!\n" ) );
-                    ;
-                } else {
-                    DEBUG_MSGTL( ( "verbose:run:exec", "      child done\n" ) );
-                    waited = 1; /* don't wait again */
-                    break;
-                }
-            } else if ( count > 0 ) {
-                /*
-                 * got some data. fix up offset, if needed.
-                 */
-                if ( output ) {
-                    offset += count;
-                    cache_size -= count;
-                    if ( cache_size <= 0 ) {
-                        DEBUG_MSGTL( ( "verbose:run:exec",
-                            "      output full\n" ) );
-                        break;
-                    }
-                    DEBUG_MSGTL( ( "verbose:run:exec",
-                        "    %d left in buffer\n", ( int )cache_size ) );
-                }
-            } else if ( ( count == -1 ) && ( EAGAIN != errno ) ) {
-                /*
-                 * if error, break
-                 */
-                DEBUG_MSGTL( ( "verbose:run:exec", "      errno %d\n",
-                    errno ) );
-                setPerrorstatus( "read" );
-                break;
-            }
+/*
+ * A job for the same command line and input, running or with a result
+ * still good; results gone stale are dropped on the way
+ */
+static ExecuteCmd_Job*
+_ExecuteCmd_find( const char* command, const char* input, int flags )
+{
+    ExecuteCmd_Job *job, *next, *found = NULL;
+    struct timeval now;
+
+    Time_getMonotonicClock( &now );
+    for ( job = _ExecuteCmd_jobs; job; job = next ) {
+        next = job->next;
+        if ( job->state == _ExecuteCmd_DONE && job->nwaiters == 0
+            && !timercmp( &now, &job->expires, < ) ) {
+            _ExecuteCmd_unlink( job );
+            _ExecuteCmd_freeJob( job );
+            continue;
         }
-        DEBUG_MSGTL( ( "verbose:run:exec", "  done reading\n" ) );
-        if ( output )
-            DEBUG_MSGTL( ( "run:exec", "  got %d bytes\n", *out_len ) );
+        if ( found == NULL && job->cacheTime > 0 && job->flags == flags
+            && !strcmp( job->command, command )
+            && ( input ? job->input && !strcmp( job->input, input ) : !job->input ) )
+            found = job;
+    }
+    return found;
+}
 
-        /*
-         * close pipe to signal that we aren't listenting any more.
-         */
-        close( opipe[ 0 ] );
+int ExecuteCmd_runCachedCommand( char* command, char* input, int flags,
+    int cacheTime, char* output, int* out_len )
+{
+    ExecuteCmd_Job* job;
 
-        /*
-         * if we didn't wait successfully above, wait now.
-         * xxx-rks: seems like this is a waste of the agent's
-         * time. maybe start a time to wait(WNOHANG) once a second,
-         * and late the agent continue?
-         */
-        if ( ( !waited ) && ( waitpid( pid, &result, 0 ) < 0 ) ) {
-            Logger_logPerror( "waitpid" );
+    if ( !command )
+        return -1;
+    if ( cacheTime <= 0 )
+        return _ExecuteCmd_run( command, input, flags, output, out_len );
+
+    job = _ExecuteCmd_find( command, input, flags );
+    if ( job == NULL ) {
+        job = _ExecuteCmd_newJob( command, input, flags, cacheTime,
+            NETSNMP_MAXCACHESIZE );
+        if ( job == NULL )
             return -1;
-        }
-
-        /*
-         * null terminate any output
-         */
-        if ( output ) {
-            output[ offset ] = 0;
-            *out_len = offset;
-        }
-        DEBUG_MSGTL( ( "run:exec", "  child %d finished. result=%d\n",
-            pid, result ) );
-
-        return WEXITSTATUS( result );
-
     } else {
-        /*
-         * Parent process - fork failed
-         */
-        Logger_logPerror( "fork" );
-        close( ipipe[ 0 ] );
-        close( ipipe[ 1 ] );
-        close( opipe[ 0 ] );
-        close( opipe[ 1 ] );
-        return -1;
+        DEBUG_MSGTL( ( "run:exec", "'%s' %s\n", command,
+            job->state == _ExecuteCmd_DONE ? "cached" : "already running" ) );
     }
+    if ( job->state != _ExecuteCmd_DONE && _ExecuteCmd_wait( job ) < 0 )
+        return -1;
+    return _ExecuteCmd_result( job, output, out_len );
+}
+
+void ExecuteCmd_prefetchCommand( char* command, char* input, int flags,
+    int cacheTime )
+{
+    if ( !command || cacheTime <= 0 || _ExecuteCmd_find( command, input, flags ) )
+        return;
+    if ( _ExecuteCmd_newJob( command, input, flags, cacheTime,
+             NETSNMP_MAXCACHESIZE ) )
+        _ExecuteCmd_startQueued();
 }
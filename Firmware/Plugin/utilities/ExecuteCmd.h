@@ -1,6 +1,11 @@
 #ifndef EXECUTECMD_H
 #define EXECUTECMD_H
 
+/* run the command through /bin/sh -c rather than exec'ing it */
+#define ExecuteCmdFlag_SHELL 0x01
+
+/* commands run in the background at once; more wait for their turn */
+#define EXECUTECMD_MAX_RUNNING 8
 
 int
 ExecuteCmd_runShellCommand( char * command,
@@ -14,4 +19,32 @@ ExecuteCmd_runExecCommand( char * command,
                         char * output,
                         int  * out_len );
 
+char **
+ExecuteCmd_tokenizeExecCommand( char * command,
+                             int  * argc );
+
+/*
+ * Like the above, but the result of a run is kept for cacheTime seconds
+ * and handed to any run of the same command line, with the same input,
+ * in that time; a run of it already under way is waited for rather than
+ * started again.  A cacheTime of 0 or less keeps nothing.
+ */
+int
+ExecuteCmd_runCachedCommand( char * command,
+                          char * input,
+                          int    flags,
+                          int    cacheTime,
+                          char * output,
+                          int  * out_len );
+
+/*
+ * Starts a run in the background, for ExecuteCmd_runCachedCommand() to
+ * find, unless one is under way or its result is still kept.
+ */
+void
+ExecuteCmd_prefetchCommand( char * command,
+                         char * input,
+                         int    flags,
+                         int    cacheTime );
+
 #endif // EXECUTECMD_H
@@ -1,24 +1,60 @@
 
-
 #include "get_pid_from_inode.h"
 #include "System/Util/Logger.h"
+#include "System/Util/Time.h"
+#include "System/Util/Trace.h"
 #include <stdint.h>
+#include <sys/stat.h>
 
 #define PROC_PATH "/proc"
 #define SOCKET_TYPE_1 "socket:["
 #define SOCKET_TYPE_2 "[0000]:"
 
-/* Definition of a simple open addressing hash table.*/
+/* Rescan every process at least this often (seconds), to catch sockets*/
+/* that replaced another one without changing the number of open fds.*/
+#define INODE_PID_FULL_SCAN_INTERVAL 30
+
+/* Definition of a simple open addressing hash table, linear probing.*/
 /* When inode == 0 then the entry is empty.*/
 typedef struct {
     ino64_t inode;
     pid_t pid;
 } inode_pid_ent_t;
 
-#define INODE_PID_TABLE_MAX_COLLISIONS 1000
-#define INODE_PID_TABLE_LENGTH 20000
-#define INODE_PID_TABLE_SIZE ( INODE_PID_TABLE_LENGTH * sizeof( inode_pid_ent_t ) )
-static inode_pid_ent_t inode_pid_table[ INODE_PID_TABLE_LENGTH ];
+#define INODE_PID_TABLE_MIN_LENGTH 1024
+static inode_pid_ent_t* inode_pid_table = NULL;
+static uint32_t inode_pid_table_length = 0; /* power of 2 */
+static uint32_t inode_pid_table_count = 0;
+
+/* What we know about a process: the sockets it had open when its fd*/
+/* directory was last read, and what that directory looked like.*/
+typedef struct {
+    pid_t pid;
+    ino64_t fd_ino; /* a new process with a reused pid has a new fd dir */
+    off_t fd_count; /* st_size of the fd dir: number of fds, 0 if unknown */
+    ino64_t* inodes;
+    uint32_t inode_count;
+    uint32_t inode_size;
+} pid_ent_t;
+
+/* sorted by pid */
+static pid_ent_t* pid_table = NULL;
+static uint32_t pid_table_count = 0;
+
+static time_t last_full_scan = 0;
+
+/* How well the incremental scan does, shown by the*/
+/* util:get_pid_from_inode:stats debug token after each scan.*/
+static struct {
+    u_long hits; /* lookups that found an owner */
+    u_long misses; /* lookups that did not */
+    u_long scans; /* calls to netsnmp_get_pid_from_inode_init */
+    u_long full_scans; /* ... that read every process */
+    u_long processes_scanned; /* fd directories read */
+    u_long fds_read; /* fd links read */
+    u_long last_scan_usec;
+    u_long total_scan_usec;
+} inode_pid_stats;
 
 static uint32_t
 _hash( uint64_t key )
@@ -32,46 +68,106 @@ _hash( uint64_t key )
     return key;
 }
 
-static void
-_clear( void )
+static int
+_resize( uint32_t length )
 {
-    /* Clear the inode/pid hash table.*/
-    memset( inode_pid_table, 0, INODE_PID_TABLE_SIZE );
+    inode_pid_ent_t *old = inode_pid_table, *entry;
+    uint32_t old_length = inode_pid_table_length, i, j;
+
+    inode_pid_table = ( inode_pid_ent_t* )calloc( length, sizeof( inode_pid_ent_t ) );
+    if ( NULL == inode_pid_table ) {
+        inode_pid_table = old;
+        return -1;
+    }
+    inode_pid_table_length = length;
+
+    for ( i = 0; i < old_length; i++ ) {
+        if ( old[ i ].inode == 0 )
+            continue;
+        for ( j = _hash( old[ i ].inode );; j++ ) {
+            entry = &inode_pid_table[ j & ( length - 1 ) ];
+            if ( entry->inode == 0 ) {
+                *entry = old[ i ];
+                break;
+            }
+        }
+    }
+    free( old );
+    return 0;
 }
 
 static void
 _set( ino64_t inode, pid_t pid )
 {
-    uint32_t hash = _hash( inode );
     uint32_t i;
     inode_pid_ent_t* entry;
 
-    /* We will try for a maximum number of collisions.*/
-    for ( i = 0; i < INODE_PID_TABLE_MAX_COLLISIONS; i++ ) {
-        entry = &inode_pid_table[ ( hash + i ) % INODE_PID_TABLE_LENGTH ];
+    /* Keep the table at most half full, so that probe runs stay short.*/
+    if ( ( inode_pid_table_count + 1 ) * 2 > inode_pid_table_length
+        && _resize( inode_pid_table_length ? inode_pid_table_length * 2
+                                           : INODE_PID_TABLE_MIN_LENGTH )
+            < 0 )
+        return;
+
+    for ( i = _hash( inode );; i++ ) {
+        entry = &inode_pid_table[ i & ( inode_pid_table_length - 1 ) ];
 
         /* Check if this entry is empty, or the actual inode we were looking for.*/
-        /* The second part should never happen, but it is here for completeness.*/
+        /* The latter happens for sockets shared between processes: the last*/
+        /* process scanned wins.*/
         if ( entry->inode == 0 || entry->inode == inode ) {
+            if ( entry->inode == 0 )
+                inode_pid_table_count++;
             entry->inode = inode;
             entry->pid = pid;
             return;
         }
     }
+}
+
+static void
+_remove( ino64_t inode, pid_t pid )
+{
+    uint32_t mask = inode_pid_table_length - 1;
+    uint32_t i, j, home;
+
+    if ( 0 == inode_pid_table_length )
+        return;
 
-    /* We will silently fail to insert the inode if we get too many collisions.*/
-    /* the _get function will return a zero pid.*/
+    for ( i = _hash( inode ) & mask;; i = ( i + 1 ) & mask ) {
+        if ( inode_pid_table[ i ].inode == 0 )
+            return;
+        if ( inode_pid_table[ i ].inode == inode )
+            break;
+    }
+
+    /* Another process owns the socket now, leave it.*/
+    if ( inode_pid_table[ i ].pid != pid )
+        return;
+
+    /* Shift the rest of the probe run back, so no tombstones are needed.*/
+    for ( j = ( i + 1 ) & mask; inode_pid_table[ j ].inode != 0; j = ( j + 1 ) & mask ) {
+        home = _hash( inode_pid_table[ j ].inode ) & mask;
+        if ( ( ( j - home ) & mask ) >= ( ( j - i ) & mask ) ) {
+            inode_pid_table[ i ] = inode_pid_table[ j ];
+            i = j;
+        }
+    }
+    inode_pid_table[ i ].inode = 0;
+    inode_pid_table[ i ].pid = 0;
+    inode_pid_table_count--;
 }
 
 static pid_t _get( ino64_t inode )
 {
-    uint32_t hash = _hash( inode );
     uint32_t i;
     inode_pid_ent_t* entry;
 
-    /* We will try for a maximum number of collisions.*/
-    for ( i = 0; i < INODE_PID_TABLE_MAX_COLLISIONS; i++ ) {
-        entry = &inode_pid_table[ ( hash + i ) % INODE_PID_TABLE_LENGTH ];
+    if ( 0 == inode_pid_table_length )
+        return 0;
+
+    for ( i = _hash( inode );; i++ ) {
+        entry = &inode_pid_table[ i & ( inode_pid_table_length - 1 ) ];
 
         /* Check if this entry is empty, or the actual inode we were looking for.*/
         /* If the entry is empty it means the inode is not in the table and we*/
@@ -80,27 +176,105 @@ static pid_t _get( ino64_t inode )
             return entry->pid;
         }
     }
+}
 
-    /* We could not find the pid.*/
-    return 0;
+/* Forget the sockets a process had open.*/
+static void
+_forget( pid_ent_t* proc )
+{
+    uint32_t i;
+
+    for ( i = 0; i < proc->inode_count; i++ )
+        _remove( proc->inodes[ i ], proc->pid );
+    proc->inode_count = 0;
 }
 
-void netsnmp_get_pid_from_inode_init( void )
+/* Read /proc/<pid>/fd/ and record the sockets found there.*/
+static void
+_scan( pid_ent_t* proc, char* path_name, int filelen )
 {
-    DIR *procdirs = NULL, *piddirs = NULL;
-    char path_name[ PATH_MAX + 1 ];
+    DIR* piddir;
+    struct dirent* pidinfo;
     char socket_lnk[ NAME_MAX + 1 ];
-    int filelen = 0, readlen = 0;
-    struct dirent *procinfo, *pidinfo;
-    pid_t pid = 0;
-    ino64_t temp_inode;
+    int readlen = 0;
+    ino64_t temp_inode, *tmp;
+
+    _forget( proc );
+    inode_pid_stats.processes_scanned++;
+
+    /* walk over all the files in /proc/<pid>/fd/*/
+    if ( !( piddir = opendir( path_name ) ) )
+        return;
+
+    while ( ( pidinfo = readdir( piddir ) ) != NULL ) {
+        if ( '.' == pidinfo->d_name[ 0 ] )
+            continue;
+        if ( filelen + strlen( pidinfo->d_name ) > PATH_MAX )
+            continue;
+
+        strcpy( path_name + filelen, pidinfo->d_name );
 
-    _clear();
+        /* The file discriptor is a symbolic link to a socket or a file.*/
+        /* Thus read the symbolic link.*/
+        inode_pid_stats.fds_read++;
+        readlen = readlink( path_name, socket_lnk, NAME_MAX );
+        if ( readlen < 0 )
+            continue;
+
+        socket_lnk[ readlen ] = '\0';
+
+        /* Check if to see if the file descriptor is a socket by comparing*/
+        /* the start to a string. Also extract the inode number from this*/
+        /* symbolic link.*/
+        if ( !strncmp( socket_lnk, SOCKET_TYPE_1, 8 ) ) {
+            temp_inode = strtoull( socket_lnk + 8, NULL, 0 );
+        } else if ( !strncmp( socket_lnk, SOCKET_TYPE_2, 7 ) ) {
+            temp_inode = strtoull( socket_lnk + 7, NULL, 0 );
+        } else {
+            temp_inode = 0;
+        }
+
+        /* Add the inode/pid combination to our hash table.*/
+        if ( temp_inode == 0 )
+            continue;
+        if ( proc->inode_count == proc->inode_size ) {
+            uint32_t size = proc->inode_size ? proc->inode_size * 2 : 8;
+            tmp = ( ino64_t* )realloc( proc->inodes, size * sizeof( ino64_t ) );
+            if ( NULL == tmp )
+                break;
+            proc->inodes = tmp;
+            proc->inode_size = size;
+        }
+        proc->inodes[ proc->inode_count++ ] = temp_inode;
+        _set( temp_inode, proc->pid );
+    }
+    closedir( piddir );
+    path_name[ filelen ] = '\0';
+}
+
+static int
+_pid_compare( const void* lhs, const void* rhs )
+{
+    pid_t l = *( const pid_t* )lhs, r = *( const pid_t* )rhs;
+
+    return ( l < r ) ? -1 : ( l > r );
+}
+
+/* Collect the pids in /proc, sorted. Returns the count, -1 on error.*/
+static int
+_list_pids( pid_t** pids )
+{
+    DIR* procdirs;
+    struct dirent* procinfo;
+    int count = 0, size = 0;
+    pid_t* tmp;
+
+    *pids = NULL;
 
     /* walk over all directories in /proc*/
     if ( !( procdirs = opendir( PROC_PATH ) ) ) {
         LOGGER_LOGONCE( ( LOGGER_PRIORITY_ERR, "snmpd: cannot open /proc\n" ) );
-        return;
+        return -1;
     }
 
     while ( ( procinfo = readdir( procdirs ) ) != NULL ) {
@@ -114,56 +288,135 @@ void netsnmp_get_pid_from_inode_init( void )
         if ( *name )
             continue;
 
-        /* Create the /proc/<pid>/fd/ path name.*/
-        memset( path_name, '\0', PATH_MAX + 1 );
-        filelen = snprintf( path_name, PATH_MAX,
-            PROC_PATH "/%s/fd/", procinfo->d_name );
-        if ( filelen <= 0 || PATH_MAX < filelen )
-            continue;
+        if ( count == size ) {
+            size = size ? size * 2 : 256;
+            tmp = ( pid_t* )realloc( *pids, size * sizeof( pid_t ) );
+            if ( NULL == tmp )
+                break;
+            *pids = tmp;
+        }
+        ( *pids )[ count++ ] = strtoul( procinfo->d_name, NULL, 0 );
+    }
+    closedir( procdirs );
 
-        /* walk over all the files in /proc/<pid>/fd/*/
-        if ( !( piddirs = opendir( path_name ) ) )
-            continue;
+    qsort( *pids, count, sizeof( pid_t ), _pid_compare );
+    return count;
+}
 
-        while ( ( pidinfo = readdir( piddirs ) ) != NULL ) {
-            if ( filelen + strlen( pidinfo->d_name ) > PATH_MAX )
-                continue;
-
-            strcpy( path_name + filelen, pidinfo->d_name );
-
-            /* The file discriptor is a symbolic link to a socket or a file.*/
-            /* Thus read the symbolic link.*/
-            memset( socket_lnk, '\0', NAME_MAX + 1 );
-            readlen = readlink( path_name, socket_lnk, NAME_MAX );
-            if ( readlen < 0 )
-                continue;
-
-            socket_lnk[ readlen ] = '\0';
-
-            /* Check if to see if the file descriptor is a socket by comparing*/
-            /* the start to a string. Also extract the inode number from this*/
-            /* symbolic link.*/
-            if ( !strncmp( socket_lnk, SOCKET_TYPE_1, 8 ) ) {
-                temp_inode = strtoull( socket_lnk + 8, NULL, 0 );
-            } else if ( !strncmp( socket_lnk, SOCKET_TYPE_2, 7 ) ) {
-                temp_inode = strtoull( socket_lnk + 7, NULL, 0 );
-            } else {
-                temp_inode = 0;
-            }
+/*
+ * Bring the inode/pid table up to date. Only processes that are new, or
+ * whose number of open fds changed, are read again; processes that went
+ * away are dropped. Every INODE_PID_FULL_SCAN_INTERVAL seconds all
+ * processes are read again.
+ */
+void netsnmp_get_pid_from_inode_init( void )
+{
+    char path_name[ PATH_MAX + 1 ];
+    int filelen = 0, full, rescan;
+    pid_t* pids;
+    pid_ent_t *procs, *proc, *old;
+    uint32_t i, o = 0, n = 0;
+    int count;
+    struct stat st;
+    struct timeval start, end;
 
-            /* Add the inode/pid combination to our hash table.*/
-            if ( temp_inode != 0 ) {
-                pid = strtoul( procinfo->d_name, NULL, 0 );
-                _set( temp_inode, pid );
-            }
+    Time_getMonotonicClock( &start );
+
+    count = _list_pids( &pids );
+    if ( count < 0 )
+        return;
+
+    procs = ( pid_ent_t* )calloc( count ? count : 1, sizeof( pid_ent_t ) );
+    if ( NULL == procs ) {
+        free( pids );
+        return;
+    }
+
+    full = ( 0 == last_full_scan
+        || start.tv_sec - last_full_scan >= INODE_PID_FULL_SCAN_INTERVAL );
+    if ( full )
+        last_full_scan = start.tv_sec;
+
+    /* Merge the current pids with what we knew, both sorted.*/
+    for ( i = 0; i < ( uint32_t )count; i++ ) {
+        /* Processes that exited.*/
+        while ( o < pid_table_count && pid_table[ o ].pid < pids[ i ] ) {
+            _forget( &pid_table[ o ] );
+            free( pid_table[ o ].inodes );
+            o++;
         }
-        closedir( piddirs );
+
+        proc = &procs[ n ];
+        old = ( o < pid_table_count && pid_table[ o ].pid == pids[ i ] )
+            ? &pid_table[ o++ ]
+            : NULL;
+        if ( old )
+            *proc = *old;
+        else
+            proc->pid = pids[ i ];
+
+        /* Create the /proc/<pid>/fd/ path name.*/
+        filelen = snprintf( path_name, PATH_MAX, PROC_PATH "/%d/fd/", pids[ i ] );
+        if ( filelen <= 0 || PATH_MAX < filelen || stat( path_name, &st ) < 0 ) {
+            /* Gone, or not ours to read.*/
+            _forget( proc );
+            free( proc->inodes );
+            memset( proc, 0, sizeof( *proc ) );
+            continue;
+        }
+
+        /* st_size of the fd directory counts the open fds on recent*/
+        /* kernels. Where it is 0 there is no telling, so read it again.*/
+        rescan = full || NULL == old || 0 == st.st_size
+            || st.st_size != proc->fd_count || st.st_ino != proc->fd_ino;
+        if ( rescan ) {
+            proc->fd_ino = st.st_ino;
+            proc->fd_count = st.st_size;
+            _scan( proc, path_name, filelen );
+        }
+        n++;
+    }
+    for ( ; o < pid_table_count; o++ ) {
+        _forget( &pid_table[ o ] );
+        free( pid_table[ o ].inodes );
     }
-    if ( procdirs )
-        closedir( procdirs );
+
+    free( pid_table );
+    free( pids );
+    pid_table = procs;
+    pid_table_count = n;
+
+    Time_getMonotonicClock( &end );
+    inode_pid_stats.scans++;
+    if ( full )
+        inode_pid_stats.full_scans++;
+    inode_pid_stats.last_scan_usec = ( end.tv_sec - start.tv_sec ) * 1000000
+        + ( end.tv_usec - start.tv_usec );
+    inode_pid_stats.total_scan_usec += inode_pid_stats.last_scan_usec;
+
+    DEBUG_MSGTL( ( "util:get_pid_from_inode",
+        "%s scan: %u processes, %u sockets, %lu usec\n", full ? "full" : "partial",
+        pid_table_count, inode_pid_table_count, inode_pid_stats.last_scan_usec ) );
+    DEBUG_MSGTL( ( "util:get_pid_from_inode:stats",
+        "%lu scans (%lu full, %lu usec), %lu fd dirs and %lu fds read, "
+        "%lu lookups found an owner, %lu did not\n",
+        inode_pid_stats.scans, inode_pid_stats.full_scans,
+        inode_pid_stats.total_scan_usec, inode_pid_stats.processes_scanned,
+        inode_pid_stats.fds_read, inode_pid_stats.hits, inode_pid_stats.misses ) );
 }
 
 pid_t netsnmp_get_pid_from_inode( ino64_t inode )
 {
-    return _get( inode );
+    pid_t pid;
+
+    /* Sockets in TIME_WAIT and the like have no inode, nor owner.*/
+    if ( 0 == inode )
+        return 0;
+
+    pid = _get( inode );
+    if ( pid )
+        inode_pid_stats.hits++;
+    else
+        inode_pid_stats.misses++;
+    return pid;
 }
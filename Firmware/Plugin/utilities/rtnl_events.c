@@ -0,0 +1,233 @@
+#include "rtnl_events.h"
+#include "System/Dispatcher/FdEventManager.h"
+#include "System/Util/Logger.h"
+#include "System/Util/Trace.h"
+#include <errno.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+
+#ifndef SOL_NETLINK
+#define SOL_NETLINK 270
+#endif
+
+/*
+ * notifications come in bursts (an interface going down takes its
+ * addresses and routes with it): give the kernel room to queue them
+ * while the agent is busy with a request.
+ */
+#define RTNL_EVENTS_RCVBUF ( 1024 * 1024 )
+#define RTNL_EVENTS_BUF_SIZE 16384
+
+typedef struct rtnl_listener_s {
+    u_int groups;
+    netsnmp_rtnl_event_f* cb;
+    void* context;
+    struct rtnl_listener_s* next;
+} rtnl_listener;
+
+static rtnl_listener* _rtnl_listeners = NULL;
+static int _rtnl_fd = -1;
+/* RTMGRP_* groups the socket is already a member of */
+static u_int _rtnl_groups = 0;
+
+/** RTMGRP_* group a notification was sent to, 0 if not interesting */
+static u_int
+_msg_group( const struct nlmsghdr* h )
+{
+    switch ( h->nlmsg_type ) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+        return RTMGRP_LINK;
+
+    case RTM_NEWNEIGH:
+    case RTM_DELNEIGH:
+        return RTMGRP_NEIGH;
+
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+        if ( h->nlmsg_len < NLMSG_LENGTH( sizeof( struct ifaddrmsg ) ) )
+            return 0;
+        switch ( ( ( struct ifaddrmsg* )NLMSG_DATA( h ) )->ifa_family ) {
+        case AF_INET:
+            return RTMGRP_IPV4_IFADDR;
+        case AF_INET6:
+            return RTMGRP_IPV6_IFADDR;
+        }
+        return 0;
+
+    case RTM_NEWROUTE:
+    case RTM_DELROUTE:
+        if ( h->nlmsg_len < NLMSG_LENGTH( sizeof( struct rtmsg ) ) )
+            return 0;
+        switch ( ( ( struct rtmsg* )NLMSG_DATA( h ) )->rtm_family ) {
+        case AF_INET:
+            return RTMGRP_IPV4_ROUTE;
+        case AF_INET6:
+            return RTMGRP_IPV6_ROUTE;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+static void
+_dispatch( const struct nlmsghdr* h, u_int group )
+{
+    rtnl_listener *l, *next;
+
+    for ( l = _rtnl_listeners; l; l = next ) {
+        next = l->next;
+        if ( l->groups & group )
+            l->cb( h, l->context );
+    }
+}
+
+static void
+_rtnl_events_read( int fd, void* data )
+{
+    char buf[ RTNL_EVENTS_BUF_SIZE ];
+    struct nlmsghdr* h;
+    u_int group;
+    int len, events = 0;
+
+    for ( ;; ) {
+        len = recv( fd, buf, sizeof( buf ), MSG_DONTWAIT );
+        if ( len < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            if ( ENOBUFS == errno ) {
+                /*
+                 * the kernel dropped notifications: nobody can tell
+                 * what changed any more, so everybody reloads.
+                 */
+                DEBUG_MSGTL( ( "utilities:rtnl_events", "overrun\n" ) );
+                _dispatch( NULL, ~0U );
+                continue;
+            }
+            if ( EAGAIN != errno && EWOULDBLOCK != errno )
+                Logger_log( LOGGER_PRIORITY_ERR,
+                    "rtnl_events: recv failed: %s\n", strerror( errno ) );
+            break;
+        }
+        if ( 0 == len )
+            break;
+
+        for ( h = ( struct nlmsghdr* )buf; NLMSG_OK( h, len );
+              h = NLMSG_NEXT( h, len ) ) {
+            group = _msg_group( h );
+            if ( 0 == group )
+                continue;
+            ++events;
+            _dispatch( h, group );
+        }
+    }
+
+    DEBUG_MSGTL( ( "utilities:rtnl_events", "%d events\n", events ) );
+}
+
+static int
+_rtnl_events_open( void )
+{
+    struct sockaddr_nl sa;
+    int fd, size = RTNL_EVENTS_RCVBUF;
+
+    fd = socket( AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE );
+    if ( fd < 0 ) {
+        DEBUG_MSGTL( ( "utilities:rtnl_events", "socket failed (%d)\n", errno ) );
+        return -1;
+    }
+
+    memset( &sa, 0, sizeof( sa ) );
+    sa.nl_family = AF_NETLINK;
+    if ( bind( fd, ( struct sockaddr* )&sa, sizeof( sa ) ) < 0 ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "rtnl_events: bind failed: %s\n",
+            strerror( errno ) );
+        close( fd );
+        return -1;
+    }
+
+    if ( setsockopt( fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof( size ) ) < 0 )
+        DEBUG_MSGTL( ( "utilities:rtnl_events", "SO_RCVBUF failed (%d)\n",
+            errno ) );
+
+    if ( FdEventManager_registerReadFD( fd, _rtnl_events_read, NULL ) != 0 ) {
+        Logger_log( LOGGER_PRIORITY_ERR,
+            "rtnl_events: error registering netlink socket\n" );
+        close( fd );
+        return -1;
+    }
+
+    _rtnl_fd = fd;
+    _rtnl_groups = 0;
+    return 0;
+}
+
+/** joins the groups in the RTMGRP_* mask the socket is not a member of */
+static int
+_rtnl_events_join( u_int groups )
+{
+    int i, group;
+
+    for ( i = 0; i < 32; ++i ) {
+        if ( !( groups & ( 1U << i ) ) || ( _rtnl_groups & ( 1U << i ) ) )
+            continue;
+        /* legacy RTMGRP_x is 1 << ( RTNLGRP_x - 1 ) */
+        group = i + 1;
+        if ( setsockopt( _rtnl_fd, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP,
+                 &group, sizeof( group ) )
+            < 0 ) {
+            DEBUG_MSGTL( ( "utilities:rtnl_events", "group %d: error %d\n",
+                group, errno ) );
+            return -1;
+        }
+        _rtnl_groups |= 1U << i;
+    }
+    return 0;
+}
+
+int netsnmp_rtnl_events_register( u_int groups, netsnmp_rtnl_event_f* cb,
+    void* context )
+{
+    rtnl_listener* l;
+
+    if ( NULL == cb || 0 == groups )
+        return -1;
+
+    if ( _rtnl_fd < 0 && _rtnl_events_open() < 0 )
+        return -1;
+
+    if ( _rtnl_events_join( groups ) < 0 )
+        return -1;
+
+    l = MEMORY_MALLOC_TYPEDEF( rtnl_listener );
+    if ( NULL == l )
+        return -1;
+    l->groups = groups;
+    l->cb = cb;
+    l->context = context;
+    l->next = _rtnl_listeners;
+    _rtnl_listeners = l;
+
+    DEBUG_MSGTL( ( "utilities:rtnl_events", "listening to 0x%x\n", groups ) );
+    return 0;
+}
+
+void netsnmp_rtnl_events_unregister( netsnmp_rtnl_event_f* cb, void* context )
+{
+    rtnl_listener **prev, *l;
+
+    for ( prev = &_rtnl_listeners; ( l = *prev ); ) {
+        if ( l->cb == cb && l->context == context ) {
+            *prev = l->next;
+            MEMORY_FREE( l );
+        } else
+            prev = &l->next;
+    }
+
+    if ( NULL == _rtnl_listeners && _rtnl_fd >= 0 ) {
+        FdEventManager_unregisterReadFD( _rtnl_fd );
+        close( _rtnl_fd );
+        _rtnl_fd = -1;
+        _rtnl_groups = 0;
+    }
+}
@@ -0,0 +1,35 @@
+/*
+ * utilities/rtnl_events.h:  one shared rtnetlink socket subscribed to the
+ * multicast groups the loaded tables care about, so that they learn about
+ * link/address/route changes instead of polling for them.
+ */
+#ifndef NETSNMP_MIBGROUP_UTILITIES_RTNL_EVENTS_H
+#define NETSNMP_MIBGROUP_UTILITIES_RTNL_EVENTS_H
+
+#include "CacheHandler.h"
+#include "Types.h"
+#include <linux/rtnetlink.h>
+
+/*
+ * called for every notification in one of the groups the listener asked
+ * for. the message is only valid during the call.
+ *
+ * msg is NULL when the socket overran and notifications were lost: the
+ * listener has to resynchronize with a full reload.
+ */
+typedef void (netsnmp_rtnl_event_f)(const struct nlmsghdr *msg,
+                                    void *context);
+
+/*
+ * listen to the RTMGRP_* groups in groups.
+ *
+ * @retval  0 registered
+ * @retval -1 rtnetlink notifications not available (keep polling)
+ */
+int netsnmp_rtnl_events_register(u_int groups, netsnmp_rtnl_event_f *cb,
+                                 void *context);
+
+void netsnmp_rtnl_events_unregister(netsnmp_rtnl_event_f *cb,
+                                    void *context);
+
+#endif /* NETSNMP_MIBGROUP_UTILITIES_RTNL_EVENTS_H */
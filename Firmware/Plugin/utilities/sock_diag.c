@@ -0,0 +1,137 @@
+#include "sock_diag.h"
+#include "System/Util/Logger.h"
+#include "System/Util/Trace.h"
+#include <errno.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <sys/socket.h>
+
+/*
+ * big enough for a few hundred sockets per recv; the kernel fills it
+ * up to the size we offer.
+ */
+#define SOCK_DIAG_BUF_SIZE 32768
+
+/* set once the kernel told us it has no sock_diag at all */
+static int _sock_diag_unsupported = 0;
+
+static int
+_open_socket( void )
+{
+    int fd;
+
+    fd = socket( AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG );
+    if ( fd < 0 ) {
+        if ( EPROTONOSUPPORT == errno || EAFNOSUPPORT == errno )
+            _sock_diag_unsupported = 1;
+        DEBUG_MSGTL( ( "utilities:sock_diag", "socket failed (%d)\n", errno ) );
+    }
+    return fd;
+}
+
+static int
+_send_request( int fd, int family, int protocol, u_int states )
+{
+    struct sockaddr_nl sa;
+    struct {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 r;
+    } req;
+
+    memset( &sa, 0, sizeof( sa ) );
+    sa.nl_family = AF_NETLINK;
+
+    memset( &req, 0, sizeof( req ) );
+    req.nlh.nlmsg_len = sizeof( req );
+    req.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = 1;
+    req.r.sdiag_family = family;
+    req.r.sdiag_protocol = protocol;
+    req.r.idiag_states = states;
+
+    if ( sendto( fd, &req, sizeof( req ), 0, ( struct sockaddr* )&sa,
+             sizeof( sa ) )
+        < 0 ) {
+        DEBUG_MSGTL( ( "utilities:sock_diag", "sendto failed (%d)\n", errno ) );
+        return -1;
+    }
+    return 0;
+}
+
+int netsnmp_sock_diag_dump( int family, int protocol, u_int states,
+    netsnmp_sock_diag_f* cb, void* context )
+{
+    char buf[ SOCK_DIAG_BUF_SIZE ];
+    struct nlmsghdr* h;
+    struct nlmsgerr* err;
+    int fd, len, rc = 0, rows = 0, done = 0;
+
+    if ( NULL == cb )
+        return -1;
+
+    if ( _sock_diag_unsupported )
+        return 1;
+
+    fd = _open_socket();
+    if ( fd < 0 )
+        return 1;
+
+    if ( _send_request( fd, family, protocol, states ) < 0 ) {
+        close( fd );
+        return 1;
+    }
+
+    while ( !done ) {
+        len = recv( fd, buf, sizeof( buf ), 0 );
+        if ( len < 0 ) {
+            if ( EINTR == errno )
+                continue;
+            Logger_log( LOGGER_PRIORITY_ERR, "sock_diag: recv failed: %s\n",
+                strerror( errno ) );
+            rc = -2;
+            break;
+        }
+        if ( 0 == len )
+            break;
+
+        for ( h = ( struct nlmsghdr* )buf; NLMSG_OK( h, len );
+              h = NLMSG_NEXT( h, len ) ) {
+            if ( NLMSG_DONE == h->nlmsg_type ) {
+                done = 1;
+                break;
+            }
+            if ( NLMSG_ERROR == h->nlmsg_type ) {
+                err = ( struct nlmsgerr* )NLMSG_DATA( h );
+                DEBUG_MSGTL( ( "utilities:sock_diag",
+                    "family %d protocol %d: error %d\n", family, protocol,
+                    -err->error ) );
+                /*
+                 * a kernel without (this part of) inet_diag refuses the
+                 * request up front; anything later is a real error.
+                 */
+                rc = ( 0 == rows ) ? 1 : -2;
+                done = 1;
+                break;
+            }
+            if ( SOCK_DIAG_BY_FAMILY != h->nlmsg_type
+                || h->nlmsg_len < NLMSG_LENGTH( sizeof( struct inet_diag_msg ) ) )
+                continue;
+
+            ++rows;
+            rc = cb( ( const struct inet_diag_msg* )NLMSG_DATA( h ), context );
+            if ( rc < 0 ) {
+                done = 1;
+                break;
+            }
+            rc = 0;
+        }
+    }
+
+    close( fd );
+
+    DEBUG_MSGTL( ( "utilities:sock_diag", "family %d protocol %d: %d rows\n",
+        family, protocol, rows ) );
+
+    return rc;
+}
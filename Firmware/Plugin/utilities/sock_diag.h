@@ -0,0 +1,33 @@
+/*
+ * utilities/sock_diag.h:  dump the kernel socket tables over
+ * NETLINK_SOCK_DIAG (inet_diag) instead of parsing /proc/net/{tcp,udp}.
+ */
+#ifndef NETSNMP_MIBGROUP_UTILITIES_SOCK_DIAG_H
+#define NETSNMP_MIBGROUP_UTILITIES_SOCK_DIAG_H
+
+#include "Types.h"
+#include <linux/inet_diag.h>
+
+/*
+ * called once per socket. the message is only valid during the call.
+ * returning < 0 stops the dump.
+ */
+typedef int (netsnmp_sock_diag_f)(const struct inet_diag_msg *msg,
+                                  void *context);
+
+/** idiag_states mask selecting every state */
+#define NETSNMP_SOCK_DIAG_ALL_STATES      0xffffffff
+
+/*
+ * dump all sockets of the given family (AF_INET/AF_INET6) and protocol
+ * (IPPROTO_TCP/IPPROTO_UDP) whose state bit is set in states.
+ *
+ * @retval  0 dump complete
+ * @retval  1 sock_diag not available for this family/protocol, nothing
+ *            was dumped (use the procfs loader instead)
+ * @retval <0 error, or the value returned by the callback
+ */
+int netsnmp_sock_diag_dump(int family, int protocol, u_int states,
+                           netsnmp_sock_diag_f *cb, void *context);
+
+#endif /* NETSNMP_MIBGROUP_UTILITIES_SOCK_DIAG_H */
@@ -11,13 +11,15 @@ unix {
                priot_proj \
                plugin_proj \
                daemon_proj \
-               test_proj
+               test_proj \
+               bench_proj
 
     core_proj.subdir   = Core
     priot_proj.subdir  = Priot
     plugin_proj.subdir = Plugin
     daemon_proj.subdir = Daemon
     test_proj.subdir =  Test
+    bench_proj.subdir = Bench
 
 
     daemon_proj.depends = core_proj  priot_proj plugin_proj
@@ -20,6 +20,7 @@
 #include "VarStruct.h"
 
 #include <sys/time.h>
+#include <time.h>
 
 int Agent_handlePdu( AgentSession* asp );
 int Agent_handleRequest( AgentSession* asp,
@@ -121,6 +122,13 @@ AgentSession* agent_processingSet = NULL;
 AgentSession* agent_delegated_list = NULL;
 AgentSession* agent_agentQueuedList = NULL;
 
+/*
+ * sessions one of whose delegated requests is done, and when all the
+ * delegated ones were last looked at
+ */
+static AgentSession* _agent_doneList = NULL;
+static time_t _agent_lastDelegatedSweep = 0;
+
 static int _agent_currentGlobalid = 0;
 
 int agent_running = 1;
@@ -1184,6 +1192,40 @@ Agent_initAgentPriotSession( Types_Session* session, Types_Pdu* pdu )
     return asp;
 }
 
+static void
+_Agent_removeFromDone( AgentSession* asp )
+{
+    AgentSession** prev;
+
+    if ( !asp->queuedDone )
+        return;
+    for ( prev = &_agent_doneList; *prev; prev = &( *prev )->nextDone )
+        if ( *prev == asp ) {
+            *prev = asp->nextDone;
+            break;
+        }
+    asp->nextDone = NULL;
+    asp->queuedDone = 0;
+}
+
+/*
+ * Agent_delegatedRequestDone
+ *
+ * called when a delegated request of asp is done, so the main loop looks
+ * at asp again rather than at every delegated session.  Handlers going
+ * through AgentHandler_handlerMarkRequestsAsDelegated(),
+ * AgentHandler_freeDelegatedCache() or Agent_requestSetError() needn't
+ * call it themselves.
+ */
+void Agent_delegatedRequestDone( AgentSession* asp )
+{
+    if ( asp == NULL || asp->queuedDone )
+        return;
+    asp->queuedDone = 1;
+    asp->nextDone = _agent_doneList;
+    _agent_doneList = asp;
+}
+
 void Agent_freeAgentPriotSession( AgentSession* asp )
 {
     if ( !asp )
@@ -1192,6 +1234,7 @@ void Agent_freeAgentPriotSession( AgentSession* asp )
     DEBUG_MSGTL( ( "snmp_agent", "agent_session %8p released\n", asp ) );
 
     Agent_removeFromDelegated( asp );
+    _Agent_removeFromDone( asp );
 
     DEBUG_MSGTL( ( "verbose:asp", "asp %p reqinfo %p freed\n",
         asp, asp->reqinfo ) );
@@ -2330,54 +2373,49 @@ int Agent_handleVarRequests( AgentSession* asp )
 }
 
 /*
-* loop through our sessions known delegated sessions and check to see
-* if they've completed yet. If there are no more delegated sessions,
-* check for and process any queued requests
+* check the delegated sessions that had a request done to see if they've
+* completed yet. If there are no more delegated sessions, check for and
+* process any queued requests
 */
 void Agent_checkOutstandingAgentRequests( void )
 {
-    AgentSession *asp, *prev_asp = NULL, *next_asp = NULL;
+    AgentSession* asp;
+    time_t now;
 
     /*
-    * deal with delegated requests
+    * once a second, look at all of them, in case a handler cleared
+    * request->delegated itself without saying so
     */
-    for ( asp = agent_delegated_list; asp; asp = next_asp ) {
-        next_asp = asp->next; /* save in case we clean up asp */
-        if ( !Agent_checkForDelegated( asp ) ) {
-
-            /*
-            * we're done with this one, remove from queue
-            */
-            if ( prev_asp != NULL )
-                prev_asp->next = asp->next;
-            else
-                agent_delegated_list = asp->next;
-            asp->next = NULL;
+    if ( agent_delegated_list && ( now = time( NULL ) ) != _agent_lastDelegatedSweep ) {
+        _agent_lastDelegatedSweep = now;
+        for ( asp = agent_delegated_list; asp; asp = asp->next )
+            Agent_delegatedRequestDone( asp );
+    }
 
-            /*
-            * check request status
-            */
-            Agent_checkAllRequestsStatus( asp, 0 );
+    /*
+    * deal with delegated requests
+    */
+    while ( ( asp = _agent_doneList ) != NULL ) {
+        _agent_doneList = asp->nextDone;
+        asp->nextDone = NULL;
+        asp->queuedDone = 0;
 
-            /*
-            * continue processing or finish up
-            */
-            Agent_checkDelayedRequest( asp );
+        /*
+        * still waiting for others, or not delegated at all
+        */
+        if ( Agent_checkForDelegated( asp ) || !Agent_removeFromDelegated( asp ) )
+            continue;
+        asp->next = NULL;
 
-            /*
-            * if head was removed, don't drop it if it
-            * was it re-queued
-            */
-            if ( ( prev_asp == NULL ) && ( agent_delegated_list == asp ) ) {
-                prev_asp = asp;
-            }
-        } else {
+        /*
+        * check request status
+        */
+        Agent_checkAllRequestsStatus( asp, 0 );
 
-            /*
-            * asp is still on the queue
-            */
-            prev_asp = asp;
-        }
+        /*
+        * continue processing or finish up
+        */
+        Agent_checkDelayedRequest( asp );
     }
 
     /*
@@ -3070,6 +3108,8 @@ _Agent_requestSetError( RequestInfo* request, int mode, int error_value )
         return ErrorCode_NO_VARS;
 
     request->processed = 1;
+    if ( request->delegated && request->agent_req_info )
+        Agent_delegatedRequestDone( request->agent_req_info->asp );
     request->delegated = REQUEST_IS_NOT_DELEGATED;
 
     switch ( error_value ) {
@@ -186,6 +186,12 @@ typedef struct AgentSession_s {
     int treecache_num; /* number of current cache entries */
     Cachemap* cache_store;
     int vbcount;
+
+    /*
+     * on the completion queue, see Agent_delegatedRequestDone()
+     */
+    struct AgentSession_s* nextDone;
+    int queuedDone;
 } AgentSession;
 
 /*
@@ -212,6 +218,7 @@ int Agent_initMasterAgent( void );
 void Agent_shutdownMasterAgent( void );
 int Agent_checkAndProcess( int block );
 void Agent_checkOutstandingAgentRequests( void );
+void Agent_delegatedRequestDone( AgentSession* asp );
 
 int Agent_requestSetError( RequestInfo* request, int error_value );
 int Agent_checkRequestsError( RequestInfo* reqs );
@@ -879,8 +879,12 @@ void AgentHandler_freeDelegatedCache( DelegatedCache* dcache )
     /*
      * right now, no extra data is there that needs to be freed
      */
-    if ( dcache )
+    if ( dcache ) {
+        /* the requests are done with, if they are still there */
+        if ( AgentHandler_handlerCheckCache( dcache ) )
+            Agent_delegatedRequestDone( dcache->reqinfo->asp );
         MEMORY_FREE( dcache );
+    }
 
     return;
 }
@@ -896,6 +900,8 @@ void AgentHandler_handlerMarkRequestsAsDelegated( RequestInfo* requests,
     int isdelegated )
 {
     while ( requests ) {
+        if ( requests->delegated && !isdelegated && requests->agent_req_info )
+            Agent_delegatedRequestDone( requests->agent_req_info->asp );
         requests->delegated = isdelegated;
         requests = requests->next;
     }
@@ -4,6 +4,7 @@
 #include "Serialize.h"
 #include "ReadOnly.h"
 #include "BulkToNext.h"
+#include "Await.h"
 #include "RowMerge.h"
 #include "StashCache.h"
 #include "TableDataset.h"
@@ -15,6 +16,7 @@ void AllHelpers_initHelpers(void)
     Serialize_initSerialize();
     ReadOnly_initReadOnlyHelper();
     BulkToNext_initBulkToNextHelper();
+    Await_initAwaitHelper();
     TableDataset_initTableDataset();
     RowMerge_initRowMerge();
     StashCache_initStashCacheHelper();
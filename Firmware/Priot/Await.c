@@ -0,0 +1,437 @@
+#include "Await.h"
+#include "Agent.h"
+#include "BulkToNext.h"
+#include "System/Dispatcher/FdEventManager.h"
+#include "System/Util/Alarm.h"
+#include "System/Util/Logger.h"
+#include "System/Util/Trace.h"
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+/** @defgroup await await
+ *  Run handlers that wait for I/O without holding the agent up.
+ *  The helper calls the handlers below it on a coroutine; see Await.h.
+ *  @ingroup utilities
+ *  @{
+ */
+
+/* how often a child is looked for without pidfds, in ms */
+#define _AWAIT_CHILD_POLL 100
+
+typedef struct Await_Coroutine_s {
+    ucontext_t context;
+    ucontext_t caller; /* whoever started or last resumed it */
+    void* stack;
+
+    MibHandler* handler;
+    HandlerRegistration* reginfo;
+    AgentRequestInfo* reqinfo;
+    RequestInfo* requests;
+    int mode; /* the mode the handler was called in */
+    DelegatedCache* cache; /* once it has had to wait */
+    char dataName[ 32 ]; /* of its entry in the agent data of reqinfo */
+    int cancelled;
+    int dropped; /* reqinfo is gone, see _Await_dropped() */
+    int done;
+    int result;
+
+    /*
+     * what it waits for, and what the wait ended with
+     */
+    int fd;
+    unsigned int alarmId;
+    Await_Queue* queue;
+    struct Await_Coroutine_s* nextWaiter;
+    int status;
+} Await_Coroutine;
+
+static Await_Coroutine* _await_current = NULL;
+
+static void
+_Await_free( Await_Coroutine* co )
+{
+    if ( co->stack )
+        munmap( co->stack, AWAIT_STACK_SIZE );
+    free( co );
+}
+
+static void
+_Await_main( void )
+{
+    Await_Coroutine* co = _await_current;
+
+    co->result = AgentHandler_callNextHandler( co->handler, co->reginfo,
+        co->reqinfo, co->requests );
+    co->done = 1;
+    /* back to co->caller, by uc_link */
+}
+
+/*
+ * Runs co until it waits or returns
+ */
+static void
+_Await_switch( Await_Coroutine* co )
+{
+    Await_Coroutine* prev = _await_current;
+
+    _await_current = co;
+    swapcontext( &co->caller, &co->context );
+    _await_current = prev;
+}
+
+static void
+_Await_stopWaiting( Await_Coroutine* co )
+{
+    Await_Coroutine** prev;
+
+    if ( co->fd >= 0 ) {
+        FdEventManager_unregisterReadFD( co->fd );
+        co->fd = -1;
+    }
+    if ( co->alarmId ) {
+        Alarm_unregister( co->alarmId );
+        co->alarmId = 0;
+    }
+    if ( co->queue ) {
+        for ( prev = &co->queue->head; *prev; prev = &( *prev )->nextWaiter )
+            if ( *prev == co ) {
+                *prev = co->nextWaiter;
+                break;
+            }
+        co->queue = NULL;
+        co->nextWaiter = NULL;
+    }
+}
+
+static void
+_Await_woken( unsigned int alarmId, void* data );
+
+/*
+ * Called when the agent frees reqinfo with the requests still delegated,
+ * as when they time out or the session goes away.  Whatever the coroutine
+ * waits for may never happen, so it stops waiting and is resumed, with
+ * AwaitStatus_CANCELLED, from the main loop; its stack goes as soon as the
+ * handler has returned.
+ */
+static void
+_Await_dropped( void* data )
+{
+    Await_Coroutine* co = ( Await_Coroutine* )data;
+    struct timeval now = { 0, 0 };
+
+    DEBUG_MSGTL( ( "helper:await", "%p: the requests were dropped\n", co ) );
+    co->cancelled = 1;
+    co->dropped = 1;
+    _Await_stopWaiting( co );
+    co->alarmId = Alarm_registerHr( now, AlarmFlag_NO_REPEAT, _Await_woken, co );
+    if ( co->alarmId == 0 )
+        Logger_log( LOGGER_PRIORITY_WARNING, "await: cannot resume a cancelled handler\n" );
+}
+
+/*
+ * Hands the requests of a coroutine that had to wait back to the agent
+ */
+static void
+_Await_finish( Await_Coroutine* co )
+{
+    Map* data;
+
+    DEBUG_MSGTL( ( "helper:await", "%p done, result %d\n", co, co->result ) );
+    _Await_stopWaiting( co );
+    if ( !co->dropped ) {
+        /* reqinfo stays: take the entry out without cancelling */
+        data = Map_find( co->reqinfo->agent_data, co->dataName );
+        if ( data )
+            data->freeFunction = NULL;
+        Agent_removeListData( co->reqinfo, co->dataName );
+    }
+    if ( !co->cancelled ) {
+        AgentHandler_handlerMarkRequestsAsDelegated( co->requests,
+            REQUEST_IS_NOT_DELEGATED );
+        if ( co->result != PRIOT_ERR_NOERROR )
+            Agent_requestSetErrorAll( co->requests, co->result );
+        /* run as a GETNEXT by bulk_to_next */
+        if ( co->reqinfo->mode == MODE_GETBULK && co->mode != MODE_GETBULK )
+            BulkToNext_fixRequests( co->requests );
+    }
+    AgentHandler_freeDelegatedCache( co->cache );
+    _Await_free( co );
+}
+
+static void
+_Await_resume( Await_Coroutine* co, int status )
+{
+    int mode = 0;
+
+    _Await_stopWaiting( co );
+    co->status = status;
+    if ( !co->cancelled && AgentHandler_handlerCheckCache( co->cache ) == NULL ) {
+        DEBUG_MSGTL( ( "helper:await", "%p: the requests are gone\n", co ) );
+        co->cancelled = 1;
+    }
+
+    if ( co->cancelled ) {
+        co->status = AwaitStatus_CANCELLED;
+        _Await_switch( co );
+    } else {
+        mode = co->reqinfo->mode;
+        co->reqinfo->mode = co->mode;
+        _Await_switch( co );
+        co->reqinfo->mode = mode;
+    }
+
+    if ( co->done )
+        _Await_finish( co );
+}
+
+static void
+_Await_fdReady( int fd, void* data )
+{
+    config_UNUSED( fd );
+
+    _Await_resume( ( Await_Coroutine* )data, AwaitStatus_READY );
+}
+
+static void
+_Await_timedOut( unsigned int alarmId, void* data )
+{
+    Await_Coroutine* co = ( Await_Coroutine* )data;
+
+    config_UNUSED( alarmId );
+
+    co->alarmId = 0;
+    _Await_resume( co, AwaitStatus_TIMEDOUT );
+}
+
+static void
+_Await_woken( unsigned int alarmId, void* data )
+{
+    Await_Coroutine* co = ( Await_Coroutine* )data;
+
+    config_UNUSED( alarmId );
+
+    co->alarmId = 0;
+    _Await_resume( co, AwaitStatus_READY );
+}
+
+/*
+ * Gives control back until what the current coroutine waits for happens,
+ * or the timeout passes
+ */
+static int
+_Await_block( Await_Coroutine* co, long timeout )
+{
+    struct timeval t;
+
+    if ( co->cancelled ) {
+        _Await_stopWaiting( co );
+        return AwaitStatus_CANCELLED;
+    }
+    if ( timeout >= 0 ) {
+        t.tv_sec = timeout / 1000;
+        t.tv_usec = ( timeout % 1000 ) * 1000;
+        co->alarmId = Alarm_registerHr( t, AlarmFlag_NO_REPEAT, _Await_timedOut, co );
+        if ( co->alarmId == 0 ) {
+            _Await_stopWaiting( co );
+            return AwaitStatus_ERROR;
+        }
+    }
+    swapcontext( &co->context, &co->caller );
+    return co->status;
+}
+
+/** returns an await handler that can be injected into a given handler
+ *  chain.
+ */
+MibHandler*
+Await_getAwaitHandler( void )
+{
+    return AgentHandler_createHandler( "await", Await_helper );
+}
+
+/** @internal Implements the await handler */
+int Await_helper( MibHandler* handler,
+    HandlerRegistration* reginfo,
+    AgentRequestInfo* reqinfo,
+    RequestInfo* requests )
+{
+    Await_Coroutine* co;
+    int result;
+
+    co = MEMORY_MALLOC_TYPEDEF( Await_Coroutine );
+    if ( co ) {
+        co->stack = mmap( NULL, AWAIT_STACK_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0 );
+        if ( co->stack == MAP_FAILED )
+            co->stack = NULL;
+    }
+    if ( co == NULL || co->stack == NULL || getcontext( &co->context ) < 0 ) {
+        Logger_log( LOGGER_PRIORITY_WARNING, "await: no coroutine, running %s blocking\n",
+            reginfo->handlerName ? reginfo->handlerName : "handler" );
+        if ( co )
+            _Await_free( co );
+        return AgentHandler_callNextHandler( handler, reginfo, reqinfo, requests );
+    }
+
+    /*
+     * the lowest page is left unmapped to catch an overflow
+     */
+    mprotect( co->stack, getpagesize(), PROT_NONE );
+    co->context.uc_stack.ss_sp = co->stack;
+    co->context.uc_stack.ss_size = AWAIT_STACK_SIZE;
+    co->context.uc_link = &co->caller;
+    makecontext( &co->context, _Await_main, 0 );
+
+    co->handler = handler;
+    co->reginfo = reginfo;
+    co->reqinfo = reqinfo;
+    co->requests = requests;
+    co->mode = reqinfo->mode;
+    co->fd = -1;
+
+    _Await_switch( co );
+    if ( co->done ) {
+        result = co->result;
+        _Await_free( co );
+        return result;
+    }
+
+    /*
+     * it waits: the agent has the requests back once it returns
+     */
+    DEBUG_MSGTL( ( "helper:await", "%p waits, mode %d\n", co, co->mode ) );
+    co->cache = AgentHandler_createDelegatedCache( handler, reginfo, reqinfo,
+        requests, co );
+    snprintf( co->dataName, sizeof( co->dataName ), "await:%p", ( void* )co );
+    Agent_addListData( reqinfo, Map_newElement( co->dataName, co, _Await_dropped ) );
+    AgentHandler_handlerMarkRequestsAsDelegated( requests, REQUEST_IS_DELEGATED );
+    return PRIOT_ERR_NOERROR;
+}
+
+/** initializes the await helper which then registers an await
+ *  handler as a run-time injectable handler for configuration file
+ *  use.
+ */
+void Await_initAwaitHelper( void )
+{
+    AgentHandler_registerHandlerByName( "await", Await_getAwaitHandler() );
+}
+
+int Await_isAwaiting( void )
+{
+    return _await_current != NULL;
+}
+
+int Await_isCancelled( void )
+{
+    return _await_current != NULL && _await_current->cancelled;
+}
+
+int Await_readable( int fd, long timeout )
+{
+    Await_Coroutine* co = _await_current;
+    struct pollfd pfd;
+    int rc;
+
+    if ( co == NULL ) {
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        while ( ( rc = poll( &pfd, 1, timeout < 0 ? -1 : ( int )timeout ) ) < 0
+            && errno == EINTR )
+            ;
+        return rc < 0 ? AwaitStatus_ERROR : rc == 0 ? AwaitStatus_TIMEDOUT : AwaitStatus_READY;
+    }
+
+    if ( FdEventManager_registerReadFD( fd, _Await_fdReady, co ) != 0 )
+        return AwaitStatus_ERROR;
+    co->fd = fd;
+    return _Await_block( co, timeout );
+}
+
+int Await_sleep( long timeout )
+{
+    Await_Coroutine* co = _await_current;
+    struct timespec ts;
+
+    if ( timeout < 0 )
+        return AwaitStatus_ERROR;
+    if ( co == NULL ) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = ( timeout % 1000 ) * 1000000;
+        while ( nanosleep( &ts, &ts ) < 0 && errno == EINTR )
+            ;
+        return AwaitStatus_TIMEDOUT;
+    }
+    return _Await_block( co, timeout );
+}
+
+int Await_childExit( Types_PidT pid, int* status, long timeout )
+{
+    int pidfd, rc, dummy;
+    long step;
+
+    if ( status == NULL )
+        status = &dummy;
+
+    /*
+     * a pidfd becomes readable when the child exits
+     */
+    pidfd = syscall( SYS_pidfd_open, pid, 0 );
+    if ( pidfd >= 0 ) {
+        rc = Await_readable( pidfd, timeout );
+        close( pidfd );
+        if ( rc != AwaitStatus_READY )
+            return rc;
+        return waitpid( pid, status, WNOHANG ) == pid ? AwaitStatus_READY : AwaitStatus_ERROR;
+    }
+
+    for ( ;; ) {
+        rc = waitpid( pid, status, WNOHANG );
+        if ( rc == pid )
+            return AwaitStatus_READY;
+        if ( rc < 0 )
+            return AwaitStatus_ERROR;
+        if ( timeout == 0 )
+            return AwaitStatus_TIMEDOUT;
+        step = ( timeout < 0 || timeout > _AWAIT_CHILD_POLL ) ? _AWAIT_CHILD_POLL : timeout;
+        if ( ( rc = Await_sleep( step ) ) != AwaitStatus_TIMEDOUT )
+            return rc;
+        if ( timeout > 0 )
+            timeout -= step;
+    }
+}
+
+int Await_wait( Await_Queue* queue, long timeout )
+{
+    Await_Coroutine* co = _await_current;
+
+    if ( co == NULL )
+        return AwaitStatus_ERROR;
+    co->queue = queue;
+    co->nextWaiter = queue->head;
+    queue->head = co;
+    return _Await_block( co, timeout );
+}
+
+/*
+ * The waiters are resumed from the main loop rather than from in here, so
+ * the caller needn't worry about what they do
+ */
+void Await_wakeAll( Await_Queue* queue )
+{
+    Await_Coroutine* co;
+    struct timeval now = { 0, 0 };
+
+    while ( ( co = queue->head ) != NULL ) {
+        _Await_stopWaiting( co );
+        co->alarmId = Alarm_registerHr( now, AlarmFlag_NO_REPEAT, _Await_woken, co );
+    }
+}
+
+/**  @} */
@@ -0,0 +1,62 @@
+#ifndef AWAIT_H
+#define AWAIT_H
+
+#include "AgentHandler.h"
+
+/*
+ * The helper runs the rest of the handler chain on a coroutine of its own.
+ * When a handler below it waits, through the functions here, for a
+ * descriptor, a timer, a child process or a queue, the requests are
+ * delegated and the agent gets on with other work; the handler carries on
+ * where it left off once the wait is over, and its requests are finished
+ * when it returns.  Handlers under the helper shouldn't delegate requests
+ * themselves.
+ *
+ * Anywhere else the same functions simply block.
+ */
+
+/** bytes of stack each coroutine gets */
+#define AWAIT_STACK_SIZE ( 256 * 1024 )
+
+/** what a wait ended with */
+#define AwaitStatus_READY 0
+#define AwaitStatus_TIMEDOUT 1
+/** the requests were dropped meanwhile: return at once, without touching them */
+#define AwaitStatus_CANCELLED 2
+#define AwaitStatus_ERROR -1
+
+/** coroutines waiting for something, see Await_wait() */
+typedef struct Await_Queue_s {
+    struct Await_Coroutine_s* head;
+} Await_Queue;
+
+MibHandler*
+Await_getAwaitHandler( void );
+
+void Await_initAwaitHelper( void );
+
+NodeHandlerFT Await_helper;
+
+/** whether the caller runs on a coroutine, and so may wait without blocking */
+int Await_isAwaiting( void );
+
+/** whether the caller's requests were dropped while it waited: it should
+ *  return at once, without touching them */
+int Await_isCancelled( void );
+
+/*
+ * Timeouts are in milliseconds; a negative one means none.
+ */
+int Await_readable( int fd, long timeout );
+
+int Await_sleep( long timeout );
+
+/** waits for the child pid to exit, and collects its status */
+int Await_childExit( Types_PidT pid, int* status, long timeout );
+
+/** waits for Await_wakeAll() on queue; only on a coroutine */
+int Await_wait( Await_Queue* queue, long timeout );
+
+void Await_wakeAll( Await_Queue* queue );
+
+#endif // AWAIT_H
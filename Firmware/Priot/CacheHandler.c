@@ -13,9 +13,21 @@
 static Cache* _cacheHandler_head = NULL;
 static int _cacheHandler_outstandingValid = 0;
 static int _CacheHandler_load( Cache* cache );
+static void _CacheHandler_nextGeneration( void );
+
+/* see CacheHandler_loadGeneration() */
+static u_int _cacheHandler_loadGeneration = 0;
+static int _cacheHandler_loadingForRequest = 0;
 
 #define CACHE_RELEASE_FREQUENCY 60 /* Check for expired caches every 60s */
 
+#define CACHE_SNAPSHOT_NAME "cacheSnapshot"
+#define CACHE_GENERATION_NAME "cacheGeneration"
+
+/* exponentially weighted moving average of the load and request statistics */
+#define CACHE_AVERAGE( avg, sample ) \
+    ( ( avg ) ? ( 3 * ( avg ) + ( sample ) ) / 4 : ( sample ) )
+
 void CacheHandler_releaseCachedResources( unsigned int regNo, void* clientargs );
 
 /** @defgroup cache_handler cache_handler
@@ -67,6 +79,32 @@ void CacheHandler_releaseCachedResources( unsigned int regNo, void* clientargs )
  *  the cache when it expires. This is useful for keeping the cache fresh,
  *  even in the absence of incoming snmp requests.
  *
+ *  If CacheOperation_STALE_WHILE_REVALIDATE is set (see
+ *  CacheHandler_setStaleWhileRevalidate()), requests never wait for a
+ *  reload while the data is less than timeout + staleTimeout seconds old.
+ *  A cache that was used since its last load is reloaded from an alarm
+ *  refreshAhead seconds before it expires, and a request finding the
+ *  cache expired is served the current data while a reload is scheduled
+ *  for the next pass of the main loop. Past the staleness bound, the cache
+ *  is reloaded inline as usual. Unused caches are not refreshed, so they
+ *  expire and are released normally. Caches whose load hook needs the
+ *  request (CacheOperation_HINT_HANDLER_ARGS) can't use it. The
+ *  cacheStaleWhileRevalidate directive (see nsCache) sets it for a cache
+ *  given by its root OID. Combine it with
+ *  CacheOperation_SNAPSHOT if delegated requests may still use the data
+ *  being replaced.
+ *
+ *  If CacheOperation_ADAPTIVE_TIMEOUT is set (see
+ *  CacheHandler_setAdaptiveTimeout()), the timeout is recomputed after
+ *  every load from the measured load duration and time between requests:
+ *  frequently requested caches get a short timeout (fresher data), rarely
+ *  requested ones a long one (fewer useless loads), always within the
+ *  configured bounds. The timeout is also kept long enough for reloads
+ *  not to take more than loadBudget percent of the time. The cacheAdaptive
+ *  directive (see nsCache) sets the bounds of a cache given by its root
+ *  OID. The measurements are kept for every cache, and are shown in the
+ *  nsCacheTable.
+ *
  *  If CacheOperation_RESET_TIMER_ON_USE is set, the expiry timer will be
  *  reset on each cache access. In practice the 'timeout' becomes a timer
  *  which triggers when the cache is no longer needed. This is useful
@@ -113,12 +151,30 @@ void CacheHandler_releaseCachedResources( unsigned int regNo, void* clientargs )
  *
  *          CacheOperation_RESET_TIMER_ON_USE
  *
+ *  Reloaded while delegated requests are in flight:
+ *      If CacheOperation_SNAPSHOT is set, the data left in cache->magic by
+ *      each successful load is wrapped in a reference counted snapshot.
+ *      Every request (PDU) that passes through the cache handler pins the
+ *      snapshot that was live at that time, and a reload (or an expiry)
+ *      only swaps in a new snapshot: the previous data is handed to the
+ *      free_cache routine once the last request using it has finished.
+ *      The load_cache routine must therefore build a new data set and
+ *      store it in cache->magic (it must not reuse the previous one), and
+ *      the free_cache routine must only release the data it is passed.
+ *      Lower handlers get the data of their request with
+ *      CacheHandler_snapshotData(). This allows short timeouts on busy
+ *      tables without a reload freeing data that a delegated request is
+ *      still using.
+ *
  *  @{
  */
 
 static void
 _CacheHandler_free2( Cache* cache );
 
+static void
+_CacheHandler_destroy( Cache* cache );
+
 /** get cache head
  * @internal
  * unadvertised function to get cache head. You really should not
@@ -232,9 +288,34 @@ int CacheHandler_free( Cache* cache )
     if ( 0 != cache->timer_id )
         CacheHandler_timerStop( cache );
 
+    if ( 0 != cache->refresh_id ) {
+        Alarm_unregister( cache->refresh_id );
+        cache->refresh_id = 0;
+    }
+
     if ( cache->valid )
         _CacheHandler_free2( cache );
 
+    /*
+     * Requests still using a retired snapshot need the cache (and its
+     * free hook): the last of them completes the release.
+     */
+    if ( cache->retiredSnapshots > 0 ) {
+        DEBUG_MSGTL( ( "helper:cache_handler", "deferring free of %p (%d snapshots in use)\n",
+            cache, cache->retiredSnapshots ) );
+        cache->enabled = 0;
+        cache->freePending = 1;
+        return ErrorCode_SUCCESS;
+    }
+
+    _CacheHandler_destroy( cache );
+
+    return ErrorCode_SUCCESS;
+}
+
+static void
+_CacheHandler_destroy( Cache* cache )
+{
     if ( cache->timestampM )
         free( cache->timestampM );
 
@@ -242,8 +323,71 @@ int CacheHandler_free( Cache* cache )
         free( cache->rootoid );
 
     free( cache );
+}
 
-    return ErrorCode_SUCCESS;
+/** wraps the data just loaded into cache->magic in a new snapshot */
+static CacheSnapshot*
+_CacheHandler_snapshotNew( Cache* cache )
+{
+    CacheSnapshot* snapshot = NULL;
+
+    snapshot = MEMORY_MALLOC_TYPEDEF( CacheSnapshot );
+    if ( NULL == snapshot ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "malloc error in _CacheHandler_snapshotNew\n" );
+        return NULL;
+    }
+    snapshot->refcnt = 1;
+    snapshot->magic = cache->magic;
+    snapshot->cache = cache;
+
+    return snapshot;
+}
+
+/** drops a reference to a snapshot, freeing its data with the last one.
+ *  Also used as the free function of the request pins.
+ */
+static void
+_CacheHandler_snapshotRelease( void* data )
+{
+    CacheSnapshot* snapshot = ( CacheSnapshot* )data;
+    Cache* cache;
+    void* live;
+
+    if ( NULL == snapshot || --snapshot->refcnt > 0 )
+        return;
+
+    cache = snapshot->cache;
+    DEBUG_MSGTL( ( "helper:cache_handler", "freeing snapshot %p of %p\n",
+        snapshot, cache ) );
+
+    /*
+     * the free hook may reset cache->magic, which by now holds the
+     * data of a newer snapshot (if any): preserve it.
+     */
+    live = cache->magic;
+    cache->magic = snapshot->magic;
+    if ( NULL != cache->free_cache )
+        cache->free_cache( cache, snapshot->magic );
+    cache->magic = live;
+    free( snapshot );
+
+    if ( --cache->retiredSnapshots == 0 && cache->freePending )
+        _CacheHandler_destroy( cache );
+}
+
+/** detaches the live snapshot from the cache. Its data is freed now, or
+ *  when the last request pinning it has finished.
+ */
+static void
+_CacheHandler_snapshotRetire( Cache* cache )
+{
+    CacheSnapshot* snapshot = cache->snapshot;
+
+    cache->snapshot = NULL;
+    cache->magic = NULL;
+    cache->valid = 0;
+    cache->retiredSnapshots++;
+    _CacheHandler_snapshotRelease( snapshot );
 }
 
 /** removes a cache
@@ -275,6 +419,18 @@ int CacheHandler_remove( Cache* cache )
     return -1;
 }
 
+/** empties a cache. For a CacheOperation_SNAPSHOT cache, requests still
+ *  using the current data keep it until they are done. */
+void CacheHandler_flush( Cache* cache )
+{
+    if ( NULL == cache )
+        return;
+
+    if ( cache->valid )
+        _CacheHandler_free2( cache );
+    MEMORY_FREE( cache->timestampM );
+}
+
 /** callback function to call cache load function */
 static void
 _CacheHandler_timerReload( unsigned int regNo, void* clientargs )
@@ -284,6 +440,7 @@ _CacheHandler_timerReload( unsigned int regNo, void* clientargs )
     DEBUG_MSGT( ( "cache_timer:start", "loading cache %p\n", cache ) );
 
     cache->expired = 1;
+    cache->cache_hint = NULL;
 
     _CacheHandler_load( cache );
 }
@@ -341,6 +498,180 @@ void CacheHandler_timerStop( Cache* cache )
     cache->flags |= CacheOperation_AUTO_RELOAD;
 }
 
+/** callback function to reload a cache ahead of its expiry */
+static void
+_CacheHandler_refreshReload( unsigned int regNo, void* clientargs )
+{
+    Cache* cache = ( Cache* )clientargs;
+
+    cache->refresh_id = 0;
+    if ( !cache->enabled )
+        return;
+
+    /*
+     * nobody asked for the data since it was loaded:
+     * let the cache expire (and be released) as usual.
+     */
+    if ( !cache->used ) {
+        DEBUG_MSGT( ( "helper:cache_handler", " %p unused, not refreshed\n",
+            cache ) );
+        return;
+    }
+
+    /*
+     * no request is being handled: the hint left by the last one is gone
+     */
+    cache->cache_hint = NULL;
+    if ( cache->flags & CacheOperation_HINT_HANDLER_ARGS ) {
+        cache->expired = 1;
+        return;
+    }
+
+    DEBUG_MSGT( ( "helper:cache_handler", " refreshing %p\n", cache ) );
+    _CacheHandler_load( cache );
+}
+
+/** schedules a reload of the cache in the given number of seconds */
+static void
+_CacheHandler_refreshSchedule( Cache* cache, int seconds )
+{
+    if ( 0 != cache->refresh_id )
+        Alarm_unregister( cache->refresh_id );
+
+    cache->refresh_id = Alarm_register( seconds > 0 ? seconds : 0, 0,
+        _CacheHandler_refreshReload, cache );
+    if ( 0 == cache->refresh_id )
+        Logger_log( LOGGER_PRIORITY_ERR, "could not register alarm\n" );
+}
+
+/** serves expired data for up to staleTimeout seconds while the cache is
+ *  reloaded in the background, and starts reloading refreshAhead seconds
+ *  before the cache expires.
+ */
+void CacheHandler_setStaleWhileRevalidate( Cache* cache, int refreshAhead,
+    int staleTimeout )
+{
+    if ( NULL == cache )
+        return;
+
+    /*
+     * the background reload has no request to hand to the load hook
+     */
+    if ( staleTimeout > 0 && ( cache->flags & CacheOperation_HINT_HANDLER_ARGS ) ) {
+        Logger_log( LOGGER_PRIORITY_WARNING,
+            "cache loads need the request, not revalidated in the background\n" );
+        return;
+    }
+
+    if ( refreshAhead < 0 )
+        refreshAhead = 0;
+
+    cache->refreshAhead = refreshAhead;
+    cache->staleTimeout = staleTimeout;
+    if ( staleTimeout > 0 )
+        cache->flags |= CacheOperation_STALE_WHILE_REVALIDATE;
+    else
+        cache->flags &= ~CacheOperation_STALE_WHILE_REVALIDATE;
+}
+
+/** keeps the cache timeout within [minTimeout, maxTimeout], adapting it to
+ *  the measured request rate and load cost.
+ */
+void CacheHandler_setAdaptiveTimeout( Cache* cache, int minTimeout,
+    int maxTimeout, int loadBudget )
+{
+    if ( NULL == cache )
+        return;
+
+    if ( minTimeout < 1 )
+        minTimeout = 1;
+    if ( maxTimeout < minTimeout )
+        maxTimeout = minTimeout;
+    if ( loadBudget < 0 || loadBudget > 100 )
+        loadBudget = 0;
+
+    cache->minTimeout = minTimeout;
+    cache->maxTimeout = maxTimeout;
+    cache->loadBudget = loadBudget;
+    cache->flags |= CacheOperation_ADAPTIVE_TIMEOUT;
+}
+
+/** marks the cache data as out of date, e.g. after a change notification.
+ *  A cache that is in use is reloaded in the background within a second,
+ *  so a burst of notifications costs a single reload; other caches are
+ *  reloaded by the next request.
+ */
+void CacheHandler_invalidate( Cache* cache )
+{
+    if ( NULL == cache )
+        return;
+
+    cache->expired = 1;
+    if ( !cache->enabled || !cache->valid || !cache->used )
+        return;
+
+    if ( 0 == cache->refresh_id ) {
+        DEBUG_MSGT( ( "helper:cache_handler", " %p invalidated\n", cache ) );
+        _CacheHandler_refreshSchedule( cache, 1 );
+    }
+}
+
+static u_long
+_CacheHandler_elapsedMs( const struct timeval* from, const struct timeval* to )
+{
+    return ( to->tv_sec - from->tv_sec ) * 1000 + ( to->tv_usec - from->tv_usec ) / 1000;
+}
+
+/** updates the average time between requests */
+static void
+_CacheHandler_noteRequest( Cache* cache )
+{
+    struct timeval now;
+
+    Time_getMonotonicClock( &now );
+    if ( cache->lastRequest.tv_sec || cache->lastRequest.tv_usec )
+        cache->requestInterval = CACHE_AVERAGE( cache->requestInterval,
+            _CacheHandler_elapsedMs( &cache->lastRequest, &now ) );
+    cache->lastRequest = now;
+}
+
+/** recomputes the timeout of a CacheOperation_ADAPTIVE_TIMEOUT cache */
+static void
+_CacheHandler_adaptTimeout( Cache* cache )
+{
+    long timeout, floor;
+
+    /*
+     * frequently requested data is kept fresh, rarely requested
+     * data is kept for (about) the time between two requests.
+     */
+    if ( cache->requestInterval )
+        timeout = 2 * cache->requestInterval / 1000;
+    else
+        timeout = cache->maxTimeout;
+    if ( timeout < cache->minTimeout )
+        timeout = cache->minTimeout;
+
+    /*
+     * don't spend more than loadBudget % of the time reloading
+     */
+    if ( cache->loadBudget > 0 ) {
+        floor = ( cache->loadTime * 100 / cache->loadBudget + 999 ) / 1000;
+        if ( timeout < floor )
+            timeout = floor;
+    }
+    if ( timeout > cache->maxTimeout )
+        timeout = cache->maxTimeout;
+
+    if ( timeout != cache->timeout ) {
+        DEBUG_MSGTL( ( "helper:cache_handler", "timeout of %p adapted %d -> %ld"
+                                               " (load %lums, interval %lums)\n",
+            cache, cache->timeout, timeout, cache->loadTime,
+            cache->requestInterval ) );
+        cache->timeout = timeout;
+    }
+}
+
 /** returns a cache handler that can be injected into a given handler chain.
  */
 MibHandler*
@@ -437,12 +768,27 @@ _CacheHandler_buildCacheName( const char* name )
     return dup;
 }
 
-/** Insert the cache information for a given request (PDU) */
+static char*
+_CacheHandler_buildSnapshotName( const char* name )
+{
+    char* dup = ( char* )malloc( strlen( name ) + strlen( CACHE_SNAPSHOT_NAME ) + 2 );
+    if ( NULL == dup )
+        return NULL;
+    sprintf( dup, "%s:%s", CACHE_SNAPSHOT_NAME, name );
+    return dup;
+}
+
+/** Insert the cache information for a given request (PDU).
+ *  For a CacheOperation_SNAPSHOT cache, this also pins the live snapshot
+ *  until the request is freed.
+ */
 void CacheHandler_reqinfoInsert( Cache* cache,
     AgentRequestInfo* reqinfo,
     const char* name )
 {
     char* cache_name = _CacheHandler_buildCacheName( name );
+    char* snapshot_name;
+
     if ( NULL == Agent_getListData( reqinfo, cache_name ) ) {
         DEBUG_MSGTL( ( "verbose:helper:cache_handler", " adding '%s' to %p\n",
             cache_name, reqinfo ) );
@@ -451,6 +797,20 @@ void CacheHandler_reqinfoInsert( Cache* cache,
                                cache, NULL ) );
     }
     MEMORY_FREE( cache_name );
+
+    if ( !( cache->flags & CacheOperation_SNAPSHOT ) || NULL == cache->snapshot )
+        return;
+
+    snapshot_name = _CacheHandler_buildSnapshotName( name );
+    if ( NULL == Agent_getListData( reqinfo, snapshot_name ) ) {
+        DEBUG_MSGTL( ( "verbose:helper:cache_handler", " pinning '%s' to %p\n",
+            snapshot_name, reqinfo ) );
+        cache->snapshot->refcnt++;
+        Agent_addListData( reqinfo,
+            Map_newElement( snapshot_name,
+                               cache->snapshot, _CacheHandler_snapshotRelease ) );
+    }
+    MEMORY_FREE( snapshot_name );
 }
 
 /** Extract the cache information for a given request (PDU) */
@@ -472,6 +832,27 @@ CacheHandler_extractCacheInfo( AgentRequestInfo* reqinfo )
     return CacheHandler_reqinfoExtract( reqinfo, CACHE_NAME );
 }
 
+/** Returns the cached data a request (PDU) should use: the snapshot it
+ *  pinned for a CacheOperation_SNAPSHOT cache, cache->magic otherwise. */
+void* CacheHandler_snapshotData( AgentRequestInfo* reqinfo, Cache* cache )
+{
+    char addrstr[ 32 ];
+    char* snapshot_name;
+    CacheSnapshot* snapshot;
+
+    if ( NULL == cache )
+        return NULL;
+    if ( !( cache->flags & CacheOperation_SNAPSHOT ) )
+        return cache->magic;
+
+    snprintf( addrstr, sizeof( addrstr ), "%ld", ( long int )cache );
+    snapshot_name = _CacheHandler_buildSnapshotName( addrstr );
+    snapshot = ( CacheSnapshot* )Agent_getListData( reqinfo, snapshot_name );
+    MEMORY_FREE( snapshot_name );
+
+    return snapshot ? snapshot->magic : cache->magic;
+}
+
 /** Check if the cache timeout has passed. Sets and return the expired flag. */
 int CacheHandler_checkExpired( Cache* cache )
 {
@@ -488,18 +869,48 @@ int CacheHandler_checkExpired( Cache* cache )
     return cache->expired;
 }
 
+/** Has expired data outlived the staleness bound of the cache? */
+static int
+_CacheHandler_checkTooStale( Cache* cache )
+{
+    if ( !( cache->flags & CacheOperation_STALE_WHILE_REVALIDATE ) )
+        return 1;
+    if ( !cache->valid || ( NULL == cache->timestampM ) || ( cache->timeout < 0 ) )
+        return 1;
+
+    return Time_readyMonotonic( cache->timestampM,
+        1000 * ( cache->timeout + cache->staleTimeout ) );
+}
+
 /** Reload the cache if required */
 int CacheHandler_checkAndReload( Cache* cache )
 {
+    int ret;
+
     if ( !cache ) {
         DEBUG_MSGT( ( "helper:cache_handler", " no cache\n" ) );
         return 0; /* ?? or -1 */
     }
-    if ( !cache->valid || CacheHandler_checkExpired( cache ) )
-        return _CacheHandler_load( cache );
-    else {
+    _CacheHandler_noteRequest( cache );
+    if ( !cache->valid || CacheHandler_checkExpired( cache ) ) {
+        if ( !_CacheHandler_checkTooStale( cache ) ) {
+            DEBUG_MSGT( ( "helper:cache_handler", " stale (%d), reload pending\n",
+                cache->timeout ) );
+            cache->used = 1;
+            cache->hits++;
+            if ( 0 == cache->refresh_id )
+                _CacheHandler_refreshSchedule( cache, 0 );
+            return 0;
+        }
+        ret = _CacheHandler_load( cache );
+        cache->used = 1;
+        cache->misses++;
+        return ret;
+    } else {
         DEBUG_MSGT( ( "helper:cache_handler", " cached (%d)\n",
             cache->timeout ) );
+        cache->used = 1;
+        cache->hits++;
         return 0;
     }
 }
@@ -573,18 +984,31 @@ int CacheHandler_helperHandler( MibHandler* handler,
          * only touch cache once per pdu request, to prevent a cache
          * reload while a module is using cached data.
          *
-         * XXX: this won't catch a request reloading the cache while
-         * a previous (delegated) request is still using the cache.
-         * maybe use a reference counter?
+         * This won't catch a request reloading the cache while a
+         * previous (delegated) request is still using the cache, unless
+         * the cache uses CacheOperation_SNAPSHOT: the previous request
+         * then keeps its pinned snapshot alive.
          */
         if ( CacheHandler_isValid( reqinfo, addrstr ) )
             break;
 
+        /*
+         * the caches a request reloads share one load generation
+         */
+        if ( NULL == Agent_getListData( reqinfo, CACHE_GENERATION_NAME ) ) {
+            _CacheHandler_nextGeneration();
+            Agent_addListData( reqinfo,
+                Map_newElement( CACHE_GENERATION_NAME,
+                                   &_cacheHandler_loadGeneration, NULL ) );
+        }
+
         /*
          * call the load hook, and update the cache timestamp.
          * If it's not already there, add to reqinfo
          */
+        _cacheHandler_loadingForRequest = 1;
         CacheHandler_checkAndReload( cache );
+        _cacheHandler_loadingForRequest = 0;
         CacheHandler_reqinfoInsert( cache, reqinfo, addrstr );
         /** next handler called automatically - 'AUTO_NEXT' */
         break;
@@ -603,10 +1027,8 @@ int CacheHandler_helperHandler( MibHandler* handler,
          * Only do this on the last pass through.
          */
     case MODE_SET_COMMIT:
-        if ( cache->valid && !( cache->flags & CacheOperation_DONT_INVALIDATE_ON_SET ) ) {
-            cache->free_cache( cache, cache->magic );
-            cache->valid = 0;
-        }
+        if ( cache->valid && !( cache->flags & CacheOperation_DONT_INVALIDATE_ON_SET ) )
+            _CacheHandler_free2( cache );
         /** next handler called automatically - 'AUTO_NEXT' */
         break;
 
@@ -624,25 +1046,54 @@ int CacheHandler_helperHandler( MibHandler* handler,
 static void
 _CacheHandler_free2( Cache* cache )
 {
+    if ( NULL != cache->snapshot ) {
+        _CacheHandler_snapshotRetire( cache );
+        return;
+    }
     if ( NULL != cache->free_cache ) {
         cache->free_cache( cache, cache->magic );
         cache->valid = 0;
     }
 }
 
+static void
+_CacheHandler_nextGeneration( void )
+{
+    if ( 0 == ++_cacheHandler_loadGeneration )
+        ++_cacheHandler_loadGeneration;
+}
+
+/** The load generation in progress.  The loads made for one request
+ *  have the same generation; any other load, such as a refresh from an
+ *  alarm, has one of its own.  A data source several caches are loaded
+ *  from can be read once per generation.
+ */
+u_int CacheHandler_loadGeneration( void )
+{
+    return _cacheHandler_loadGeneration;
+}
+
 static int
 _CacheHandler_load( Cache* cache )
 {
     int ret = -1;
+    struct timeval start, end;
+
+    if ( !_cacheHandler_loadingForRequest )
+        _CacheHandler_nextGeneration();
 
     /*
      * If we've got a valid cache, then release it before reloading
      */
-    if ( cache->valid && ( !( cache->flags & CacheOperation_DONT_FREE_BEFORE_LOAD ) ) )
+    if ( cache->valid && ( ( cache->flags & CacheOperation_SNAPSHOT ) || !( cache->flags & CacheOperation_DONT_FREE_BEFORE_LOAD ) ) )
         _CacheHandler_free2( cache );
 
+    Time_getMonotonicClock( &start );
     if ( cache->load_cache )
         ret = cache->load_cache( cache, cache->magic );
+    Time_getMonotonicClock( &end );
+    cache->loadTime = CACHE_AVERAGE( cache->loadTime,
+        _CacheHandler_elapsedMs( &start, &end ) );
     if ( ret < 0 ) {
         DEBUG_MSGT( ( "helper:cache_handler", " load failed (%d)\n", ret ) );
         cache->valid = 0;
@@ -650,6 +1101,19 @@ _CacheHandler_load( Cache* cache )
     }
     cache->valid = 1;
     cache->expired = 0;
+    if ( cache->flags & CacheOperation_SNAPSHOT )
+        cache->snapshot = _CacheHandler_snapshotNew( cache );
+
+    cache->used = 0;
+    if ( cache->flags & CacheOperation_ADAPTIVE_TIMEOUT )
+        _CacheHandler_adaptTimeout( cache );
+    /*
+     * an adapted timeout may have become shorter than refreshAhead
+     */
+    if ( ( cache->flags & CacheOperation_STALE_WHILE_REVALIDATE ) && ( cache->timeout > 0 ) )
+        _CacheHandler_refreshSchedule( cache, cache->timeout > cache->refreshAhead
+                ? cache->timeout - cache->refreshAhead
+                : cache->timeout );
 
     /*
      * If we didn't previously have any valid caches outstanding,
@@ -690,7 +1154,7 @@ void CacheHandler_releaseCachedResources( unsigned int regNo, void* clientargs )
              * Otherwise, note that we still have at
              *   least one active cache.
              */
-            if ( CacheHandler_checkExpired( cache ) ) {
+            if ( CacheHandler_checkExpired( cache ) && _CacheHandler_checkTooStale( cache ) ) {
                 if ( !( cache->flags & CacheOperation_DONT_FREE_EXPIRED ) )
                     _CacheHandler_free2( cache );
             } else {
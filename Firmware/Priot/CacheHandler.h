@@ -23,15 +23,32 @@ enum CacheOperation_e {
     CacheOperation_PRELOAD = 0x0010,
     CacheOperation_AUTO_RELOAD = 0x0020,
     CacheOperation_RESET_TIMER_ON_USE = 0x0040,
+    CacheOperation_SNAPSHOT = 0x0080,
+    CacheOperation_STALE_WHILE_REVALIDATE = 0x0100,
+    CacheOperation_ADAPTIVE_TIMEOUT = 0x0200,
     CacheOperation_HINT_HANDLER_ARGS = 0x1000
 };
 
 typedef struct Cache_s Cache;
 
+typedef struct CacheSnapshot_s CacheSnapshot;
+
 typedef int( CacheLoadFT )( Cache*, void* );
 
 typedef void( CacheFreeFT )( Cache*, void* );
 
+/*
+ * A reference counted view of the data loaded by one call of the
+ * load_cache hook (see CacheOperation_SNAPSHOT).
+ */
+struct CacheSnapshot_s {
+    /** The cache itself holds one reference while it is the live data */
+    int refcnt;
+    /** The data the load_cache hook left in cache->magic */
+    void* magic;
+    Cache* cache;
+};
+
 struct Cache_s {
     /** Number of handlers whose myvoid member points at this structure. */
     int refcnt;
@@ -46,6 +63,26 @@ struct Cache_s {
     timeMarker timestampM; /* When the cache was last loaded */
     u_long timer_id; /* periodic timer id */
 
+    /*
+    * For CacheOperation_STALE_WHILE_REVALIDATE
+    */
+    int refreshAhead; /* Reload this long (in s) before the cache expires */
+    int staleTimeout; /* How long (in s) expired data may still be served */
+    u_long refresh_id; /* pending refresh alarm id */
+    char used; /* Data was requested since the last load */
+
+    /*
+    * Load statistics, and the CacheOperation_ADAPTIVE_TIMEOUT bounds
+    */
+    int minTimeout; /* Shortest adapted timeout (in s) */
+    int maxTimeout; /* Longest adapted timeout (in s) */
+    int loadBudget; /* Max percentage of time spent reloading */
+    u_long loadTime; /* Average load duration (in ms) */
+    u_long requestInterval; /* Average time between requests (in ms) */
+    u_long hits; /* Requests served from the cached data */
+    u_long misses; /* Requests that had to wait for a load */
+    struct timeval lastRequest;
+
     CacheLoadFT* load_cache;
     CacheFreeFT* free_cache;
 
@@ -61,6 +98,14 @@ struct Cache_s {
     */
     HandlerArgs* cache_hint;
 
+    /*
+    * The live snapshot (CacheOperation_SNAPSHOT only), and the number
+    * of replaced snapshots still pinned by outstanding requests.
+    */
+    CacheSnapshot* snapshot;
+    int retiredSnapshots;
+    char freePending;
+
     /*
  * For SNMP-management of the data caches
  */
@@ -79,8 +124,12 @@ CacheHandler_reqinfoExtract( AgentRequestInfo* reqinfo,
 Cache*
 CacheHandler_extractCacheInfo( AgentRequestInfo* );
 
+void* CacheHandler_snapshotData( AgentRequestInfo* reqinfo, Cache* cache );
+
 int CacheHandler_checkAndReload( Cache* cache );
 
+u_int CacheHandler_loadGeneration( void );
+
 int CacheHandler_checkExpired( Cache* cache );
 
 int CacheHandler_isValid( AgentRequestInfo*,
@@ -114,6 +163,8 @@ int CacheHandler_remove( Cache* cache );
 
 int CacheHandler_free( Cache* cache );
 
+void CacheHandler_flush( Cache* cache );
+
 MibHandler*
 CacheHandler_handlerGet( Cache* cache );
 
@@ -128,6 +179,14 @@ CacheHandler_timerStart( Cache* cache );
 
 void CacheHandler_timerStop( Cache* cache );
 
+void CacheHandler_setStaleWhileRevalidate( Cache* cache, int refreshAhead,
+    int staleTimeout );
+
+void CacheHandler_setAdaptiveTimeout( Cache* cache, int minTimeout,
+    int maxTimeout, int loadBudget );
+
+void CacheHandler_invalidate( Cache* cache );
+
 int CacheHandler_helperHandler( MibHandler* handler,
     HandlerRegistration* reginfo,
     AgentRequestInfo* reqinfo,
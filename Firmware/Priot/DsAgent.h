@@ -39,7 +39,8 @@ enum DsAgentBoolean_e{
     DsAgentBoolean_APP_NO_AUTHORIZATION          ,
     DsAgentBoolean_DISKIO_NO_FD                  ,       /* 1 = don't report /dev/fd*   entries in diskIOTable */
     DsAgentBoolean_DISKIO_NO_LOOP                ,       /* 1 = don't report /dev/loop* entries in diskIOTable */
-    DsAgentBoolean_DISKIO_NO_RAM                         /* 1 = don't report /dev/ram*  entries in diskIOTable */
+    DsAgentBoolean_DISKIO_NO_RAM                 ,       /* 1 = don't report /dev/ram*  entries in diskIOTable */
+    DsAgentBoolean_AGENTX_NO_PUSH_CACHE                  /* 1 = don't accept values pushed by AgentX subagents */
 
 
 };
@@ -81,7 +82,8 @@ enum DsAgentInterger_e{
    DsAgentInterger_INTERNAL_VERSION     , /* used by internal queries */
    DsAgentInterger_INTERNAL_SECLEVEL    , /* used by internal queries */
    DsAgentInterger_MAX_GETBULKREPEATS   , /* max getbulk repeats */
-   DsAgentInterger_MAX_GETBULKRESPONSES   /* max getbulk respones */
+   DsAgentInterger_MAX_GETBULKRESPONSES , /* max getbulk respones */
+   DsAgentInterger_AGENTX_WINDOW          /* outstanding PDUs per subagent */
 
 };
 
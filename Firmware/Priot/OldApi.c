@@ -1,4 +1,5 @@
 #include "OldApi.h"
+#include "Await.h"
 #include "Impl.h"
 #include "AgentRegistry.h"
 #include "Api.h"
@@ -116,6 +117,8 @@ OldApi_registerOldApi(const char *moduleName,
         reginfo->contextName = (context) ? strdup(context) : NULL;
         reginfo->modes = vp->acl == IMPL_OLDAPI_RONLY ? HANDLER_CAN_RONLY :
                          HANDLER_CAN_RWRITE;
+        if (flags & OLDAPI_AWAIT)
+            AgentHandler_injectHandler(reginfo, Await_getAwaitHandler());
 
         /*
          * register ourselves in the mib tree
@@ -311,6 +314,11 @@ OldApi_helper(MibHandler *handler,
                 tmp_len = requests->requestvb->nameLength;
                 access = (*(vp->findVar)) (cvp, tmp_name, &tmp_len,
                                            exact, &len, &write_method);
+                /*
+                 * dropped while it waited: requests and reqinfo are gone
+                 */
+                if (Await_isCancelled())
+                    return PRIOT_ERR_NOERROR;
                 Client_setVarObjid( requests->requestvb, tmp_name, tmp_len );
             }
             else
@@ -398,6 +406,8 @@ OldApi_helper(MibHandler *handler,
                                              requests->requestvb->
                                              nameLength);
             _OldApi_setCurrentAgentSession(oldasp);
+            if (Await_isCancelled())
+                return PRIOT_ERR_NOERROR;
 
             if (status != PRIOT_ERR_NOERROR) {
                 Agent_setRequestError(reqinfo, requests, status);
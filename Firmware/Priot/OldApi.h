@@ -7,6 +7,12 @@
 
 #define OLD_API_NAME "oldApi"
 
+/*
+ * flags for OldApi_registerOldApi()
+ */
+/** call the FindVarMethod on a coroutine, so it may wait (see Await.h) */
+#define OLDAPI_AWAIT 0x01
+
 typedef struct OldApiInfo_s {
     struct Variable_s *var;
     size_t          varsize;
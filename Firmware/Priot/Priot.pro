@@ -32,6 +32,7 @@ HEADERS += \
     SysORTable.h \
     Trap.h \
     AllHelpers.h \
+    Await.h \
     BabySteps.h \
     BulkToNext.h \
     CacheHandler.h \
@@ -70,6 +71,7 @@ HEADERS += \
     ../Plugin/Agentx/XClient.h \
     ../Plugin/Agentx/Master.h \
     ../Plugin/Agentx/MasterAdmin.h \
+    ../Plugin/Agentx/MasterCache.h \
     AgentModuleInits.h
 
 
@@ -83,6 +85,7 @@ SOURCES += \
     AllHelpers.c \
     BabySteps.c \
     AgentReadConfig.c \
+    Await.c \
     BulkToNext.c \
     CacheHandler.c \
     DebugHandler.c \
@@ -118,4 +121,5 @@ SOURCES += \
     ../Plugin/Agentx/XClient.c \
     ../Plugin/Agentx/Subagent.c \
     ../Plugin/Agentx/Master.c \
-    ../Plugin/Agentx/MasterAdmin.c
+    ../Plugin/Agentx/MasterAdmin.c \
+    ../Plugin/Agentx/MasterCache.c
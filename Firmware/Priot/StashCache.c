@@ -46,6 +46,8 @@ StashCache_getTimedBareStashCacheHandler(int timeout, oid *rootoid, size_t rooto
 
     if (!cinfo)
         return NULL;
+    /* StashCache_load() runs the handlers below for the current request */
+    cinfo->flags |= CacheOperation_HINT_HANDLER_ARGS;
 
     handler = CacheHandler_handlerGet( cinfo );
     if (!handler) {
@@ -188,14 +190,22 @@ StashCache_helper( MibHandler *handler,
 int
 StashCache_load( Cache *cache, void *magic )
 {
-    MibHandler          *handler  = cache->cache_hint->handler;
-    HandlerRegistration *reginfo  = cache->cache_hint->reginfo;
-    AgentRequestInfo   *reqinfo  = cache->cache_hint->reqinfo;
-    RequestInfo         *requests = cache->cache_hint->requests;
+    MibHandler          *handler;
+    HandlerRegistration *reginfo;
+    AgentRequestInfo   *reqinfo;
+    RequestInfo         *requests;
     StashCacheInfo     *cinfo    = (StashCacheInfo*) magic;
     int old_mode;
     int ret;
 
+    /* only loaded for a request */
+    if (!cache->cache_hint)
+        return -1;
+    handler  = cache->cache_hint->handler;
+    reginfo  = cache->cache_hint->reginfo;
+    reqinfo  = cache->cache_hint->reqinfo;
+    requests = cache->cache_hint->requests;
+
     if (!cinfo) {
         cinfo = StashCache_getNewStashCache();
         cache->magic = cinfo;
@@ -11,6 +11,9 @@ static void _Table_helperCleanup( AgentRequestInfo* reqinfo,
     RequestInfo* request,
     int status );
 static void _Table_dataFreeFunc( void* data );
+static TableRequestInfo* _Table_requestInfoNew( void );
+static ssize_t _Table_decodeTypedIndexes( TableRequestInfo* tri,
+    const oid* name, size_t len );
 static int
 _Table_sparseTableHelperHandler( MibHandler* handler,
     HandlerRegistration* reginfo,
@@ -359,14 +362,19 @@ int Table_helperHandler( MibHandler* handler,
             incomplete = 0;
             tbl_req_info = Table_extractTableInfo( request );
             if ( NULL == tbl_req_info ) {
-                tbl_req_info = MEMORY_MALLOC_TYPEDEF( TableRequestInfo );
+                tbl_req_info = _Table_requestInfoNew();
                 if ( tbl_req_info == NULL ) {
                     _Table_helperCleanup( reqinfo, request,
                         PRIOT_ERR_GENERR );
                     continue;
                 }
                 tbl_req_info->reg_info = tbl_info;
-                tbl_req_info->indexes = Client_cloneVarbind( tbl_info->indexes );
+                /*
+                 * typed tables decode straight into index_values, so
+                 * there is no varbind list to clone (and free) here.
+                 */
+                if ( !( tbl_info->flags & TABLE_FLAG_TYPED_INDEXES ) )
+                    tbl_req_info->indexes = Client_cloneVarbind( tbl_info->indexes );
                 tbl_req_info->number_indexes = 0; /* none yet */
                 AgentHandler_requestAddListData( request,
                     Map_newElement( TABLE_HANDLER_NAME,
@@ -511,8 +519,18 @@ int Table_helperHandler( MibHandler* handler,
          */
             DEBUG_MSGTL( ( "helper:table", "  looking for %d indexes\n",
                 tbl_info->number_indexes ) );
+            /*
+             * typed tables have no varbinds to parse into (indexes is
+             * NULL), so the loop below is skipped for them.
+             */
+            if ( tbl_info->flags & TABLE_FLAG_TYPED_INDEXES ) {
+                tmp_len = _Table_decodeTypedIndexes( tbl_req_info,
+                    tbl_req_info->index_oid, tbl_req_info->index_oid_len );
+                if ( 0 == tmp_len )
+                    tmp_len = -1; /* all sub-identifiers used */
+            }
             for ( tmp_idx = 0, vb = tbl_req_info->indexes;
-                  tmp_idx < tbl_info->number_indexes;
+                  vb && tmp_idx < tbl_info->number_indexes;
                   ++tmp_idx, vb = vb->next ) {
                 size_t parsed_oid_len;
 
@@ -828,6 +846,16 @@ int Table_buildOid( HandlerRegistration* reginfo,
     if ( !reginfo || !reqinfo || !table_info )
         return ErrorCode_GENERR;
 
+    if ( NULL == table_info->indexes ) {
+        /*
+         * typed indexes: index_values may have been changed by the
+         * caller, so re-encode them before building the oid.
+         */
+        if ( Table_updateIndexesFromVariableList( table_info ) != ErrorCode_SUCCESS )
+            return ErrorCode_GENERR;
+        return Table_buildOidFromIndex( reginfo, reqinfo, table_info );
+    }
+
     /*
      * xxx-rks: inefficent. we do a copy here, then Mib_buildOid does it
      *          again. either come up with a new utility routine, or
@@ -884,6 +912,14 @@ int Table_updateVariableListFromIndex( TableRequestInfo* tri )
     if ( !tri )
         return ErrorCode_GENERR;
 
+    if ( tri->reg_info && ( tri->reg_info->flags & TABLE_FLAG_TYPED_INDEXES ) ) {
+        if ( _Table_decodeTypedIndexes( tri, tri->index_oid,
+                 tri->index_oid_len )
+            != 0 )
+            return ErrorCode_GENERR;
+        return ErrorCode_SUCCESS;
+    }
+
     /*
      * free any existing allocated memory, then parse oid into varbinds
      */
@@ -896,9 +932,29 @@ int Table_updateVariableListFromIndex( TableRequestInfo* tri )
 /** builds an oid given a set of indexes. */
 int Table_updateIndexesFromVariableList( TableRequestInfo* tri )
 {
+    TableRegistrationInfo* tbl_info;
+    unsigned int i;
+    u_long value;
+
     if ( !tri )
         return ErrorCode_GENERR;
 
+    tbl_info = tri->reg_info;
+    if ( tbl_info && ( tbl_info->flags & TABLE_FLAG_TYPED_INDEXES ) ) {
+        tri->index_oid_len = 0;
+        for ( i = 0; i < tbl_info->number_indexes; ++i ) {
+            value = tri->index_values[ i ];
+            if ( asnIPADDRESS == tbl_info->index_types[ i ] ) {
+                tri->index_oid[ tri->index_oid_len++ ] = ( value >> 24 ) & 0xff;
+                tri->index_oid[ tri->index_oid_len++ ] = ( value >> 16 ) & 0xff;
+                tri->index_oid[ tri->index_oid_len++ ] = ( value >> 8 ) & 0xff;
+                tri->index_oid[ tri->index_oid_len++ ] = value & 0xff;
+            } else
+                tri->index_oid[ tri->index_oid_len++ ] = value;
+        }
+        return ErrorCode_SUCCESS;
+    }
+
     return Mib_buildOidNoalloc( tri->index_oid, sizeof( tri->index_oid ),
         &tri->index_oid_len, NULL, 0, tri->indexes );
 }
@@ -980,6 +1036,38 @@ void Table_registrationInfoFree( TableRegistrationInfo* tri )
 /*
  * internal routines
  */
+/*
+ * a TableRequestInfo is needed for every varbind of every table request,
+ * so keep a few of them around instead of going back to malloc each time.
+ */
+#define TABLE_REQUEST_INFO_CACHE_SIZE 32
+
+static TableRequestInfo* _Table_requestInfoCache[ TABLE_REQUEST_INFO_CACHE_SIZE ];
+static int _Table_requestInfoCached = 0;
+
+static TableRequestInfo*
+_Table_requestInfoNew( void )
+{
+    TableRequestInfo* info;
+
+    if ( 0 == _Table_requestInfoCached )
+        return MEMORY_MALLOC_TYPEDEF( TableRequestInfo );
+
+    info = _Table_requestInfoCache[ --_Table_requestInfoCached ];
+    info->colnum = 0;
+    info->number_indexes = 0;
+    info->indexes = NULL;
+    info->index_oid_len = 0;
+    info->reg_info = NULL;
+    return info;
+}
+
+void Table_clearRequestInfoCache( void )
+{
+    while ( _Table_requestInfoCached > 0 )
+        free( _Table_requestInfoCache[ --_Table_requestInfoCached ] );
+}
+
 static void
 _Table_dataFreeFunc( void* data )
 {
@@ -987,7 +1075,56 @@ _Table_dataFreeFunc( void* data )
     if ( !info )
         return;
     Api_freeVarbind( info->indexes );
-    free( info );
+    if ( _Table_requestInfoCached < TABLE_REQUEST_INFO_CACHE_SIZE )
+        _Table_requestInfoCache[ _Table_requestInfoCached++ ] = info;
+    else
+        free( info );
+}
+
+/*
+ * decodes the fixed width indexes of a TABLE_FLAG_TYPED_INDEXES table
+ * into tri->index_values. Like Mib_parseOneOidIndex(), a short ip address
+ * is zero filled. Indexes that are missing entirely are left 0 and not
+ * counted in number_indexes.
+ *
+ * returns the number of sub-identifiers left over, or -1 if a
+ * sub-identifier is out of range.
+ */
+static ssize_t
+_Table_decodeTypedIndexes( TableRequestInfo* tri, const oid* name, size_t len )
+{
+    TableRegistrationInfo* tbl_info = tri->reg_info;
+    unsigned int i, j;
+    u_long value;
+
+    memset( tri->index_values, 0, sizeof( tri->index_values ) );
+    tri->number_indexes = 0;
+
+    for ( i = 0; i < tbl_info->number_indexes && len > 0; ++i ) {
+        if ( asnIPADDRESS == tbl_info->index_types[ i ] ) {
+            for ( j = 0, value = 0; j < 4; ++j ) {
+                value <<= 8;
+                if ( j >= len )
+                    continue;
+                if ( name[ j ] > 255 ) {
+                    DEBUG_MSGTL( ( "helper:table", "illegal oid in index: %lu\n",
+                        ( u_long )name[ j ] ) );
+                    return -1;
+                }
+                value |= name[ j ];
+            }
+            j = ( len < 4 ) ? len : 4;
+        } else {
+            value = name[ 0 ];
+            j = 1;
+        }
+        tri->index_values[ i ] = value;
+        name += j;
+        len -= j;
+        ++tri->number_indexes;
+    }
+
+    return len;
 }
 
 static void
@@ -1105,6 +1242,55 @@ void Table_helperAddIndexes( TableRegistrationInfo* tinfo,
     va_end( debugargs );
 }
 
+/**
+ * Switches a table to typed index decoding. Instead of parsing the
+ * index of every request into a freshly allocated varbind list, the
+ * table helper decodes it straight into TableRequestInfo::index_values
+ * and leaves TableRequestInfo::indexes NULL, so lower handlers must not
+ * use the varbind list. Containers keyed by TABLE_CONTAINER_KEY_NETSNMP_INDEX
+ * keep comparing the raw index oid.
+ *
+ * Only tables whose indexes are all fixed width (integers and ip
+ * addresses) qualify. Call it after the indexes have been added.
+ *
+ * @param tinfo is a pointer to a TableRegistrationInfo struct.
+ *
+ * @return ErrorCode_SUCCESS, or ErrorCode_GENERR if the table can't be
+ *         decoded this way (it is then left untouched).
+ */
+int Table_setTypedIndexes( TableRegistrationInfo* tinfo )
+{
+    VariableList* vb;
+    unsigned int count = 0;
+
+    if ( NULL == tinfo || NULL == tinfo->indexes )
+        return ErrorCode_GENERR;
+
+    for ( vb = tinfo->indexes; vb; vb = vb->next, ++count ) {
+        if ( count >= TABLE_MAX_TYPED_INDEXES )
+            return ErrorCode_GENERR;
+        switch ( vb->type ) {
+        case asnINTEGER:
+        case asnCOUNTER:
+        case asnGAUGE:
+        case asnTIMETICKS:
+        case asnIPADDRESS:
+            break;
+        default:
+            DEBUG_MSGTL( ( "helper:table", "index type %d is not fixed width\n",
+                vb->type ) );
+            return ErrorCode_GENERR;
+        }
+    }
+
+    for ( vb = tinfo->indexes, count = 0; vb; vb = vb->next )
+        tinfo->index_types[ count++ ] = vb->type;
+    tinfo->number_indexes = count;
+    tinfo->flags |= TABLE_FLAG_TYPED_INDEXES;
+
+    return ErrorCode_SUCCESS;
+}
+
 static void
 _Table_rowStashDataListFree( void* ptr )
 {
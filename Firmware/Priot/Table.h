@@ -26,6 +26,18 @@
  */
 #define TABLE_HANDLER_NAME "table"
 
+/**
+ * maximum number of indexes a table can have and still use typed
+ * index decoding (see Table_setTypedIndexes())
+ */
+#define TABLE_MAX_TYPED_INDEXES 8
+
+/**
+ * TableRegistrationInfo flags
+ */
+/** indexes are decoded into TableRequestInfo::index_values, no varbinds */
+#define TABLE_FLAG_TYPED_INDEXES 0x01
+
 /** @typedef struct ColumnInfoT_s ColumnInfo
  * Typedefs the ColumnInfoT_s struct into ColumnInfo */
 
@@ -73,6 +85,11 @@ typedef struct TableRegistrationInfo_s {
 /** more details on columns */
     ColumnInfo *valid_columns;
 
+/** TABLE_FLAG_* bits */
+    u_char          flags;
+/** index types, filled in by Table_setTypedIndexes() */
+    u_char          index_types[TABLE_MAX_TYPED_INDEXES];
+
 } TableRegistrationInfo;
 
 /** @typedef struct TableRequestInfo_s TableRequestInfo
@@ -94,6 +111,11 @@ typedef struct TableRequestInfo_s {
     oid    index_oid[asnMAX_OID_LEN];
     size_t index_oid_len;
     TableRegistrationInfo *reg_info;
+   /**
+    * index values when the table uses TABLE_FLAG_TYPED_INDEXES (indexes
+    * is NULL then). Integers are stored as is, ip addresses in host order.
+    */
+    u_long index_values[TABLE_MAX_TYPED_INDEXES];
 } TableRequestInfo;
 
 MibHandler *
@@ -155,6 +177,9 @@ NodeHandlerFT Table_helperHandler;
 void
 Table_helperAddIndexes( TableRegistrationInfo *tinfo, ...);
 
+int
+Table_setTypedIndexes( TableRegistrationInfo *tinfo );
+
 int Table_checkGetnextReply( RequestInfo *request,
                              oid * prefix,
                              size_t prefix_len,
@@ -178,4 +203,8 @@ Table_sparseTableRegister( HandlerRegistration *reginfo,
 MibHandler*
 Table_sparseTableHandlerGet(void);
 
+/* frees the TableRequestInfo kept for reuse, at shutdown */
+void
+Table_clearRequestInfoCache(void);
+
 #endif // TABLE_H
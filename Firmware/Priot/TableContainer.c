@@ -30,6 +30,9 @@ typedef struct ContainerTableData_s {
     /** container for the table rows */
     Container_Container* table;
 
+    /** if set, the rows are in the snapshot of this cache a request uses */
+    Cache* cache;
+
     /*
      * mutex_type                lock;
      */
@@ -112,6 +115,11 @@ typedef struct ContainerTableData_s {
  *    contraints and inserting any newly created rows into the container
  *    and the request's data list.
  *
+ *  A table whose rows are loaded by a CacheOperation_SNAPSHOT cache
+ *  should call TableContainer_setCache(): each request then looks its rows
+ *  up in the container of the snapshot it pinned, which a reload can't
+ *  free under it, rather than in the container given at registration.
+ *
  *  If a row is found, it will be inserted into
  *  the request's data list. The sub-handler may retrieve it by calling
  *      tableContainer_tableExtractContext(request); *
@@ -319,6 +327,27 @@ int TableContainer_register( HandlerRegistration* reginfo,
     return Table_registerTable( reginfo, tabreg );
 }
 
+/** makes the table_container handler find the rows of each request in
+ *  the data of the CacheOperation_SNAPSHOT cache it pinned.
+ *  The cache data must be a Container_Container; the container given to
+ *  TableContainer_handlerGet() is freed, as nothing fills it.
+ */
+void TableContainer_setCache( MibHandler* handler, Cache* cache )
+{
+    ContainerTableData* tad;
+
+    if ( ( NULL == handler ) || ( NULL == handler->myvoid ) ) {
+        Logger_log( LOGGER_PRIORITY_ERR, "bad param in TableContainer_setCache\n" );
+        return;
+    }
+    tad = ( ContainerTableData* )handler->myvoid;
+    tad->cache = cache;
+    if ( tad->table ) {
+        CONTAINER_FREE( tad->table );
+        tad->table = NULL;
+    }
+}
+
 int TableContainer_unregister( HandlerRegistration* reginfo )
 {
     ContainerTableData* tad;
@@ -328,7 +357,8 @@ int TableContainer_unregister( HandlerRegistration* reginfo )
     tad = ( ContainerTableData* )
         AgentHandler_findHandlerDataByName( reginfo, "tableContainer" );
     if ( tad ) {
-        CONTAINER_FREE( tad->table );
+        if ( tad->table )
+            CONTAINER_FREE( tad->table );
         tad->table = NULL;
         /*
      * Note: don't free the memory tad points at here - that is done
@@ -536,8 +566,11 @@ _TableContainer_dataLookup( HandlerRegistration* reginfo,
     VariableList* var;
     Types_Index index;
     void* key;
+    Container_Container* table = tad->table;
 
     var = request->requestvb;
+    if ( NULL != tad->cache )
+        table = ( Container_Container* )CacheHandler_snapshotData( agtreq_info, tad->cache );
 
     DEBUG_IF( "tableContainer" )
     {
@@ -560,7 +593,8 @@ _TableContainer_dataLookup( HandlerRegistration* reginfo,
          * column, if necessary.
          */
         _TableContainer_setKey( tad, request, tblreq_info, &key, &index );
-        row = ( Types_Index* )_TableContainer_findNextRow( tad->table, tblreq_info, key );
+        if ( NULL != table )
+            row = ( Types_Index* )_TableContainer_findNextRow( table, tblreq_info, key );
         if ( row ) {
             /*
              * update indexes in tblreq_info (index & varbind),
@@ -594,7 +628,8 @@ _TableContainer_dataLookup( HandlerRegistration* reginfo,
     else {
 
         _TableContainer_setKey( tad, request, tblreq_info, &key, &index );
-        row = ( Types_Index* )CONTAINER_FIND( tad->table, key );
+        if ( NULL != table )
+            row = ( Types_Index* )CONTAINER_FIND( table, key );
         if ( NULL == row ) {
             /*
              * not results found. For a get, that is an error
@@ -618,7 +653,7 @@ _TableContainer_dataLookup( HandlerRegistration* reginfo,
                                                  row, NULL ) );
         AgentHandler_requestAddListData( request,
             Map_newElement( TABLE_CONTAINER_CONTAINER,
-                                             tad->table, NULL ) );
+                                             table, NULL ) );
     }
 }
 
@@ -2,6 +2,7 @@
 #define TABLECONTAINER_H
 
 #include "AgentHandler.h"
+#include "CacheHandler.h"
 #include "Table.h"
 #include "System/Containers/Container.h"
 /*
@@ -47,6 +48,13 @@ TableContainer_register(HandlerRegistration *reginfo,
 int
 TableContainer_unregister(HandlerRegistration *reginfo);
 
+/*
+ * look rows up in the data each request pinned in a
+ * CacheOperation_SNAPSHOT cache rather than in a fixed container
+ */
+void
+TableContainer_setCache(MibHandler *handler, Cache *cache);
+
 /** retrieve the container used by the table_container helper */
 Container_Container*
 TableContainer_containerExtract(RequestInfo *request);
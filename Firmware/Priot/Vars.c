@@ -13,6 +13,7 @@
 #include "System/Util/DefaultStore.h"
 #include "System/Util/Logger.h"
 #include "System/Util/Trace.h"
+#include "Table.h"
 #include "Transports/CallbackDomain.h"
 #include "Transports/UDPDomain.h"
 #include "Transports/UnixDomain.h"
@@ -198,6 +199,7 @@ void Vars_shutdownAgent( void )
     CallbackDomain_clearCallbackList();
     Transport_clearTdomainList();
     AgentHandler_clearHandlerList();
+    Table_clearRequestInfoCache();
     SysORTable_shutdownAgentSysORTable();
     Container_freeList();
     SecMod_clear();
@@ -0,0 +1,124 @@
+#include "AgentxPeer.h"
+#include "Agentx/Protocol.h"
+#include "Api.h"
+#include "Client.h"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define _AGENTXPEER_ANSWER 42
+
+/*
+ * Reads one whole AgentX packet; its length, or 0 at the end
+ */
+static size_t
+_AgentxPeer_readPacket( int fd, u_char* buf, size_t size )
+{
+    size_t got = 0, want = 20;
+    ssize_t n;
+
+    while ( got < want ) {
+        n = read( fd, buf + got, want - got );
+        if ( n <= 0 )
+            return 0;
+        got += n;
+        if ( got == 20 ) {
+            want = Protocol_checkPacket( buf, got );
+            if ( want > size )
+                return 0;
+        }
+    }
+    return got;
+}
+
+static void
+_AgentxPeer_respond( int fd )
+{
+    Types_Session session;
+    Types_Pdu *request, *response;
+    VariableList* var;
+    u_char packet[ 65536 ], *out = NULL;
+    size_t len, outSize = 0, outLen;
+    long value = _AGENTXPEER_ANSWER;
+
+    memset( &session, 0, sizeof( session ) );
+    session.version = AGENTX_VERSION_1;
+    while ( ( len = _AgentxPeer_readPacket( fd, packet, sizeof( packet ) ) ) > 0 ) {
+        request = Client_pduCreate( 0 );
+        if ( Protocol_parse( &session, request, packet, len ) != 0 )
+            break;
+        response = Client_pduCreate( AGENTX_MSG_RESPONSE );
+        response->version = AGENTX_VERSION_1;
+        response->flags = request->flags & AGENTX_FLAGS_NETWORK_BYTE_ORDER;
+        response->sessid = request->sessid;
+        response->transid = request->transid;
+        response->reqid = request->reqid;
+        for ( var = request->variables; var; var = var->next )
+            Api_pduAddVariable( response, var->name, var->nameLength, asnINTEGER,
+                &value, sizeof( value ) );
+        outLen = 0;
+        if ( Protocol_reallocBuild( &session, response, &out, &outSize, &outLen ) != 0
+            || write( fd, out, outLen ) != ( ssize_t )outLen )
+            break;
+        Api_freePdu( request );
+        Api_freePdu( response );
+    }
+    free( out );
+}
+
+Types_PidT AgentxPeer_start( int* fd )
+{
+    int fds[ 2 ];
+    Types_PidT pid;
+
+    if ( socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) < 0 )
+        return -1;
+    pid = fork();
+    if ( pid == 0 ) {
+        close( fds[ 0 ] );
+        _AgentxPeer_respond( fds[ 1 ] );
+        _exit( 0 );
+    }
+    close( fds[ 1 ] );
+    if ( pid < 0 ) {
+        close( fds[ 0 ] );
+        return -1;
+    }
+    *fd = fds[ 0 ];
+    return pid;
+}
+
+void AgentxPeer_stop( int fd, Types_PidT pid )
+{
+    int status;
+
+    close( fd );
+    if ( pid > 0 )
+        waitpid( pid, &status, 0 );
+}
+
+bool AgentxPeer_roundTrip( int fd, Types_Session* session, Types_Pdu* pdu,
+    u_char** buf, size_t* bufSize )
+{
+    u_char packet[ 65536 ];
+    Types_Pdu* parsed;
+    VariableList *var, *asked;
+    size_t outLen = 0, len;
+    bool ok;
+
+    if ( Protocol_reallocBuild( session, pdu, buf, bufSize, &outLen ) != 0
+        || write( fd, *buf, outLen ) != ( ssize_t )outLen
+        || ( len = _AgentxPeer_readPacket( fd, packet, sizeof( packet ) ) ) == 0 )
+        return false;
+
+    parsed = Client_pduCreate( 0 );
+    ok = Protocol_parse( session, parsed, packet, len ) == 0
+        && parsed->command == AGENTX_MSG_RESPONSE && parsed->reqid == pdu->reqid;
+    for ( var = parsed->variables, asked = pdu->variables; ok && asked;
+          var = var->next, asked = asked->next )
+        ok = var && var->type == asnINTEGER && *var->value.integer == _AGENTXPEER_ANSWER
+            && Api_oidEquals( var->name, var->nameLength, asked->name, asked->nameLength ) == 0;
+    ok = ok && var == NULL;
+    Api_freePdu( parsed );
+    return ok;
+}
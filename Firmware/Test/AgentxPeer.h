@@ -0,0 +1,34 @@
+#ifndef AGENTXPEER_H
+#define AGENTXPEER_H
+
+/** \file AgentxPeer.h
+ *  @brief  A subagent stand-in for AgentX round trips: a child process on
+ *          the other end of a socket pair, which answers every request with
+ *          the integer 42 for each of its search ranges.
+ */
+
+#include "Types.h"
+
+/** @brief  Forks the responder.
+ *
+ *  @param  fd - set to the master end of the socket pair.
+ *  @return the pid of the responder, or -1 if it could not be started.
+ */
+Types_PidT AgentxPeer_start( int* fd );
+
+/** @brief  Closes the master end and waits for the responder to exit. */
+void AgentxPeer_stop( int fd, Types_PidT pid );
+
+/** @brief  Encodes pdu, sends it, and decodes and checks the response.
+ *
+ *  @param  fd - the master end.
+ *  @param  session - the AgentX session both ends use.
+ *  @param  pdu - the request.
+ *  @param  buf - the encoding buffer, grown as needed.
+ *  @param  bufSize - its allocated size.
+ *  @return true if the response has pdu's reqid and a 42 for each varbind.
+ */
+bool AgentxPeer_roundTrip( int fd, Types_Session* session, Types_Pdu* pdu,
+    u_char** buf, size_t* bufSize );
+
+#endif // AGENTXPEER_H
@@ -1,5 +1,21 @@
 #include "Test.h"
+#include "AgentxPeer.h"
+#include "Agentx/Master.h"
+#include "Agentx/MasterCache.h"
+#include "Agentx/Protocol.h"
+#include "Api.h"
+#include "Client.h"
+#include "Priot.h"
+#include "System/Containers/ContainerSync.h"
 #include "System/String.h"
+#include "System/Util/ProcFile.h"
+#include "System/Util/Time.h"
+#include "Transports/ShmDomain.h"
+#include "VarStruct.h"
+#include "ucd-snmp/proxy.h"
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 void printResult( const char* testName, bool ok )
 {
@@ -68,11 +84,923 @@ void Test_String()
     }
 }
 
+typedef struct Test_SyncRow_s {
+    Types_Index index; /* of key */
+    oid key;
+    int value;
+    u_int generation;
+} Test_SyncRow;
+
+static void*
+_Test_syncCreate( const void* row, void* context )
+{
+    Test_SyncRow* entry = ( Test_SyncRow* )malloc( sizeof( Test_SyncRow ) );
+
+    config_UNUSED( context );
+    memcpy( entry, row, sizeof( Test_SyncRow ) );
+    entry->index.oids = &entry->key;
+    return entry;
+}
+
+static int
+_Test_syncUpdate( void* entry, const void* row, void* context )
+{
+    Test_SyncRow* e = ( Test_SyncRow* )entry;
+    const Test_SyncRow* r = ( const Test_SyncRow* )row;
+
+    config_UNUSED( context );
+    if ( e->value == r->value )
+        return 0;
+    e->value = r->value;
+    return 1;
+}
+
+static void
+_Test_syncRelease( void* entry, void* context )
+{
+    config_UNUSED( context );
+    free( entry );
+}
+
+/*
+ * Feeds a pass of rows, key i having value values[ i ] (0: no row)
+ */
+static size_t
+_Test_syncPass( ContainerSync* sync, const int* values, int count )
+{
+    Test_SyncRow row;
+    int i;
+
+    ContainerSync_begin( sync );
+    for ( i = 0; i < count; i++ ) {
+        if ( values[ i ] == 0 )
+            continue;
+        row.key = i;
+        row.index.oids = &row.key;
+        row.index.len = 1;
+        row.value = values[ i ];
+        ContainerSync_row( sync, &row, &row );
+    }
+    return ContainerSync_end( sync );
+}
+
+static Test_SyncRow*
+_Test_syncFind( Container_Container* container, oid key )
+{
+    Types_Index index;
+
+    index.oids = &key;
+    index.len = 1;
+    return ( Test_SyncRow* )CONTAINER_FIND( container, &index );
+}
+
+void Test_ContainerSync()
+{
+    static const int first[] = { 0, 10, 20, 30 };
+    static const int second[] = { 0, 10, 21, 0, 40 };
+    Container_Container* container;
+    ContainerSync sync;
+    Test_SyncRow* kept;
+
+    printf( "\n-----[ ContainerSync ]----- \n\n" );
+
+    Container_initList();
+    container = Container_find( "binaryArray" );
+    ContainerSync_init( &sync, container, offsetof( Test_SyncRow, generation ),
+        _Test_syncCreate, _Test_syncUpdate, _Test_syncRelease, NULL );
+
+    if ( 1 ) { /** ContainerSync, first pass */
+        bool ok = _Test_syncPass( &sync, first, 4 ) == 0 && sync.inserted == 3
+            && CONTAINER_SIZE( container ) == 3;
+        printResult( "ContainerSync first pass", ok );
+    }
+    if ( 1 ) { /** ContainerSync, changed, new and vanished rows */
+        bool ok;
+        kept = _Test_syncFind( container, 1 );
+        ok = _Test_syncPass( &sync, second, 5 ) == 1
+            && sync.unchanged == 1 && sync.updated == 1 && sync.inserted == 1
+            && sync.deleted == 1 && CONTAINER_SIZE( container ) == 3
+            && _Test_syncFind( container, 1 ) == kept /* not reallocated */
+            && _Test_syncFind( container, 2 )->value == 21
+            && _Test_syncFind( container, 3 ) == NULL
+            && _Test_syncFind( container, 4 )->value == 40;
+        printResult( "ContainerSync generation diff", ok );
+    }
+    if ( 1 ) { /** ContainerSync, no rows */
+        bool ok = _Test_syncPass( &sync, NULL, 0 ) == 3 && CONTAINER_SIZE( container ) == 0;
+        printResult( "ContainerSync empty pass", ok );
+    }
+    if ( 1 ) { /** ContainerSync, failed pass */
+        bool ok = _Test_syncPass( &sync, first, 4 ) == 0 && CONTAINER_SIZE( container ) == 3;
+        ContainerSync_begin( &sync );
+        ok = ok && ContainerSync_abort( &sync ) == 3 && CONTAINER_SIZE( container ) == 0
+            && _Test_syncPass( &sync, first, 4 ) == 0 && sync.inserted == 3;
+        printResult( "ContainerSync aborted pass", ok );
+    }
+    CONTAINER_CLEAR( container, _Test_syncRelease, NULL );
+    CONTAINER_FREE( container );
+}
+
+static bool
+_Test_writeFile( const char* path, const char* contents )
+{
+    FILE* f = fopen( path, "w" );
+
+    if ( f == NULL )
+        return false;
+    fputs( contents, f );
+    return fclose( f ) == 0;
+}
+
+void Test_ProcFile()
+{
+    static char path[] = "/tmp/testProcFileXXXXXX";
+    static const char* const names[] = { "InErrors", "Forwarding", "Missing" };
+    unsigned long long values[ 3 ] = { 0, 0, 0 }, value;
+    uint64_t found = 0;
+    ProcFile *file, *again;
+    u_int generation;
+    int fd;
+
+    printf( "\n-----[ ProcFile ]----- \n\n" );
+
+    fd = mkstemp( path );
+    if ( fd < 0 ) {
+        printResult( "ProcFile", false );
+        return;
+    }
+    close( fd );
+    _Test_writeFile( path, "Ip: Forwarding DefaultTTL InErrors\n"
+                           "Ip: 1 64 7\n"
+                           "MemTotal:     16309560 kB\n" );
+
+    file = ProcFile_shared( path );
+    again = ProcFile_shared( path );
+
+    if ( 1 ) { /** ProcFile_shared */
+        bool ok = file != NULL && file == again;
+        printResult( "ProcFile_shared", ok );
+    }
+    if ( 1 ) { /** ProcFile_refresh: one read per load generation */
+        bool ok = ProcFile_refresh( file, 7 ) == ErrorCode_SUCCESS;
+        generation = file->generation;
+        _Test_writeFile( path, "Ip: Forwarding DefaultTTL InErrors\n"
+                               "Ip: 2 64 9\n"
+                               "MemTotal:     16309561 kB\n" );
+        ok = ok && ProcFile_refresh( again, 7 ) == ErrorCode_SUCCESS
+            && file->generation == generation
+            && ProcFile_refresh( again, 8 ) == ErrorCode_SUCCESS
+            && file->generation == generation + 1
+            && ProcFile_refresh( again, 0 ) == ErrorCode_SUCCESS
+            && ProcFile_refresh( again, 0 ) == ErrorCode_SUCCESS
+            && file->generation == generation + 3;
+        printResult( "ProcFile_refresh", ok );
+    }
+    if ( 1 ) { /** ProcFile_headerFields: columns by name */
+        bool ok = ProcFile_headerFields( file, "Ip", names, 3, values, &found ) == 2
+            && values[ 0 ] == 9 && values[ 1 ] == 2 && values[ 2 ] == 0 && found == 3;
+        printResult( "ProcFile_headerFields", ok );
+    }
+    if ( 1 ) { /** ProcFile_keyedValue */
+        bool ok = ProcFile_keyedValue( file, "MemTotal", &value ) == ErrorCode_SUCCESS
+            && value == 16309561
+            && ProcFile_keyedValue( file, "MemFree", &value ) != ErrorCode_SUCCESS;
+        printResult( "ProcFile_keyedValue", ok );
+    }
+    ProcFile_close( file );
+    unlink( path );
+}
+
+/*
+ * What the AgentX builder made of the PDUs of _Test_agentxPdu() before it
+ * encoded variable lists in one go
+ */
+static const u_char _Test_getbulk[] = {
+    0x01, 0x07, 0x10, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x09,
+    0x00, 0x00, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x50, 0x00, 0x01, 0x00, 0x05,
+    0x06, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0a,
+    0x00, 0x00, 0x00, 0x03, 0x06, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x04, 0x03, 0x04, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x86, 0x9f, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00,
+};
+static const u_char _Test_response[] = {
+    0x01, 0x12, 0x10, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x09,
+    0x00, 0x00, 0x00, 0x0b, 0x00, 0x00, 0x01, 0x04, 0x00, 0x00, 0x04, 0xd2,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x06, 0x02, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x03,
+    0xff, 0xff, 0xff, 0xfb, 0x00, 0x41, 0x00, 0x00, 0x06, 0x02, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x04,
+    0xee, 0x6b, 0x28, 0x00, 0x00, 0x04, 0x00, 0x00, 0x03, 0x04, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x86, 0x9f, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x05, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x00, 0x00, 0x00,
+    0x00, 0x06, 0x00, 0x00, 0x06, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x03, 0x03, 0x04, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x86, 0x9f, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x46, 0x00, 0x00, 0x06, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x04, 0x12, 0x34, 0x56, 0x78,
+    0x9a, 0xbc, 0xde, 0xf0, 0x00, 0x40, 0x00, 0x00, 0x03, 0x04, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x86, 0x9f, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x04, 0x0a, 0x00, 0x00, 0x01, 0x00, 0x82, 0x00, 0x00,
+    0x06, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0a,
+    0x00, 0x00, 0x00, 0x03,
+};
+static const u_char _Test_testset[] = {
+    0x01, 0x08, 0x18, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x09,
+    0x00, 0x00, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x00, 0x00, 0x03,
+    0x63, 0x74, 0x78, 0x00, 0x00, 0x02, 0x00, 0x00, 0x06, 0x02, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x03,
+    0xff, 0xff, 0xff, 0xfb,
+};
+
+static const oid _Test_oidA[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 3 };
+static const oid _Test_oidB[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 4 };
+static const oid _Test_oidC[] = { 1, 3, 6, 1, 4, 1, 99999, 1 };
+
+static Types_Pdu*
+_Test_agentxPdu( int command, int byteOrder )
+{
+    Types_Pdu* pdu = Client_pduCreate( command );
+    int integer = -5;
+    u_int counter = 4000000000u;
+    Counter64 counter64 = { 0x12345678, 0x9abcdef0 };
+
+    pdu->version = AGENTX_VERSION_1;
+    pdu->flags = byteOrder;
+    pdu->sessid = 7;
+    pdu->transid = 9;
+    pdu->reqid = 11;
+    pdu->errstat = 0;
+    pdu->errindex = 0;
+    switch ( command ) {
+    case AGENTX_MSG_GETBULK:
+        pdu->non_repeaters = 1;
+        pdu->max_repetitions = 5;
+        Api_pduAddVariable( pdu, _Test_oidA, 11, asnPRIV_INCL_RANGE, _Test_oidB, sizeof( _Test_oidB ) );
+        Api_pduAddVariable( pdu, _Test_oidC, 8, asnPRIV_EXCL_RANGE, NULL, 0 );
+        break;
+    case AGENTX_MSG_RESPONSE:
+        pdu->time = 1234;
+        Api_pduAddVariable( pdu, _Test_oidA, 11, asnINTEGER, &integer, 4 );
+        Api_pduAddVariable( pdu, _Test_oidB, 11, asnCOUNTER, &counter, 4 );
+        Api_pduAddVariable( pdu, _Test_oidC, 8, asnOCTET_STR, "hello", 5 );
+        Api_pduAddVariable( pdu, _Test_oidA, 11, asnOBJECT_ID, _Test_oidC, sizeof( _Test_oidC ) );
+        Api_pduAddVariable( pdu, _Test_oidB, 11, asnCOUNTER64, &counter64, sizeof( counter64 ) );
+        Api_pduAddVariable( pdu, _Test_oidC, 8, asnIPADDRESS, "\12\0\0\1", 4 );
+        Api_pduAddVariable( pdu, _Test_oidA, 11, PRIOT_ENDOFMIBVIEW, NULL, 0 );
+        break;
+    case AGENTX_MSG_TESTSET:
+        pdu->flags |= AGENTX_MSG_FLAG_NON_DEFAULT_CONTEXT;
+        pdu->community = ( u_char* )strdup( "ctx" );
+        pdu->communityLen = 3;
+        Api_pduAddVariable( pdu, _Test_oidA, 11, asnINTEGER, &integer, 4 );
+        break;
+    }
+    return pdu;
+}
+
+/*
+ * Whether the varbinds b were decoded from are a; a search range left open
+ * comes back ending at the null OID
+ */
+static bool
+_Test_sameVars( const VariableList* a, const VariableList* b )
+{
+    static const oid nullOid[] = { 0, 0 };
+    const u_char* value;
+    size_t valueLength;
+
+    for ( ; a && b; a = a->next, b = b->next ) {
+        value = a->value.string;
+        valueLength = a->valueLength;
+        if ( ( a->type == asnPRIV_INCL_RANGE || a->type == asnPRIV_EXCL_RANGE )
+            && valueLength == 0 ) {
+            value = ( const u_char* )nullOid;
+            valueLength = sizeof( nullOid );
+        }
+        if ( a->type != b->type || valueLength != b->valueLength
+            || Api_oidEquals( a->name, a->nameLength, b->name, b->nameLength ) != 0
+            || ( valueLength && memcmp( value, b->value.string, valueLength ) != 0 ) )
+            return false;
+    }
+    return a == NULL && b == NULL;
+}
+
+static bool
+_Test_samePdu( const Types_Pdu* a, const Types_Pdu* b )
+{
+    return a->command == b->command && a->sessid == b->sessid
+        && a->transid == b->transid && a->reqid == b->reqid
+        && ( a->command != AGENTX_MSG_GETBULK
+               || ( a->non_repeaters == b->non_repeaters
+                      && a->max_repetitions == b->max_repetitions ) )
+        && ( a->command != AGENTX_MSG_RESPONSE || a->time == b->time )
+        && a->communityLen == b->communityLen
+        && ( a->communityLen == 0 || memcmp( a->community, b->community, a->communityLen ) == 0 )
+        && _Test_sameVars( a->variables, b->variables );
+}
+
+void Test_Agentx()
+{
+    static const struct {
+        int command;
+        const u_char* packet;
+        size_t len;
+    } golden[] = {
+        { AGENTX_MSG_GETBULK, _Test_getbulk, sizeof( _Test_getbulk ) },
+        { AGENTX_MSG_RESPONSE, _Test_response, sizeof( _Test_response ) },
+        { AGENTX_MSG_TESTSET, _Test_testset, sizeof( _Test_testset ) },
+    };
+    Types_Session session;
+    Types_Pdu *pdu, *parsed;
+    u_char* buf = NULL;
+    size_t bufLen = 0, outLen;
+    int i, order;
+
+    printf( "\n-----[ AgentX ]----- \n\n" );
+
+    memset( &session, 0, sizeof( session ) );
+    session.version = AGENTX_VERSION_1;
+
+    if ( 1 ) { /** Protocol_reallocBuild */
+        bool ok = true;
+        for ( i = 0; i < 3; i++ ) {
+            pdu = _Test_agentxPdu( golden[ i ].command, AGENTX_FLAGS_NETWORK_BYTE_ORDER );
+            outLen = 0;
+            if ( Protocol_reallocBuild( &session, pdu, &buf, &bufLen, &outLen ) != 0
+                || outLen != golden[ i ].len || memcmp( buf, golden[ i ].packet, outLen ) != 0 )
+                ok = false;
+            Api_freePdu( pdu );
+        }
+        printResult( "Protocol_reallocBuild", ok );
+    }
+    if ( 1 ) { /** Protocol_parse */
+        bool ok = true;
+        for ( i = 0; i < 3; i++ ) {
+            pdu = _Test_agentxPdu( golden[ i ].command, AGENTX_FLAGS_NETWORK_BYTE_ORDER );
+            parsed = Client_pduCreate( 0 );
+            memcpy( buf, golden[ i ].packet, golden[ i ].len );
+            if ( Protocol_parse( &session, parsed, buf, golden[ i ].len ) != 0
+                || !_Test_samePdu( pdu, parsed ) )
+                ok = false;
+            Api_freePdu( parsed );
+            Api_freePdu( pdu );
+        }
+        printResult( "Protocol_parse", ok );
+    }
+    if ( 1 ) { /** encode -> decode, both byte orders */
+        bool ok = true;
+        for ( order = 0; order <= AGENTX_FLAGS_NETWORK_BYTE_ORDER; order += AGENTX_FLAGS_NETWORK_BYTE_ORDER ) {
+            for ( i = 0; i < 3; i++ ) {
+                pdu = _Test_agentxPdu( golden[ i ].command, order );
+                parsed = Client_pduCreate( 0 );
+                outLen = 0;
+                if ( Protocol_reallocBuild( &session, pdu, &buf, &bufLen, &outLen ) != 0
+                    || Protocol_parse( &session, parsed, buf, outLen ) != 0
+                    || !_Test_samePdu( pdu, parsed ) )
+                    ok = false;
+                Api_freePdu( parsed );
+                Api_freePdu( pdu );
+            }
+        }
+        printResult( "AgentX encode/decode", ok );
+    }
+    if ( 1 ) { /** truncated varbinds */
+        bool ok = true;
+        size_t cut;
+        /* the last varbind, the context-less TESTSET's integer, cut short */
+        for ( cut = sizeof( _Test_testset ) - 3; cut < sizeof( _Test_testset ); cut++ ) {
+            memcpy( buf, _Test_testset, cut );
+            buf[ 19 ] = cut - 20;
+            parsed = Client_pduCreate( 0 );
+            if ( Protocol_parse( &session, parsed, buf, cut ) == 0 )
+                ok = false;
+            Api_freePdu( parsed );
+        }
+        printResult( "AgentX truncated packet", ok );
+    }
+    free( buf );
+}
+
+/*
+ * A GETBULK request as the agent sets it up: repeat + 1 varbinds to fill,
+ * all named as the request to start with
+ */
+static RequestInfo*
+_Test_bulkRequest( RequestInfo* prev, int repeat, const oid* name, size_t len,
+    oid* rangeEnd, size_t rangeEndLen )
+{
+    RequestInfo* request = ( RequestInfo* )calloc( 1, sizeof( RequestInfo ) );
+    VariableList** vb = &request->requestvb;
+    int i;
+
+    for ( i = 0; i <= repeat; i++ ) {
+        *vb = ( VariableList* )calloc( 1, sizeof( VariableList ) );
+        Client_setVarObjid( *vb, name, len );
+        vb = &( *vb )->next;
+    }
+    request->requestvb_start = request->requestvb;
+    request->repeat = request->orig_repeat = repeat;
+    request->range_end = rangeEnd;
+    request->range_end_len = rangeEndLen;
+    if ( prev ) {
+        prev->next = request;
+        request->index = prev->index + 1;
+    }
+    return request;
+}
+
+static void
+_Test_freeBulkRequests( RequestInfo* requests )
+{
+    RequestInfo* next;
+
+    for ( ; requests; requests = next ) {
+        next = requests->next;
+        Api_freeVarbind( requests->requestvb_start );
+        free( requests );
+    }
+}
+
+static bool
+_Test_isVar( const VariableList* var, int type, const oid* name, size_t len )
+{
+    return var && var->type == type && Api_oidEquals( var->name, var->nameLength, name, len ) == 0;
+}
+
+void Test_MasterBulk()
+{
+    static oid sysDescr[] = { 1, 3, 6, 1, 2, 1, 1, 1 };
+    static oid sysDescr0[] = { 1, 3, 6, 1, 2, 1, 1, 1, 0 };
+    static oid ifDescr[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2 };
+    static oid ifType[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 3 };
+    static oid ifMtu[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 4 };
+    static oid ifDescr1[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2, 1 };
+    static oid ifDescr2[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2, 2 };
+    static oid ifDescr3[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2, 3 };
+    static oid ifType1[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 3, 1 };
+    static oid ifMtu1[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 4, 1 };
+    static oid ifMtu2[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 4, 2 };
+    RequestInfo *requests, *ifDescrs, *ifTypes;
+    Types_Pdu* response;
+    long value = 1;
+
+    printf( "\n-----[ AgentX GetBulk ]----- \n\n" );
+
+    /*
+     * a non-repeater, and two columns repeated twice, each registered on
+     * its own
+     */
+    requests = _Test_bulkRequest( NULL, 0, sysDescr, 8, ifDescr, 10 );
+    ifDescrs = _Test_bulkRequest( requests, 2, ifDescr, 10, ifType, 10 );
+    ifTypes = _Test_bulkRequest( ifDescrs, 2, ifType, 10, ifMtu, 10 );
+
+    if ( 1 ) { /** Master_mergeBulkResponse, full rows */
+        bool ok;
+        response = Client_pduCreate( AGENTX_MSG_RESPONSE );
+        Api_pduAddVariable( response, sysDescr0, 9, asnOCTET_STR, "x", 1 );
+        Api_pduAddVariable( response, ifDescr1, 11, asnOCTET_STR, "lo", 2 );
+        Api_pduAddVariable( response, ifType1, 11, asnINTEGER, &value, sizeof( value ) );
+        Api_pduAddVariable( response, ifDescr2, 11, asnOCTET_STR, "eth0", 4 );
+        Api_pduAddVariable( response, ifMtu1, 11, asnINTEGER, &value, sizeof( value ) );
+        Api_pduAddVariable( response, ifDescr3, 11, asnOCTET_STR, "eth1", 4 );
+        Api_pduAddVariable( response, ifMtu2, 11, asnINTEGER, &value, sizeof( value ) );
+        ok = Master_mergeBulkResponse( requests, response->variables ) == ErrorCode_SUCCESS
+            && _Test_isVar( requests->requestvb, asnOCTET_STR, sysDescr0, 9 )
+            /* ifDescr: three rows, the cache filled */
+            && ifDescrs->repeat == 0 && ifDescrs->requestvb == ifDescrs->requestvb_start->next->next
+            && _Test_isVar( ifDescrs->requestvb_start, asnOCTET_STR, ifDescr1, 11 )
+            && _Test_isVar( ifDescrs->requestvb_start->next, asnOCTET_STR, ifDescr2, 11 )
+            && _Test_isVar( ifDescrs->requestvb, asnOCTET_STR, ifDescr3, 11 )
+            /* ifType: past its range at the second row, left at its end */
+            && ifTypes->repeat == 1 && ifTypes->requestvb == ifTypes->requestvb_start->next
+            && _Test_isVar( ifTypes->requestvb_start, asnINTEGER, ifType1, 11 )
+            && _Test_isVar( ifTypes->requestvb, asnNULL, ifMtu, 10 )
+            && ifTypes->inclusive == 2;
+        Api_freePdu( response );
+        printResult( "Master_mergeBulkResponse", ok );
+    }
+    _Test_freeBulkRequests( requests );
+
+    requests = _Test_bulkRequest( NULL, 0, sysDescr, 8, ifDescr, 10 );
+    ifDescrs = _Test_bulkRequest( requests, 2, ifDescr, 10, ifType, 10 );
+
+    if ( 1 ) { /** Master_mergeBulkResponse, a short response */
+        bool ok;
+        response = Client_pduCreate( AGENTX_MSG_RESPONSE );
+        Api_pduAddVariable( response, sysDescr0, 9, asnOCTET_STR, "x", 1 );
+        Api_pduAddVariable( response, ifDescr1, 11, asnOCTET_STR, "lo", 2 );
+        ok = Master_mergeBulkResponse( requests, response->variables ) == ErrorCode_SUCCESS
+            /* moved on to the next slot, to be asked for again */
+            && ifDescrs->repeat == 1 && ifDescrs->requestvb == ifDescrs->requestvb_start->next
+            && _Test_isVar( ifDescrs->requestvb, asnPRIV_RETRY, ifDescr1, 11 );
+        Api_freePdu( response );
+        printResult( "Master_mergeBulkResponse short", ok );
+    }
+    if ( 1 ) { /** Master_mergeBulkResponse, no first row */
+        bool ok;
+        response = Client_pduCreate( AGENTX_MSG_RESPONSE );
+        Api_pduAddVariable( response, sysDescr0, 9, asnOCTET_STR, "x", 1 );
+        ok = Master_mergeBulkResponse( requests, response->variables ) != ErrorCode_SUCCESS;
+        Api_freePdu( response );
+        printResult( "Master_mergeBulkResponse missing row", ok );
+    }
+    _Test_freeBulkRequests( requests );
+}
+
+/*
+ * A snapshot as MasterCache_store() leaves it: count instances .i.0 of
+ * subtree, sorted, pushed by sessid
+ */
+static MasterSnapshot*
+_Test_snapshot( const oid* subtree, size_t len, int count, long sessid, int ttl )
+{
+    MasterSnapshot* snap = ( MasterSnapshot* )calloc( 1, sizeof( MasterSnapshot ) );
+    Types_Pdu* pdu = Client_pduCreate( AGENTX_MSG_CACHE_PUSH );
+    oid name[ TYPES_MAX_OID_LEN ];
+    long value;
+    int i;
+
+    memcpy( snap->subtree, subtree, len * sizeof( oid ) );
+    snap->subtreeLen = len;
+    snap->sessid = sessid;
+    snap->vars = ( VariableList** )calloc( count, sizeof( VariableList* ) );
+    memcpy( name, subtree, len * sizeof( oid ) );
+    for ( i = 0; i < count; i++ ) {
+        name[ len ] = i + 1;
+        name[ len + 1 ] = 0;
+        value = i + 1;
+        Api_pduAddVariable( pdu, name, len + 2, asnINTEGER, &value, sizeof( value ) );
+    }
+    while ( pdu->variables ) {
+        snap->vars[ snap->count ] = pdu->variables;
+        pdu->variables = pdu->variables->next;
+        snap->vars[ snap->count++ ]->next = NULL;
+    }
+    Api_freePdu( pdu );
+    Time_getMonotonicClock( &snap->expires );
+    snap->expires.tv_sec += ttl;
+    return snap;
+}
+
+static VariableList*
+_Test_cacheFind( MasterSession* ms, Subtree* subtree, int mode, const oid* name,
+    size_t len, int inclusive, oid* rangeEnd, size_t rangeEndLen )
+{
+    VariableList var;
+    RequestInfo request;
+
+    memset( &var, 0, sizeof( var ) );
+    memset( &request, 0, sizeof( request ) );
+    var.name = ( oid* )name;
+    var.nameLength = len;
+    request.requestvb = &var;
+    request.subtree = subtree;
+    request.inclusive = inclusive;
+    request.range_end = rangeEnd;
+    request.range_end_len = rangeEndLen;
+    return MasterCache_find( ms, mode, &request );
+}
+
+void Test_MasterCache()
+{
+    static oid enterprise[] = { 1, 3, 6, 1, 4, 1, 99 };
+    static oid table[] = { 1, 3, 6, 1, 4, 1, 99, 1 };
+    static oid column1[] = { 1, 3, 6, 1, 4, 1, 99, 1, 1, 0 };
+    static oid column2[] = { 1, 3, 6, 1, 4, 1, 99, 1, 2, 0 };
+    static oid column3[] = { 1, 3, 6, 1, 4, 1, 99, 1, 3, 0 };
+    static oid missing[] = { 1, 3, 6, 1, 4, 1, 99, 1, 2, 1 };
+    static oid column2End[] = { 1, 3, 6, 1, 4, 1, 99, 1, 2 };
+    Types_Session session, other;
+    Subtree subtree, otherSubtree;
+    MasterSession ms;
+    VariableList* var;
+
+    printf( "\n-----[ MasterCache ]----- \n\n" );
+
+    memset( &ms, 0, sizeof( ms ) );
+    memset( &session, 0, sizeof( session ) );
+    memset( &other, 0, sizeof( other ) );
+    session.sessid = 5;
+    other.sessid = 6;
+    memset( &subtree, 0, sizeof( subtree ) );
+    subtree.start_a = table;
+    subtree.start_len = 8;
+    subtree.session = &session;
+    otherSubtree = subtree;
+    otherSubtree.session = &other;
+    ms.snapshots = _Test_snapshot( table, 8, 3, 5, 60 );
+
+    if ( 1 ) { /** MasterCache_find, GET */
+        bool ok = ( var = _Test_cacheFind( &ms, &subtree, MODE_GET, column2, 10, 1, NULL, 0 ) ) != NULL
+            && *var->value.integer == 2
+            && _Test_cacheFind( &ms, &subtree, MODE_GET, missing, 10, 1, NULL, 0 ) == NULL;
+        printResult( "MasterCache_find GET", ok );
+    }
+    if ( 1 ) { /** MasterCache_find, GETNEXT */
+        bool ok = ( var = _Test_cacheFind( &ms, &subtree, MODE_GETNEXT, column1, 10, 0, NULL, 0 ) ) != NULL
+            && Api_oidEquals( var->name, var->nameLength, column2, 10 ) == 0
+            /* inclusive: the instance itself */
+            && ( var = _Test_cacheFind( &ms, &subtree, MODE_GETNEXT, column1, 10, 1, NULL, 0 ) ) != NULL
+            && Api_oidEquals( var->name, var->nameLength, column1, 10 ) == 0
+            /* before the registration: its first instance */
+            && ( var = _Test_cacheFind( &ms, &subtree, MODE_GETNEXT, enterprise, 7, 0, NULL, 0 ) ) != NULL
+            && Api_oidEquals( var->name, var->nameLength, column1, 10 ) == 0
+            /* what follows the snapshot isn't known */
+            && _Test_cacheFind( &ms, &subtree, MODE_GETNEXT, column3, 10, 0, NULL, 0 ) == NULL;
+        printResult( "MasterCache_find GETNEXT", ok );
+    }
+    if ( 1 ) { /** MasterCache_find, GETNEXT past the range end */
+        bool ok = _Test_cacheFind( &ms, &subtree, MODE_GETNEXT, column1, 10, 0, column2End, 9 ) == NULL
+            && _Test_cacheFind( &ms, &subtree, MODE_GETNEXT, column1, 10, 1, column2End, 9 ) != NULL;
+        printResult( "MasterCache_find range end", ok );
+    }
+    if ( 1 ) { /** MasterCache_find, another session's registration */
+        bool ok = _Test_cacheFind( &ms, &otherSubtree, MODE_GET, column2, 10, 1, NULL, 0 ) == NULL;
+        printResult( "MasterCache_find other session", ok );
+    }
+    if ( 1 ) { /** MasterCache_invalidate, MasterCache_dropSession, MasterCache_expire */
+        bool ok;
+        MasterCache_invalidate( &ms, column2, 10 );
+        ok = ms.snapshots == NULL;
+        ms.snapshots = _Test_snapshot( table, 8, 3, 5, 60 );
+        MasterCache_dropSession( &ms, 6 );
+        ok = ok && ms.snapshots != NULL;
+        MasterCache_dropSession( &ms, 5 );
+        ok = ok && ms.snapshots == NULL;
+        ms.snapshots = _Test_snapshot( table, 8, 3, 5, -1 );
+        MasterCache_expire( &ms );
+        ok = ok && ms.snapshots == NULL;
+        printResult( "MasterCache invalidation", ok );
+    }
+    MasterCache_free( &ms );
+}
+
+static void
+_Test_addRow( Types_Pdu* pdu, const oid* column, size_t len, oid index, int type )
+{
+    oid name[ TYPES_MAX_OID_LEN ];
+    long value = index;
+
+    memcpy( name, column, len * sizeof( oid ) );
+    name[ len ] = index;
+    if ( type == asnINTEGER )
+        Api_pduAddVariable( pdu, name, len + 1, asnINTEGER, &value, sizeof( value ) );
+    else
+        Api_pduAddVariable( pdu, name, len + 1, type, NULL, 0 );
+}
+
+/*
+ * the next of name the proxy would answer from its cache, checked
+ * against column.index
+ */
+static bool
+_Test_proxyNext( struct proxy_target* t, const oid* name, size_t len,
+    const oid* column, size_t columnLen, oid index )
+{
+    oid next[ TYPES_MAX_OID_LEN ];
+
+    memcpy( next, column, columnLen * sizeof( oid ) );
+    next[ columnLen ] = index;
+    return _Test_isVar( proxy_cache_find( t, MODE_GETNEXT, name, len ), asnINTEGER,
+        next, columnLen + 1 );
+}
+
+void Test_ProxyCache()
+{
+    static oid ifIndex[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 1 };
+    static oid ifType[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 3 };
+    static oid ifIndex1[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 1, 1 };
+    static oid ifIndex2[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 1, 2 };
+    static oid ifIndex3[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 1, 3 };
+    static oid ifType1[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 3, 1 };
+    static oid ifType2[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 3, 2 };
+    struct proxy_target* t = ( struct proxy_target* )calloc( 1, sizeof( struct proxy_target ) );
+    Types_Pdu *asked, *pdu;
+
+    printf( "\n-----[ ProxyCache ]----- \n\n" );
+
+    t->key = ( char* )"test";
+    t->ttl = 60;
+
+    /* a GETNEXT of ifIndex and ifType sent as a GETBULK of three rows;
+     * ifType ends after its second */
+    asked = Client_pduCreate( PRIOT_MSG_GETBULK );
+    Api_pduAddVariable( asked, ifIndex, 10, asnNULL, NULL, 0 );
+    Api_pduAddVariable( asked, ifType, 10, asnNULL, NULL, 0 );
+    pdu = Client_pduCreate( PRIOT_MSG_RESPONSE );
+    pdu->errstat = PRIOT_ERR_NOERROR;
+    _Test_addRow( pdu, ifIndex, 10, 1, asnINTEGER );
+    _Test_addRow( pdu, ifType, 10, 1, asnINTEGER );
+    _Test_addRow( pdu, ifIndex, 10, 2, asnINTEGER );
+    _Test_addRow( pdu, ifType, 10, 2, asnINTEGER );
+    _Test_addRow( pdu, ifIndex, 10, 3, asnINTEGER );
+    _Test_addRow( pdu, ifType, 10, 3, PRIOT_ENDOFMIBVIEW );
+    proxy_cache_response( t, PRIOT_MSG_GETBULK, asked->variables, 2, pdu );
+
+    if ( 1 ) { /** proxy_cache_response, GETBULK rows as GETNEXT answers */
+        bool ok = _Test_proxyNext( t, ifIndex, 10, ifIndex, 10, 1 )
+            && _Test_proxyNext( t, ifIndex1, 11, ifIndex, 10, 2 )
+            && _Test_proxyNext( t, ifIndex2, 11, ifIndex, 10, 3 )
+            && _Test_proxyNext( t, ifType, 10, ifType, 10, 1 )
+            && _Test_proxyNext( t, ifType1, 11, ifType, 10, 2 );
+        printResult( "proxy_cache_response GETBULK", ok );
+    }
+    if ( 1 ) { /** proxy_cache_find, what wasn't answered */
+        bool ok = proxy_cache_find( t, MODE_GETNEXT, ifIndex3, 11 ) == NULL
+            /* an exception isn't kept */
+            && proxy_cache_find( t, MODE_GETNEXT, ifType2, 11 ) == NULL
+            && proxy_cache_find( t, MODE_GET, ifIndex1, 11 ) == NULL
+            && t->ncached == 5;
+        printResult( "proxy_cache_find misses", ok );
+    }
+    if ( 1 ) { /** proxy_cache_response, GET and SET */
+        bool ok;
+        proxy_cache_response( t, PRIOT_MSG_GET, NULL, 6, pdu );
+        ok = _Test_isVar( proxy_cache_find( t, MODE_GET, ifIndex2, 11 ), asnINTEGER, ifIndex2, 11 )
+            && proxy_cache_find( t, MODE_GET, ifType2, 11 ) != NULL;
+        proxy_cache_response( t, PRIOT_MSG_SET, NULL, 0, pdu );
+        ok = ok && t->ncached == 0
+            && proxy_cache_find( t, MODE_GETNEXT, ifIndex, 10 ) == NULL;
+        printResult( "proxy_cache_response GET, SET", ok );
+    }
+    if ( 1 ) { /** proxy_cache_response, error responses */
+        bool ok;
+        pdu->errstat = PRIOT_ERR_GENERR;
+        proxy_cache_response( t, PRIOT_MSG_GETBULK, asked->variables, 2, pdu );
+        ok = t->ncached == 0;
+        printResult( "proxy_cache_response error", ok );
+    }
+    Api_freePdu( asked );
+    Api_freePdu( pdu );
+    free( t );
+}
+
+/*
+ * GETNEXTs of ten varbinds to a responder on the other end of a socket
+ * pair, encoded, sent, decoded and answered as master and subagent would
+ */
+void Test_AgentxRoundTrip()
+{
+    Types_Session session;
+    Types_Pdu* pdu;
+    u_char* buf = NULL;
+    size_t bufSize = 0;
+    int fd, i;
+    Types_PidT pid;
+    bool ok;
+
+    printf( "\n-----[ AgentX round trip ]----- \n\n" );
+
+    pid = AgentxPeer_start( &fd );
+    ok = pid > 0;
+
+    memset( &session, 0, sizeof( session ) );
+    session.version = AGENTX_VERSION_1;
+    pdu = Client_pduCreate( AGENTX_MSG_GETNEXT );
+    pdu->version = AGENTX_VERSION_1;
+    pdu->flags = AGENTX_FLAGS_NETWORK_BYTE_ORDER;
+    pdu->sessid = 7;
+    for ( i = 0; i < 10; i++ )
+        Api_pduAddVariable( pdu, _Test_oidA, 11, asnPRIV_EXCL_RANGE, _Test_oidB, sizeof( _Test_oidB ) );
+
+    for ( i = 0; ok && i < 3; i++ ) {
+        pdu->transid = pdu->reqid = i;
+        ok = AgentxPeer_roundTrip( fd, &session, pdu, &buf, &bufSize );
+    }
+    if ( pid > 0 )
+        AgentxPeer_stop( fd, pid );
+    Api_freePdu( pdu );
+    free( buf );
+    printResult( "AgentX round trip", ok );
+}
+
+/*
+ * Reads from a stream transport until want bytes came, the stream ended,
+ * or nothing came for two seconds
+ */
+static int
+_Test_transportRecv( Transport_Transport* t, char* buf, int want )
+{
+    struct timeval timeout;
+    fd_set fds;
+    void* opaque;
+    int olength, got = 0, n;
+
+    while ( got < want ) {
+        FD_ZERO( &fds );
+        FD_SET( t->sock, &fds );
+        timeout.tv_sec = 2;
+        timeout.tv_usec = 0;
+        if ( select( t->sock + 1, &fds, NULL, NULL, &timeout ) <= 0 )
+            break;
+        t->flags &= ~TRANSPORT_FLAG_EMPTY_PKT;
+        n = t->f_recv( t, buf + got, want - got, &opaque, &olength );
+        if ( n < 0 || ( n == 0 && !( t->flags & TRANSPORT_FLAG_EMPTY_PKT ) ) )
+            break;
+        got += n;
+    }
+    return got;
+}
+
+/*
+ * A child connects to a listening shm transport, sends "ping" and waits
+ * for "pong"
+ */
+void Test_ShmDomain()
+{
+    char dir[] = "/tmp/shmTestXXXXXX", buf[ 8 ];
+    struct sockaddr_un addr;
+    Transport_Transport *listener, *conn = NULL, *client;
+    void* opaque = NULL;
+    int olength = 0, status = -1, ok;
+    Types_PidT pid;
+
+    printf( "\n-----[ ShmDomain ]----- \n\n" );
+
+    if ( mkdtemp( dir ) == NULL ) {
+        printResult( "ShmDomain", false );
+        return;
+    }
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    snprintf( addr.sun_path, sizeof( addr.sun_path ), "%s/master", dir );
+
+    listener = ShmDomain_transport( &addr, 1 );
+    if ( 1 ) { /** ShmDomain_transport, listening */
+        bool ok = listener != NULL && ( listener->flags & TRANSPORT_FLAG_LISTEN );
+        printResult( "ShmDomain listen", ok );
+    }
+    if ( listener == NULL ) {
+        rmdir( dir );
+        return;
+    }
+
+    pid = fork();
+    if ( pid == 0 ) {
+        client = ShmDomain_transport( &addr, 0 );
+        ok = client != NULL
+            && client->f_send( client, "ping", 4, &opaque, &olength ) == 4
+            && _Test_transportRecv( client, buf, 4 ) == 4 && memcmp( buf, "pong", 4 ) == 0;
+        if ( client != NULL ) {
+            client->f_close( client );
+            Transport_free( client );
+        }
+        _exit( ok ? 0 : 1 );
+    }
+
+    if ( 1 ) { /** ShmDomain, accept, recv and send */
+        bool ok = pid > 0;
+        int sock = ok ? listener->f_accept( listener ) : -1;
+
+        if ( sock >= 0 && ( conn = Transport_copy( listener ) ) != NULL ) {
+            conn->sock = sock;
+            conn->flags &= ~TRANSPORT_FLAG_LISTEN;
+        }
+        ok = ok && conn != NULL
+            && _Test_transportRecv( conn, buf, 4 ) == 4 && memcmp( buf, "ping", 4 ) == 0
+            && conn->f_send( conn, "pong", 4, &opaque, &olength ) == 4;
+        if ( pid > 0 )
+            waitpid( pid, &status, 0 );
+        ok = ok && WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+        printResult( "ShmDomain send and recv", ok );
+    }
+    if ( 1 ) { /** ShmDomain, the peer closed */
+        bool ok = conn != NULL && _Test_transportRecv( conn, buf, 1 ) == 0
+            && !( conn->flags & TRANSPORT_FLAG_EMPTY_PKT );
+        printResult( "ShmDomain end of stream", ok );
+    }
+    if ( 1 ) { /** ShmDomain, close */
+        bool ok = ( conn == NULL || conn->f_close( conn ) == 0 )
+            && listener->f_close( listener ) == 0 && access( addr.sun_path, F_OK ) != 0;
+        printResult( "ShmDomain close", ok );
+    }
+    Transport_free( conn );
+    Transport_free( listener );
+    rmdir( dir );
+}
+
 int main()
 {
     printf( "-----[ Start Test ]----- \n\n" );
 
     Test_String();
+    Test_ContainerSync();
+    Test_ProcFile();
+    Test_Agentx();
+    Test_AgentxRoundTrip();
+    Test_MasterBulk();
+    Test_MasterCache();
+    Test_ProxyCache();
+    Test_ShmDomain();
 
     printf( "\n-----[ End Test ]----- \n\n" );
 
@@ -10,10 +10,12 @@ QMAKE_CFLAGS += -Werror=implicit-function-declaration
 
 
 SOURCES += \
+    AgentxPeer.c \
     Test.c
 
 
 HEADERS += \
+    AgentxPeer.h \
     Test.h
 
 unix:!macx: LIBS += -L$$OUT_PWD/../Core/ -lcore